@@ -0,0 +1,84 @@
+--[[
+   Folds evaluation-mode batch normalization into the preceding convolution.
+
+   In evaluation mode nn.SpatialBatchNormalization is a fixed affine transform
+   per channel, y = (x - running_mean) / sqrt(running_var + eps) * weight + bias,
+   so it can be baked into the weight and bias of the convolution that produces
+   x. cunn.foldBatchNormalization(model) does this for every convolution
+   directly followed by a batch normalization inside an nn.Sequential, and
+   removes the batch normalization layers it folded. The folded model computes
+   the same outputs without the extra read and write of every activation.
+
+   Only modules in evaluation mode are folded: folding freezes the running
+   statistics, so the model should not be trained afterwards.
+]]--
+local THNN = require 'nn.THNN'
+
+cunn = cunn or {}
+
+local convolutions = {
+   ['nn.SpatialConvolution'] = true,
+   ['nn.SpatialConvolutionMM'] = true,
+   ['nn.SpatialDilatedConvolution'] = true,
+}
+
+local function canFold(conv, bn)
+   return convolutions[torch.type(conv)]
+      and torch.type(bn) == 'nn.SpatialBatchNormalization'
+      and not bn.train
+      and bn.running_mean:nElement() == conv.nOutputPlane
+end
+
+local function fold(conv, bn)
+   if not conv.bias then
+      conv.bias = conv.weight.new(conv.nOutputPlane):zero()
+      conv.gradBias = conv.weight.new(conv.nOutputPlane):zero()
+   end
+
+   if torch.type(conv.weight) == 'torch.CudaTensor' then
+      conv.weight.THNN.BatchNormalization_foldConvolution(
+         conv.weight:cdata(),
+         conv.bias:cdata(),
+         THNN.optionalTensor(bn.weight),
+         THNN.optionalTensor(bn.bias),
+         bn.running_mean:cdata(),
+         bn.running_var:cdata(),
+         bn.eps)
+      return
+   end
+
+   -- other tensor types: the same arithmetic with tensor operations
+   local scale = bn.running_var:clone():add(bn.eps):pow(-0.5)
+   if bn.weight then
+      scale:cmul(bn.weight)
+   end
+   local weight = conv.weight:view(conv.nOutputPlane, -1)
+   weight:cmul(scale:view(conv.nOutputPlane, 1):expandAs(weight))
+   conv.bias:add(-1, bn.running_mean):cmul(scale)
+   if bn.bias then
+      conv.bias:add(bn.bias)
+   end
+end
+
+-- Returns the model and the number of batch normalization layers folded
+function cunn.foldBatchNormalization(model)
+   local count = 0
+   local function visit(module)
+      if torch.type(module) == 'nn.Sequential' then
+         local i = 1
+         while i < #module.modules do
+            if canFold(module.modules[i], module.modules[i + 1]) then
+               fold(module.modules[i], module.modules[i + 1])
+               module:remove(i + 1)
+               count = count + 1
+            end
+            i = i + 1
+         end
+      end
+      for _, child in ipairs(module.modules or {}) do
+         visit(child)
+      end
+   end
+   visit(model)
+   return model, count
+end
@@ -0,0 +1,110 @@
+--[[
+   Fuses pointwise activations into the preceding convolution for inference.
+
+   A SpatialConvolution followed by ReLU, Threshold, ELU or LeakyReLU makes
+   one pass over the activation tensor for the convolution (bias included)
+   and one for the activation. cunn.fuseConvolutionActivation(model) applies
+   the activation in the convolution's epilogue instead, for every such pair
+   inside an nn.Sequential: the convolution is converted in place to
+   nn.SpatialConvolutionActivation or nn.SpatialConvolutionMMActivation (see
+   ModuleVariants.lua) and the activation module is removed. Batch
+   normalization between the two is folded into the convolution first (see
+   cunn.foldBatchNormalization), so Conv -> BN -> ReLU becomes a single
+   module.
+
+   Only convolutions in evaluation mode are fused. Fused convolutions run on
+   CUDA inputs only and have no backward pass, so the model should not be
+   trained afterwards.
+]]--
+local THNN = require 'nn.THNN'
+local ModuleVariants = require 'cunn.ModuleVariants'
+
+cunn = cunn or {}
+
+-- Fused variant of each convolution class
+local convolutions = {
+   ['nn.SpatialConvolution'] = 'nn.SpatialConvolutionActivation',
+   ['nn.SpatialConvolutionMM'] = 'nn.SpatialConvolutionMMActivation',
+}
+
+-- Activation kinds of THNN_CudaSpatialConvolutionMM_updateOutputActivation;
+-- keep in sync with ConvActivationKind in lib/THCUNN/conv_activation.h
+local ACTIVATION = {
+   THRESHOLD = 1,
+   ELU = 2,
+   LEAKY_RELU = 3,
+}
+
+-- Kind and (a, b) parameters of each module type
+local activations = {
+   ['nn.ReLU'] = function(m) return ACTIVATION.THRESHOLD, m.threshold, m.val end,
+   ['nn.Threshold'] = function(m) return ACTIVATION.THRESHOLD, m.threshold, m.val end,
+   ['nn.ELU'] = function(m) return ACTIVATION.ELU, m.alpha, 0 end,
+   ['nn.LeakyReLU'] = function(m) return ACTIVATION.LEAKY_RELU, m.negval, 0 end,
+}
+
+local function canFuse(conv, activation)
+   return convolutions[torch.type(conv)]
+      and not conv.train
+      and torch.type(conv.weight) == 'torch.CudaTensor'
+      and activations[torch.type(activation)]
+end
+
+local function fusedUpdateOutput(self, input)
+   assert(torch.type(input) == 'torch.CudaTensor',
+          torch.type(self) .. ' expects a torch.CudaTensor input')
+   self.finput = self.finput or input.new()
+   self.fgradInput = self.fgradInput or input.new()
+   input = input:contiguous()
+   local act = self.fusedActivation
+   input.THNN.SpatialConvolutionMM_updateOutputActivation(
+      input:cdata(),
+      self.output:cdata(),
+      self.weight:cdata(),
+      THNN.optionalTensor(self.bias),
+      self.finput:cdata(),
+      self.fgradInput:cdata(),
+      self.kW, self.kH,
+      self.dW, self.dH,
+      self.padW or 0, self.padH or 0,
+      act.kind, act.a, act.b)
+   return self.output
+end
+
+local function noBackward(self)
+   error(torch.type(self) .. ' supports inference only')
+end
+
+for name, fusedName in pairs(convolutions) do
+   local class = ModuleVariants.define(fusedName, name)
+   class.updateOutput = fusedUpdateOutput
+   class.updateGradInput = noBackward
+   class.accGradParameters = noBackward
+end
+
+-- Returns the model and the number of activation layers fused
+function cunn.fuseConvolutionActivation(model)
+   cunn.foldBatchNormalization(model)
+   local count = 0
+   local function visit(module)
+      if torch.type(module) == 'nn.Sequential' then
+         local i = 1
+         while i < #module.modules do
+            local conv, activation = module.modules[i], module.modules[i + 1]
+            if canFuse(conv, activation) then
+               local kind, a, b = activations[torch.type(activation)](activation)
+               conv.fusedActivation = {kind = kind, a = a, b = b}
+               ModuleVariants.convert(conv, convolutions[torch.type(conv)])
+               module:remove(i + 1)
+               count = count + 1
+            end
+            i = i + 1
+         end
+      end
+      for _, child in ipairs(module.modules or {}) do
+         visit(child)
+      end
+   end
+   visit(model)
+   return model, count
+end
@@ -12,6 +12,10 @@
    For best performance, install NCCL:
     https://github.com/NVIDIA/nccl
     https://github.com/ngimel/nccl.torch
+
+   Without NCCL, the gradients are summed and the parameters broadcast with
+   peer copies. The default 'star' reduction moves every replica through the
+   first GPU; 'ring' and 'tree' spread the traffic over all the links.
 ]]--
 local DataParallelTable, parent = torch.class('nn.DataParallelTable', 'nn.Container')
 
@@ -41,11 +45,83 @@ local function waitForDevice(dst, src)
    end
 end
 
-function DataParallelTable:__init(dimension, flattenParams, usenccl)
+-- Makes stream wait for waitOn on each of the devices
+local function streamWaitFor(devices, stream, waitOn)
+   for _, device in ipairs(devices) do
+      cutorch.setDevice(device)
+      cutorch.streamWaitFor(stream, {waitOn})
+   end
+end
+
+local function setStream(devices, stream)
+   for _, device in ipairs(devices) do
+      cutorch.setDevice(device)
+      cutorch.setStream(stream)
+   end
+end
+
+-- Stream the bucketed reductions run on, reserved after the user's streams
+local commStream
+local function getCommStream()
+   if not commStream or cutorch.getNumStreams() < commStream
+      or cutorch.getStream() == commStream then
+      commStream = cutorch.getNumStreams() + 1
+      cutorch.reserveStreams(commStream)
+   end
+   return commStream
+end
+
+-- Splits the backward pass of module into steps in execution order. Nested
+-- nn.Sequential containers are unrolled; every other module is one step of
+-- {module, input}.
+local function backwardSteps(module, input)
+   local steps, stack = {}, { {module, input} }
+   while #stack > 0 do
+      local entry = table.remove(stack)
+      local m = entry[1]
+      if torch.type(m) == 'nn.Sequential' and #m.modules > 0 then
+         for i = 1, #m.modules do
+            stack[#stack + 1] = { m.modules[i], i > 1 and m.modules[i - 1].output or entry[2] }
+         end
+      else
+         steps[#steps + 1] = entry
+      end
+   end
+   return steps
+end
+
+-- Calls fn() and, if measure is set, adds its time on the current device to
+-- m.__replicaTime
+local function timeReplica(measure, m, fn)
+   if not measure then
+      return fn()
+   end
+   cutorch.synchronize()
+   local timer = torch.Timer()
+   local res = fn()
+   cutorch.synchronize()
+   m.__replicaTime = (m.__replicaTime or 0) + timer:time().real
+   return res
+end
+
+-- Size along dim of the first tensor in a (nested table of) tensors
+local function batchSize(input, dim)
+   if torch.type(input) == 'table' then
+      return input[1] and batchSize(input[1], dim) or 0
+   end
+   return input:dim() > 0 and input:size(dim) or 0
+end
+
+local reductions = { star = true, ring = true, tree = true, auto = true }
+
+function DataParallelTable:__init(dimension, flattenParams, usenccl, reduction)
    parent.__init(self)
    if not dimension then
       error "must specify a dimension!"
    end
+   if reduction and not reductions[reduction] then
+      error("unknown reduction '" .. tostring(reduction) .. "', expected star, ring, tree or auto")
+   end
 
    self.dimension = dimension
    self.modules = {}
@@ -58,12 +134,14 @@ function DataParallelTable:__init(dimension, flattenParams, usenccl)
    self.flattenParams = flattenParams or false
    self.usenccl = false
    self.needsSync = false
+   self.reduction = reduction or 'star'
    self.impl = Impls.Basic(self)
    if usenccl then
       assert(self.flattenParams, 'cannot use nccl without flattenParams')
       self.usenccl = pcall(require, 'nccl')
       if not self.usenccl then
-         print("warning: could not load nccl, falling back to default communication")
+         self.reduction = reduction or 'auto'
+         print("warning: could not load nccl, falling back to " .. self.reduction .. " reduction")
       end
    end
 end
@@ -91,6 +169,104 @@ function DataParallelTable:threads(initFunc)
    return self
 end
 
+-- Reduces the flattened gradients in buckets of at most bucketSize bytes
+-- (default 25MB) while the backward pass is still running. If timed is true,
+-- every bucket is synchronized and timed; see bucketTimings(). Pass false to
+-- reduce after the backward pass again.
+function DataParallelTable:bucketReduction(bucketSize, timed)
+   if bucketSize == false then
+      self.bucketSize = nil
+   else
+      self.bucketSize = bucketSize or 25 * 1024 * 1024
+   end
+   self.timeBuckets = timed or false
+   self.buckets = nil
+   return self
+end
+
+-- Per bucket timings of the last bucketed backward pass with timing enabled
+function DataParallelTable:bucketTimings()
+   return self.bucketTimes
+end
+
+-- Splits the input in proportion to weights, one per replica. nil restores
+-- even splits.
+function DataParallelTable:setSplitWeights(weights)
+   if weights then
+      assert(#weights == #self.gpuAssignments, 'expected one weight per replica')
+      for _, w in ipairs(weights) do
+         assert(w > 0, 'split weights must be positive')
+      end
+   end
+   self.splitWeights = weights
+   return self
+end
+
+-- Learns the split weights from the throughput of each replica. One training
+-- step in every `interval` (default 10) times each replica's forward and
+-- backward pass, with the replicas synchronized; the weights are the mean
+-- throughput over the last `window` (default 10) timed steps. Pass false to
+-- stop learning and keep the current weights.
+function DataParallelTable:autoBalance(window, interval)
+   if window == false then
+      self.balance = nil
+   else
+      self.balance = {
+         window = window or 10,
+         interval = interval or 10,
+         step = 0,
+         history = {},
+      }
+   end
+   self.measuring = false
+   return self
+end
+
+-- Folds the replica times measured in this step into the split weights
+function DataParallelTable:_updateSplitWeights()
+   local times = self.impl:exec(function(m)
+      local t = m.__replicaTime
+      m.__replicaTime = nil
+      return t
+   end)
+   local history = self.balance.history
+   local n = #self.gpuAssignments
+   for i = 1, n do
+      local rows = batchSize(self.inputGpu[i], self.dimension)
+      if times[i] and times[i] > 0 and rows > 0 then
+         history[i] = history[i] or {}
+         table.insert(history[i], rows / times[i])
+         if #history[i] > self.balance.window then
+            table.remove(history[i], 1)
+         end
+      end
+   end
+
+   local weights, sum, count = {}, 0, 0
+   for i = 1, n do
+      if history[i] and #history[i] > 0 then
+         local mean = 0
+         for _, v in ipairs(history[i]) do mean = mean + v end
+         weights[i] = mean / #history[i]
+         sum, count = sum + weights[i], count + 1
+      end
+   end
+   if count == 0 then
+      return
+   end
+   -- replicas that have not been measured yet get the average share, and no
+   -- replica drops below a tenth of the fastest so it keeps being measured
+   local maxWeight = 0
+   for i = 1, n do
+      weights[i] = weights[i] or sum / count
+      maxWeight = math.max(maxWeight, weights[i])
+   end
+   for i = 1, n do
+      weights[i] = math.max(weights[i], 0.1 * maxWeight)
+   end
+   self.splitWeights = weights
+end
+
 function DataParallelTable:__tostring()
    return 'DataParallelTable: ' .. #self.gpuAssignments .. ' x ' .. tostring(self.modules[1])
 end
@@ -123,6 +299,7 @@ function DataParallelTable:flattenParameters()
       end
    end)
    self.flattenParams = true
+   self.buckets = nil
 end
 
 function DataParallelTable:getParameters()
@@ -187,6 +364,14 @@ function DataParallelTable:updateOutput(input)
 
    local prevGpuid = cutorch.getDevice()
 
+   -- time this step if the split weights are being learned
+   local measure = false
+   if self.balance and self.train ~= false then
+      self.balance.step = self.balance.step + 1
+      measure = self.balance.step % self.balance.interval == 0
+   end
+   self.measuring = measure
+
    -- distribute the input to GPUs
    self:_distribute(self.inputGpu, input)
 
@@ -194,7 +379,10 @@ function DataParallelTable:updateOutput(input)
    local inputGpu = self.inputGpu
    self.outputGpu = self.impl:exec(function(m, i)
       if _hasData(inputGpu[i]) then
-         return m:updateOutput(inputGpu[i])
+         m.__replicaTime = nil
+         return timeReplica(measure, m, function()
+            return m:updateOutput(inputGpu[i])
+         end)
       else
          return inputGpu[i]
       end
@@ -223,8 +411,14 @@ function DataParallelTable:moduleParameters()
 end
 
 function DataParallelTable:__backward(method, input, gradOutput, scale)
+   if self.bucketSize and method ~= 'updateGradInput'
+      and #self.gpuAssignments > 1 and hasFlattenedParameters(self) then
+      return self:__bucketedBackward(method, gradOutput, scale)
+   end
+
    local prevGpuid = cutorch.getDevice()
    local inputGpu, gradOutputGpu = self.inputGpu, self.gradOutputGpu
+   local measure = self.measuring
 
    if method == 'backward' or method == 'updateGradInput' then
       -- distribute the gradOutput to GPUs
@@ -234,7 +428,9 @@ function DataParallelTable:__backward(method, input, gradOutput, scale)
          if torch.isTensor(inputGpu[i]) and inputGpu[i]:numel() == 0 then
             return torch.CudaTensor()
          else
-            return m[method](m, inputGpu[i], gradOutputGpu[i], scale)
+            return timeReplica(measure, m, function()
+               return m[method](m, inputGpu[i], gradOutputGpu[i], scale)
+            end)
          end
       end)
 
@@ -249,7 +445,9 @@ function DataParallelTable:__backward(method, input, gradOutput, scale)
          if torch.isTensor(inputGpu[i]) and inputGpu[i]:numel() == 0 then
             return torch.CudaTensor()
          else
-            return m:accGradParameters(inputGpu[i], gradOutputGpu[i], scale)
+            return timeReplica(measure, m, function()
+               return m:accGradParameters(inputGpu[i], gradOutputGpu[i], scale)
+            end)
          end
       end)
    end
@@ -272,6 +470,10 @@ function DataParallelTable:__backward(method, input, gradOutput, scale)
          end
       end
       self.needsSync = true
+      if measure then
+         self:_updateSplitWeights()
+         self.measuring = false
+      end
    end
 
    cutorch.setDevice(prevGpuid)
@@ -444,7 +646,7 @@ function DataParallelTable:__write(file)
          t[k] = {v[1]}
       elseif k == 'inputGpu' or k == 'outputGpu' or k == 'gradInputGpu' or k == 'gradOutputGpu' then
          t[k] = {}
-      elseif k == 'buffer' then
+      elseif k == 'buffer' or k == 'comm' or k == 'buckets' or k == 'bucketTimes' then
          t[k] = nil
       else
          t[k] = v
@@ -457,6 +659,7 @@ end
 
 function DataParallelTable:_reflattenReplicaParameters()
    local flattenedParams = self.flattenedParams
+   self.buckets = nil
    if flattenedParams then
       self.flattenedParams = self.impl:exec(function(m, i)
          if i == 1 then
@@ -484,6 +687,36 @@ local function sliceRange(nElem, idx, splits)
    end
 end
 
+-- Like sliceRange, but gives split idx a share of nElem proportional to
+-- weights[idx]
+local function weightedSliceRange(nElem, idx, weights)
+   local total, before = 0, 0
+   for i, w in ipairs(weights) do
+      total = total + w
+      if i < idx then
+         before = before + w
+      end
+   end
+   local rangeStart = math.floor(nElem * before / total + 0.5) + 1
+   if idx == #weights then
+      return rangeStart, nElem - rangeStart + 1
+   else
+      local rangeEnd = math.floor(nElem * (before + weights[idx]) / total + 0.5)
+      return rangeStart, rangeEnd - rangeStart + 1
+   end
+end
+
+-- Range of the input handled by replica idx. The replicas always take
+-- consecutive ranges in order, so _concat needs no reordering.
+function DataParallelTable:_sliceRange(nElem, idx, n)
+   local weights = self.splitWeights
+   if weights then
+      assert(#weights == n, 'split weights do not match the number of replicas')
+      return weightedSliceRange(nElem, idx, weights)
+   end
+   return sliceRange(nElem, idx, n)
+end
+
 local function sumSizes(tensors, dim)
    local size
    for i=1,#tensors do
@@ -498,36 +731,367 @@ local function sumSizes(tensors, dim)
    return size
 end
 
+-- Device operations the collectives below are written against. Tests swap
+-- in a host-memory mock to check the algorithms without several GPUs.
+local CudaComm = {}
+CudaComm.__index = CudaComm
+DataParallelTable.CudaComm = CudaComm
+
+function CudaComm.new()
+   return setmetatable({ buffers = {} }, CudaComm)
+end
+
+-- Returns a receive buffer on device shaped like t, reused across calls.
+-- slot is the replica receiving into it: a device may host several replicas,
+-- and every receive pending in one step needs storage of its own.
+function CudaComm:buffer(device, slot, t)
+   cutorch.setDevice(device)
+   local key = device .. ':' .. slot
+   self.buffers[key] = self.buffers[key] or torch.CudaTensor()
+   return self.buffers[key]:resizeAs(t)
+end
+
+-- Peer copy of src on srcDevice into dst on dstDevice
+function CudaComm:copy(dstDevice, dst, srcDevice, src)
+   cutorch.setDevice(dstDevice)
+   -- Synchronize before and after copy to ensure that it doesn't overlap
+   -- with earlier or later writes on either device
+   waitForDevice(srcDevice, dstDevice)
+   dst:copy(src)
+   waitForDevice(dstDevice, srcDevice)
+end
+
+function CudaComm:add(device, dst, src)
+   cutorch.setDevice(device)
+   dst:add(src)
+end
+
+-- Reductions and broadcasts over one tensor per device, rooted at the first.
+-- 'star' moves all N-1 tensors through the root. 'ring' splits the tensor into
+-- N chunks: a reduce-scatter leaves each device with one fully summed chunk,
+-- which is then gathered on the root (or, for a broadcast, the root scatters
+-- the chunks and a ring all-gather completes them), so no device moves more
+-- than 2(N-1)/N of the tensor and every link is busy at every step. 'tree'
+-- needs only log2(N) steps and is preferable for small, latency bound tensors;
+-- 'auto' picks between the two with treeThreshold.
+local Collectives = {}
+DataParallelTable.collectives = Collectives
+Collectives.treeThreshold = 65536
+
+local function chunk(t, idx, n)
+   local start, size = sliceRange(t:nElement(), idx, n)
+   return t:view(t:nElement()):narrow(1, start, size)
+end
+
+local function algorithm(mode, t, n)
+   if mode == 'ring' or mode == 'auto' then
+      -- every device needs a non-empty chunk of a flat view
+      if not t:isContiguous() or t:nElement() < n
+         or (mode == 'auto' and t:nElement() < Collectives.treeThreshold) then
+         return 'tree'
+      end
+      return 'ring'
+   end
+   return mode
+end
+
+local function starReduce(comm, tensors, devices)
+   for i = 2, #tensors do
+      local buffer = comm:buffer(devices[1], 1, tensors[i])
+      comm:copy(devices[1], buffer, devices[i], tensors[i])
+      comm:add(devices[1], tensors[1], buffer)
+   end
+end
+
+local function starBroadcast(comm, tensors, devices)
+   for i = 2, #tensors do
+      comm:copy(devices[i], tensors[i], devices[1], tensors[1])
+   end
+end
+
+local function ringReduce(comm, tensors, devices)
+   local n = #tensors
+   -- reduce-scatter: at step s device r passes chunk r-s on to device r+1,
+   -- which adds it to its own; afterwards device r holds the sum of chunk r+1
+   for step = 0, n - 2 do
+      local received = {}
+      for r = 1, n do
+         local dst, c = r % n + 1, (r - 1 - step) % n + 1
+         local src = chunk(tensors[r], c, n)
+         received[dst] = { comm:buffer(devices[dst], dst, src), c }
+         comm:copy(devices[dst], received[dst][1], devices[r], src)
+      end
+      for r = 1, n do
+         local buffer, c = unpack(received[r])
+         comm:add(devices[r], chunk(tensors[r], c, n), buffer)
+      end
+   end
+   -- gather the summed chunks on the root
+   for r = 2, n do
+      local c = r % n + 1
+      comm:copy(devices[1], chunk(tensors[1], c, n), devices[r], chunk(tensors[r], c, n))
+   end
+end
+
+local function ringBroadcast(comm, tensors, devices)
+   local n = #tensors
+   -- scatter chunk r to device r
+   for r = 2, n do
+      comm:copy(devices[r], chunk(tensors[r], r, n), devices[1], chunk(tensors[1], r, n))
+   end
+   -- all-gather: at step s device r passes chunk r-s on to device r+1. The
+   -- root already holds every chunk, so it only sends.
+   for step = 0, n - 2 do
+      for r = 1, n do
+         local dst, c = r % n + 1, (r - 1 - step) % n + 1
+         if dst ~= 1 then
+            comm:copy(devices[dst], chunk(tensors[dst], c, n), devices[r], chunk(tensors[r], c, n))
+         end
+      end
+   end
+end
+
+local function treeReduce(comm, tensors, devices)
+   local n, d = #tensors, 1
+   while d < n do
+      local received = {}
+      for r = 1, n - d, 2 * d do
+         received[r] = comm:buffer(devices[r], r, tensors[r + d])
+         comm:copy(devices[r], received[r], devices[r + d], tensors[r + d])
+      end
+      for r = 1, n - d, 2 * d do
+         comm:add(devices[r], tensors[r], received[r])
+      end
+      d = 2 * d
+   end
+end
+
+local function treeBroadcast(comm, tensors, devices)
+   local n, d = #tensors, 1
+   while 2 * d < n do
+      d = 2 * d
+   end
+   while d >= 1 do
+      for r = 1, n - d, 2 * d do
+         comm:copy(devices[r + d], tensors[r + d], devices[r], tensors[r])
+      end
+      d = d / 2
+   end
+end
+
+local reduceImpls = { star = starReduce, ring = ringReduce, tree = treeReduce }
+local broadcastImpls = { star = starBroadcast, ring = ringBroadcast, tree = treeBroadcast }
+
+-- Sums tensors[i] (on devices[i]) into tensors[1]
+function Collectives.reduce(comm, mode, tensors, devices)
+   if #tensors > 1 then
+      reduceImpls[algorithm(mode, tensors[1], #tensors)](comm, tensors, devices)
+   end
+end
+
+-- Copies tensors[1] into every other tensors[i]
+function Collectives.broadcast(comm, mode, tensors, devices)
+   if #tensors > 1 then
+      broadcastImpls[algorithm(mode, tensors[1], #tensors)](comm, tensors, devices)
+   end
+end
+
 -- Copies the parameters from the first replica to all other replicas
 function DataParallelTable:_broadcast(params)
-   for moduleIdx = 2, #params do
-      for paramIdx = 1, #params[moduleIdx] do
-         params[moduleIdx][paramIdx]:copy(params[1][paramIdx])
-      end
-      waitForDevice(self.gpuAssignments[moduleIdx], self.gpuAssignments[1])
+   self.comm = self.comm or CudaComm.new()
+   for paramIdx = 1, #params[1] do
+      Collectives.broadcast(self.comm, self.reduction or 'star',
+                            pluck(params, paramIdx), self.gpuAssignments)
    end
 end
 
 -- Sums all the gradParams on to the first replica
 function DataParallelTable:_reduce(gradParams)
-   local dstGpuid = self.gpuAssignments[1]
-   cutorch.setDevice(dstGpuid)
+   self.comm = self.comm or CudaComm.new()
+   for paramIdx = 1, #gradParams[1] do
+      Collectives.reduce(self.comm, self.reduction or 'star',
+                         pluck(gradParams, paramIdx), self.gpuAssignments)
+   end
+   cutorch.setDevice(self.gpuAssignments[1])
+end
+
+-- Groups the flattened gradients into buckets of at most bucketSize bytes in
+-- reverse layer order. Each bucket records the backward step after which all
+-- of its gradients have been produced.
+function DataParallelTable:_gradientBuckets()
+   if self.buckets then
+      return self.buckets
+   end
+
+   local layout = self.impl:exec(function(m, i)
+      if i ~= 1 then
+         return {}
+      end
+      local steps = backwardSteps(m)
+      local params = {}
+      for step, entry in ipairs(steps) do
+         local _, gradParams = entry[1]:parameters()
+         for _, gradParam in ipairs(gradParams or {}) do
+            params[#params + 1] = { gradParam:storageOffset(), gradParam:nElement(), step }
+         end
+      end
+      return { nSteps = #steps, params = params }
+   end)[1]
+
+   local flat = self.flattenedParams[1][2]
+   local limit = math.max(1, math.floor(self.bucketSize / flat:elementSize()))
+   local params = layout.params
+   table.sort(params, function(a, b) return a[1] > b[1] end)
+
+   local buckets, current = { nSteps = layout.nSteps }, nil
+   for _, p in ipairs(params) do
+      local lo = p[1] - flat:storageOffset()
+      local hi = lo + p[2]
+      if current and lo >= current.lo then
+         -- shared with a parameter that is already in the bucket
+         current.step = math.max(current.step, p[3])
+      elseif current and current.hi - lo <= limit then
+         current.lo = lo
+         current.step = math.max(current.step, p[3])
+      else
+         current = { lo = lo, hi = current and current.lo or hi, step = p[3] }
+         buckets[#buckets + 1] = current
+      end
+   end
+   assert(#buckets > 0 and buckets[1].hi <= flat:nElement() and current.lo >= 0,
+          'gradients are not all in the flattened parameters')
+
+   for i, bucket in ipairs(buckets) do
+      bucket.first, bucket.numel, bucket.index = bucket.lo + 1, bucket.hi - bucket.lo, i
+      bucket.lo, bucket.hi = nil, nil
+   end
+   table.sort(buckets, function(a, b)
+      return a.step < b.step or (a.step == b.step and a.index < b.index)
+   end)
+   self.buckets = buckets
+   return buckets
+end
+
+-- Starts the reduction of one bucket on the communication stream, once the
+-- compute streams have produced its gradients
+function DataParallelTable:_reduceBucket(bucket, computeStream, stream)
+   local devices = self.gpuAssignments
+   local views = {}
+   for i, params in ipairs(self.flattenedParams) do
+      views[i] = params[2]:narrow(1, bucket.first, bucket.numel)
+   end
+
+   local timer
+   if self.timeBuckets then
+      cutorch.synchronizeAll()
+      timer = torch.Timer()
+   end
+
+   streamWaitFor(devices, stream, computeStream)
+   setStream(devices, stream)
+   if self.usenccl and not cudaLaunchBlocking then
+      nccl.reduce(views, nil, true, 1)
+   else
+      self.comm = self.comm or CudaComm.new()
+      Collectives.reduce(self.comm, self.reduction or 'star', views, devices)
+   end
+   setStream(devices, computeStream)
+
+   if timer then
+      cutorch.synchronizeAll()
+      table.insert(self.bucketTimes, {
+         first = bucket.first,
+         numel = bucket.numel,
+         bytes = bucket.numel * views[1]:elementSize(),
+         step = bucket.step,
+         ms = timer:time().real * 1000,
+      })
+   end
+end
 
-   self.buffer = self.buffer or torch.CudaTensor()
-   for moduleIdx = 2, #gradParams do
-      for paramIdx = 1, #gradParams[moduleIdx] do
-         local dst = gradParams[1][paramIdx]
-         local src = gradParams[moduleIdx][paramIdx]
+-- backward / accGradParameters that runs the replicas one step at a time and
+-- reduces each bucket of gradients as soon as every replica has produced it,
+-- overlapping the communication with the rest of the backward pass
+function DataParallelTable:__bucketedBackward(method, gradOutput, scale)
+   local prevGpuid = cutorch.getDevice()
+   local inputGpu, gradOutputGpu = self.inputGpu, self.gradOutputGpu
+   local devices = self.gpuAssignments
+
+   if method == 'backward' then
+      self:_distribute(self.gradOutputGpu, gradOutput)
+   end
 
-         -- Synchronize before and after copy to ensure that it doesn't overlap
-         -- with this add or previous adds
-         waitForDevice(self.gpuAssignments[moduleIdx], dstGpuid)
-         self.buffer:resizeAs(src):copy(src)
-         waitForDevice(dstGpuid, self.gpuAssignments[moduleIdx])
+   local buckets = self:_gradientBuckets()
+   local measure = self.measuring
+   local computeStream = cutorch.getStream()
+   local stream = getCommStream()
+   self.bucketTimes = self.timeBuckets and {} or nil
 
-         dst:add(self.buffer)
+   self.impl:exec(function(m, i)
+      if torch.isTensor(inputGpu[i]) and inputGpu[i]:numel() == 0 then
+         m.__bucketedBackward = nil
+      else
+         m.__bucketedBackward = {
+            steps = backwardSteps(m, inputGpu[i]),
+            gradOutput = gradOutputGpu[i],
+         }
+      end
+   end)
+
+   local nextBucket = 1
+   for step = 1, buckets.nSteps do
+      self.impl:exec(function(m, i)
+         local state = m.__bucketedBackward
+         if state then
+            local module, input = state.steps[step][1], state.steps[step][2]
+            timeReplica(measure, m, function()
+               if method == 'backward' then
+                  state.gradOutput = module:backward(input, state.gradOutput, scale)
+               else
+                  module:accGradParameters(input, state.gradOutput, scale)
+                  state.gradOutput = module.gradInput
+               end
+            end)
+         end
+      end)
+      while buckets[nextBucket] and buckets[nextBucket].step == step do
+         self:_reduceBucket(buckets[nextBucket], computeStream, stream)
+         nextBucket = nextBucket + 1
       end
    end
+
+   local gradInputGpu = self.impl:exec(function(m, i)
+      local state = m.__bucketedBackward
+      m.__bucketedBackward = nil
+      if not state then
+         return torch.CudaTensor()
+      end
+      if method == 'backward' then
+         m.gradInput = state.gradOutput
+      end
+      return state.gradOutput
+   end)
+   if method == 'backward' then
+      self.gradInputGpu = gradInputGpu
+      if self.gradInput then
+         self.gradInput = self:_concat(self.gradInput, self.gradInputGpu)
+      end
+   end
+
+   -- Later kernels must not touch the gradients before the reductions finish
+   streamWaitFor(devices, computeStream, stream)
+   for i = 2, #devices do
+      cutorch.setDevice(devices[i])
+      self.flattenedParams[i][2]:zero()
+   end
+   self.needsSync = true
+   if measure then
+      self:_updateSplitWeights()
+      self.measuring = false
+   end
+
+   cutorch.setDevice(prevGpuid)
+   return self.gradInput
 end
 
 function DataParallelTable:_distribute(dst, src)
@@ -560,7 +1124,7 @@ function DataParallelTable:_distributeTensorRecursive(dst, src, idx, n)
    dst = torch.type(dst) == 'torch.CudaTensor' and dst or torch.CudaTensor()
 
    local srcsize = src:dim() > 0 and src:size(self.dimension) or 0
-   local index, size = sliceRange(srcsize, idx, n)
+   local index, size = self:_sliceRange(srcsize, idx, n)
    if size == 0 then
       dst:resize(0)
    else
@@ -0,0 +1,81 @@
+--[[
+   Cross-entropy of raw scores (logits) against class targets, equivalent to
+   nn.LogSoftMax followed by nn.ClassNLLCriterion but computed by a single
+   fused kernel per pass, without materializing the log-probabilities.
+
+   weights and sizeAverage have the same meaning as in nn.ClassNLLCriterion.
+   With inplace set, backward writes the gradient over the input logits.
+]]--
+local THNN = require 'nn.THNN'
+local FusedCrossEntropyCriterion, parent = torch.class('nn.FusedCrossEntropyCriterion', 'nn.Criterion')
+
+function FusedCrossEntropyCriterion:__init(weights, sizeAverage, inplace)
+   parent.__init(self)
+   if sizeAverage ~= nil then
+      self.sizeAverage = sizeAverage
+   else
+      self.sizeAverage = true
+   end
+   if weights then
+      assert(weights:dim() == 1, "weights input should be 1-D Tensor")
+      self.weights = weights
+   end
+   self.inplace = inplace or false
+
+   self.output_tensor = torch.zeros(1)
+   self.total_weight_tensor = torch.ones(1)
+   self.logsum = torch.Tensor()
+   self.target = torch.zeros(1):long()
+end
+
+function FusedCrossEntropyCriterion:__len()
+   return self.weights and #self.weights or 0
+end
+
+function FusedCrossEntropyCriterion:updateOutput(input, target)
+   assert(torch.type(input) == 'torch.CudaTensor',
+          'FusedCrossEntropyCriterion only supports torch.CudaTensor input')
+   if torch.type(target) == 'torch.CudaLongTensor' then
+      self.target = target
+   else
+      -- other targets are copied into a buffer kept across calls
+      if torch.type(self.targetBuffer) ~= 'torch.CudaLongTensor' then
+         self.targetBuffer = torch.CudaLongTensor()
+      end
+      if type(target) == 'number' then
+         self.targetBuffer:resize(1):fill(target)
+      else
+         self.targetBuffer:resize(target:size()):copy(target)
+      end
+      self.target = self.targetBuffer
+   end
+
+   input.THNN.CrossEntropy_updateOutput(
+      input:cdata(),
+      self.target:cdata(),
+      self.output_tensor:cdata(),
+      self.sizeAverage,
+      THNN.optionalTensor(self.weights),
+      self.total_weight_tensor:cdata(),
+      self.logsum:cdata()
+   )
+   self.output = self.output_tensor[1]
+   return self.output
+end
+
+function FusedCrossEntropyCriterion:updateGradInput(input, target)
+   if self.inplace then
+      self.gradInput = input
+   end
+
+   input.THNN.CrossEntropy_updateGradInput(
+      input:cdata(),
+      self.target:cdata(),
+      self.gradInput:cdata(),
+      self.sizeAverage,
+      THNN.optionalTensor(self.weights),
+      self.total_weight_tensor:cdata(),
+      self.logsum:cdata()
+   )
+   return self.gradInput
+end
@@ -0,0 +1,216 @@
+--[[
+   Stores max-pooling argmax indices as one byte per output element.
+
+   The max-pooling modules keep, for every output element, where its maximum
+   came from so the backward pass (and nn.SpatialMaxUnpooling /
+   nn.VolumetricMaxUnpooling) can route gradients back. By default that is a
+   float per output element. cunn.compactPoolingIndices(model) converts the
+   max-pooling modules of the model to compact variants (e.g.
+   nn.SpatialMaxPoolingCompact, see ModuleVariants.lua) that keep a
+   torch.CudaByteTensor holding the position of the maximum inside its
+   window, a quarter of the memory and traffic;
+   cunn.compactPoolingIndices(model, false) converts them back.
+
+   Windows may have at most 255 elements. The unpooling modules of the model
+   are converted as well and follow the format of the pooling module they
+   are attached to. Non-CUDA inputs use float indices.
+]]--
+local ModuleVariants = require 'cunn.ModuleVariants'
+
+cunn = cunn or {}
+
+local poolings = {
+   ['nn.SpatialMaxPooling'] = 2,
+   ['nn.SpatialDilatedMaxPooling'] = 2,
+   ['nn.VolumetricMaxPooling'] = 3,
+   ['nn.VolumetricDilatedMaxPooling'] = 3,
+}
+
+local function compactIndices(module)
+   if torch.type(module.indices) ~= 'torch.CudaByteTensor' then
+      module.indices = torch.CudaByteTensor()
+   end
+   return module.indices
+end
+
+local function spatialParams(self)
+   self.padW = self.padW or 0
+   self.padH = self.padH or 0
+   self.ceil_mode = self.ceil_mode or false
+   return self.kW, self.kH, self.dW, self.dH, self.padW, self.padH,
+      self.dilationW or 1, self.dilationH or 1, self.ceil_mode
+end
+
+local function volumetricParams(self)
+   self.padT = self.padT or 0
+   self.padW = self.padW or 0
+   self.padH = self.padH or 0
+   self.ceil_mode = self.ceil_mode or false
+   return self.kT, self.kW, self.kH, self.dT, self.dW, self.dH,
+      self.padT, self.padW, self.padH,
+      self.dilationT or 1, self.dilationW or 1, self.dilationH or 1
+end
+
+local function spatialUpdateOutput(self, input)
+   local dims = input:dim()
+   self.iheight = input:size(dims-1)
+   self.iwidth = input:size(dims)
+   input.THNN.SpatialDilatedMaxPooling_updateOutputCompact(
+      input:cdata(), self.output:cdata(), compactIndices(self):cdata(),
+      spatialParams(self))
+   return self.output
+end
+
+local function spatialUpdateGradInput(self, input, gradOutput)
+   input.THNN.SpatialDilatedMaxPooling_updateGradInputCompact(
+      input:cdata(), gradOutput:cdata(), self.gradInput:cdata(),
+      self.indices:cdata(), spatialParams(self))
+   return self.gradInput
+end
+
+local function volumetricUpdateOutput(self, input)
+   local dims = input:dim()
+   self.itime = input:size(dims-2)
+   self.iheight = input:size(dims-1)
+   self.iwidth = input:size(dims)
+   local kT, kW, kH, dT, dW, dH, padT, padW, padH,
+         dilationT, dilationW, dilationH = volumetricParams(self)
+   input.THNN.VolumetricDilatedMaxPooling_updateOutputCompact(
+      input:cdata(), self.output:cdata(), compactIndices(self):cdata(),
+      kT, kW, kH, dT, dW, dH, padT, padW, padH,
+      dilationT, dilationW, dilationH, self.ceil_mode)
+   return self.output
+end
+
+local function volumetricUpdateGradInput(self, input, gradOutput)
+   input.THNN.VolumetricDilatedMaxPooling_updateGradInputCompact(
+      input:cdata(), gradOutput:cdata(), self.gradInput:cdata(),
+      self.indices:cdata(), volumetricParams(self))
+   return self.gradInput
+end
+
+local compactMethods = {
+   [2] = {spatialUpdateOutput, spatialUpdateGradInput},
+   [3] = {volumetricUpdateOutput, volumetricUpdateGradInput},
+}
+
+-- Unpooling reads the window geometry from its pooling module
+local function pooledCompact(self)
+   return torch.type(self.pooling.indices) == 'torch.CudaByteTensor'
+end
+
+local function spatialUnpoolParams(self)
+   local p = self.pooling
+   return self.owidth, self.oheight, p.kW, p.kH, p.dW, p.dH,
+      p.padW or 0, p.padH or 0, p.dilationW or 1, p.dilationH or 1
+end
+
+local function volumetricUnpoolParams(self)
+   local p = self.pooling
+   return self.otime, self.owidth, self.oheight, p.kT, p.kW, p.kH,
+      p.dT, p.dW, p.dH, p.padT or 0, p.padW or 0, p.padH or 0
+end
+
+-- Compact methods of the unpooling modules
+local unpoolings = {
+   ['nn.SpatialMaxUnpooling'] = {
+      updateOutput = function(self, input)
+         self:setParams()
+         input.THNN.SpatialMaxUnpooling_updateOutputCompact(
+            input:cdata(), self.output:cdata(), self.indices:cdata(),
+            spatialUnpoolParams(self))
+         return self.output
+      end,
+      updateGradInput = function(self, input, gradOutput)
+         self:setParams()
+         input.THNN.SpatialMaxUnpooling_updateGradInputCompact(
+            input:cdata(), gradOutput:cdata(), self.gradInput:cdata(),
+            self.indices:cdata(), spatialUnpoolParams(self))
+         return self.gradInput
+      end,
+   },
+   ['nn.VolumetricMaxUnpooling'] = {
+      updateOutput = function(self, input)
+         self:setParams()
+         input.THNN.VolumetricMaxUnpooling_updateOutputCompact(
+            input:cdata(), self.output:cdata(), self.indices:cdata(),
+            volumetricUnpoolParams(self))
+         return self.output
+      end,
+      updateGradInput = function(self, input, gradOutput)
+         self:setParams()
+         input.THNN.VolumetricMaxUnpooling_updateGradInputCompact(
+            input:cdata(), gradOutput:cdata(), self.gradInput:cdata(),
+            self.indices:cdata(), volumetricUnpoolParams(self))
+         return self.gradInput
+      end,
+   },
+}
+
+-- Compact variant of each class, e.g. nn.SpatialMaxPoolingCompact
+local compactNames = {}
+
+for name, dim in pairs(poolings) do
+   local class, parent = ModuleVariants.define(name .. 'Compact', name)
+   local compactOutput, compactGradInput = unpack(compactMethods[dim])
+   compactNames[name] = name .. 'Compact'
+
+   function class:updateOutput(input)
+      if torch.type(input) == 'torch.CudaTensor' then
+         return compactOutput(self, input)
+      end
+      if torch.type(self.indices) == 'torch.CudaByteTensor' then
+         self.indices = nil
+      end
+      return parent.updateOutput(self, input)
+   end
+
+   function class:updateGradInput(input, gradOutput)
+      if torch.type(input) == 'torch.CudaTensor' then
+         return compactGradInput(self, input, gradOutput)
+      end
+      return parent.updateGradInput(self, input, gradOutput)
+   end
+end
+
+for name, methods in pairs(unpoolings) do
+   local class, parent = ModuleVariants.define(name .. 'Compact', name)
+   compactNames[name] = name .. 'Compact'
+
+   function class:updateOutput(input)
+      if pooledCompact(self) then
+         return methods.updateOutput(self, input)
+      end
+      return parent.updateOutput(self, input)
+   end
+
+   function class:updateGradInput(input, gradOutput)
+      if pooledCompact(self) then
+         return methods.updateGradInput(self, input, gradOutput)
+      end
+      return parent.updateGradInput(self, input, gradOutput)
+   end
+end
+
+-- Returns the model and the number of max-pooling modules converted
+function cunn.compactPoolingIndices(model, enabled)
+   enabled = enabled ~= false
+   local count = 0
+   for _, module in ipairs(model:listModules()) do
+      local name = torch.type(module)
+      local parentName = ModuleVariants.parentOf(module)
+      if enabled and compactNames[name] then
+         ModuleVariants.convert(module, compactNames[name])
+         count = count + (poolings[name] and 1 or 0)
+      elseif not enabled and parentName and compactNames[parentName] then
+         ModuleVariants.revert(module)
+         if poolings[parentName] then
+            if torch.type(module.indices) == 'torch.CudaByteTensor' then
+               module.indices = nil
+            end
+            count = count + 1
+         end
+      end
+   end
+   return model, count
+end
@@ -0,0 +1,48 @@
+--[[
+   Subclasses that existing nn modules are converted to in place.
+
+   Some cunn features change how a module runs, such as fused activations
+   and compact pooling indices. Instead of patching the nn classes, each
+   feature defines a variant of every class it applies to and switches the
+   modules of a model to it by changing their metatable. The fields, and any
+   references held to the module, are kept. Variants are ordinary torch
+   classes, so converted modules save and load like others once cunn is
+   loaded.
+]]--
+
+local ModuleVariants = {}
+
+-- parent class name by variant class name
+local parents = {}
+
+-- Defines the variant `name` of `parentName`; returns the class and its
+-- parent like torch.class
+function ModuleVariants.define(name, parentName)
+   parents[name] = parentName
+   return torch.class(name, parentName)
+end
+
+-- Converts module to the variant `name` of its class
+function ModuleVariants.convert(module, name)
+   assert(parents[name] == torch.type(module),
+          torch.type(module) .. ' cannot be converted to ' .. name)
+   torch.setmetatable(module, name)
+   return module
+end
+
+-- Converts a variant back to its parent class; other modules are returned
+-- unchanged
+function ModuleVariants.revert(module)
+   local parentName = parents[torch.type(module)]
+   if parentName then
+      torch.setmetatable(module, parentName)
+   end
+   return module
+end
+
+-- Name of the class module was converted from, or nil
+function ModuleVariants.parentOf(module)
+   return parents[torch.type(module)]
+end
+
+return ModuleVariants
@@ -0,0 +1,167 @@
+--[[
+   Runs a chain of pointwise activations as one module.
+
+   Each activation module (Square, Sqrt, Tanh, ...) reads and writes the
+   whole tensor once in its forward and once in its backward pass, so a chain
+   of n of them costs n passes each way. nn.PointwiseFused({m1, m2, ...})
+   computes ... m2(m1(x)) and its gradient in a single pass each, recomputing
+   the intermediate values in registers instead of keeping them in memory.
+
+   Abs, Square, Sqrt, Tanh, Sigmoid, Threshold, ReLU, HardTanh, SoftPlus, ELU
+   and LeakyReLU can be chained, up to 8 of them. Square -> Sqrt,
+   Square -> Sqrt -> Tanh, Abs -> Sqrt, Threshold -> HardTanh and
+   SoftPlus -> Tanh have kernels of their own; other chains go through a
+   generic kernel. cunn.fusePointwise(model) replaces every run of two or more
+   such modules inside an nn.Sequential.
+
+   Non-CUDA inputs run the modules one after another.
+]]--
+local ffi = require 'ffi'
+
+cunn = cunn or {}
+
+-- Op codes of THNN_CudaPointwiseFused_*; keep in sync with PointwiseOpCode in
+-- lib/THCUNN/pointwise_fusion.h
+local OP = {
+   ABS = 1,
+   SQUARE = 2,
+   SQRT = 3,
+   TANH = 4,
+   SIGMOID = 5,
+   THRESHOLD = 6,
+   HARDTANH = 7,
+   SOFTPLUS = 8,
+   ELU = 9,
+   LEAKY_RELU = 10,
+}
+
+-- Op code and (a, b) parameters of each module type
+local opCodes = {
+   ['nn.Abs'] = function(m) return OP.ABS, 0, 0 end,
+   ['nn.Square'] = function(m) return OP.SQUARE, 0, 0 end,
+   ['nn.Sqrt'] = function(m) return OP.SQRT, m.eps or 0, 0 end,
+   ['nn.Tanh'] = function(m) return OP.TANH, 0, 0 end,
+   ['nn.Sigmoid'] = function(m) return OP.SIGMOID, 0, 0 end,
+   ['nn.Threshold'] = function(m) return OP.THRESHOLD, m.threshold, m.val end,
+   ['nn.ReLU'] = function(m) return OP.THRESHOLD, m.threshold, m.val end,
+   ['nn.HardTanh'] = function(m) return OP.HARDTANH, m.min_val, m.max_val end,
+   ['nn.SoftPlus'] = function(m) return OP.SOFTPLUS, m.beta, m.threshold end,
+   ['nn.ELU'] = function(m) return OP.ELU, m.alpha, 0 end,
+   ['nn.LeakyReLU'] = function(m) return OP.LEAKY_RELU, m.negval, 0 end,
+}
+
+local maxOps = 8
+
+local PointwiseFused, parent = torch.class('nn.PointwiseFused', 'nn.Module')
+
+function PointwiseFused:__init(modules)
+   parent.__init(self)
+   assert(#modules >= 1 and #modules <= maxOps,
+          'between 1 and ' .. maxOps .. ' modules expected')
+   self.fused = {}
+   self.ops = {}
+   self.params = {}
+   for i, m in ipairs(modules) do
+      local code = opCodes[torch.type(m)]
+      assert(code, torch.type(m) .. ' cannot be fused')
+      local op, a, b = code(m)
+      self.fused[i] = m
+      self.ops[i] = op
+      self.params[2 * i - 1] = a
+      self.params[2 * i] = b
+   end
+end
+
+function PointwiseFused.canFuse(module)
+   return opCodes[torch.type(module)] ~= nil
+end
+
+local function program(self)
+   local n = #self.ops
+   return n, ffi.new('int[?]', n, self.ops), ffi.new('float[?]', 2 * n, self.params)
+end
+
+function PointwiseFused:updateOutput(input)
+   if torch.type(input) ~= 'torch.CudaTensor' then
+      local x = input
+      for _, m in ipairs(self.fused) do
+         x = m:updateOutput(x)
+      end
+      self.output = x
+      return self.output
+   end
+   if torch.type(self.output) ~= 'torch.CudaTensor' then
+      self.output = input.new()
+   end
+   input.THNN.PointwiseFused_updateOutput(
+      input:cdata(), self.output:cdata(), program(self))
+   return self.output
+end
+
+function PointwiseFused:updateGradInput(input, gradOutput)
+   if torch.type(input) ~= 'torch.CudaTensor' then
+      local g = gradOutput
+      for i = #self.fused, 1, -1 do
+         local x = i > 1 and self.fused[i - 1].output or input
+         g = self.fused[i]:updateGradInput(x, g)
+      end
+      self.gradInput = g
+      return self.gradInput
+   end
+   if torch.type(self.gradInput) ~= 'torch.CudaTensor' then
+      self.gradInput = input.new()
+   end
+   input.THNN.PointwiseFused_updateGradInput(
+      input:cdata(), gradOutput:cdata(), self.gradInput:cdata(), program(self))
+   return self.gradInput
+end
+
+function PointwiseFused:clearState()
+   for _, m in ipairs(self.fused) do
+      m:clearState()
+   end
+   return parent.clearState(self)
+end
+
+function PointwiseFused:__tostring__()
+   local names = {}
+   for i, m in ipairs(self.fused) do
+      names[i] = tostring(m)
+   end
+   return torch.type(self) .. '(' .. table.concat(names, ' -> ') .. ')'
+end
+
+-- Returns the model and the number of modules fused
+function cunn.fusePointwise(model)
+   local count = 0
+   local function visit(module)
+      if torch.type(module) == 'nn.Sequential' then
+         local i = 1
+         while i < #module.modules do
+            local j = i
+            while PointwiseFused.canFuse(module.modules[j])
+                  and j < #module.modules and j - i + 1 < maxOps
+                  and PointwiseFused.canFuse(module.modules[j + 1]) do
+               j = j + 1
+            end
+            if j > i then
+               local run = {}
+               for k = i, j do
+                  run[#run + 1] = module.modules[k]
+               end
+               for k = j, i + 1, -1 do
+                  module:remove(k)
+               end
+               module.modules[i] = nn.PointwiseFused(run)
+               count = count + #run
+            end
+            i = i + 1
+         end
+      end
+      for _, child in ipairs(module.modules or {}) do
+         visit(child)
+      end
+   end
+   visit(model)
+   return model, count
+end
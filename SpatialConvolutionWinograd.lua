@@ -0,0 +1,35 @@
+--[[
+   Caches the Winograd-transformed filters of 3x3 stride-1 convolutions.
+
+   The Winograd path of nn.SpatialConvolutionMM transforms the filters at the
+   start of every forward pass. For inference the weights do not change, so
+   cunn.cacheWinogradFilters(model) transforms them once, on the first forward
+   pass that uses them, and keeps the result until
+   cunn.cacheWinogradFilters(model, false) releases it, or the weights are
+   freed. Each forward pass compares the weights with those the filters were
+   transformed from, on the device, and transforms again the filters that
+   changed, so updating cached weights in place is safe.
+]]--
+
+cunn = cunn or {}
+
+local function eligible(module)
+   return torch.type(module) == 'nn.SpatialConvolutionMM'
+      and torch.type(module.weight) == 'torch.CudaTensor'
+      and module.kW == 3 and module.kH == 3
+      and module.dW == 1 and module.dH == 1
+end
+
+-- Returns the model and the number of convolutions whose filters are cached
+-- (or released, with enabled == false)
+function cunn.cacheWinogradFilters(model, enabled)
+   enabled = enabled ~= false
+   local count = 0
+   for _, module in ipairs(model:listModules()) do
+      if eligible(module) and (not enabled or not module.train) then
+         module.weight.THNN.SpatialConvolutionMM_cacheWinogradFilter(module.weight:cdata(), enabled)
+         count = count + 1
+      end
+   end
+   return model, count
+end
@@ -54,4 +54,126 @@ local function_names = extract_function_names(THCUNN_h)
 THNN.kernels['torch.CudaTensor'] = THNN.bind(THCUNN.C, function_names, 'Cuda', THCUNN.getState)
 torch.getmetatable('torch.CudaTensor').THNN = THNN.kernels['torch.CudaTensor']
 
+-- Lets SpatialConvolutionMM unfold several samples into its columns buffer and
+-- run one GEMM per chunk instead of one per sample. `bytes` caps the size of the
+-- columns buffer and thereby picks the chunk size; 0 restores the per-sample loop.
+function THCUNN.setConvolutionColumnsLimit(bytes)
+   THCUNN.C.THNN_CudaSpatialConvolutionMM_setColumnsLimit(THCUNN.getState(), bytes)
+end
+
+-- SpatialConvolutionMM, SpatialDilatedConvolution and VolumetricConvolution
+-- can gather the unfolded input tile by tile inside the GEMM instead of
+-- writing it out with im2col first. 'auto' (the default) times both paths
+-- for each pass and shape bucket and keeps the faster one with the tuning
+-- choices; true forces the implicit kernels and false the columns path.
+-- The implicit weight gradient accumulates with atomics, so 'auto' keeps
+-- accGradParameters on the columns path.
+function THCUNN.setImplicitGemm(mode)
+   local modes = {auto = 0, [true] = 1, [false] = -1}
+   assert(modes[mode] ~= nil, "mode should be 'auto', true or false")
+   THCUNN.C.THNN_CudaConvolution_setImplicitGemm(THCUNN.getState(), modes[mode])
+end
+
+-- 3x3 stride-1 SpatialConvolutionMM forward passes can run as Winograd
+-- F(2x2,3x3) or F(4x4,3x3) convolutions. 'auto' (the default) times F(2x2)
+-- against the regular path, like setImplicitGemm, and keeps the faster;
+-- false disables them and 2 or 4 forces that output tile size.
+function THCUNN.setWinograd(mode)
+   local modes = {auto = 0, [false] = -1, [2] = 2, [4] = 4}
+   assert(modes[mode] ~= nil, "mode should be 'auto', false, 2 or 4")
+   THCUNN.C.THNN_CudaSpatialConvolutionMM_setWinograd(THCUNN.getState(), modes[mode])
+end
+
+-- Host reference of the Winograd forward pass on FloatTensors: input is
+-- batch x nInputPlane x H x W and weight nOutputPlane x nInputPlane x 3 x 3.
+function THCUNN.winogradReference(input, weight, bias, padW, padH, tile)
+   local output = torch.FloatTensor()
+   THCUNN.C.THNN_CudaSpatialConvolutionMM_winogradReference(THCUNN.getState(),
+      input:cdata(), output:cdata(), weight:cdata(), bias and bias:cdata() or nil,
+      padW, padH, tile)
+   return output
+end
+
+-- The backward pass of SpatialMaxPooling and SpatialDilatedMaxPooling can
+-- scatter each output gradient to its argmax instead of searching the windows
+-- around every input. 'auto' (the default) scatters when windows do not
+-- overlap or the output is much smaller than the input, true and false force
+-- either kernel. Both are deterministic.
+function THCUNN.setMaxPoolingScatter(mode)
+   local modes = {auto = 0, [true] = 1, [false] = -1}
+   assert(modes[mode] ~= nil, "mode should be 'auto', true or false")
+   THCUNN.C.THNN_CudaSpatialDilatedMaxPooling_setScatterBackward(THCUNN.getState(), modes[mode])
+end
+
+-- Convolution scratch buffers (columns, fgradInput, ones) are borrowed from an
+-- arena per device and stream for the duration of each call, so peak scratch
+-- memory is that of the largest layer rather than the sum over all layers.
+-- Passing false gives every module its own buffers again.
+function THCUNN.setWorkspaceEnabled(enabled)
+   THCUNN.C.THNN_CudaWorkspace_setEnabled(THCUNN.getState(), enabled)
+end
+
+-- Returns the arena size and high-water mark (bytes) on the current device,
+-- with the number of borrows and of allocations that served them.
+function THCUNN.workspaceStats()
+   local stats = ffi.new('long[4]')
+   THCUNN.C.THNN_CudaWorkspace_getStats(THCUNN.getState(), stats)
+   return {
+      capacity = tonumber(stats[0]),
+      highWater = tonumber(stats[1]),
+      borrows = tonumber(stats[2]),
+      grows = tonumber(stats[3]),
+   }
+end
+
+-- Frees the arenas of the current device; they grow back on the next call.
+function THCUNN.releaseWorkspace()
+   THCUNN.C.THNN_CudaWorkspace_release(THCUNN.getState())
+end
+
+-- Kernels with several launch configurations (LogSoftMax, SpatialSubSampling)
+-- time them on first use per device, kernel and shape bucket, and keep the
+-- fastest. Choices are kept in memory, and also in $THCUNN_TUNING_CACHE when
+-- that is set. setTuningCache(path) keeps them in another file, '' in memory
+-- only and nil goes back to the default.
+function THCUNN.setTuningEnabled(enabled)
+   THCUNN.C.THNN_CudaTuning_setEnabled(THCUNN.getState(), enabled ~= false)
+end
+
+function THCUNN.setTuningCache(path)
+   THCUNN.C.THNN_CudaTuning_setCacheFile(THCUNN.getState(), path)
+end
+
+-- Forgets the choices held in memory; the cache file is left alone.
+function THCUNN.clearTuning()
+   THCUNN.C.THNN_CudaTuning_clear(THCUNN.getState())
+end
+
+-- The candidate index recorded for a kernel and shape size, or nil. `device`
+-- is '<name>/<multiProcessorCount>' as reported by cutorch.getDeviceProperties.
+function THCUNN.tuningLookup(device, kernel, size, candidates)
+   local choice = ffi.new('int[1]')
+   THCUNN.C.THNN_CudaTuning_lookup(THCUNN.getState(), device, kernel, size, candidates, choice)
+   return choice[0] >= 0 and choice[0] or nil
+end
+
+-- Entry point profiling; needs a build configured with -DTHCUNN_PROFILE=ON.
+-- Each THNN_Cuda* call is timed with events on the current stream and logged
+-- with its input shape and the launch configurations it used. Setting
+-- THCUNN_PROFILE=<prefix> in the environment has the same effect as
+-- THCUNN.profile(true) and writes <prefix>.json and <prefix>.txt at exit.
+function THCUNN.profile(enabled)
+   THCUNN.C.THNN_CudaProfiler_setEnabled(THCUNN.getState(), enabled ~= false)
+end
+
+-- Writes the Chrome trace (chrome://tracing) to `tracePath` and the table
+-- aggregated per entry point to `summaryPath`, or to stderr when omitted.
+function THCUNN.profileDump(tracePath, summaryPath)
+   THCUNN.C.THNN_CudaProfiler_dump(THCUNN.getState(), tracePath, summaryPath)
+end
+
+function THCUNN.profileReset()
+   THCUNN.C.THNN_CudaProfiler_reset(THCUNN.getState())
+end
+
 return THCUNN
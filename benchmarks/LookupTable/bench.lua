@@ -0,0 +1,50 @@
+-- Embedding-gradient throughput of nn.LookupTable:accGradParameters on the GPU.
+--
+--   th bench.lua [-d 128] [-n 20] [--scaleGradByFreq]
+--
+-- Sweeps vocabularies from 10k to 1M rows and batches up to 64k indices and
+-- reports indices/s and the effective gradWeight update bandwidth.
+require 'cunn'
+
+local opt = lapp[[
+   -d,--dim                   (default 128)   embedding dimension
+   -n,--nloop                 (default 20)    timed iterations per configuration
+   --scaleGradByFreq                          scale gradients by index frequency
+   --seed                     (default 1)     random seed
+]]
+
+torch.manualSeed(opt.seed)
+
+local vocabs = {10000, 100000, 1000000}
+local batches = {1024, 4096, 16384, 65536}
+
+print(string.format('%-10s %-10s %-14s %-12s %-10s', 'vocab', 'indices', 'ms/iter', 'Mindices/s', 'GB/s'))
+for _, nVocab in ipairs(vocabs) do
+   local lut = nn.LookupTable(nVocab, opt.dim):cuda()
+   if opt.scaleGradByFreq then
+      lut:scaleGradByFreq()
+   end
+   for _, nIndex in ipairs(batches) do
+      -- Zipf-like index distribution: a few very frequent rows, as in real text
+      local input = torch.rand(nIndex):pow(3):mul(nVocab - 1):floor():add(1):long():cuda()
+      local gradOutput = torch.CudaTensor(nIndex, opt.dim):normal()
+
+      lut:forward(input)
+      lut:backward(input, gradOutput)
+      cutorch.synchronize()
+
+      local timer = torch.Timer()
+      for i = 1, opt.nloop do
+         lut:backward(input, gradOutput)
+      end
+      cutorch.synchronize()
+      local elapsed = timer:time().real / opt.nloop
+
+      -- every index reads a gradOutput row and reads/writes a gradWeight row
+      local bytes = nIndex * opt.dim * 4 * 3
+      print(string.format('%-10d %-10d %-14.3f %-12.2f %-10.2f',
+                          nVocab, nIndex, elapsed * 1e3, nIndex / elapsed / 1e6, bytes / elapsed / 1e9))
+   end
+   lut = nil
+   collectgarbage()
+end
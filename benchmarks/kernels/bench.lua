@@ -0,0 +1,195 @@
+-- Forward/backward timings of THCUNN kernels over canonical layer shapes.
+--
+--   th bench.lua [--suite conv|pool|bn|softmax|criterion|lookup] [--filter pattern]
+--                [--save baseline.json] [--compare baseline.json] [--check]
+--                [--backend cuda|float]
+--
+-- Reports ms per call, GFLOP/s where the flop count is meaningful and GB/s of
+-- compulsory traffic. --save writes the timings as a JSON baseline;
+-- --compare flags every case that got slower than the baseline by more than
+-- --threshold and exits with status 1 if there is any. --check compares each
+-- case against a double precision CPU run first.
+--
+-- --backend float runs the same cases with the CPU modules, so the harness,
+-- the shape sets and the checks can be exercised on machines without a GPU.
+require 'nn'
+require 'paths'
+
+local dir = paths.dirname(paths.thisfile())
+package.path = dir .. '/?.lua;' .. package.path
+local cases = require 'cases'
+local json = require 'json'
+
+local opt = lapp[[
+   --backend                  (default cuda)  cuda | float
+   --suite                    (default all)   all | conv | pool | bn | softmax | criterion | lookup
+   --filter                   (default none)  only cases whose name matches this Lua pattern
+   -b,--batch                 (default 0)     batch size; 0 picks 32 on cuda, 2 on float
+   -n,--nloop                 (default 10)    timed iterations per case
+   --warmup                   (default 2)     untimed iterations per case
+   --check                                    compare against a double precision reference
+   --save                     (default none)  write the timings to this JSON baseline
+   --compare                  (default none)  JSON baseline to compare against
+   --threshold                (default 0.10)  relative slowdown reported as a regression
+   --seed                     (default 1)     random seed
+]]
+
+local cuda = opt.backend == 'cuda'
+if cuda then
+   require 'cunn'
+elseif opt.backend ~= 'float' then
+   error('unknown backend ' .. opt.backend)
+end
+local bs = opt.batch > 0 and opt.batch or (cuda and 32 or 2)
+torch.manualSeed(opt.seed)
+
+local function sync()
+   if cuda then cutorch.synchronize() end
+end
+
+local function convert(t, backend, index)
+   if backend == 'cuda' then return t:cuda() end
+   if index then return t end
+   return backend == 'double' and t:double() or t:float()
+end
+
+local function maxError(a, b)
+   if a == nil or a:nElement() == 0 then return 0 end
+   local ref = b:double()
+   local scale = math.max(1, ref:clone():abs():max())
+   return (a:double() - ref):abs():max() / scale
+end
+
+-- one forward and backward on fresh copies; returns the worst relative error
+local function check(case, module, input, other)
+   local ref = (case.reference and case.reference() or module:clone()):double()
+   local rInput = convert(input, 'double', case.index)
+   local rOther = convert(other, 'double', case.targetIndex)
+   local dInput = convert(input, opt.backend, case.index)
+   local dOther = convert(other, opt.backend, case.targetIndex)
+   if not case.criterion then
+      module:zeroGradParameters()
+      ref:zeroGradParameters()
+   end
+
+   local err
+   if case.criterion then
+      err = math.abs(module:forward(dInput, dOther) - ref:forward(rInput, rOther))
+         / math.max(1, math.abs(ref.output))
+      err = math.max(err, maxError(module:backward(dInput, dOther), ref:backward(rInput, rOther)))
+   else
+      err = maxError(module:forward(dInput), ref:forward(rInput))
+      err = math.max(err, maxError(module:backward(dInput, dOther), ref:backward(rInput, rOther)))
+      local _, grads = module:parameters()
+      local _, rGrads = ref:parameters()
+      for i = 1, grads and #grads or 0 do
+         err = math.max(err, maxError(grads[i], rGrads[i]))
+      end
+   end
+   return err
+end
+
+local function time(fn)
+   for i = 1, opt.warmup do fn() end
+   sync()
+   local timer = torch.Timer()
+   for i = 1, opt.nloop do fn() end
+   sync()
+   return timer:time().real / opt.nloop
+end
+
+local baseline
+if opt.compare ~= 'none' then
+   baseline = json.load(opt.compare)
+   if baseline.backend ~= opt.backend or baseline.batch ~= bs then
+      print(string.format('warning: baseline was taken with backend %s, batch %d',
+                          tostring(baseline.backend), baseline.batch or 0))
+   end
+end
+
+local results = {}
+local regressions, failures = {}, {}
+
+print(string.format('backend %s, batch %d, %d iterations', opt.backend, bs, opt.nloop))
+print(string.format('%-44s %-4s %10s %10s %10s %10s %8s',
+                    'case', 'pass', 'ms', 'GFLOP/s', 'GB/s', 'base ms', 'delta'))
+
+for _, case in ipairs(cases) do
+   if (opt.suite == 'all' or opt.suite == case.suite)
+      and (opt.filter == 'none' or case.name:find(opt.filter)) then
+
+      local module, input, other = case.build(bs, opt.backend)
+      if opt.check then
+         local checkModule = cuda and module:clone():cuda() or module:clone():float()
+         local err = check(case, checkModule, input, other)
+         local ok = err < 1e-3
+         print(string.format('%-44s check %s (max relative error %.2e)', case.name, ok and 'ok' or 'FAILED', err))
+         if not ok then failures[#failures + 1] = case.name end
+      end
+
+      module = cuda and module:cuda() or module:float()
+      input = convert(input, opt.backend, case.index)
+      other = convert(other, opt.backend, case.targetIndex)
+
+      local fwd, bwd
+      if case.criterion then
+         fwd = function() module:forward(input, other) end
+         bwd = function() module:backward(input, other) end
+      else
+         fwd = function() module:forward(input) end
+         bwd = function() module:backward(input, other) end
+      end
+
+      local flops = case.flops and {case.flops(bs)} or {}
+      local bytes = {case.bytes(bs)}
+      for pass, fn in ipairs{fwd, bwd} do
+         local passName = pass == 1 and 'fwd' or 'bwd'
+         local key = case.name .. ' ' .. passName
+         local t = time(fn)
+         results[key] = {ms = t * 1e3}
+
+         local base = baseline and baseline.results[key]
+         local delta = ''
+         if base then
+            local rel = t * 1e3 / base.ms - 1
+            delta = string.format('%+.1f%%', rel * 100)
+            if rel > opt.threshold then
+               regressions[#regressions + 1] = string.format('%s: %.3f ms -> %.3f ms (%s)', key, base.ms, t * 1e3, delta)
+               delta = delta .. ' !'
+            end
+         end
+         print(string.format('%-44s %-4s %10.3f %10s %10.2f %10s %8s',
+                             case.name, passName, t * 1e3,
+                             flops[pass] and string.format('%.1f', flops[pass] / t / 1e9) or '-',
+                             bytes[pass] / t / 1e9,
+                             base and string.format('%.3f', base.ms) or '-', delta))
+      end
+
+      module, input, other = nil, nil, nil
+      collectgarbage()
+      collectgarbage()
+   end
+end
+
+if opt.save ~= 'none' then
+   json.save(opt.save, {
+      backend = opt.backend,
+      batch = bs,
+      device = cuda and cutorch.getDeviceProperties(cutorch.getDevice()).name or 'cpu',
+      date = os.date('%Y-%m-%d'),
+      results = results,
+   })
+   print('baseline written to ' .. opt.save)
+end
+
+if #failures > 0 then
+   print(string.format('%d case(s) failed the reference check:', #failures))
+   for _, name in ipairs(failures) do print('  ' .. name) end
+end
+if #regressions > 0 then
+   print(string.format('%d regression(s) above %.0f%%:', #regressions, opt.threshold * 100))
+   for _, r in ipairs(regressions) do print('  ' .. r) end
+end
+if #failures > 0 or #regressions > 0 then
+   os.exit(1)
+end
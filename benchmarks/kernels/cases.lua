@@ -0,0 +1,254 @@
+-- Canonical shape sets for the kernel benchmarks.
+--
+-- Every case builds float modules and tensors; bench.lua converts them to the
+-- backend under test, leaving the LongTensors marked `index` / `targetIndex`
+-- alone on the CPU. `flops` and `bytes` give the work of one forward and one
+-- backward pass: bytes count the compulsory traffic only (every tensor read
+-- or written once), so GB/s is a lower bound on what the kernels moved.
+require 'nn'
+
+local cases = {}
+
+local function add(case)
+   cases[#cases + 1] = case
+end
+
+local function numel(...)
+   local n = 1
+   for _, d in ipairs{...} do n = n * d end
+   return n
+end
+
+----------------------------------------------------------------------
+-- convolutions: ResNet-50 and VGG-16 layers
+
+local convs = {
+   -- name,                 nIn, nOut, size, k, stride, pad
+   {'resnet50.conv1',         3,   64,  224, 7, 2, 3},
+   {'resnet50.res2.1x1',    256,   64,   56, 1, 1, 0},
+   {'resnet50.res2.3x3',     64,   64,   56, 3, 1, 1},
+   {'resnet50.res3.3x3',    128,  128,   28, 3, 1, 1},
+   {'resnet50.res4.3x3',    256,  256,   14, 3, 1, 1},
+   {'resnet50.res5.3x3',    512,  512,    7, 3, 1, 1},
+   {'vgg16.conv1_2',         64,   64,  224, 3, 1, 1},
+   {'vgg16.conv3_2',        256,  256,   56, 3, 1, 1},
+   {'vgg16.conv5_2',        512,  512,   14, 3, 1, 1},
+}
+
+for _, c in ipairs(convs) do
+   local name, nIn, nOut, size, k, s, p = unpack(c)
+   local out = math.floor((size + 2 * p - k) / s) + 1
+   add{
+      suite = 'conv',
+      name = 'SpatialConvolutionMM/' .. name,
+      build = function(bs)
+         local module = nn.SpatialConvolutionMM(nIn, nOut, k, k, s, s, p, p)
+         return module, torch.randn(bs, nIn, size, size), torch.randn(bs, nOut, out, out)
+      end,
+      flops = function(bs)
+         local f = 2 * bs * nOut * out * out * nIn * k * k
+         return f, 2 * f
+      end,
+      bytes = function(bs)
+         local i, o, w = numel(bs, nIn, size, size), numel(bs, nOut, out, out), numel(nOut, nIn, k, k)
+         return 4 * (i + o + w), 4 * (2 * i + 2 * o + 2 * w)
+      end,
+   }
+end
+
+-- locally connected: DeepFace-style layers, one filter bank per position
+local locals = {
+   -- name,             nIn, nOut, size, k
+   {'deepface.L4',       16,   16,   32, 9},
+   {'deepface.L5',       16,   16,   24, 7},
+}
+
+for _, c in ipairs(locals) do
+   local name, nIn, nOut, size, k = unpack(c)
+   local out = size - k + 1
+   add{
+      suite = 'conv',
+      name = 'SpatialConvolutionLocal/' .. name,
+      build = function(bs)
+         local module = nn.SpatialConvolutionLocal(nIn, nOut, size, size, k, k)
+         return module, torch.randn(bs, nIn, size, size), torch.randn(bs, nOut, out, out)
+      end,
+      flops = function(bs)
+         local f = 2 * bs * nOut * out * out * nIn * k * k
+         return f, 2 * f
+      end,
+      bytes = function(bs)
+         local i, o, w = numel(bs, nIn, size, size), numel(bs, nOut, out, out), numel(out * out, nOut, nIn * k * k)
+         return 4 * (i + o + w), 4 * (2 * i + 2 * o + 2 * w)
+      end,
+   }
+end
+
+----------------------------------------------------------------------
+-- pooling
+
+local pools = {
+   -- name,                     module,                 planes, size, k, stride, pad
+   {'resnet50.pool1',           'SpatialMaxPooling',        64,  112, 3, 2, 1},
+   {'vgg16.pool1',              'SpatialMaxPooling',        64,  224, 2, 2, 0},
+   {'vgg16.pool5',              'SpatialMaxPooling',       512,   14, 2, 2, 0},
+   {'resnet50.avgpool',         'SpatialAveragePooling',  2048,    7, 7, 1, 0},
+}
+
+for _, c in ipairs(pools) do
+   local name, kind, planes, size, k, s, p = unpack(c)
+   local out = math.floor((size + 2 * p - k) / s) + 1
+   add{
+      suite = 'pool',
+      name = kind .. '/' .. name,
+      build = function(bs)
+         local module = nn[kind](k, k, s, s, p, p)
+         return module, torch.randn(bs, planes, size, size), torch.randn(bs, planes, out, out)
+      end,
+      bytes = function(bs)
+         local i, o = numel(bs, planes, size, size), numel(bs, planes, out, out)
+         return 4 * (i + o), 4 * (i + 2 * o)
+      end,
+   }
+end
+
+----------------------------------------------------------------------
+-- batch normalization
+
+local bns = {
+   {'resnet50.res2', 64, 56},
+   {'resnet50.res2.expand', 256, 56},
+   {'resnet50.res3', 512, 28},
+   {'resnet50.res5', 2048, 7},
+}
+
+for _, c in ipairs(bns) do
+   local name, planes, size = unpack(c)
+   add{
+      suite = 'bn',
+      name = 'SpatialBatchNormalization/' .. name,
+      build = function(bs)
+         local module = nn.SpatialBatchNormalization(planes)
+         local input = torch.randn(bs, planes, size, size)
+         return module, input, torch.randn(bs, planes, size, size)
+      end,
+      bytes = function(bs)
+         local n = numel(bs, planes, size, size)
+         -- forward: statistics pass + normalization pass; backward: same
+         return 4 * 3 * n, 4 * 5 * n
+      end,
+   }
+end
+
+----------------------------------------------------------------------
+-- softmax over classifier and language model vocabularies
+
+local softmaxes = {
+   {'imagenet', 1000},
+   {'lm.10k', 10000},
+   {'lm.32k', 32000},
+   {'lm.100k', 100000},
+}
+
+for _, kind in ipairs{'SoftMax', 'LogSoftMax'} do
+   for _, c in ipairs(softmaxes) do
+      local name, dim = unpack(c)
+      add{
+         suite = 'softmax',
+         name = kind .. '/' .. name,
+         build = function(bs)
+            return nn[kind](), torch.randn(bs, dim), torch.randn(bs, dim)
+         end,
+         bytes = function(bs)
+            local n = numel(bs, dim)
+            return 4 * 2 * n, 4 * 3 * n
+         end,
+      }
+   end
+end
+
+----------------------------------------------------------------------
+-- criterions
+
+local function classTarget(bs, dim)
+   return torch.LongTensor(bs):random(1, dim)
+end
+
+for _, c in ipairs(softmaxes) do
+   local name, dim = unpack(c)
+   add{
+      suite = 'criterion',
+      name = 'ClassNLLCriterion/' .. name,
+      criterion = true,
+      targetIndex = true,
+      build = function(bs)
+         return nn.ClassNLLCriterion(), torch.randn(bs, dim), classTarget(bs, dim)
+      end,
+      bytes = function(bs)
+         return 4 * 2 * bs, 4 * (numel(bs, dim) + bs)
+      end,
+   }
+   add{
+      suite = 'criterion',
+      name = 'CrossEntropy/' .. name,
+      criterion = true,
+      targetIndex = true,
+      -- the fused kernels only exist on the device; CPU backends time the
+      -- LogSoftMax + ClassNLLCriterion pair they replace
+      build = function(bs, backend)
+         local module = backend == 'cuda' and nn.FusedCrossEntropyCriterion() or nn.CrossEntropyCriterion()
+         return module, torch.randn(bs, dim), classTarget(bs, dim)
+      end,
+      reference = function()
+         return nn.CrossEntropyCriterion()
+      end,
+      bytes = function(bs)
+         local n = numel(bs, dim)
+         return 4 * n, 4 * 2 * n
+      end,
+   }
+end
+
+add{
+   suite = 'criterion',
+   name = 'MSECriterion/4M',
+   criterion = true,
+   build = function(bs)
+      return nn.MSECriterion(), torch.randn(bs, 131072), torch.randn(bs, 131072)
+   end,
+   bytes = function(bs)
+      local n = numel(bs, 131072)
+      return 4 * 2 * n, 4 * 3 * n
+   end,
+}
+
+----------------------------------------------------------------------
+-- embeddings: LM vocabularies, batch x sequence indices
+
+local lookups = {
+   -- name,         vocab, dim, sequence length
+   {'vocab10k',     10000, 512, 35},
+   {'vocab100k',   100000, 512, 35},
+   {'vocab1M',    1000000, 128, 20},
+}
+
+for _, c in ipairs(lookups) do
+   local name, vocab, dim, seq = unpack(c)
+   add{
+      suite = 'lookup',
+      name = 'LookupTable/' .. name,
+      index = true,  -- input holds indices, not values
+      build = function(bs)
+         local module = nn.LookupTable(vocab, dim)
+         -- Zipf-like: a few very frequent rows, as in real text
+         local input = torch.rand(bs * seq):pow(3):mul(vocab - 1):floor():add(1):long()
+         return module, input, torch.randn(bs * seq, dim)
+      end,
+      bytes = function(bs)
+         local n = numel(bs, seq, dim)
+         return 4 * 2 * n, 4 * 3 * n
+      end,
+   }
+end
+
+return cases
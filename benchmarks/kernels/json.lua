@@ -0,0 +1,150 @@
+-- Just enough JSON for the baseline files: objects, arrays, strings, numbers
+-- and booleans. Object keys are written sorted so baselines diff cleanly.
+
+local json = {}
+
+local function encodeString(s)
+   return '"' .. s:gsub('[%c"\\]', function(c)
+      if c == '"' or c == '\\' then return '\\' .. c end
+      return string.format('\\u%04x', c:byte())
+   end) .. '"'
+end
+
+local function encode(v, indent)
+   local t = type(v)
+   if t == 'number' then
+      return string.format('%.6g', v)
+   elseif t == 'string' then
+      return encodeString(v)
+   elseif t == 'boolean' then
+      return tostring(v)
+   elseif t == 'table' then
+      local pad = string.rep('  ', indent + 1)
+      local items = {}
+      if #v > 0 then
+         for _, x in ipairs(v) do
+            items[#items + 1] = pad .. encode(x, indent + 1)
+         end
+         return '[\n' .. table.concat(items, ',\n') .. '\n' .. string.rep('  ', indent) .. ']'
+      end
+      local keys = {}
+      for k in pairs(v) do keys[#keys + 1] = tostring(k) end
+      table.sort(keys)
+      for _, k in ipairs(keys) do
+         items[#items + 1] = pad .. encodeString(k) .. ': ' .. encode(v[k], indent + 1)
+      end
+      if #items == 0 then return '{}' end
+      return '{\n' .. table.concat(items, ',\n') .. '\n' .. string.rep('  ', indent) .. '}'
+   end
+   error('cannot encode ' .. t)
+end
+
+function json.encode(v)
+   return encode(v, 0)
+end
+
+function json.decode(s)
+   local pos = 1
+
+   local function skip()
+      pos = s:find('[^%s]', pos) or #s + 1
+   end
+
+   local value
+
+   local function str()
+      local out = {}
+      pos = pos + 1
+      while true do
+         local c = s:sub(pos, pos)
+         if c == '"' then
+            pos = pos + 1
+            return table.concat(out)
+         elseif c == '\\' then
+            local e = s:sub(pos + 1, pos + 1)
+            if e == 'u' then
+               out[#out + 1] = string.char(tonumber(s:sub(pos + 2, pos + 5), 16) % 256)
+               pos = pos + 6
+            else
+               local map = {n = '\n', t = '\t', r = '\r', b = '\b', f = '\f'}
+               out[#out + 1] = map[e] or e
+               pos = pos + 2
+            end
+         elseif c == '' then
+            error('unterminated string in JSON')
+         else
+            out[#out + 1] = c
+            pos = pos + 1
+         end
+      end
+   end
+
+   function value()
+      skip()
+      local c = s:sub(pos, pos)
+      if c == '{' then
+         local obj = {}
+         pos = pos + 1
+         skip()
+         if s:sub(pos, pos) == '}' then pos = pos + 1 return obj end
+         while true do
+            skip()
+            local k = str()
+            skip()
+            assert(s:sub(pos, pos) == ':', 'expected : in JSON object')
+            pos = pos + 1
+            obj[k] = value()
+            skip()
+            c = s:sub(pos, pos)
+            pos = pos + 1
+            if c == '}' then return obj end
+            assert(c == ',', 'expected , in JSON object')
+         end
+      elseif c == '[' then
+         local arr = {}
+         pos = pos + 1
+         skip()
+         if s:sub(pos, pos) == ']' then pos = pos + 1 return arr end
+         while true do
+            arr[#arr + 1] = value()
+            skip()
+            c = s:sub(pos, pos)
+            pos = pos + 1
+            if c == ']' then return arr end
+            assert(c == ',', 'expected , in JSON array')
+         end
+      elseif c == '"' then
+         return str()
+      elseif s:sub(pos, pos + 3) == 'true' then
+         pos = pos + 4
+         return true
+      elseif s:sub(pos, pos + 4) == 'false' then
+         pos = pos + 5
+         return false
+      elseif s:sub(pos, pos + 3) == 'null' then
+         pos = pos + 4
+         return nil
+      end
+      local num = s:match('^-?[%d%.eE+-]+', pos)
+      assert(num, 'unexpected character in JSON at ' .. pos)
+      pos = pos + #num
+      return tonumber(num)
+   end
+
+   return value()
+end
+
+function json.load(path)
+   local f = assert(io.open(path, 'r'))
+   local s = f:read('*a')
+   f:close()
+   return json.decode(s)
+end
+
+function json.save(path, v)
+   local f = assert(io.open(path, 'w'))
+   f:write(json.encode(v), '\n')
+   f:close()
+end
+
+return json
@@ -4,5 +4,11 @@ require "cunn.THCUNN"
 
 require('cunn.test')
 require('cunn.DataParallelTable')
+require('cunn.FusedCrossEntropyCriterion')
+require('cunn.BatchNormalizationFolding')
+require('cunn.SpatialConvolutionWinograd')
+require('cunn.MaxPoolingCompactIndices')
+require('cunn.ConvolutionActivationFusion')
+require('cunn.PointwiseFused')
 
 nn.Module._flattenTensorBuffer['torch.CudaTensor'] = torch.FloatTensor.new
@@ -22,6 +22,8 @@ struct absupdateOutput_functor
 
 void THNN_CudaAbs_updateOutput(THCState *state, THCudaTensor *input, THCudaTensor *output)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   THCUNN_assertSameGPU(state, 2, input, output);
   THCudaTensor_resizeAs(state, output, input);
   THC_pointwiseApply2(state, output, input, absupdateOutput_functor());
@@ -39,6 +41,8 @@ struct absupdateGradInput_functor
 
 void THNN_CudaAbs_updateGradInput(THCState *state, THCudaTensor *input, THCudaTensor *gradOutput, THCudaTensor *gradInput)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   THCUNN_assertSameGPU(state, 3, input, gradOutput, gradInput);
   THCudaTensor_resizeAs(state, gradInput, input);
   THC_pointwiseApply3(state, gradInput, input, gradOutput, absupdateGradInput_functor());
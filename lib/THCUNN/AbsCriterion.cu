@@ -30,6 +30,8 @@ struct abs_functor
 
 void THNN_CudaAbsCriterion_updateOutput(THCState *state, THCudaTensor *input, THCudaTensor *target, THCudaTensor *output, bool sizeAverage)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   THCUNN_assertSameGPU(state, 2, input, target);
 
   long size = THCudaTensor_nElement(state, input);
@@ -84,6 +86,8 @@ struct abs_updateGradInput_functor
 
 void THNN_CudaAbsCriterion_updateGradInput(THCState *state, THCudaTensor *input, THCudaTensor *target, THCudaTensor *gradInput, bool sizeAverage)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   THCUNN_assertSameGPU(state, 3, input, target, gradInput);
 
   long size = THCudaTensor_nElement(state, input);
@@ -47,6 +47,8 @@ struct bce_functor_weights
 
 void THNN_CudaBCECriterion_updateOutput(THCState *state, THCudaTensor *input, THCudaTensor *target, THCudaTensor *output, bool sizeAverage, THCudaTensor *weights)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   THCUNN_assertSameGPU(state, 3, input, target, weights);
 
   long size = THCudaTensor_nElement(state, input);
@@ -139,6 +141,8 @@ struct bce_updateGradInput_functor_weights
 
 void THNN_CudaBCECriterion_updateGradInput(THCState *state, THCudaTensor *input, THCudaTensor *target, THCudaTensor *gradInput, bool sizeAverage, THCudaTensor *weights)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   THCUNN_assertSameGPU(state, 4, input, target, gradInput, weights);
 
   long size = THCudaTensor_nElement(state, input);
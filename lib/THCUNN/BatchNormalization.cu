@@ -1,31 +1,28 @@
 #include "hip/hip_runtime.h"
 #include "THCUNN.h"
 #include "common.h"
+#include "workspace.h"
+#include "wavefront.h"
 
 #include "THCDeviceTensor.cuh"
 #include "THCDeviceTensorUtils.cuh"
 
-const int WARP_SIZE = 32;
+#include <algorithm>
+
 typedef THCDeviceTensor<float, 3> DeviceTensor3;
 typedef THCDeviceTensor<float, 1> DeviceTensor1;
 
 // The maximum number of threads in a block
 const int MAX_BLOCK_SIZE = 512;
 
-// Number of threads in a block given an input size up to MAX_BLOCK_SIZE
+// Number of threads in a block given an input size up to MAX_BLOCK_SIZE: a
+// power of two, and at least one wavefront
 static int getNumThreads(int nElem) {
-  int threadSizes[5] = { 32, 64, 128, 256, MAX_BLOCK_SIZE };
-  for (int i = 0; i != 5; ++i) {
-    if (nElem <= threadSizes[i]) {
-      return threadSizes[i];
-    }
+  int threads = WAVEFRONT_SIZE;
+  while (threads < nElem && threads < MAX_BLOCK_SIZE) {
+    threads *= 2;
   }
-  return MAX_BLOCK_SIZE;
-}
-
-// Returns the index of the most significant 1 bit in `val`.
-__device__ __forceinline__ int getMSB(int val) {
-  return 31 - __clz(val);
+  return threads;
 }
 
 struct Float2 {
@@ -71,28 +68,8 @@ struct GradOp {
   const DeviceTensor3 gradOutput;
 };
 
-// Sum across all threads within a warp
-static __device__ __forceinline__ float warpSum(float val) {
-#if __CUDA_ARCH__ >= 300
-  for (int i = 0; i < getMSB(WARP_SIZE); ++i) {
-    val += __shfl_xor(val, 1 << i, WARP_SIZE);
-  }
-#else
-  __shared__ float values[MAX_BLOCK_SIZE];
-  values[hipThreadIdx_x] = val;
-  __threadfence_block();
-  const int base = (hipThreadIdx_x / WARP_SIZE) * WARP_SIZE;
-  for (int i = 1; i < WARP_SIZE; i++) {
-    val += values[base + ((i + hipThreadIdx_x) % WARP_SIZE)];
-  }
-#endif
-  return val;
-}
-
-static __device__ __forceinline__ Float2 warpSum(Float2 value) {
-  value.v1 = warpSum(value.v1);
-  value.v2 = warpSum(value.v2);
-  return value;
+static __device__ __forceinline__ Float2 waveShflXor(Float2 value, int mask, int width) {
+  return Float2(waveShflXor(value.v1, mask, width), waveShflXor(value.v2, mask, width));
 }
 
 // Sum across (batch, x/y/z) applying Op() pointwise
@@ -105,30 +82,118 @@ __device__ T reduce(Op op, DeviceTensor3 tensor, int plane) {
     }
   }
 
-  // sum over NumThreads within a warp
-  sum = warpSum(sum);
+  // Everyone gets the sum over the block
+  return blockReduce(sum, WaveSum(), (T)0);
+}
 
-  // 'transpose', and reduce within warp again
-  __shared__ T sharedv[32];
-  __syncthreads();
-  if (hipThreadIdx_x % WARP_SIZE == 0) {
-    sharedv[hipThreadIdx_x / WARP_SIZE] = sum;
+// Split reductions
+//
+// The kernels above give each plane a single block, which leaves most of the
+// device idle when there are few planes over large maps (e.g. 3-32 channels
+// at 512x512). The kernels below split the (batch, x/y/z) elements of every
+// plane into `chunks` contiguous ranges, one block each: a first pass writes
+// per-chunk partial results, a second pass with one block per plane merges
+// them, and a third applies the result elementwise over the same grid. The
+// forward statistics use Welford's single-pass update and its pairwise merge,
+// so mean and variance come out of one read of the input without the
+// cancellation of sum / sum-of-squares.
+
+// Blocks wanted per compute unit before a plane is split
+const int SPLIT_BLOCKS_PER_CU = 4;
+// Elements per thread below which a chunk is not worth a block
+const int SPLIT_MIN_PER_THREAD = 16;
+const int SPLIT_MAX_CHUNKS = 1024;
+
+// Number of blocks each plane is split across; 1 selects the one block per
+// plane kernels
+static int getNumChunks(THCState *state, int planes, long n) {
+  hipDeviceProp_t *prop = THCState_getCurrentDeviceProperties(state);
+  long wanted = (long)SPLIT_BLOCKS_PER_CU * prop->multiProcessorCount;
+  if (planes >= wanted) {
+    return 1;
   }
-  if (hipThreadIdx_x >= hipBlockDim_x / WARP_SIZE && hipThreadIdx_x < WARP_SIZE) {
-    // zero out the other entries in shared
-    sharedv[hipThreadIdx_x] = (T)0;
+  long chunks = (wanted + planes - 1) / planes;
+  chunks = std::min(chunks, n / (MAX_BLOCK_SIZE * SPLIT_MIN_PER_THREAD));
+  chunks = std::min(chunks, (long)SPLIT_MAX_CHUNKS);
+  return chunks > 1 ? (int)chunks : 1;
+}
+
+// Count, mean and sum of squared deviations of a set of values
+struct Welford {
+  float n, mean, m2;
+  __device__ Welford() : n(0), mean(0), m2(0) {}
+  __device__ Welford(float n, float mean, float m2) : n(n), mean(mean), m2(m2) {}
+
+  __device__ __forceinline__ void push(float v) {
+    n += 1;
+    float delta = v - mean;
+    mean += delta / n;
+    m2 += delta * (v - mean);
   }
-  __syncthreads();
-  if (hipThreadIdx_x / WARP_SIZE == 0) {
-    sum = warpSum(sharedv[hipThreadIdx_x]);
-    if (hipThreadIdx_x == 0) {
-      sharedv[0] = sum;
+
+  __device__ __forceinline__ void merge(const Welford& o) {
+    if (o.n == 0) {
+      return;
+    }
+    if (n == 0) {
+      *this = o;
+      return;
     }
+    float total = n + o.n;
+    float delta = o.mean - mean;
+    mean += delta * (o.n / total);
+    m2 += o.m2 + delta * delta * (n * o.n / total);
+    n = total;
+  }
+};
+
+static __device__ __forceinline__ Welford waveShflXor(const Welford& w, int mask, int width) {
+  return Welford(waveShflXor(w.n, mask, width), waveShflXor(w.mean, mask, width),
+                 waveShflXor(w.m2, mask, width));
+}
+
+struct WelfordMerge {
+  __device__ __forceinline__ Welford operator()(Welford a, const Welford& b) const {
+    a.merge(b);
+    return a;
+  }
+};
+
+// Merges the values of all threads of the block; the result is valid in
+// thread 0. Welford has a constructor, so the per-wavefront results go
+// through shared memory as floats rather than through blockReduce.
+static __device__ Welford blockWelford(Welford w) {
+  __shared__ float sn[MAX_BLOCK_SIZE / WAVEFRONT_SIZE];
+  __shared__ float smean[MAX_BLOCK_SIZE / WAVEFRONT_SIZE];
+  __shared__ float sm2[MAX_BLOCK_SIZE / WAVEFRONT_SIZE];
+  int lane = hipThreadIdx_x % WAVEFRONT_SIZE;
+  int wave = hipThreadIdx_x / WAVEFRONT_SIZE;
+  int waves = hipBlockDim_x / WAVEFRONT_SIZE;
+
+  w = waveReduce(w, WelfordMerge());
+  if (lane == 0) {
+    sn[wave] = w.n;
+    smean[wave] = w.mean;
+    sm2[wave] = w.m2;
   }
   __syncthreads();
+  if (wave == 0) {
+    w = lane < waves ? Welford(sn[lane], smean[lane], sm2[lane]) : Welford();
+    w = waveReduce(w, WelfordMerge());
+  }
+  return w;
+}
 
-  // Everyone picks it up, should be broadcast into the whole gradInput
-  return sharedv[0];
+// Sums Float2 values over the block
+static __device__ Float2 blockSum(Float2 v) {
+  return blockReduce(v, WaveSum(), Float2(0));
+}
+
+// Range [begin, end) of the flattened (batch, x/y/z) elements of a plane
+// covered by block hipBlockIdx_x
+static __device__ __forceinline__ void chunkRange(int n, int chunkSize, int *begin, int *end) {
+  *begin = hipBlockIdx_x * chunkSize;
+  *end = min(*begin + chunkSize, n);
 }
 
 template <int Dim>
@@ -229,11 +294,101 @@ __global__ void BatchNormalizationUpdateOutput_kernel(
   }
 }
 
+// grid (chunks, planes): per-chunk Welford states into partial[plane][chunk]
+__global__ void BatchNormalizationStatsPartial_kernel(
+    const DeviceTensor3 input,
+    float *partial,
+    int chunkSize) {
+
+  int plane = hipBlockIdx_y;
+  int spatial = input.getSize(2);
+  int begin, end;
+  chunkRange(input.getSize(0) * spatial, chunkSize, &begin, &end);
+
+  Welford w;
+  for (int i = begin + hipThreadIdx_x; i < end; i += hipBlockDim_x) {
+    int batch = i / spatial;
+    w.push(input[batch][plane][i - batch * spatial].ldg());
+  }
+  w = blockWelford(w);
+
+  if (hipThreadIdx_x == 0) {
+    float *out = partial + 3 * (plane * hipGridDim_x + hipBlockIdx_x);
+    out[0] = w.n;
+    out[1] = w.mean;
+    out[2] = w.m2;
+  }
+}
+
+// one block per plane: merges the chunks and saves the statistics
+__global__ void BatchNormalizationStatsMerge_kernel(
+    const float *partial,
+    int chunks,
+    const float epsilon,
+    const float momentum,
+    DeviceTensor1 runningMean,
+    DeviceTensor1 runningVar,
+    DeviceTensor1 saveMean,
+    DeviceTensor1 saveStd) {
+
+  int plane = hipBlockIdx_x;
+  Welford w;
+  for (int c = hipThreadIdx_x; c < chunks; c += hipBlockDim_x) {
+    const float *p = partial + 3 * (plane * chunks + c);
+    w.merge(Welford(p[0], p[1], p[2]));
+  }
+  w = blockWelford(w);
+
+  if (hipThreadIdx_x == 0) {
+    float varN = w.m2;
+    float invStd = 0.0f;
+    if (varN != 0.0f || epsilon != 0.0f) {
+      invStd = 1 / sqrt(varN / w.n + epsilon);
+    }
+    float unbiasedVar = varN / (w.n - 1);
+    saveMean[plane] = w.mean;
+    saveStd[plane] = invStd;
+    runningMean[plane] = (1 - momentum) * runningMean[plane] + momentum * w.mean;
+    runningVar[plane] = (1 - momentum) * runningVar[plane] + momentum * unbiasedVar;
+  }
+}
+
+// grid (chunks, planes): output = gamma * (input - mean) * invstd + beta, with
+// invstd read from `scale` or, if fromVar, computed from it as a variance
+__global__ void BatchNormalizationNormalize_kernel(
+    const DeviceTensor3 input,
+    DeviceTensor3 output,
+    const DeviceTensor1 mean,
+    const DeviceTensor1 scale,
+    const DeviceTensor1 weight,
+    const DeviceTensor1 bias,
+    float epsilon,
+    bool fromVar,
+    int chunkSize) {
+
+  int plane = hipBlockIdx_y;
+  int spatial = input.getSize(2);
+  int begin, end;
+  chunkRange(input.getSize(0) * spatial, chunkSize, &begin, &end);
+
+  float m = mean[plane].ldg();
+  float invstd = fromVar ? 1.0f / sqrt(scale[plane].ldg() + epsilon) : scale[plane].ldg();
+  float gamma = weight.numElements() > 0 ? weight[plane].ldg() : 1.0f;
+  float beta = bias.numElements() > 0 ? bias[plane].ldg() : 0.0f;
+
+  for (int i = begin + hipThreadIdx_x; i < end; i += hipBlockDim_x) {
+    int batch = i / spatial;
+    int x = i - batch * spatial;
+    output[batch][plane][x] = gamma * (input[batch][plane][x].ldg() - m) * invstd + beta;
+  }
+}
+
 void THNN_CudaBatchNormalization_updateOutput(
   THCState *state, THCudaTensor *input_, THCudaTensor *output_,
   THCudaTensor *weight_, THCudaTensor *bias_, THCudaTensor *runningMean_,
   THCudaTensor *runningVar_, THCudaTensor *saveMean_, THCudaTensor *saveStd_,
   bool train, double momentum, double eps) {
+  THCUNN_PROFILE_FUNC(state);
 
   THCUNN_assertSameGPU(state, 8, input_, output_, weight_, bias_, runningMean_,
     runningVar_, saveMean_, saveStd_);
@@ -247,16 +402,46 @@ void THNN_CudaBatchNormalization_updateOutput(
   DeviceTensor1 saveStd = devicetensor<1>(state, saveStd_);
 
   hipStream_t s = THCState_getCurrentStream(state);
-  hipDeviceProp_t *prop = THCState_getCurrentDeviceProperties(state);
-
-  if (!train) {
+  int planes = input.getSize(1);
+  int n = input.getSize(0) * input.getSize(2);
+  int chunks = getNumChunks(state, planes, n);
+
+  if (chunks > 1) {
+    int chunkSize = (n + chunks - 1) / chunks;
+    dim3 grid(chunks, planes);
+    dim3 threads(MAX_BLOCK_SIZE);
+    if (!train) {
+      THCUNN_PROFILE_LAUNCH(grid, threads);
+      hipLaunchKernelGGL((BatchNormalizationNormalize_kernel), dim3(grid), dim3(threads), 0, s,
+        input, output, runningMean, runningVar, weight, bias, eps, true, chunkSize);
+    } else {
+      THCudaTensor *partial_ = THCudaTensor_new(state);
+      {
+        THCUNNWorkspace workspace(state);
+        workspace.borrow2d(partial_, planes, 3 * chunks);
+        float *partial = THCudaTensor_data(state, partial_);
+        THCUNN_PROFILE_LAUNCH(grid, threads);
+        hipLaunchKernelGGL((BatchNormalizationStatsPartial_kernel), dim3(grid), dim3(threads), 0, s,
+          input, partial, chunkSize);
+        THCUNN_PROFILE_LAUNCH(planes, dim3(getNumThreads(chunks)));
+        hipLaunchKernelGGL((BatchNormalizationStatsMerge_kernel), dim3(planes), dim3(getNumThreads(chunks)), 0, s,
+          partial, chunks, eps, momentum, runningMean, runningVar, saveMean, saveStd);
+        THCUNN_PROFILE_LAUNCH(grid, threads);
+        hipLaunchKernelGGL((BatchNormalizationNormalize_kernel), dim3(grid), dim3(threads), 0, s,
+          input, output, saveMean, saveStd, weight, bias, eps, false, chunkSize);
+      }
+      THCudaTensor_free(state, partial_);
+    }
+  } else if (!train) {
     dim3 blocks(input.getSize(1));
     dim3 threads(getNumThreads(input.getSize(2)));
+    THCUNN_PROFILE_LAUNCH(blocks, threads);
     hipLaunchKernelGGL((BatchNormalizationUpdateOutputInference_kernel), dim3(blocks), dim3(threads), 0, s, 
       input, output, runningMean, runningVar, weight, bias, eps);
   } else {
     dim3 blocks(input.getSize(1));
     dim3 threads(getNumThreads(input.getSize(2)));
+    THCUNN_PROFILE_LAUNCH(blocks, threads);
     hipLaunchKernelGGL((BatchNormalizationUpdateOutput_kernel), dim3(blocks), dim3(threads), 0, s, 
       input, output, weight, bias, eps, momentum, runningMean, runningVar,
       saveMean, saveStd);
@@ -333,11 +518,125 @@ __global__ void BatchNormalizationBackward_kernel(
   }
 }
 
+// grid (chunks, planes): per-chunk sums of gradOutput and of
+// (input - mean) * gradOutput into partial[plane][chunk]
+__global__ void BatchNormalizationGradPartial_kernel(
+    const DeviceTensor3 input,
+    const DeviceTensor3 gradOutput,
+    const DeviceTensor1 runningMean,
+    const DeviceTensor1 saveMean,
+    bool train,
+    float *partial,
+    int chunkSize) {
+
+  int plane = hipBlockIdx_y;
+  int spatial = gradOutput.getSize(2);
+  int begin, end;
+  chunkRange(gradOutput.getSize(0) * spatial, chunkSize, &begin, &end);
+
+  GradOp op(train ? saveMean[plane] : runningMean[plane], input, gradOutput);
+  Float2 sum(0.0f);
+  for (int i = begin + hipThreadIdx_x; i < end; i += hipBlockDim_x) {
+    int batch = i / spatial;
+    sum += op(batch, plane, i - batch * spatial);
+  }
+  sum = blockSum(sum);
+
+  if (hipThreadIdx_x == 0) {
+    float *out = partial + 2 * (plane * (hipGridDim_x + 1) + hipBlockIdx_x);
+    out[0] = sum.v1;
+    out[1] = sum.v2;
+  }
+}
+
+// one block per plane: sums the chunks into partial[plane][chunks] and
+// accumulates gradWeight and gradBias
+__global__ void BatchNormalizationGradMerge_kernel(
+    float *partial,
+    int chunks,
+    DeviceTensor1 gradWeight,
+    DeviceTensor1 gradBias,
+    const DeviceTensor1 runningVar,
+    const DeviceTensor1 saveStd,
+    bool train,
+    float scale,
+    double eps) {
+
+  int plane = hipBlockIdx_x;
+  float *sums = partial + 2 * plane * (chunks + 1);
+  Float2 sum(0.0f);
+  for (int c = hipThreadIdx_x; c < chunks; c += hipBlockDim_x) {
+    sum += Float2(sums[2 * c], sums[2 * c + 1]);
+  }
+  sum = blockSum(sum);
+
+  if (hipThreadIdx_x == 0) {
+    float stdVal = train ? saveStd[plane] : 1 / sqrt(runningVar[plane] + eps);
+    sums[2 * chunks] = sum.v1;
+    sums[2 * chunks + 1] = sum.v2;
+    if (gradWeight.numElements() > 0) {
+      gradWeight[plane] += scale * sum.v2 * stdVal;
+    }
+    if (gradBias.numElements() > 0) {
+      gradBias[plane] += scale * sum.v1;
+    }
+  }
+}
+
+// grid (chunks, planes): gradInput from the merged sums
+__global__ void BatchNormalizationGradInput_kernel(
+    const DeviceTensor3 input,
+    const DeviceTensor3 gradOutput,
+    DeviceTensor3 gradInput,
+    const DeviceTensor1 weight,
+    const DeviceTensor1 runningMean,
+    const DeviceTensor1 runningVar,
+    const DeviceTensor1 saveMean,
+    const DeviceTensor1 saveStd,
+    const float *partial,
+    bool train,
+    double eps,
+    int chunkSize) {
+
+  int plane = hipBlockIdx_y;
+  int spatial = gradOutput.getSize(2);
+  int n = gradOutput.getSize(0) * spatial;
+  int begin, end;
+  chunkRange(n, chunkSize, &begin, &end);
+
+  float mean, stdVal;
+  if (train) {
+    mean = saveMean[plane];
+    stdVal = saveStd[plane];
+  } else {
+    mean = runningMean[plane];
+    stdVal = 1 / sqrt(runningVar[plane] + eps);
+  }
+  const float *sums = partial + 2 * (plane * (hipGridDim_x + 1) + hipGridDim_x);
+  float norm = 1.0f / n;
+  float gradMean = sums[0] * norm;
+  float projScale = sums[1] * norm * stdVal * stdVal;
+  float gradScale = stdVal * (weight.numElements() > 0 ? weight[plane] : 1.0f);
+
+  for (int i = begin + hipThreadIdx_x; i < end; i += hipBlockDim_x) {
+    int batch = i / spatial;
+    int x = i - batch * spatial;
+    float gradOut = gradOutput[batch][plane][x];
+    if (train) {
+      float proj = (input[batch][plane][x] - mean) * projScale;
+      gradInput[batch][plane][x] = (gradOut - proj - gradMean) * gradScale;
+    } else {
+      gradInput[batch][plane][x] = gradOut * gradScale;
+    }
+  }
+}
+
 void THNN_CudaBatchNormalization_backward(
   THCState *state, THCudaTensor *input_, THCudaTensor *gradOutput_,
   THCudaTensor *gradInput_, THCudaTensor *gradWeight_, THCudaTensor *gradBias_,
   THCudaTensor *weight_, THCudaTensor *runningMean_, THCudaTensor *runningVar_,
   THCudaTensor *saveMean_, THCudaTensor *saveStd_, bool train, float scale, double eps) {
+  THCUNN_PROFILE_FUNC(state);
 
   THCUNN_assertSameGPU(state, 10, input_, gradOutput_, gradInput_, gradWeight_,
     gradBias_, weight_, runningMean_, runningVar_, saveMean_, saveStd_);
@@ -353,11 +652,94 @@ void THNN_CudaBatchNormalization_backward(
   DeviceTensor1 saveStd = devicetensor<1>(state, saveStd_);
 
   hipStream_t s = THCState_getCurrentStream(state);
+  int planes = gradOutput.getSize(1);
+  int n = gradOutput.getSize(0) * gradOutput.getSize(2);
+  int chunks = getNumChunks(state, planes, n);
+
+  if (chunks > 1) {
+    int chunkSize = (n + chunks - 1) / chunks;
+    dim3 grid(chunks, planes);
+    dim3 threads(MAX_BLOCK_SIZE);
+    THCudaTensor *partial_ = THCudaTensor_new(state);
+    {
+      THCUNNWorkspace workspace(state);
+      workspace.borrow2d(partial_, planes, 2 * (chunks + 1));
+      float *partial = THCudaTensor_data(state, partial_);
+      THCUNN_PROFILE_LAUNCH(grid, threads);
+      hipLaunchKernelGGL((BatchNormalizationGradPartial_kernel), dim3(grid), dim3(threads), 0, s,
+        input, gradOutput, runningMean, saveMean, train, partial, chunkSize);
+      THCUNN_PROFILE_LAUNCH(planes, dim3(getNumThreads(chunks)));
+      hipLaunchKernelGGL((BatchNormalizationGradMerge_kernel), dim3(planes), dim3(getNumThreads(chunks)), 0, s,
+        partial, chunks, gradWeight, gradBias, runningVar, saveStd, train, scale, eps);
+      if (gradInput.numElements() > 0) {
+        THCUNN_PROFILE_LAUNCH(grid, threads);
+        hipLaunchKernelGGL((BatchNormalizationGradInput_kernel), dim3(grid), dim3(threads), 0, s,
+          input, gradOutput, gradInput, weight, runningMean, runningVar, saveMean, saveStd,
+          partial, train, eps, chunkSize);
+      }
+    }
+    THCudaTensor_free(state, partial_);
+  } else {
+    dim3 blocks(planes);
+    dim3 threads(getNumThreads(gradOutput.getSize(2)));
+    THCUNN_PROFILE_LAUNCH(blocks, threads);
+    hipLaunchKernelGGL((BatchNormalizationBackward_kernel), dim3(blocks), dim3(threads), 0, s, 
+      input, gradOutput, gradInput, gradWeight, gradBias, weight, runningMean, runningVar,
+      saveMean, saveStd, train, scale, eps);
+  }
+  THCudaCheck(hipGetLastError());
+}
+
+// Scales each output plane of a convolution by weight / sqrt(runningVar + eps)
+// and shifts its bias, so that the convolution alone computes convolution
+// followed by batch normalization in evaluation mode
+__global__ void BatchNormalizationFoldConvolution_kernel(
+    float *convWeight,
+    float *convBias,
+    const float *weight,
+    const float *bias,
+    const float *runningMean,
+    const float *runningVar,
+    int planes,
+    int planeSize,
+    float eps) {
+
+  CUDA_KERNEL_LOOP(i, planes * planeSize) {
+    int plane = i / planeSize;
+    convWeight[i] *= (weight ? weight[plane] : 1.0f) / sqrt(runningVar[plane] + eps);
+    if (i < planes) {
+      float scale = (weight ? weight[i] : 1.0f) / sqrt(runningVar[i] + eps);
+      convBias[i] = (convBias[i] - runningMean[i]) * scale + (bias ? bias[i] : 0.0f);
+    }
+  }
+}
 
-  dim3 blocks(gradOutput.getSize(1));
-  dim3 threads(getNumThreads(gradOutput.getSize(2)));
-  hipLaunchKernelGGL((BatchNormalizationBackward_kernel), dim3(blocks), dim3(threads), 0, s, 
-    input, gradOutput, gradInput, gradWeight, gradBias, weight, runningMean, runningVar,
-    saveMean, saveStd, train, scale, eps);
+void THNN_CudaBatchNormalization_foldConvolution(
+  THCState *state, THCudaTensor *convWeight, THCudaTensor *convBias,
+  THCudaTensor *weight, THCudaTensor *bias, THCudaTensor *runningMean,
+  THCudaTensor *runningVar, double eps) {
+  THCUNN_PROFILE_FUNC(state);
+
+  THCUNN_assertSameGPU(state, 6, convWeight, convBias, weight, bias, runningMean, runningVar);
+  THArgCheck(THCudaTensor_isContiguous(state, convWeight), 2, "convolution weight must be contiguous");
+  long planes = THCudaTensor_size(state, convWeight, 0);
+  THArgCheck(THCudaTensor_nElement(state, convBias) == planes, 3,
+             "convolution bias does not match the output planes");
+  THArgCheck(THCudaTensor_nElement(state, runningMean) == planes, 6,
+             "batch normalization does not match the output planes");
+  THArgCheck(THCudaTensor_nElement(state, runningVar) == planes, 7,
+             "batch normalization does not match the output planes");
+  THArgCheck(!weight || THCudaTensor_nElement(state, weight) == planes, 4,
+             "batch normalization does not match the output planes");
+  THArgCheck(!bias || THCudaTensor_nElement(state, bias) == planes, 5,
+             "batch normalization does not match the output planes");
+
+  long n = THCudaTensor_nElement(state, convWeight);
+  hipLaunchKernelGGL((BatchNormalizationFoldConvolution_kernel), dim3(GET_BLOCKS(n)), dim3(CUDA_NUM_THREADS), 0, THCState_getCurrentStream(state),
+    THCudaTensor_data(state, convWeight), THCudaTensor_data(state, convBias),
+    weight ? THCudaTensor_data(state, weight) : NULL,
+    bias ? THCudaTensor_data(state, bias) : NULL,
+    THCudaTensor_data(state, runningMean), THCudaTensor_data(state, runningVar),
+    planes, n / planes, eps);
   THCudaCheck(hipGetLastError());
 }
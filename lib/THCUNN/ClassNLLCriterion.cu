@@ -1,98 +1,43 @@
 #include "hip/hip_runtime.h"
 #include "THCUNN.h"
 #include "common.h"
+#include "nll_reduce.h"
 
 #include <stdio.h>
 #include <assert.h>
 
-static const int NTHREADS = 32;
-
-__global__ void cunn_ClassNLLCriterion_updateOutput_kernel1( float *output,
-                                                           float *total_weight,
-                                                           float *input,
-                                                           long  *target,
-                                                           float *weights,
-                                                           int size_average,
-                                                           int n_classes) {
-#if defined(__HIP_PLATFORM_NVCC__)
-  assert(hipThreadIdx_x == 0 && hipThreadIdx_y == 0 && hipThreadIdx_z == 0);
-#endif
-
-  // TODO: T4951791 Reuse code between updateOutput_kernel1 and
-  // updateOutput_kernel.
-
-  int t = (int)*target - TH_INDEX_BASE;
-#if defined(__HIP_PLATFORM_NVCC__)
-  assert(t >= 0 && t < n_classes);
-#endif
-  float cur_weight = weights ? weights[t] : 1.0f;
-  *output = -cur_weight * input[t];
-  *total_weight = cur_weight;
-  if (size_average && *total_weight > 0) {
-    *output /= *total_weight;
-  }
-}
-
-__global__ void cunn_ClassNLLCriterion_updateOutput_kernel( float *output,
-                                                           float *total_weight,
+// First stage of the loss reduction: each block sums its share of the frames
+// into partials[2*blockIdx] (loss) and partials[2*blockIdx+1] (weight).
+__global__ void cunn_ClassNLLCriterion_updateOutput_kernel( float *partials,
                                                            float *input,
                                                            long *target,
                                                            float *weights,
-                                                           int size_average,
                                                            int nframe,
                                                            int ndim,
                                                            int n_classes) {
-  __shared__ float shInputs[NTHREADS], acc_weight[NTHREADS];
   int i, t;
   float cur_weight;
+  float input_sum = 0.0f;
+  float acc_weight = 0.0f;
 
-  shInputs[hipThreadIdx_x] = 0.0f;
-  acc_weight[hipThreadIdx_x] = 0.0f;
-  for (i = hipThreadIdx_x; i < nframe; i += NTHREADS) {
+  for (i = hipBlockIdx_x * hipBlockDim_x + hipThreadIdx_x; i < nframe; i += hipBlockDim_x * hipGridDim_x) {
       t = target[i] - TH_INDEX_BASE;
 #if defined(__HIP_PLATFORM_NVCC__)
       assert(t >= 0 && t < n_classes);
 #endif
       cur_weight = weights ? weights[t] : 1.0f;
-      shInputs[hipThreadIdx_x] -= input[i * ndim + t] * cur_weight;
-      acc_weight[hipThreadIdx_x] += cur_weight;
+      input_sum -= input[i * ndim + t] * cur_weight;
+      acc_weight += cur_weight;
   }
-  __syncthreads();
 
-  // TODO: T4951791 Reuse code between updateOutput_kernel1 and
-  // updateOutput_kernel
+  nllReduceBlock(input_sum, acc_weight);
 
   if (hipThreadIdx_x == 0) {
-    *output = *total_weight = 0;
-    for (i = 0; i < NTHREADS; ++i){
-      *output += shInputs[i];
-      *total_weight += acc_weight[i];
-    }
-    if (size_average && *total_weight > 0) {
-      *output /= *total_weight;
-    }
+    partials[2 * hipBlockIdx_x] = input_sum;
+    partials[2 * hipBlockIdx_x + 1] = acc_weight;
   }
 }
 
-__global__ void cunn_ClassNLLCriterion_updateGradInput_kernel1( 
-  float* gradInput,
-  float* weights,
-  long* target,
-  float* total_weight,
-  int size_average,
-  int n_classes)
-{
-  if (*total_weight <= 0) {
-    return;
-  }
-  float norm = size_average ? (1.0f / *total_weight) : 1.0f;
-  int t = (int)*target - TH_INDEX_BASE;
-#if defined(__HIP_PLATFORM_NVCC__)
-  assert(t >= 0 && t < n_classes);
-#endif
-  gradInput[t] = -(weights ? weights[t] : 1.0f) * norm;
-}
-
 __global__ void cunn_ClassNLLCriterion_updateGradInput_kernel( 
   float *gradInput,
   long *target,
@@ -106,10 +51,10 @@ __global__ void cunn_ClassNLLCriterion_updateGradInput_kernel(
   if (*total_weight <= 0) {
     return;
   }
-  int i, t;
+  int t;
   float norm = size_average ? (1.0f / *total_weight) : 1.0f;
 
-  for (i = hipThreadIdx_x; i < nframe; i += NTHREADS) {
+  CUDA_KERNEL_LOOP(i, nframe) {
     t = (int)target[i] - TH_INDEX_BASE;
 #if defined(__HIP_PLATFORM_NVCC__)
     assert(t >= 0 && t < n_classes);
@@ -119,6 +64,8 @@ __global__ void cunn_ClassNLLCriterion_updateGradInput_kernel(
 }
 
 void THNN_CudaClassNLLCriterion_updateOutput(THCState *state, THCudaTensor *input, THCudaLongTensor *target, THCudaTensor *output, bool sizeAverage, THCudaTensor *weights, THCudaTensor *total_weight) {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   if (THCudaLongTensor_nDimension(state, target) > 1) {
     THError("multi-target not supported");
   }
@@ -153,40 +100,42 @@ void THNN_CudaClassNLLCriterion_updateOutput(THCState *state, THCudaTensor *inpu
   float *output_data = THCudaTensor_data(state, output);
   float *total_weight_data = THCudaTensor_data(state, total_weight);
 
-  if (THCudaTensor_nDimension(state, input) == 1) {
-    hipLaunchKernelGGL((cunn_ClassNLLCriterion_updateOutput_kernel1), dim3(1), dim3(1), 0, THCState_getCurrentStream(state), 
-        output_data,
-        total_weight_data,
-        input_data,
-        target_data,
-        weights_data,
-        sizeAverage,
-        n_classes
-    );
+  // A vector input is a batch of one frame
+  long nframe = n_dims == 1 ? 1 : THCudaTensor_size(state, input, 0);
+  int blocks = NLL_REDUCE_BLOCKS(nframe);
+  THCudaTensor *partials = THCudaTensor_newWithSize1d(state, 2 * blocks);
+
+  hipLaunchKernelGGL((cunn_ClassNLLCriterion_updateOutput_kernel), dim3(blocks), dim3(NLL_REDUCE_THREADS), 0, THCState_getCurrentStream(state), 
+      THCudaTensor_data(state, partials),
+      input_data,
+      target_data,
+      weights_data,
+      nframe,
+      n_classes,
+      n_classes
+  );
+  THCudaCheck(hipGetLastError());
 
-  } else if (THCudaTensor_nDimension(state, input) == 2) {
-    hipLaunchKernelGGL((cunn_ClassNLLCriterion_updateOutput_kernel), dim3(1), dim3(NTHREADS), 0, THCState_getCurrentStream(state), 
-        output_data,
-        total_weight_data,
-        input_data,
-        target_data,
-        weights_data,
-        sizeAverage,
-        THCudaTensor_size(state, input, 0),
-        THCudaTensor_size(state, input, 1),
-        n_classes
-    );
-  }
+  hipLaunchKernelGGL((cunn_NLLCriterion_reducePartials_kernel), dim3(1), dim3(NLL_REDUCE_THREADS), 0, THCState_getCurrentStream(state), 
+      output_data,
+      total_weight_data,
+      THCudaTensor_data(state, partials),
+      blocks,
+      sizeAverage
+  );
   THCudaCheck(hipGetLastError());
 
   if (weights) {
     THCudaTensor_free(state, weights);
   }
+  THCudaTensor_free(state, partials);
   THCudaLongTensor_free(state, target);
   THCudaTensor_free(state, input);
 }
 
 void THNN_CudaClassNLLCriterion_updateGradInput(THCState *state, THCudaTensor *input, THCudaLongTensor *target, THCudaTensor *gradInput, bool sizeAverage, THCudaTensor *weights, THCudaTensor *total_weight) {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   if (THCudaLongTensor_nDimension(state, target) > 1) {
     THError("multi-target not supported");
   }
@@ -222,27 +171,18 @@ void THNN_CudaClassNLLCriterion_updateGradInput(THCState *state, THCudaTensor *i
   long  *target_data = THCudaLongTensor_data(state, target);
   float *total_weight_data = THCudaTensor_data(state, total_weight);
 
-  if (THCudaTensor_nDimension(state, input) == 1) {
-    hipLaunchKernelGGL((cunn_ClassNLLCriterion_updateGradInput_kernel1), dim3(1), dim3(1), 0, THCState_getCurrentStream(state), 
-        gradInput_data,
-        weights_data,
-        target_data,
-        total_weight_data,
-        sizeAverage,
-        n_classes
-    );
-  } else {
-    hipLaunchKernelGGL((cunn_ClassNLLCriterion_updateGradInput_kernel), dim3(1), dim3(NTHREADS), 0, THCState_getCurrentStream(state), 
-        gradInput_data,
-        target_data,
-        weights_data,
-        total_weight_data,
-        sizeAverage,
-        THCudaTensor_size(state, input, 0),
-        THCudaTensor_size(state, input, 1),
-        n_classes
-    );
-  }
+  long nframe = n_dims == 1 ? 1 : THCudaTensor_size(state, input, 0);
+
+  hipLaunchKernelGGL((cunn_ClassNLLCriterion_updateGradInput_kernel), dim3(GET_BLOCKS(nframe)), dim3(CUDA_NUM_THREADS), 0, THCState_getCurrentStream(state), 
+      gradInput_data,
+      target_data,
+      weights_data,
+      total_weight_data,
+      sizeAverage,
+      nframe,
+      n_classes,
+      n_classes
+  );
   THCudaCheck(hipGetLastError());
 
   if (weights) {
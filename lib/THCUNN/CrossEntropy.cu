@@ -0,0 +1,229 @@
+#include "hip/hip_runtime.h"
+#include "THCUNN.h"
+#include "common.h"
+#include "nll_reduce.h"
+
+#include <float.h>
+#include <assert.h>
+
+// Fused LogSoftMax + ClassNLLCriterion. One block handles one row of logits:
+// a single read computes the running max and sum of exponentials, from which
+// the row's log-sum-exp and loss follow. The log-sum-exp is kept so that the
+// backward pass is one read and one write per logit, and may overwrite the
+// logits in place.
+
+const int CROSSENTROPY_MAX_THREADS = 1024;
+
+static int crossEntropy_threads(int classes)
+{
+  int threads = 64;
+  while (threads < classes && threads < CROSSENTROPY_MAX_THREADS)
+    threads *= 2;
+  return threads;
+}
+
+// Merges (max, sum of exp(x - max)) pairs
+__device__ __forceinline__ void crossEntropy_merge(float &max_a, float &sum_a,
+                                                   float max_b, float sum_b)
+{
+  float max_k = fmaxf(max_a, max_b);
+  sum_a = sum_a * expf(max_a - max_k) + sum_b * expf(max_b - max_k);
+  max_a = max_k;
+}
+
+struct CrossEntropyPartial
+{
+  float max_k, sum_k;
+};
+
+__device__ __forceinline__ CrossEntropyPartial waveShflXor(const CrossEntropyPartial &p, int mask, int width)
+{
+  CrossEntropyPartial o;
+  o.max_k = waveShflXor(p.max_k, mask, width);
+  o.sum_k = waveShflXor(p.sum_k, mask, width);
+  return o;
+}
+
+struct CrossEntropyMerge
+{
+  __device__ __forceinline__ CrossEntropyPartial operator()(CrossEntropyPartial a, const CrossEntropyPartial &b) const
+  {
+    crossEntropy_merge(a.max_k, a.sum_k, b.max_k, b.sum_k);
+    return a;
+  }
+};
+
+__global__ void cunn_CrossEntropy_updateOutput_kernel(
+  float *partials,
+  float *logsum,
+  float *input,
+  long *target,
+  float *weights,
+  int classes)
+{
+  int row = hipBlockIdx_x;
+  input += (long) row * classes;
+
+  float max_k = -FLT_MAX;
+  float sum_k = 0.0f;
+  for (int j = hipThreadIdx_x; j < classes; j += hipBlockDim_x) {
+    float x = input[j];
+    if (x > max_k) {
+      sum_k = sum_k * expf(max_k - x) + 1.0f;
+      max_k = x;
+    } else {
+      sum_k += expf(x - max_k);
+    }
+  }
+  CrossEntropyPartial p = { max_k, sum_k };
+  CrossEntropyPartial identity = { -FLT_MAX, 0.0f };
+  p = blockReduce(p, CrossEntropyMerge(), identity);
+
+  if (hipThreadIdx_x == 0) {
+    int t = (int) target[row] - TH_INDEX_BASE;
+#if defined(__HIP_PLATFORM_NVCC__)
+    assert(t >= 0 && t < classes);
+#endif
+    float lse = p.max_k + logf(p.sum_k);
+    float cur_weight = weights ? weights[t] : 1.0f;
+    logsum[row] = lse;
+    partials[2 * row] = (lse - input[t]) * cur_weight;
+    partials[2 * row + 1] = cur_weight;
+  }
+}
+
+// gradInput may alias input. Like ClassNLLCriterion, the gradient is zero
+// when the total weight is not positive.
+__global__ void cunn_CrossEntropy_updateGradInput_kernel(
+  float *gradInput,
+  float *input,
+  float *logsum,
+  long *target,
+  float *weights,
+  float *total_weight,
+  int size_average,
+  int classes)
+{
+  int row = hipBlockIdx_x;
+  input += (long) row * classes;
+  gradInput += (long) row * classes;
+
+  if (*total_weight <= 0) {
+    for (int j = hipThreadIdx_x; j < classes; j += hipBlockDim_x)
+      gradInput[j] = 0.0f;
+    return;
+  }
+  int t = (int) target[row] - TH_INDEX_BASE;
+  float norm = size_average ? (1.0f / *total_weight) : 1.0f;
+  float scale = (weights ? weights[t] : 1.0f) * norm;
+  float lse = logsum[row];
+
+  for (int j = hipThreadIdx_x; j < classes; j += hipBlockDim_x) {
+    float p = expf(input[j] - lse);
+    gradInput[j] = (j == t ? p - 1.0f : p) * scale;
+  }
+}
+
+static void THNN_CudaCrossEntropy_shapeCheck(THCState *state, THCudaTensor *input,
+                                             THCudaLongTensor *target, THCudaTensor *weights)
+{
+  int n_dims = THCudaTensor_nDimension(state, input);
+  THArgCheck(n_dims == 1 || n_dims == 2, 2, "vector or matrix expected");
+  THArgCheck(THCudaLongTensor_nDimension(state, target) == 1, 3, "1D target tensor expected");
+  long nframe = n_dims == 1 ? 1 : THCudaTensor_size(state, input, 0);
+  THArgCheck(THCudaLongTensor_size(state, target, 0) == nframe, 3, "input and target batch sizes differ");
+  if (weights && THCudaTensor_nElement(state, weights) != THCudaTensor_size(state, input, n_dims - 1)) {
+    THError("weight tensor should be defined either for all or no classes");
+  }
+}
+
+void THNN_CudaCrossEntropy_updateOutput(THCState *state, THCudaTensor *input, THCudaLongTensor *target, THCudaTensor *output, bool sizeAverage, THCudaTensor *weights, THCudaTensor *total_weight, THCudaTensor *logsum) {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
+  if (weights) {
+    THCUNN_assertSameGPU(state, 6, input, target, weights, output, total_weight, logsum);
+  } else {
+    THCUNN_assertSameGPU(state, 5, input, target, output, total_weight, logsum);
+  }
+  THNN_CudaCrossEntropy_shapeCheck(state, input, target, weights);
+
+  int n_dims = THCudaTensor_nDimension(state, input);
+  int classes = THCudaTensor_size(state, input, n_dims - 1);
+  long nframe = n_dims == 1 ? 1 : THCudaTensor_size(state, input, 0);
+
+  input = THCudaTensor_newContiguous(state, input);
+  weights = weights ? THCudaTensor_newContiguous(state, weights) : NULL;
+  target = THCudaLongTensor_newContiguous(state, target);
+  THCudaTensor_resize1d(state, logsum, nframe);
+
+  // One (loss, weight) partial per row, folded by the NLL second stage
+  THCudaTensor *partials = THCudaTensor_newWithSize1d(state, 2 * nframe);
+
+  hipLaunchKernelGGL((cunn_CrossEntropy_updateOutput_kernel), dim3(nframe), dim3(crossEntropy_threads(classes)), 0, THCState_getCurrentStream(state), 
+      THCudaTensor_data(state, partials),
+      THCudaTensor_data(state, logsum),
+      THCudaTensor_data(state, input),
+      THCudaLongTensor_data(state, target),
+      weights ? THCudaTensor_data(state, weights) : NULL,
+      classes
+  );
+  THCudaCheck(hipGetLastError());
+
+  hipLaunchKernelGGL((cunn_NLLCriterion_reducePartials_kernel), dim3(1), dim3(NLL_REDUCE_THREADS), 0, THCState_getCurrentStream(state), 
+      THCudaTensor_data(state, output),
+      THCudaTensor_data(state, total_weight),
+      THCudaTensor_data(state, partials),
+      nframe,
+      sizeAverage
+  );
+  THCudaCheck(hipGetLastError());
+
+  if (weights) {
+    THCudaTensor_free(state, weights);
+  }
+  THCudaTensor_free(state, partials);
+  THCudaLongTensor_free(state, target);
+  THCudaTensor_free(state, input);
+}
+
+void THNN_CudaCrossEntropy_updateGradInput(THCState *state, THCudaTensor *input, THCudaLongTensor *target, THCudaTensor *gradInput, bool sizeAverage, THCudaTensor *weights, THCudaTensor *total_weight, THCudaTensor *logsum) {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
+  if (weights) {
+    THCUNN_assertSameGPU(state, 6, input, target, weights, gradInput, total_weight, logsum);
+  } else {
+    THCUNN_assertSameGPU(state, 5, input, target, gradInput, total_weight, logsum);
+  }
+  THNN_CudaCrossEntropy_shapeCheck(state, input, target, weights);
+  THArgCheck(THCudaTensor_isContiguous(state, input), 2, "input must be contiguous");
+
+  int n_dims = THCudaTensor_nDimension(state, input);
+  int classes = THCudaTensor_size(state, input, n_dims - 1);
+  long nframe = n_dims == 1 ? 1 : THCudaTensor_size(state, input, 0);
+  THArgCheck(THCudaTensor_nElement(state, logsum) == nframe, 8, "logsum does not match input, call updateOutput first");
+
+  // Writing the gradient over the logits is allowed (in-place)
+  if (gradInput != input) {
+    THCudaTensor_resizeAs(state, gradInput, input);
+  }
+
+  weights = weights ? THCudaTensor_newContiguous(state, weights) : NULL;
+  target = THCudaLongTensor_newContiguous(state, target);
+
+  hipLaunchKernelGGL((cunn_CrossEntropy_updateGradInput_kernel), dim3(nframe), dim3(crossEntropy_threads(classes)), 0, THCState_getCurrentStream(state), 
+      THCudaTensor_data(state, gradInput),
+      THCudaTensor_data(state, input),
+      THCudaTensor_data(state, logsum),
+      THCudaLongTensor_data(state, target),
+      weights ? THCudaTensor_data(state, weights) : NULL,
+      THCudaTensor_data(state, total_weight),
+      sizeAverage,
+      classes
+  );
+  THCudaCheck(hipGetLastError());
+
+  if (weights) {
+    THCudaTensor_free(state, weights);
+  }
+  THCudaLongTensor_free(state, target);
+}
@@ -51,6 +51,8 @@ struct ELUupdateOutputIP_functor
 void THNN_CudaELU_updateOutput(THCState *state, THCudaTensor *input, THCudaTensor *output,
   float alpha, bool inplace)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   THCUNN_assertSameGPU(state, 2, input, output);
 
   if (inplace)
@@ -114,6 +116,8 @@ struct ELUupdateGradInputIP_functor
 void THNN_CudaELU_updateGradInput(THCState *state, THCudaTensor *input, THCudaTensor *gradOutput,
   THCudaTensor *gradInput, THCudaTensor *output, float alpha, bool inplace)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   THCUNN_assertSameGPU(state, 3, output, gradOutput, gradInput);
 
   if (inplace)
@@ -42,6 +42,8 @@ void THNN_CudaHardTanh_updateOutput(
       float max_val,
       bool inplace)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   THCUNN_assertSameGPU(state, 2, input, output);
   if(inplace)
   {
@@ -94,6 +96,8 @@ void THNN_CudaHardTanh_updateGradInput(
     float max_val,
     bool inplace)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   THCUNN_assertSameGPU(state, 3, input, gradOutput, gradInput);
 
   if (inplace)
@@ -0,0 +1,172 @@
+#include "THCUNN.h"
+#include "common.h"
+#include "implicit_gemm.h"
+#include "tuning.h"
+
+#include <limits.h>
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <sstream>
+
+// Passes each path runs per shape bucket before the choice is made; only the
+// last one of each is timed, the others warm up the kernels and workspace.
+#define IMPLICIT_GEMM_TRIALS 2
+
+// -1: always use the columns path, 0: choose per pass, 1: always implicit
+static int implicitGemm_mode = 0;
+
+// Trials in progress, by device, pass and shape bucket. Paths that are not
+// candidates keep a time of -1.
+struct ImplicitGemmTrials
+{
+  int started;
+  int timed;
+  float time[IMPLICIT_GEMM_PATHS];
+};
+
+static std::mutex implicitGemm_mutex;
+static std::map<std::string, ImplicitGemmTrials> implicitGemm_trials;
+
+// The timed trial open on this thread. A THError longjmps past the
+// destructor of its choice, so a trial still open when the thread starts
+// the next pass failed: its events are destroyed and its bucket restarts.
+struct ImplicitGemmOpenTrial
+{
+  std::string key;
+  hipEvent_t start, stop;
+};
+
+static thread_local ImplicitGemmOpenTrial implicitGemm_open;
+
+static void implicitGemm_dropStale()
+{
+  if (implicitGemm_open.key.empty())
+    return;
+  if (implicitGemm_open.start)
+    hipEventDestroy(implicitGemm_open.start);
+  if (implicitGemm_open.stop)
+    hipEventDestroy(implicitGemm_open.stop);
+  {
+    std::lock_guard<std::mutex> lock(implicitGemm_mutex);
+    implicitGemm_trials.erase(implicitGemm_open.key);
+  }
+  implicitGemm_open.key.clear();
+}
+
+void THNN_CudaConvolution_setImplicitGemm(THCState *state, int mode) {
+  THCUNN_PROFILE_FUNC(state);
+  THArgCheck(mode >= -1 && mode <= 1, 2, "mode should be -1, 0 or 1");
+  implicitGemm_mode = mode;
+}
+
+ImplicitGemmChoice::ImplicitGemmChoice(THCState *state, const char *pass, bool atomic)
+  : state_(state), pass_(pass), atomic_(atomic), candidates_(0), size_(0), path_(-1),
+    paths_(0)
+{
+  implicitGemm_dropStale();
+}
+
+int ImplicitGemmChoice::path(const ConvGeometry &g, bool winograd) {
+  // the kernels index with int
+  long inputSize = (long)g.batch * g.channels * g.inSize();
+  long outputSize = (long)g.batch * g.planes * g.outSize();
+  long rows = (long)(g.channels > g.planes ? g.channels : g.planes) * g.kSize();
+  bool fits = inputSize <= INT_MAX && outputSize <= INT_MAX && rows * g.outSize() <= INT_MAX;
+
+  // The path setImplicitGemm asks for, or the columns path when it is the
+  // one to measure against
+  int regular = implicitGemm_mode > 0 && fits ? IMPLICIT_GEMM_IMPLICIT : IMPLICIT_GEMM_COLUMNS;
+  if (!tuning_enabled())
+    return regular;
+  std::vector<int> paths(1, regular);
+  if (implicitGemm_mode == 0 && fits && !atomic_)
+    paths.push_back(IMPLICIT_GEMM_IMPLICIT);
+  if (winograd)
+    paths.push_back(IMPLICIT_GEMM_WINOGRAD);
+  if (paths.size() == 1)
+    return regular;
+
+  // The GEMM is (planes x channels*kSize) by (channels*kSize x batch*outSize)
+  // in every pass, transposed differently. Choices that include Winograd
+  // are told apart by the paths they were made between.
+  std::ostringstream kernel;
+  kernel << pass_ << '/' << THCUNNTuningCache::bucket(g.planes)
+         << 'x' << THCUNNTuningCache::bucket((long)g.channels * g.kSize());
+  if (winograd) {
+    kernel << "/paths";
+    for (size_t i = 0; i < paths.size(); i++)
+      kernel << paths[i];
+  }
+  device_ = tuning_device(state_);
+  kernel_ = kernel.str();
+  size_ = (long)g.batch * g.outSize();
+  candidates_ = winograd ? IMPLICIT_GEMM_PATHS : 2;
+  int choice;
+  if (tuning_lookup(device_, kernel_.c_str(), size_, candidates_, &choice) &&
+      std::find(paths.begin(), paths.end(), choice) != paths.end())
+    return choice;
+
+  std::ostringstream key;
+  key << device_ << '\t' << kernel_ << '\t' << THCUNNTuningCache::bucket(size_);
+  int n = paths.size();
+  int trial;
+  {
+    std::lock_guard<std::mutex> lock(implicitGemm_mutex);
+    std::map<std::string, ImplicitGemmTrials>::iterator it = implicitGemm_trials.find(key.str());
+    if (it == implicitGemm_trials.end()) {
+      ImplicitGemmTrials trials = { 0, 0, { -1, -1, -1 } };
+      it = implicitGemm_trials.insert(std::make_pair(key.str(), trials)).first;
+    }
+    trial = it->second.started++;
+  }
+  // passes running concurrently with the last trials take the regular path
+  if (trial >= n * IMPLICIT_GEMM_TRIALS)
+    return regular;
+  int path = paths[trial % n];
+  if (trial >= n * (IMPLICIT_GEMM_TRIALS - 1)) {
+    implicitGemm_open.key = key.str();
+    implicitGemm_open.start = implicitGemm_open.stop = NULL;
+    THCudaCheck(hipEventCreate(&implicitGemm_open.start));
+    THCudaCheck(hipEventCreate(&implicitGemm_open.stop));
+    start_ = implicitGemm_open.start;
+    stop_ = implicitGemm_open.stop;
+    THCudaCheck(hipEventRecord(start_, THCState_getCurrentStream(state_)));
+    path_ = path;
+    paths_ = n;
+  }
+  return path;
+}
+
+// Destructors must return, so errors here only drop the measurement
+ImplicitGemmChoice::~ImplicitGemmChoice() {
+  if (path_ < 0)
+    return;
+  float ms = -1;
+  if (hipEventRecord(stop_, THCState_getCurrentStream(state_)) != hipSuccess ||
+      hipEventSynchronize(stop_) != hipSuccess ||
+      hipEventElapsedTime(&ms, start_, stop_) != hipSuccess)
+    ms = -1;
+  hipEventDestroy(start_);
+  hipEventDestroy(stop_);
+  std::string key;
+  key.swap(implicitGemm_open.key);
+
+  std::vector<float> times;
+  {
+    std::lock_guard<std::mutex> lock(implicitGemm_mutex);
+    std::map<std::string, ImplicitGemmTrials>::iterator it = implicitGemm_trials.find(key);
+    if (it == implicitGemm_trials.end())
+      return;
+    it->second.time[path_] = ms;
+    if (++it->second.timed < paths_)
+      return;
+    times.assign(it->second.time, it->second.time + candidates_);
+    implicitGemm_trials.erase(it);
+  }
+  int choice = THCUNNTuningCache::fastest(times);
+  if (choice >= 0)
+    tuning_record(device_, kernel_.c_str(), size_, candidates_, choice);
+}
+
+#undef IMPLICIT_GEMM_TRIALS
@@ -33,6 +33,8 @@ struct l1cost_functor
 
 void THNN_CudaL1Cost_updateOutput(THCState *state, THCudaTensor *input, THCudaTensor *output)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   THCUNN_assertSameGPU(state, 1, input);
   float sum;
   long size = THCudaTensor_nElement(state, input);
@@ -71,6 +73,8 @@ struct l1cost_updateGradInput_functor
 
 void THNN_CudaL1Cost_updateGradInput(THCState *state, THCudaTensor *input, THCudaTensor *gradOutput, THCudaTensor *gradInput)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   THCUNN_assertSameGPU(state, 2, input, gradInput);
   long size = THCudaTensor_nElement(state, input);
 
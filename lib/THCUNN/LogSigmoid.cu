@@ -15,6 +15,8 @@ struct logSigmoid_updateOutput_functor
 
 void THNN_CudaLogSigmoid_updateOutput(THCState *state, THCudaTensor *input, THCudaTensor *output, THCudaTensor *buffer)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   THCUNN_assertSameGPU(state, 2, input, output);
   THCudaTensor_resizeAs(state, output, input);
   THC_pointwiseApply2(state, output, input, logSigmoid_updateOutput_functor());
@@ -35,6 +37,8 @@ struct logSigmoid_updateGradInput_functor
 void THNN_CudaLogSigmoid_updateGradInput(THCState *state, THCudaTensor *input, THCudaTensor *gradOutput,
   THCudaTensor *gradInput , THCudaTensor *buffer)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   THCUNN_assertSameGPU(state, 3, input, gradOutput, gradInput);
   THCudaTensor_resizeAs(state, gradInput, input);
   THC_pointwiseApply3(state, gradInput, input, gradOutput, logSigmoid_updateGradInput_functor());
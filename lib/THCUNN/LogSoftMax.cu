@@ -1,6 +1,8 @@
 #include "hip/hip_runtime.h"
 #include "THCUNN.h"
 #include "common.h"
+#include "tuning.h"
+#include "wavefront.h"
 
 __global__ void cunn_SpatialLogSoftMax_updateOutput_kernel( float *output, float *input, int classSize, int height, int width)
 {
@@ -119,92 +121,6 @@ struct SumExpFloat
   const float max_k;
 };
 
-struct NoFinal
-{
-  __device__ __forceinline__ float operator()(float v) const
-  {
-    return v;
-  }
-};
-
-struct LSMFinal
-{
-  __device__ __forceinline__ LSMFinal(float m)
-    : max_k(m)
-  {}
-
-  __device__ __forceinline__ float operator()(float v) const
-  {
-    return max_k + logf(v);
-  }
-
-  const float max_k;
-};
-
-template <typename Reduction, typename Finalize>
-__device__ __forceinline__ float
-blockReduce(float* smem, float val,
-            const Reduction& r,
-            float defaultVal,
-            const Finalize& f)
-{
-  // To avoid RaW races from chaining blockReduce calls together, we
-  // need a sync here
-  __syncthreads();
-
-  smem[hipThreadIdx_x] = val;
-
-  __syncthreads();
-
-  float warpVal = defaultVal;
-
-  // First warp will perform per-warp reductions for the remaining warps
-  if ((hipThreadIdx_x / 32) == 0) // only threads in warp1 go into this (if)
-  {
-    int lane = hipThreadIdx_x % 32; // from 0 to 31
-
-    // if less than 1024 threads per block, then only activate the relevant lanes
-    if (lane < hipBlockDim_x / 32)
-    {
-#pragma unroll
-      for (int i = 0; i < 32; ++i)
-      {
-        warpVal = r(warpVal, smem[lane * 32 + i]);
-      }
-
-      smem[lane] = warpVal;
-    }
-  }
-
-  __syncthreads();
-
-  // First thread will perform a reduction of the above per-warp reductions
-  float blockVal = defaultVal;
-
-  if (hipThreadIdx_x == 0)
-  {
-    for (int i = 0; i < hipBlockDim_x / 32; ++i)
-    {
-      blockVal = r(blockVal, smem[i]);
-    }
-
-    smem[0] = f(blockVal);
-  }
-
-  // Sync and broadcast
-  __syncthreads();
-  return smem[0];
-}
-
-template <typename Reduction>
-__device__ __forceinline__ float
-blockReduce(float* smem, float val,
-            const Reduction& r,
-            float defaultVal)
-{
-  return blockReduce<Reduction, NoFinal>(smem, val, r, defaultVal, NoFinal());
-}
-
 template <typename Reduction, int ILP>
 __device__ __forceinline__ float
 ilpReduce(float* data,
@@ -248,8 +164,6 @@ template <int ILP>
 __global__ void
 cunn_LogSoftMax_updateOutput_kernel( float *output, float *input, int classes)
 {
-  //HIP_DYNAMIC_SHARED( float, buffer)
-  __shared__ float buffer[1024];
   // forward pointers to batch[hipBlockIdx_x]
   // each block handles a sample in the mini-batch
   input += hipBlockIdx_x * classes;
@@ -260,13 +174,12 @@ cunn_LogSoftMax_updateOutput_kernel( float *output, float *input, int classes)
     ilpReduce<MaxFloat, ILP>(input, classes, MaxFloat(), -FLT_MAX);
   // find the max over all batches
   float max_k =
-    blockReduce<MaxFloat>(buffer, threadMax, MaxFloat(), -FLT_MAX);
+    blockReduce(threadMax, MaxFloat(), -FLT_MAX);
 
   float threadExp =
     ilpReduce<SumExpFloat, ILP>(input, classes, SumExpFloat(max_k), 0.0f);
   float logsum_k =
-    blockReduce<SumFloat, LSMFinal>(
-      buffer, threadExp, SumFloat(), 0.0f, LSMFinal(max_k));
+    max_k + logf(blockReduce(threadExp, SumFloat(), 0.0f));
 
   // Output LSM (hand ILP)
   int offset = hipThreadIdx_x;
@@ -301,8 +214,6 @@ cunn_LogSoftMax_updateGradInput_kernel( float *gradInput,
                                        float *gradOutput,
                                        int classes)
 {
-  //HIP_DYNAMIC_SHARED( float, buffer)
-  __shared__ float buffer[1024];
   gradInput += hipBlockIdx_x * classes;
   output += hipBlockIdx_x * classes;
   gradOutput += hipBlockIdx_x * classes;
@@ -310,7 +221,7 @@ cunn_LogSoftMax_updateGradInput_kernel( float *gradInput,
   float threadSum =
     ilpReduce<SumFloat, 4>(gradOutput, classes, SumFloat(), 0.0f);
   float sum_k =
-    blockReduce<SumFloat>(buffer, threadSum, SumFloat(), 0.0f);
+    blockReduce(threadSum, SumFloat(), 0.0f);
 
   // Update gradInput (hand ILP)
   int offset = hipThreadIdx_x;
@@ -350,8 +261,47 @@ cunn_LogSoftMax_updateGradInput_kernel( float *gradInput,
   }
 }
 
+// Block sizes the block reduction supports (whole wavefronts, up to 1024),
+// tried by the tuner; the first is the default
+static const int LOGSOFTMAX_BLOCKS[] = {1024, 512, 256, 128};
+#define LOGSOFTMAX_NUM_BLOCKS 4
+
+struct LogSoftMaxForward
+{
+  THCState *state;
+  float *output, *input;
+  int batchSize, classSize;
+
+  void operator()(int i) const
+  {
+    dim3 grid(batchSize);
+    dim3 block(LOGSOFTMAX_BLOCKS[i]);
+    THCUNN_PROFILE_LAUNCH(grid, block);
+    hipLaunchKernelGGL((cunn_LogSoftMax_updateOutput_kernel<2>), dim3(grid), dim3(block), 0, THCState_getCurrentStream(state),
+        output, input, classSize);
+  }
+};
+
+struct LogSoftMaxBackward
+{
+  THCState *state;
+  float *gradInput, *output, *gradOutput;
+  int batchSize, classSize;
+
+  void operator()(int i) const
+  {
+    dim3 grid(batchSize);
+    dim3 block(LOGSOFTMAX_BLOCKS[i]);
+    THCUNN_PROFILE_LAUNCH(grid, block);
+    hipLaunchKernelGGL((cunn_LogSoftMax_updateGradInput_kernel<2>), dim3(grid), dim3(block), 0, THCState_getCurrentStream(state),
+        gradInput, output, gradOutput, classSize);
+  }
+};
+
 void THNN_CudaLogSoftMax_updateOutput(THCState *state, THCudaTensor *input, THCudaTensor *output)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   THCUNN_assertSameGPU(state, 2, input, output);
 
   THCudaTensor_resizeAs(state, output, input);
@@ -417,20 +367,17 @@ void THNN_CudaLogSoftMax_updateOutput(THCState *state, THCudaTensor *input, THCu
 
   if (!spatial)
   {
-    dim3 grid(batchSize);
-    dim3 block(1024);
-
-    hipLaunchKernelGGL((cunn_LogSoftMax_updateOutput_kernel<2>), dim3(grid), dim3(block), block.x * sizeof(float), THCState_getCurrentStream(state), 
-        THCudaTensor_data(state, output),
-        THCudaTensor_data(state, input),
-        classSize
-    );
+    LogSoftMaxForward launch = {
+      state, THCudaTensor_data(state, output), THCudaTensor_data(state, input), batchSize, classSize
+    };
+    launch(tuning_choose(state, "LogSoftMax_updateOutput", classSize, LOGSOFTMAX_NUM_BLOCKS, launch));
   }
   else
   {
     dim3 grid(batchSize);
     dim3 block(1024);
 
+    THCUNN_PROFILE_LAUNCH(grid, block);
     hipLaunchKernelGGL((cunn_SpatialLogSoftMax_updateOutput_kernel), dim3(grid), dim3(block), 0, THCState_getCurrentStream(state), 
         THCudaTensor_data(state, output),
         THCudaTensor_data(state, input),
@@ -450,6 +397,8 @@ void THNN_CudaLogSoftMax_updateOutput(THCState *state, THCudaTensor *input, THCu
 void THNN_CudaLogSoftMax_updateGradInput(THCState *state, THCudaTensor *input, THCudaTensor *gradOutput,
   THCudaTensor *gradInput, THCudaTensor *output)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   THCUNN_assertSameGPU(state, 3, output, gradOutput, gradInput);
 
   THCudaTensor_resizeAs(state, gradInput, output);
@@ -537,21 +486,18 @@ void THNN_CudaLogSoftMax_updateGradInput(THCState *state, THCudaTensor *input, T
 
   if (!spatial)
   {
-    dim3 grid(batchSize);
-    dim3 block(1024);
-
-    hipLaunchKernelGGL((cunn_LogSoftMax_updateGradInput_kernel<2>), dim3(grid), dim3(block), block.x * sizeof(float), THCState_getCurrentStream(state), 
-        THCudaTensor_data(state, gradInput),
-        THCudaTensor_data(state, output),
-        THCudaTensor_data(state, gradOutput),
-        classSize
-    );
+    LogSoftMaxBackward launch = {
+      state, THCudaTensor_data(state, gradInput), THCudaTensor_data(state, output),
+      THCudaTensor_data(state, gradOutput), batchSize, classSize
+    };
+    launch(tuning_choose(state, "LogSoftMax_updateGradInput", classSize, LOGSOFTMAX_NUM_BLOCKS, launch));
   }
   else
   {
     dim3 grid(batchSize);
     dim3 block(1024);
 
+    THCUNN_PROFILE_LAUNCH(grid, block);
     hipLaunchKernelGGL((cunn_SpatialLogSoftMax_updateGradInput_kernel), dim3(grid), dim3(block), 0, THCState_getCurrentStream(state), 
         THCudaTensor_data(state, gradInput),
         THCudaTensor_data(state, output),
@@ -569,3 +515,5 @@ void THNN_CudaLogSoftMax_updateGradInput(THCState *state, THCudaTensor *input, T
   THCudaTensor_free(state, gradOutput);
   THCudaTensor_free(state, output);
 }
+
+#undef LOGSOFTMAX_NUM_BLOCKS
@@ -1,62 +1,17 @@
 #include "hip/hip_runtime.h"
 #include "THCUNN.h"
 #include "common.h"
-
-#ifdef THRUST_PATH
-  #include <thrust/device_ptr.h>
-  #include <thrust/execution_policy.h>
-  #include <thrust/iterator/constant_iterator.h>
-  #include <thrust/transform_reduce.h>
-  #if CUDA_VERSION >= 7000
-  #include <thrust/system/cuda/execution_policy.h>
-  #endif
-  #include <thrust/unique.h>
-#endif 
+#include "wavefront.h"
 
 #ifndef DIVUP
 #define DIVUP(x, y) (((x) + (y) - 1) / (y))
 #endif
 
-const int WARP_SIZE = 32;
-
-__device__ __forceinline__ bool warpHasCollision(int val)
-{
-  // Compare our value to the values stored in the next 16 lanes,
-  // wrapping around at 32. If any pair of values is the same than
-  // there is a collision in the warp.
-  bool dup = 0;
-  const int laneId = hipThreadIdx_x % 32;
-
-#if __CUDA_ARCH__ >= 300
-
-  #pragma unroll
-  for (int i = 1; i <= 16; i++)
-  {
-    dup |= (__shfl(val, (laneId + i) % 32) == val);
-  }
-
-#else
-
-  volatile __shared__ int values[128];
-  values[hipThreadIdx_x] = val;
-  const int offset = hipThreadIdx_x - laneId;
-
-  #pragma unroll
-  for (int i = 1; i <= 16; i++)
-  {
-    dup |= (values[offset + ((laneId + i) % 32)] == val);
-  }
-
-#endif
-
-  return __any(dup) != 0;
-}
-
 __global__ void cunn_LookupTable_accGradParametersKernelByFeature( 
   long *input, float *gradOutput, float *gradWeight, float scale, long numel,
   long stride, int paddingValue) {
 
-  const int featureDim = hipBlockIdx_x * 4 + hipThreadIdx_x / 32;
+  const int featureDim = hipBlockIdx_x * 4 + hipThreadIdx_x / WAVEFRONT_SIZE;
   if (featureDim >= stride) {
     return;
   }
@@ -73,9 +28,9 @@ __global__ void cunn_LookupTable_accGradParametersKernelByFeature(
   // In order to get a deterministic order of execution, we handle
   // non-colliding updates separately from colliding ones. Colliding
   // updates are serialized in their order of execution by using the
-  // warp-wide collision detector `warpHasCollision`.
-  const int laneId = hipThreadIdx_x % 32;
-  for (int i = laneId; i < numel; i += WARP_SIZE) {
+  // warp-wide collision detector `waveHasCollision`.
+  const int laneId = hipThreadIdx_x % WAVEFRONT_SIZE;
+  for (int i = laneId; i < numel; i += WAVEFRONT_SIZE) {
     const int weightIndex = (int) (input[i] - TH_INDEX_BASE);
     if (weightIndex == paddingValue - TH_INDEX_BASE) {
       continue;
@@ -84,9 +39,9 @@ __global__ void cunn_LookupTable_accGradParametersKernelByFeature(
     float update = gradOutput[i*stride + featureDim] * scale;
 
     // Check for collision
-    if (warpHasCollision(weightIndex)) {
+    if (waveHasCollision(weightIndex)) {
       // Run all lanes sequentially; warp divergence
-      for (int i = 0; i < WARP_SIZE; ++i) {
+      for (int i = 0; i < WAVEFRONT_SIZE; ++i) {
         if (laneId == i) {
           gradWeight[weightIndex*stride + featureDim] += update;
         }
@@ -133,7 +88,7 @@ __global__ void cunn_LookupTable_accGradParametersKernel(
       #pragma unroll
       for (int ii = 0; ii < SZ; ii++)
       {
-        int featureDim = startFeature + ii * WARP_SIZE;
+        int featureDim = startFeature + ii * WAVEFRONT_SIZE;
         if (featureDim < stride)
         {
           gradient[ii] = gradOutput[gradOutputRow + featureDim];
@@ -150,7 +105,7 @@ __global__ void cunn_LookupTable_accGradParametersKernel(
       #pragma unroll
       for (int ii = 0; ii < SZ; ii++)
       {
-        int featureDim = startFeature + ii * WARP_SIZE;
+        int featureDim = startFeature + ii * WAVEFRONT_SIZE;
         if (featureDim < stride)
         {
           gradWeight[weightRow + featureDim] = weight[ii];
@@ -162,6 +117,243 @@ __global__ void cunn_LookupTable_accGradParametersKernel(
   }
 }
 
+// Stable LSD radix sort of (index, position) pairs, RADIX_BITS per pass.
+// Every block owns a tile of RADIX_TILE consecutive items; each thread owns
+// RADIX_ITEMS consecutive items of its tile, which keeps the scatter stable.
+#define RADIX_BITS 4
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+#define RADIX_THREADS 256
+#define RADIX_ITEMS 4
+#define RADIX_TILE (RADIX_THREADS * RADIX_ITEMS)
+
+__global__ void cunn_LookupTable_radixInitKernel(
+  long *input, long *keys, long *values, long numel)
+{
+  CUDA_KERNEL_LOOP(i, numel) {
+    keys[i] = input[i];
+    values[i] = i + TH_INDEX_BASE;
+  }
+}
+
+// hist is laid out digit-major (hist[digit * numTiles + tile]) so that an
+// exclusive scan over it yields each tile's output offset for every digit.
+__global__ void cunn_LookupTable_radixHistogramKernel(
+  long *keys, long *hist, long numel, int shift, long numTiles)
+{
+  __shared__ int counts[RADIX_BUCKETS];
+  const int tid = hipThreadIdx_x;
+  if (tid < RADIX_BUCKETS) {
+    counts[tid] = 0;
+  }
+  __syncthreads();
+
+  const long base = (long) hipBlockIdx_x * RADIX_TILE;
+  for (int i = tid; i < RADIX_TILE; i += RADIX_THREADS) {
+    if (base + i < numel) {
+      atomicAdd(&counts[(keys[base + i] >> shift) & (RADIX_BUCKETS - 1)], 1);
+    }
+  }
+  __syncthreads();
+
+  if (tid < RADIX_BUCKETS) {
+    hist[tid * numTiles + hipBlockIdx_x] = counts[tid];
+  }
+}
+
+// Single-block exclusive prefix sum, walking the array RADIX_THREADS at a time.
+__global__ void cunn_LookupTable_exclusiveScanKernel(long *data, long n)
+{
+  __shared__ long buffer[RADIX_THREADS];
+  __shared__ long carry;
+  const int tid = hipThreadIdx_x;
+  if (tid == 0) {
+    carry = 0;
+  }
+  __syncthreads();
+
+  for (long start = 0; start < n; start += RADIX_THREADS) {
+    long value = start + tid < n ? data[start + tid] : 0;
+    buffer[tid] = value;
+    __syncthreads();
+
+    for (int offset = 1; offset < RADIX_THREADS; offset *= 2) {
+      long prev = tid >= offset ? buffer[tid - offset] : 0;
+      __syncthreads();
+      buffer[tid] += prev;
+      __syncthreads();
+    }
+
+    if (start + tid < n) {
+      data[start + tid] = carry + buffer[tid] - value;
+    }
+    __syncthreads();
+    if (tid == RADIX_THREADS - 1) {
+      carry += buffer[tid];
+    }
+    __syncthreads();
+  }
+}
+
+__global__ void cunn_LookupTable_radixScatterKernel(
+  long *keysIn, long *valuesIn, long *keysOut, long *valuesOut,
+  long *offsets, long numel, int shift, long numTiles)
+{
+  // Per-thread digit counts, turned into per-thread offsets within the tile
+  __shared__ int counts[RADIX_BUCKETS][RADIX_THREADS];
+  const int tid = hipThreadIdx_x;
+  const long base = (long) hipBlockIdx_x * RADIX_TILE + tid * RADIX_ITEMS;
+
+  for (int d = 0; d < RADIX_BUCKETS; d++) {
+    counts[d][tid] = 0;
+  }
+  for (int i = 0; i < RADIX_ITEMS; i++) {
+    if (base + i < numel) {
+      counts[(keysIn[base + i] >> shift) & (RADIX_BUCKETS - 1)][tid]++;
+    }
+  }
+  __syncthreads();
+
+  if (tid < RADIX_BUCKETS) {
+    int sum = 0;
+    for (int t = 0; t < RADIX_THREADS; t++) {
+      int c = counts[tid][t];
+      counts[tid][t] = sum;
+      sum += c;
+    }
+  }
+  __syncthreads();
+
+  for (int i = 0; i < RADIX_ITEMS; i++) {
+    if (base + i < numel) {
+      long key = keysIn[base + i];
+      int digit = (key >> shift) & (RADIX_BUCKETS - 1);
+      long pos = offsets[digit * numTiles + hipBlockIdx_x] + counts[digit][tid]++;
+      keysOut[pos] = key;
+      valuesOut[pos] = valuesIn[base + i];
+    }
+  }
+}
+
+__device__ __forceinline__ int segmentHead(long *sorted, long i)
+{
+  return i == 0 || sorted[i] != sorted[i - 1];
+}
+
+// Number of runs starting in each tile of sorted
+__global__ void cunn_LookupTable_segmentTileSumKernel(
+  long *sorted, long *tileSums, long numel)
+{
+  __shared__ int heads;
+  const int tid = hipThreadIdx_x;
+  if (tid == 0) {
+    heads = 0;
+  }
+  __syncthreads();
+
+  const long base = (long) hipBlockIdx_x * RADIX_TILE;
+  int local = 0;
+  for (int i = tid; i < RADIX_TILE; i += RADIX_THREADS) {
+    if (base + i < numel) {
+      local += segmentHead(sorted, base + i);
+    }
+  }
+  atomicAdd(&heads, local);
+  __syncthreads();
+
+  if (tid == 0) {
+    tileSums[hipBlockIdx_x] = heads;
+  }
+}
+
+// Writes the run id of every item into segId and the first position of
+// every run into segStart; segStart[numRuns] is set to numel.
+__global__ void cunn_LookupTable_segmentScanKernel(
+  long *sorted, long *tileOffsets, long *segId, long *segStart, long numel)
+{
+  __shared__ long buffer[RADIX_THREADS];
+  const int tid = hipThreadIdx_x;
+  const long base = (long) hipBlockIdx_x * RADIX_TILE + tid * RADIX_ITEMS;
+
+  int local = 0;
+  for (int i = 0; i < RADIX_ITEMS; i++) {
+    if (base + i < numel) {
+      local += segmentHead(sorted, base + i);
+    }
+  }
+  buffer[tid] = local;
+  __syncthreads();
+
+  for (int offset = 1; offset < RADIX_THREADS; offset *= 2) {
+    long prev = tid >= offset ? buffer[tid - offset] : 0;
+    __syncthreads();
+    buffer[tid] += prev;
+    __syncthreads();
+  }
+
+  long id = tileOffsets[hipBlockIdx_x] + buffer[tid] - local - 1;
+  for (int i = 0; i < RADIX_ITEMS; i++) {
+    long pos = base + i;
+    if (pos < numel) {
+      if (segmentHead(sorted, pos)) {
+        id++;
+        segStart[id] = pos;
+      }
+      segId[pos] = id;
+      if (pos == numel - 1) {
+        segStart[id + 1] = numel;
+      }
+    }
+  }
+}
+
+// count holds the run id of each item on entry and its run length on exit
+__global__ void cunn_LookupTable_segmentCountKernel(
+  long *segStart, long *count, long numel)
+{
+  CUDA_KERNEL_LOOP(i, numel) {
+    long id = count[i];
+    count[i] = segStart[id + 1] - segStart[id];
+  }
+}
+
+// Sorts keys, carrying values along, with the radix kernels above. Keys are
+// bounded by the number of rows, so only that many bits are ever looked at.
+// keysAlt and valuesAlt hold numel items and hist RADIX_BUCKETS per tile.
+static void LookupTable_radixSort(
+  THCState *state, long *keys, long *values, long *keysAlt, long *valuesAlt,
+  long *hist, long numel, long rows)
+{
+  hipStream_t stream = THCState_getCurrentStream(state);
+  long numTiles = DIVUP(numel, RADIX_TILE);
+
+  int keyBits = 0;
+  while (keyBits < 63 && (1L << keyBits) <= rows + TH_INDEX_BASE)
+    keyBits++;
+
+  long *keysIn = keys, *valuesIn = values;
+  long *keysOut = keysAlt, *valuesOut = valuesAlt;
+  for (int shift = 0; shift < keyBits; shift += RADIX_BITS) {
+    hipLaunchKernelGGL((cunn_LookupTable_radixHistogramKernel), dim3(numTiles), dim3(RADIX_THREADS), 0, stream, 
+      keysIn, hist, numel, shift, numTiles);
+    THCudaCheck(hipGetLastError());
+    hipLaunchKernelGGL((cunn_LookupTable_exclusiveScanKernel), dim3(1), dim3(RADIX_THREADS), 0, stream, 
+      hist, RADIX_BUCKETS * numTiles);
+    THCudaCheck(hipGetLastError());
+    hipLaunchKernelGGL((cunn_LookupTable_radixScatterKernel), dim3(numTiles), dim3(RADIX_THREADS), 0, stream, 
+      keysIn, valuesIn, keysOut, valuesOut, hist, numel, shift, numTiles);
+    THCudaCheck(hipGetLastError());
+
+    long *tmp = keysIn; keysIn = keysOut; keysOut = tmp;
+    tmp = valuesIn; valuesIn = valuesOut; valuesOut = tmp;
+  }
+  if (keysIn != keys) {
+    THCudaCheck(hipMemcpyAsync(keys, keysIn, numel * sizeof(long),
+                               hipMemcpyDeviceToDevice, stream));
+    THCudaCheck(hipMemcpyAsync(values, valuesIn, numel * sizeof(long),
+                               hipMemcpyDeviceToDevice, stream));
+  }
+}
+
 void THNN_CudaLookupTable_accGradParameters(
   THCState *state,
   THIndexTensor *input,
@@ -174,6 +366,8 @@ void THNN_CudaLookupTable_accGradParameters(
   int paddingValue,
   float scale)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   THCUNN_assertSameGPU(state, 5, input, gradOutput, gradWeight, sorted, indices);
   if (!(THIndexTensor_(isContiguous)(state, input) &&
         THCudaTensor_isContiguous(state, gradOutput) &&
@@ -192,7 +386,7 @@ void THNN_CudaLookupTable_accGradParameters(
   hipStream_t stream = THCState_getCurrentStream(state);
 
   if (numel <= 768 && !scaleGradByFreq) {
-    hipLaunchKernelGGL((cunn_LookupTable_accGradParametersKernelByFeature), dim3(DIVUP(stride,4)), dim3(128), 0, stream, 
+    hipLaunchKernelGGL((cunn_LookupTable_accGradParametersKernelByFeature), dim3(DIVUP(stride,4)), dim3(4 * WAVEFRONT_SIZE), 0, stream, 
       THIndexTensor_(data)(state, input),
       THCudaTensor_data(state, gradOutput),
       THCudaTensor_data(state, gradWeight),
@@ -209,53 +403,53 @@ void THNN_CudaLookupTable_accGradParameters(
   THIndexTensor_(resize)(state, indices, inputSize, NULL);
   THLongStorage_free(inputSize);
 
-  // Sort the inputs into sorted with the corresponding indices
-  THIndexTensor_(sort)(state, sorted, indices, input, 0, 0);
+  long numTiles = DIVUP(numel, RADIX_TILE);
+
+  // Scratch: ping-pong keys and values, digit histograms and segment starts
+  THIndexTensor *scratch = THIndexTensor_(new)(state);
+  THIndexTensor_(resize1d)(state, scratch, 3 * numel + RADIX_BUCKETS * numTiles + 1);
+  long *scratch_data = THIndexTensor_(data)(state, scratch);
+  long *keysAlt = scratch_data;
+  long *valuesAlt = keysAlt + numel;
+  long *hist = valuesAlt + numel;
+  long *segStart = hist + RADIX_BUCKETS * numTiles;
 
   long *sorted_data = THIndexTensor_(data)(state, sorted);
-  long  *indices_data = THIndexTensor_(data)(state, indices);
+  long *indices_data = THIndexTensor_(data)(state, indices);
   long *count_data = NULL;
 
-#ifdef THRUST_PATH
+  // Sort the inputs into sorted with the corresponding indices
+  hipLaunchKernelGGL((cunn_LookupTable_radixInitKernel), dim3(GET_BLOCKS(numel)), dim3(CUDA_NUM_THREADS), 0, stream, 
+    THIndexTensor_(data)(state, input), sorted_data, indices_data, numel);
+  THCudaCheck(hipGetLastError());
+  LookupTable_radixSort(state, sorted_data, indices_data, keysAlt, valuesAlt, hist,
+                        numel, gradWeight->size[0]);
+
   if (scaleGradByFreq)
   {
     THIndexTensor_(resizeAs)(state, count, input);
     count_data = THIndexTensor_(data)(state, count);
 
-    thrust::device_ptr<long> sorted_ptr(sorted_data);
-    thrust::device_ptr<long> count_ptr(count_data);
-
-    // Compute an increasing sequence per unique item in sorted:
-    // sorted: 2 5 5 5 7 7 8 9 9
-    //  count: 1 1 2 3 1 2 1 1 2
-    thrust::inclusive_scan_by_key(
-#if CUDA_VERSION >= 7000
-      thrust::cuda::par.on(THCState_getCurrentStream(state)),
-#endif
-      sorted_ptr,
-      sorted_ptr + numel,
-      thrust::make_constant_iterator(1),
-      count_ptr
-    );
-
-    // Take the maximum of each count per unique key in reverse:
+    // Compute the length of the run each item belongs to in sorted:
     // sorted: 2 5 5 5 7 7 8 9 9
+    //  segId: 0 1 1 1 2 2 3 4 4
     //  count: 1 3 3 3 2 2 1 2 2
-    thrust::inclusive_scan_by_key(
-#if CUDA_VERSION >= 7000
-      thrust::cuda::par.on(THCState_getCurrentStream(state)),
-#endif
-      thrust::make_reverse_iterator(sorted_ptr + numel),
-      thrust::make_reverse_iterator(sorted_ptr),
-      thrust::make_reverse_iterator(count_ptr + numel),
-      thrust::make_reverse_iterator(count_ptr + numel),
-      thrust::equal_to<long>(),
-      thrust::maximum<long>()
-    );
+    hipLaunchKernelGGL((cunn_LookupTable_segmentTileSumKernel), dim3(numTiles), dim3(RADIX_THREADS), 0, stream, 
+      sorted_data, hist, numel);
+    THCudaCheck(hipGetLastError());
+    hipLaunchKernelGGL((cunn_LookupTable_exclusiveScanKernel), dim3(1), dim3(RADIX_THREADS), 0, stream, 
+      hist, numTiles);
+    THCudaCheck(hipGetLastError());
+    hipLaunchKernelGGL((cunn_LookupTable_segmentScanKernel), dim3(numTiles), dim3(RADIX_THREADS), 0, stream, 
+      sorted_data, hist, count_data, segStart, numel);
+    THCudaCheck(hipGetLastError());
+    hipLaunchKernelGGL((cunn_LookupTable_segmentCountKernel), dim3(GET_BLOCKS(numel)), dim3(CUDA_NUM_THREADS), 0, stream, 
+      segStart, count_data, numel);
+    THCudaCheck(hipGetLastError());
   }
 
-  dim3 grid(DIVUP(numel,4), DIVUP(stride,128));
-  dim3 block(32, 4);
+  dim3 grid(DIVUP(numel,4), DIVUP(stride,4 * WAVEFRONT_SIZE));
+  dim3 block(WAVEFRONT_SIZE, 4);
   hipLaunchKernelGGL((cunn_LookupTable_accGradParametersKernel), dim3(grid), dim3(block), 0, stream, 
     sorted_data,
     indices_data,
@@ -268,38 +462,51 @@ void THNN_CudaLookupTable_accGradParameters(
     paddingValue
   );
   THCudaCheck(hipGetLastError());
-#endif
+
+  THIndexTensor_(free)(state, scratch);
 }
 
 /*
  * Keep the norm of weight smaller than maxNorm
  */
-template <typename T>
-struct pow_v
-{
-  T normType;
-  pow_v(T v) : normType(v) {}
-  __host__ __device__
-  T operator()(const T& x) const {
-    if (normType == 1)
-      return std::abs(x);
-    else if (normType == 2)
-      return x * x;
-    else
-      return std::pow(std::abs(x), normType);
-  }
-};
 
-template <typename T>
-struct multiply_s
+// Threads per row of the renorm kernel
+#define RENORM_MAX_THREADS 512
+// Upper bound on renorm blocks; each then covers several rows
+#define RENORM_MAX_BLOCKS 65535
+
+// idx is sorted, so the first of every run of equal indices owns the row and
+// the others skip it: no row is rescaled twice or by two blocks at once.
+// One block per row, striding over the rows when there are more of them.
+__global__ void cunn_LookupTable_renormKernel(
+  long *idx, float *weight, long numel, long stride, float maxNorm, float normType)
 {
-  T scale;
-  multiply_s(T s) : scale(s) {}
-  __host__ __device__
-  T operator()(const T& x) const {
-    return x * scale;
+  for (long i = hipBlockIdx_x; i < numel; i += hipGridDim_x) {
+    if (!segmentHead(idx, i)) {
+      continue;
+    }
+    float *row = weight + (idx[i] - TH_INDEX_BASE) * stride;
+
+    float acc = 0;
+    for (long j = hipThreadIdx_x; j < stride; j += hipBlockDim_x) {
+      float x = fabsf(row[j]);
+      if (normType == 1)
+        acc += x;
+      else if (normType == 2)
+        acc += x * x;
+      else
+        acc += powf(x, normType);
+    }
+    float norm = powf(blockReduce(acc, WaveSum(), 0.0f), 1.0f / normType);
+
+    if (norm > maxNorm) {
+      float scale = maxNorm / (norm + 1e-7f);
+      for (long j = hipThreadIdx_x; j < stride; j += hipBlockDim_x) {
+        row[j] *= scale;
+      }
+    }
   }
-};
+}
 
 void THNN_CudaLookupTable_renorm(
   THCState *state,
@@ -308,6 +515,7 @@ void THNN_CudaLookupTable_renorm(
   float maxNorm,
   float normType)
 {
+  THCUNN_PROFILE_FUNC(state);
   THCUNN_assertSameGPU(state, 2, idx, weight);
   if (!(THIndexTensor_(isContiguous)(state, idx) &&
         THCudaTensor_isContiguous(state, weight)))
@@ -322,28 +530,35 @@ void THNN_CudaLookupTable_renorm(
   long numel = THIndexTensor_(nElement)(state, idx);
   long stride = weight->stride[0];
 
-#ifdef THRUST_PATH
-  // get the unique indices
-  thrust::device_ptr<float> weight_ptr(THCudaTensor_data(state, weight));
-  thrust::device_ptr<long> idx_ptr(THIndexTensor_(data)(state, idx));
-  thrust::device_ptr<long> end_ptr = thrust::unique(idx_ptr, idx_ptr+numel);
-  numel = end_ptr - idx_ptr;
-
-  pow_v<float> unary_pow(normType);
-  thrust::plus<float> binary_plus;
-  // numel << stride, since idx usually contains sparse row indices
-  for (long i = 0; i < numel; i++)
-  {
-    long k = idx_ptr[i] - TH_INDEX_BASE;
-    thrust::device_ptr<float> row_ptr = weight_ptr + k * stride;
-    float norm = thrust::transform_reduce(row_ptr, row_ptr + stride,
-      unary_pow, 0, binary_plus);
-    norm = std::pow(norm, (float) (1.0 / normType));
-    if (norm > maxNorm)
-    {
-      multiply_s<float> unary_mul(maxNorm / (norm + 1e-7));
-      thrust::transform(row_ptr, row_ptr + stride, row_ptr, unary_mul);
-    }
-  }
-#endif
+  if (numel == 0)
+    return;
+
+  hipStream_t stream = THCState_getCurrentStream(state);
+  long numTiles = DIVUP(numel, RADIX_TILE);
+
+  // Sort idx in place on the device; rows are then deduplicated by the
+  // kernel itself, so nothing comes back to the host.
+  THIndexTensor *scratch = THIndexTensor_(new)(state);
+  THIndexTensor_(resize1d)(state, scratch, 3 * numel + RADIX_BUCKETS * numTiles);
+  long *values = THIndexTensor_(data)(state, scratch);
+  long *keysAlt = values + numel;
+  long *valuesAlt = keysAlt + numel;
+  long *hist = valuesAlt + numel;
+  long *idx_data = THIndexTensor_(data)(state, idx);
+
+  LookupTable_radixSort(state, idx_data, values, keysAlt, valuesAlt, hist,
+                        numel, weight->size[0]);
+
+  int threads = WAVEFRONT_SIZE;
+  while (threads < stride && threads < RENORM_MAX_THREADS)
+    threads *= 2;
+  long blocks = numel < RENORM_MAX_BLOCKS ? numel : RENORM_MAX_BLOCKS;
+  hipLaunchKernelGGL((cunn_LookupTable_renormKernel), dim3(blocks), dim3(threads), 0, stream,
+    idx_data, THCudaTensor_data(state, weight), numel, stride, maxNorm, normType);
+  THCudaCheck(hipGetLastError());
+
+  THIndexTensor_(free)(state, scratch);
 }
+
+#undef RENORM_MAX_THREADS
+#undef RENORM_MAX_BLOCKS
@@ -1,13 +1,7 @@
 #include "hip/hip_runtime.h"
 #include "THCUNN.h"
 #include "common.h"
-#include "THCReduceApplyUtils.cuh"
-
-#if THRUST_PATH
-    #include <thrust/functional.h>
-#else
-    #include <bolt/amp/functional.h>
-#endif
+#include "wavefront.h"
 
 #define MULTILABELMARGIN_THREADS 1024
 
@@ -19,9 +13,6 @@ __global__ void cunn_MultiLabelMarginCriterion_updateOutput_kernel( float *outpu
                                                                    int dim,
                                                                    int sizeaverage)
 {
-  // Temporary sums (for mapreduce)
-  __shared__ float sums[MULTILABELMARGIN_THREADS];
-
   // vectors:
   int k = hipBlockIdx_x;
   float *input_k = input + k*dim;
@@ -67,11 +58,7 @@ __global__ void cunn_MultiLabelMarginCriterion_updateOutput_kernel( float *outpu
   }
 
   // reduce
-#if THRUST_PATH
-  float totalSum = reduceBlock(sums, hipBlockDim_x, sum, thrust::plus<float>(), 0.0f);
-#else
-  float totalSum = reduceBlock(sums, hipBlockDim_x, sum, bolt::amp::plus<float>(), 0.0f);
-#endif
+  float totalSum = blockReduce(sum, WaveSum(), 0.0f);
   if (hipThreadIdx_x == 0) {
     if (sizeaverage) {
       *output_k = (totalSum / dim) / nframe;
@@ -89,9 +76,6 @@ __global__ void cunn_MultiLabelMarginCriterion_updateGradInput_kernel( float *gr
                                                                       int dim,
                                                                       int sizeaverage)
 {
-  // Temporary sums (for mapreduce)
-  __shared__ float sums[MULTILABELMARGIN_THREADS];
-
   // vectors:
   int k = hipBlockIdx_x;
   float *input_k = input + k*dim;
@@ -132,11 +116,7 @@ __global__ void cunn_MultiLabelMarginCriterion_updateGradInput_kernel( float *gr
     __syncthreads();
 
     // reduce sum
-#if THRUST_PATH
-    float totalSum = reduceBlock(sums, hipBlockDim_x, sum, thrust::plus<float>(), 0.0f);
-#else
-    float totalSum = reduceBlock(sums, hipBlockDim_x, sum, bolt::amp::plus<float>(), 0.0f);
-#endif
+    float totalSum = blockReduce(sum, WaveSum(), 0.0f);
     if (hipThreadIdx_x == 0) {
       gradInput_k[target_idx] += totalSum;
     }
@@ -152,6 +132,8 @@ void THNN_CudaMultiLabelMarginCriterion_updateOutput(
           THCudaTensor *istarget,
           bool sizeaverage)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   input = THCudaTensor_newContiguous(state, input);
   target = THCudaTensor_newContiguous(state, target);
   istarget = THCudaTensor_newContiguous(state, istarget);
@@ -210,6 +192,8 @@ void THNN_CudaMultiLabelMarginCriterion_updateGradInput(
           THCudaTensor *istarget,
           bool sizeaverage)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   input = THCudaTensor_newContiguous(state, input);
   target = THCudaTensor_newContiguous(state, target);
   istarget = THCudaTensor_newContiguous(state, istarget);
@@ -98,6 +98,8 @@ void THNN_CudaMultiMarginCriterion_updateOutput(THCState *state, THCudaTensor *i
                                                 bool sizeAverage, int p, THCudaTensor *weights,
                                                 float margin)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   THCUNN_assertSameGPU(state, 2, input, target);
   input = THCudaTensor_newContiguous(state, input);
   if(weights)
@@ -181,6 +183,8 @@ void THNN_CudaMultiMarginCriterion_updateGradInput(THCState *state, THCudaTensor
                                                    bool sizeAverage, int p, THCudaTensor *weights,
                                                    float margin)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   THCUNN_assertSameGPU(state, 3, input, gradInput, target);
   input = THCudaTensor_newContiguous(state, input);
   THCudaTensor_resizeAs(state, gradInput, input);
@@ -43,6 +43,8 @@ void THNN_CudaPReLU_updateOutput(
   THCudaTensor *weight,
   long nOutputPlane)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   THCudaTensor_resizeAs(state, output, input);
 
   float *w = THCudaTensor_data(state, weight);
@@ -115,6 +117,8 @@ void THNN_CudaPReLU_updateGradInput(
   THCudaTensor *weight,
   long nOutputPlane)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   THCudaTensor_resizeAs(state, gradInput, input);
 
   float *w = THCudaTensor_data(state, weight);
@@ -204,6 +208,8 @@ void THNN_CudaPReLU_accGradParameters(
   long nOutputPlane,
   float scale)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   // use grad input for temporary storage, then call updateGradInput again
 
   if (nOutputPlane == 0)
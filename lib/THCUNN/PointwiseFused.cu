@@ -0,0 +1,93 @@
+#include "THCUNN.h"
+#include "common.h"
+#include "pointwise_fusion.h"
+
+// Reads ops and their (a, b) parameter pairs into a program. nOpsArg is the
+// argument position of nOps in the calling entry point; ops follows it.
+static PointwiseProgram pointwiseFused_program(int nOps, const int *ops, const float *params, int nOpsArg)
+{
+  THArgCheck(nOps >= 1 && nOps <= POINTWISE_MAX_OPS, nOpsArg, "between 1 and 8 ops expected");
+  PointwiseProgram p;
+  p.n = nOps;
+  for (int i = 0; i < POINTWISE_MAX_OPS; i++) {
+    p.op[i] = i < nOps ? ops[i] : 0;
+    p.a[i] = i < nOps ? params[2 * i] : 0;
+    p.b[i] = i < nOps ? params[2 * i + 1] : 0;
+    if (i < nOps)
+      THArgCheck(ops[i] >= POINTWISE_ABS && ops[i] <= POINTWISE_LEAKY_RELU, nOpsArg + 1, "unknown op %d", ops[i]);
+  }
+  return p;
+}
+
+static bool pointwiseFused_is(const PointwiseProgram &p, int n, int op0, int op1, int op2 = 0)
+{
+  return p.n == n && p.op[0] == op0 && p.op[1] == op1 && (n < 3 || p.op[2] == op2);
+}
+
+// Calls apply with the compiled chain matching p, or with p itself. Common
+// chains get a kernel of their own, with the ops inlined into each other.
+template <typename Apply>
+static void pointwiseFused_dispatch(const PointwiseProgram &p, const Apply &apply)
+{
+  if (pointwiseFused_is(p, 2, POINTWISE_SQUARE, POINTWISE_SQRT))
+    apply(PointwiseChain<PointwiseSquare, PointwiseSqrt>(p.a, p.b));
+  else if (pointwiseFused_is(p, 3, POINTWISE_SQUARE, POINTWISE_SQRT, POINTWISE_TANH))
+    apply(PointwiseChain<PointwiseSquare, PointwiseSqrt, PointwiseTanh>(p.a, p.b));
+  else if (pointwiseFused_is(p, 2, POINTWISE_THRESHOLD, POINTWISE_HARDTANH))
+    apply(PointwiseChain<PointwiseThreshold, PointwiseHardTanh>(p.a, p.b));
+  else if (pointwiseFused_is(p, 2, POINTWISE_SOFTPLUS, POINTWISE_TANH))
+    apply(PointwiseChain<PointwiseSoftPlus, PointwiseTanh>(p.a, p.b));
+  else if (pointwiseFused_is(p, 2, POINTWISE_ABS, POINTWISE_SQRT))
+    apply(PointwiseChain<PointwiseAbs, PointwiseSqrt>(p.a, p.b));
+  else
+    apply(p);
+}
+
+struct PointwiseFusedForward
+{
+  THCState *state;
+  THCudaTensor *input, *output;
+
+  template <typename Chain>
+  void operator()(const Chain &chain) const
+  {
+    THC_pointwiseApply2(state, output, input, pointwiseFusedUpdateOutput_functor<Chain>(chain));
+  }
+};
+
+struct PointwiseFusedBackward
+{
+  THCState *state;
+  THCudaTensor *input, *gradOutput, *gradInput;
+
+  template <typename Chain>
+  void operator()(const Chain &chain) const
+  {
+    THC_pointwiseApply3(state, gradInput, input, gradOutput, pointwiseFusedUpdateGradInput_functor<Chain>(chain));
+  }
+};
+
+void THNN_CudaPointwiseFused_updateOutput(THCState *state, THCudaTensor *input, THCudaTensor *output,
+                                          int nOps, const int *ops, const float *params)
+{
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
+  THCUNN_assertSameGPU(state, 2, input, output);
+  PointwiseProgram p = pointwiseFused_program(nOps, ops, params, 4);
+  THCudaTensor_resizeAs(state, output, input);
+  PointwiseFusedForward apply = { state, input, output };
+  pointwiseFused_dispatch(p, apply);
+}
+
+void THNN_CudaPointwiseFused_updateGradInput(THCState *state, THCudaTensor *input, THCudaTensor *gradOutput,
+                                             THCudaTensor *gradInput,
+                                             int nOps, const int *ops, const float *params)
+{
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
+  THCUNN_assertSameGPU(state, 3, input, gradOutput, gradInput);
+  PointwiseProgram p = pointwiseFused_program(nOps, ops, params, 5);
+  THCudaTensor_resizeAs(state, gradInput, input);
+  PointwiseFusedBackward apply = { state, input, gradOutput, gradInput };
+  pointwiseFused_dispatch(p, apply);
+}
@@ -0,0 +1,229 @@
+#include "hip/hip_runtime.h"
+#include "THCUNN.h"
+#include "common.h"
+
+#ifdef THCUNN_PROFILE
+
+#include <stdlib.h>
+#include <sys/time.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Calls kept waiting for their device time; beyond this many, the completed
+// ones are moved into the log, and the oldest are waited for if need be
+#define THCUNN_PROFILE_MAX_PENDING 1024
+
+// A call whose device time is not known yet
+struct THCUNNPendingEvent
+{
+  THCUNNProfileEvent event;
+  hipEvent_t start;
+  hipEvent_t stop;
+};
+
+// Entry points may be called from several host threads at once (e.g. under
+// DataParallelTable:threads()); the log and the pending list are shared and
+// guarded by the mutex, the scope nesting is per thread.
+//
+// The launches of each open scope are gathered in a thread-local stack
+// rather than in the scope: a THError longjmps past the destructors of the
+// scopes it leaves, so launch() must not write to a frame. Their entries
+// are dropped when an enclosing scope closes, or by reset() on the thread
+// that raised the error.
+static std::atomic<bool> thcunn_profileEnabled(false);
+static std::mutex thcunn_profileMutex;
+static THCUNNProfileLog thcunn_profileLog;
+static std::vector<THCUNNPendingEvent> thcunn_profilePending;
+static thread_local std::vector<std::string> thcunn_profileLaunches;
+static std::string thcunn_profileExitPrefix;
+
+static double thcunn_profileNow()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec * 1e6 + tv.tv_usec;
+}
+
+// Moves pending calls into the log. With wait, waits for the stop events of
+// all of them, otherwise takes only those that have completed. THCudaCheck
+// may not return, so the events are handled outside the lock.
+static void thcunn_profileResolve(bool wait)
+{
+  std::vector<THCUNNPendingEvent> pending;
+  {
+    std::lock_guard<std::mutex> lock(thcunn_profileMutex);
+    pending.swap(thcunn_profilePending);
+  }
+  std::vector<THCUNNPendingEvent> running;
+  std::vector<THCUNNProfileEvent> done;
+  for (size_t i = 0; i < pending.size(); i++) {
+    THCUNNPendingEvent &p = pending[i];
+    if (!wait && hipEventQuery(p.stop) == hipErrorNotReady) {
+      running.push_back(p);
+      continue;
+    }
+    float ms = 0;
+    THCudaCheck(hipEventSynchronize(p.stop));
+    THCudaCheck(hipEventElapsedTime(&ms, p.start, p.stop));
+    THCudaCheck(hipEventDestroy(p.start));
+    THCudaCheck(hipEventDestroy(p.stop));
+    p.event.device_us = ms * 1000.0;
+    done.push_back(p.event);
+  }
+  std::lock_guard<std::mutex> lock(thcunn_profileMutex);
+  for (size_t i = 0; i < done.size(); i++)
+    thcunn_profileLog.add(done[i]);
+  thcunn_profilePending.insert(thcunn_profilePending.end(), running.begin(), running.end());
+}
+
+static size_t thcunn_profilePendingCount()
+{
+  std::lock_guard<std::mutex> lock(thcunn_profileMutex);
+  return thcunn_profilePending.size();
+}
+
+static void thcunn_profileWrite(const char *tracePath, const char *summaryPath)
+{
+  thcunn_profileResolve(true);
+  THCUNNProfileLog log;
+  {
+    std::lock_guard<std::mutex> lock(thcunn_profileMutex);
+    log = thcunn_profileLog;
+  }
+  if (tracePath && tracePath[0]) {
+    FILE *f = fopen(tracePath, "w");
+    if (!f)
+      THError("cannot open profile trace file %s", tracePath);
+    log.writeChromeTrace(f);
+    fclose(f);
+  }
+  if (summaryPath && summaryPath[0]) {
+    FILE *f = fopen(summaryPath, "w");
+    if (!f)
+      THError("cannot open profile summary file %s", summaryPath);
+    log.writeSummary(f);
+    fclose(f);
+  } else {
+    log.writeSummary(stderr);
+  }
+}
+
+static void thcunn_profileAtExit()
+{
+  {
+    std::lock_guard<std::mutex> lock(thcunn_profileMutex);
+    if (thcunn_profileLog.events().empty() && thcunn_profilePending.empty())
+      return;
+  }
+  std::string trace = thcunn_profileExitPrefix + ".json";
+  std::string summary = thcunn_profileExitPrefix + ".txt";
+  thcunn_profileWrite(trace.c_str(), summary.c_str());
+}
+
+// THCUNN_PROFILE=<prefix> enables profiling at load time and writes
+// <prefix>.json and <prefix>.txt when the process exits
+static struct THCUNNProfileEnv
+{
+  THCUNNProfileEnv()
+  {
+    const char *prefix = getenv("THCUNN_PROFILE");
+    if (prefix && prefix[0]) {
+      thcunn_profileEnabled = true;
+      thcunn_profileExitPrefix = prefix;
+      atexit(thcunn_profileAtExit);
+    }
+  }
+} thcunn_profileEnv;
+
+THCUNNProfileScope::THCUNNProfileScope(THCState *state, const char *name)
+  : active_(thcunn_profileEnabled), state_(state), depth_(0)
+{
+  if (!active_)
+    return;
+  int device;
+  THCudaCheck(hipGetDevice(&device));
+  event_.name = name;
+  event_.start_us = thcunn_profileNow();
+  event_.device_us = 0;
+  event_.device = device;
+  THCudaCheck(hipEventCreate(&start_));
+  THCudaCheck(hipEventRecord(start_, THCState_getCurrentStream(state_)));
+  depth_ = thcunn_profileLaunches.size();
+  thcunn_profileLaunches.push_back(std::string());
+}
+
+THCUNNProfileScope::~THCUNNProfileScope()
+{
+  if (!active_)
+    return;
+  event_.launch.swap(thcunn_profileLaunches[depth_]);
+  thcunn_profileLaunches.resize(depth_);
+  THCUNNPendingEvent p;
+  p.event = event_;
+  p.start = start_;
+  THCudaCheck(hipEventCreate(&p.stop));
+  THCudaCheck(hipEventRecord(p.stop, THCState_getCurrentStream(state_)));
+  size_t pending;
+  {
+    std::lock_guard<std::mutex> lock(thcunn_profileMutex);
+    thcunn_profilePending.push_back(p);
+    pending = thcunn_profilePending.size();
+  }
+  if (pending >= THCUNN_PROFILE_MAX_PENDING) {
+    thcunn_profileResolve(false);
+    if (thcunn_profilePendingCount() >= THCUNN_PROFILE_MAX_PENDING)
+      thcunn_profileResolve(true);
+  }
+}
+
+void THCUNNProfileScope::launch(dim3 grid, dim3 block)
+{
+  if (!thcunn_profileEnabled || thcunn_profileLaunches.empty())
+    return;
+  std::string &launches = thcunn_profileLaunches.back();
+  char buf[96];
+  snprintf(buf, sizeof(buf), "%sgrid %ux%ux%u block %ux%ux%u",
+           launches.empty() ? "" : "; ",
+           grid.x, grid.y, grid.z, block.x, block.y, block.z);
+  launches += buf;
+}
+
+void THNN_CudaProfiler_setEnabled(THCState *state, bool enabled)
+{
+  thcunn_profileEnabled = enabled;
+}
+
+void THNN_CudaProfiler_dump(THCState *state, const char *tracePath, const char *summaryPath)
+{
+  thcunn_profileWrite(tracePath, summaryPath);
+}
+
+void THNN_CudaProfiler_reset(THCState *state)
+{
+  thcunn_profileResolve(true);
+  // called from Lua, so any scope still open on this thread is stale
+  thcunn_profileLaunches.clear();
+  std::lock_guard<std::mutex> lock(thcunn_profileMutex);
+  thcunn_profileLog.clear();
+}
+
+#else
+
+void THNN_CudaProfiler_setEnabled(THCState *state, bool enabled)
+{
+  if (enabled)
+    THError("THCUNN was built without profiling support, reconfigure with -DTHCUNN_PROFILE=ON");
+}
+
+void THNN_CudaProfiler_dump(THCState *state, const char *tracePath, const char *summaryPath)
+{
+  THError("THCUNN was built without profiling support, reconfigure with -DTHCUNN_PROFILE=ON");
+}
+
+void THNN_CudaProfiler_reset(THCState *state)
+{
+}
+
+#endif
@@ -106,6 +106,8 @@ struct RReLUUpdateOutputEvalIP_functor
 void THNN_CudaRReLU_updateOutput(THCState *state, THCudaTensor *input, THCudaTensor *output,
   THCudaTensor *noise, double lower, double upper, bool train, bool inplace, void *generator)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   THCUNN_assertSameGPU(state, 3, input, output, noise);
 #ifdef CURAND_PATH
   struct curandStateMtgp32* gen_states = THCRandom_generatorStates(state);
@@ -204,6 +206,8 @@ struct RReLUupdateGradInputEvalIP_functor
 void THNN_CudaRReLU_updateGradInput(THCState *state, THCudaTensor *input, THCudaTensor *gradOutput,
   THCudaTensor *gradInput, THCudaTensor *noise, double lower, double upper, bool train, bool inplace)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   THCUNN_assertSameGPU(state, 4, input, gradOutput, gradInput, noise);
 
   gradOutput = THCudaTensor_newContiguous(state, gradOutput);
@@ -14,6 +14,8 @@ struct sigmoidupdateOutput_functor
 
 void THNN_CudaSigmoid_updateOutput(THCState *state, THCudaTensor *input, THCudaTensor *output)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   THCUNN_assertSameGPU(state, 2, input, output);
   THCudaTensor_resizeAs(state, output, input);
   THC_pointwiseApply2(state, output, input, sigmoidupdateOutput_functor());
@@ -32,6 +34,8 @@ struct sigmoidupdateGradInput_functor
 
 void THNN_CudaSigmoid_updateGradInput(THCState *state, THCudaTensor *input, THCudaTensor *gradOutput, THCudaTensor *gradInput, THCudaTensor *output)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   THCUNN_assertSameGPU(state, 3, output, gradOutput, gradInput);
   THCudaTensor_resizeAs(state, gradInput, output);
   THC_pointwiseApply3(state, gradInput, output, gradOutput, sigmoidupdateGradInput_functor());
@@ -33,6 +33,8 @@ struct smoothl1_functor
 
 void THNN_CudaSmoothL1Criterion_updateOutput(THCState *state, THCudaTensor *input, THCudaTensor *target, THCudaTensor *output, bool sizeAverage)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   THCUNN_assertSameGPU(state, 2, input, target);
   THArgCheck(
     THCudaTensor_nElement(state, input) == THCudaTensor_nElement(state, target), 2,
@@ -104,6 +106,8 @@ struct smoothl1_updateGradInput_functor
 
 void THNN_CudaSmoothL1Criterion_updateGradInput(THCState *state, THCudaTensor *input, THCudaTensor *target, THCudaTensor *gradInput, bool sizeAverage)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   THCUNN_assertSameGPU(state, 3, input, target, gradInput);
   THArgCheck(
     THCudaTensor_nElement(state, input) == THCudaTensor_nElement(state, target), 2,
@@ -35,6 +35,8 @@ void THNN_CudaSoftMarginCriterion_updateOutput(THCState *state,
                                                int sizeAverage
                                               )
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   THCUNN_assertSameGPU(state, 2, input, target);
   float sum;
 
@@ -95,6 +97,8 @@ void THNN_CudaSoftMarginCriterion_updateGradInput(THCState *state,
                                                   THCudaTensor *gradInput,
                                                   int sizeAverage)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   THCUNN_assertSameGPU(state, 3, input, target, gradInput);
 
   long size = THCudaTensor_nElement(state, input);
@@ -1,175 +1,315 @@
 #include "hip/hip_runtime.h"
 #include "THCUNN.h"
 #include "common.h"
+#include "wavefront.h"
+
+#include <float.h>
+
+// SoftMax engines, picked by shape:
+//  - rows whose class dim is contiguous and short (<= SOFTMAX_WARP_MAX_DIM):
+//    one wavefront per row, reductions with shuffles only;
+//  - longer contiguous rows: one block per row, shuffle + shared memory tree
+//    reductions, float4 loads/stores when rows are 16-byte aligned;
+//  - spatial inputs (class dim strided): one thread per position, so that
+//    neighbouring threads read neighbouring addresses.
+// updateOutput reads the input twice and writes the output once: the first
+// read keeps a running max together with the sum of exponentials.
+
+#define SOFTMAX_THREADS 256
+#define SOFTMAX_MAX_THREADS 1024
+#define SOFTMAX_WARP_MAX_DIM 1024
+
+// Merges (max, sum of exp(x - max)) pairs
+__device__ __forceinline__ void softmax_merge(float &max_a, float &sum_a, float max_b, float sum_b)
+{
+  float max_k = fmaxf(max_a, max_b);
+  sum_a = sum_a * expf(max_a - max_k) + sum_b * expf(max_b - max_k);
+  max_a = max_k;
+}
 
-#define SOFTMAX_THREADS 128
+__device__ __forceinline__ void softmax_accumulate(float &max_k, float &sum_k, float x)
+{
+  if (x > max_k) {
+    sum_k = sum_k * expf(max_k - x) + 1.0f;
+    max_k = x;
+  } else {
+    sum_k += expf(x - max_k);
+  }
+}
 
-__global__ void cunn_SoftMax_updateOutput_kernel( 
-  float *output, float *input, int nframe, int dim, int stride0, int stride1)
+// Running (max, sum of exp(x - max)) pair, reduced with SoftMaxMerge
+struct SoftMaxPartial
 {
-  __shared__ float buffer[SOFTMAX_THREADS+1];
-  float *input_k  = input  + hipBlockIdx_x*dim*stride0 + hipBlockIdx_y*stride1 + hipBlockIdx_z;
-  float *output_k = output + hipBlockIdx_x*dim*stride0 + hipBlockIdx_y*stride1 + hipBlockIdx_z;
+  float max_k, sum_k;
+};
 
-  int i_start = hipThreadIdx_x;
-  int i_end = dim;
-  int i_step = hipBlockDim_x;
+__device__ __forceinline__ SoftMaxPartial waveShflXor(const SoftMaxPartial &p, int mask, int width)
+{
+  SoftMaxPartial o;
+  o.max_k = waveShflXor(p.max_k, mask, width);
+  o.sum_k = waveShflXor(p.sum_k, mask, width);
+  return o;
+}
 
-  // max?
-  buffer[hipThreadIdx_x] = -FLT_MAX;
-  for (int i=i_start; i<i_end; i+=i_step)
+struct SoftMaxMerge
+{
+  __device__ __forceinline__ SoftMaxPartial operator()(SoftMaxPartial a, const SoftMaxPartial &b) const
   {
-    float z = input_k[i*stride0];
-    if (buffer[hipThreadIdx_x] < z)
-      buffer[hipThreadIdx_x] = z;
+    softmax_merge(a.max_k, a.sum_k, b.max_k, b.sum_k);
+    return a;
   }
+};
 
+// Wavefront- and block-wide merges; every thread gets the result
+__device__ __forceinline__ void softmax_waveMerge(float &max_k, float &sum_k)
+{
+  SoftMaxPartial p = { max_k, sum_k };
+  p = waveReduce(p, SoftMaxMerge());
+  max_k = p.max_k;
+  sum_k = p.sum_k;
+}
 
-  __syncthreads();
+__device__ __forceinline__ void softmax_blockMerge(float &max_k, float &sum_k)
+{
+  SoftMaxPartial p = { max_k, sum_k };
+  SoftMaxPartial identity = { -FLT_MAX, 0.0f };
+  p = blockReduce(p, SoftMaxMerge(), identity);
+  max_k = p.max_k;
+  sum_k = p.sum_k;
+}
 
-  // reduce
-  if (hipThreadIdx_x == 0)
-  {
-    float max_k = -FLT_MAX;
-    for (int i=0; i<hipBlockDim_x; i++)
-    {
-      if (max_k < buffer[i])
-        max_k = buffer[i];
+// One wavefront per row; hipBlockDim_y rows per block
+__global__ void cunn_SoftMax_updateOutput_warp_kernel(
+  float *output, float *input, int nframe, int dim)
+{
+  int row = hipBlockIdx_x * hipBlockDim_y + hipThreadIdx_y;
+  if (row >= nframe)
+    return;
+  float *input_k  = input  + (long) row * dim;
+  float *output_k = output + (long) row * dim;
+
+  float max_k = -FLT_MAX;
+  float sum_k = 0.0f;
+  for (int i = hipThreadIdx_x; i < dim; i += WAVEFRONT_SIZE)
+    softmax_accumulate(max_k, sum_k, input_k[i]);
+  softmax_waveMerge(max_k, sum_k);
+
+  float norm = 1.0f / sum_k;
+  for (int i = hipThreadIdx_x; i < dim; i += WAVEFRONT_SIZE)
+    output_k[i] = expf(input_k[i] - max_k) * norm;
+}
+
+__global__ void cunn_SoftMax_updateGradInput_warp_kernel(
+  float *gradInput, float *output, float *gradOutput, int nframe, int dim)
+{
+  int row = hipBlockIdx_x * hipBlockDim_y + hipThreadIdx_y;
+  if (row >= nframe)
+    return;
+  long offset = (long) row * dim;
+
+  float sum_k = 0.0f;
+  for (int i = hipThreadIdx_x; i < dim; i += WAVEFRONT_SIZE)
+    sum_k += gradOutput[offset + i] * output[offset + i];
+  sum_k = waveSum(sum_k);
+
+  for (int i = hipThreadIdx_x; i < dim; i += WAVEFRONT_SIZE)
+    gradInput[offset + i] = output[offset + i] * (gradOutput[offset + i] - sum_k);
+}
+
+// One block per row. With Vec, rows are 16-byte aligned and dim % 4 == 0.
+template <bool Vec>
+__global__ void cunn_SoftMax_updateOutput_block_kernel(
+  float *output, float *input, int dim)
+{
+  float *input_k  = input  + (long) hipBlockIdx_x * dim;
+  float *output_k = output + (long) hipBlockIdx_x * dim;
+
+  float max_k = -FLT_MAX;
+  float sum_k = 0.0f;
+  if (Vec) {
+    float4 *in4 = (float4 *) input_k;
+    for (int i = hipThreadIdx_x; i < dim / 4; i += hipBlockDim_x) {
+      float4 v = in4[i];
+      softmax_accumulate(max_k, sum_k, v.x);
+      softmax_accumulate(max_k, sum_k, v.y);
+      softmax_accumulate(max_k, sum_k, v.z);
+      softmax_accumulate(max_k, sum_k, v.w);
     }
-    buffer[SOFTMAX_THREADS] = max_k;
+  } else {
+    for (int i = hipThreadIdx_x; i < dim; i += hipBlockDim_x)
+      softmax_accumulate(max_k, sum_k, input_k[i]);
   }
-
-  __syncthreads();
-
-  // sum?
-  float max_k = buffer[SOFTMAX_THREADS];
-  buffer[hipThreadIdx_x] = 0;
-  for (int i=i_start; i<i_end; i+=i_step) {
-#ifdef __HIP_PLATFORM_HCC__
-    float z = expf(input_k[i*stride0]-max_k);
-#else
-    float z = __expf(input_k[i*stride0]-max_k);
-#endif
-    buffer[hipThreadIdx_x] += z;
-    output_k[i*stride0] = z;
+  softmax_blockMerge(max_k, sum_k);
+
+  float norm = 1.0f / sum_k;
+  if (Vec) {
+    float4 *in4 = (float4 *) input_k;
+    float4 *out4 = (float4 *) output_k;
+    for (int i = hipThreadIdx_x; i < dim / 4; i += hipBlockDim_x) {
+      float4 v = in4[i];
+      v.x = expf(v.x - max_k) * norm;
+      v.y = expf(v.y - max_k) * norm;
+      v.z = expf(v.z - max_k) * norm;
+      v.w = expf(v.w - max_k) * norm;
+      out4[i] = v;
+    }
+  } else {
+    for (int i = hipThreadIdx_x; i < dim; i += hipBlockDim_x)
+      output_k[i] = expf(input_k[i] - max_k) * norm;
   }
+}
 
-  __syncthreads();
-
-  // reduce
-  if (hipThreadIdx_x == 0)
-  {
-    float sum_k = 0;
-    for (int i=0; i<hipBlockDim_x; i++)
-      sum_k += buffer[i];
-    buffer[SOFTMAX_THREADS] = sum_k;
+template <bool Vec>
+__global__ void cunn_SoftMax_updateGradInput_block_kernel(
+  float *gradInput, float *output, float *gradOutput, int dim)
+{
+  long offset = (long) hipBlockIdx_x * dim;
+
+  float sum_k = 0.0f;
+  if (Vec) {
+    float4 *out4 = (float4 *) (output + offset);
+    float4 *gout4 = (float4 *) (gradOutput + offset);
+    for (int i = hipThreadIdx_x; i < dim / 4; i += hipBlockDim_x) {
+      float4 o = out4[i];
+      float4 g = gout4[i];
+      sum_k += o.x * g.x + o.y * g.y + o.z * g.z + o.w * g.w;
+    }
+  } else {
+    for (int i = hipThreadIdx_x; i < dim; i += hipBlockDim_x)
+      sum_k += gradOutput[offset + i] * output[offset + i];
   }
+  sum_k = blockReduce(sum_k, WaveSum(), 0.0f);
+
+  if (Vec) {
+    float4 *out4 = (float4 *) (output + offset);
+    float4 *gout4 = (float4 *) (gradOutput + offset);
+    float4 *gin4 = (float4 *) (gradInput + offset);
+    for (int i = hipThreadIdx_x; i < dim / 4; i += hipBlockDim_x) {
+      float4 o = out4[i];
+      float4 g = gout4[i];
+      g.x = o.x * (g.x - sum_k);
+      g.y = o.y * (g.y - sum_k);
+      g.z = o.z * (g.z - sum_k);
+      g.w = o.w * (g.w - sum_k);
+      gin4[i] = g;
+    }
+  } else {
+    for (int i = hipThreadIdx_x; i < dim; i += hipBlockDim_x)
+      gradInput[offset + i] = output[offset + i] * (gradOutput[offset + i] - sum_k);
+  }
+}
 
-  __syncthreads();
+// One thread per (frame, position); classes are stride0 = npos apart
+__global__ void cunn_SoftMax_updateOutput_spatial_kernel(
+  float *output, float *input, int nframe, int dim, int npos)
+{
+  CUDA_KERNEL_LOOP(index, nframe * npos) {
+    long offset = (long) (index / npos) * dim * npos + index % npos;
+
+    float max_k = -FLT_MAX;
+    float sum_k = 0.0f;
+    for (int i = 0; i < dim; i++)
+      softmax_accumulate(max_k, sum_k, input[offset + (long) i * npos]);
 
-  // softmax
-  float sum_k = buffer[SOFTMAX_THREADS];
-  for (int i=i_start; i<i_end; i+=i_step)
-    output_k[i*stride0] = output_k[i*stride0] / sum_k;
+    float norm = 1.0f / sum_k;
+    for (int i = 0; i < dim; i++)
+      output[offset + (long) i * npos] = expf(input[offset + (long) i * npos] - max_k) * norm;
+  }
 }
 
-__global__ void cunn_SoftMax_updateGradInput_kernel( 
-  float *gradInput, float *output, float *gradOutput, int nframe, int dim, int stride0, int stride1)
+__global__ void cunn_SoftMax_updateGradInput_spatial_kernel(
+  float *gradInput, float *output, float *gradOutput, int nframe, int dim, int npos)
 {
-  __shared__ float buffer[SOFTMAX_THREADS];
-  float *gradInput_k  = gradInput  + hipBlockIdx_x*dim*stride0 + hipBlockIdx_y * stride1 + hipBlockIdx_z;
-  float *output_k     = output     + hipBlockIdx_x*dim*stride0 + hipBlockIdx_y * stride1 + hipBlockIdx_z;
-  float *gradOutput_k = gradOutput + hipBlockIdx_x*dim*stride0 + hipBlockIdx_y * stride1 + hipBlockIdx_z;
-
-  int i_start = hipThreadIdx_x;
-  int i_end = dim;
-  int i_step = hipBlockDim_x;
+  CUDA_KERNEL_LOOP(index, nframe * npos) {
+    long offset = (long) (index / npos) * dim * npos + index % npos;
 
-  // sum?
-  buffer[hipThreadIdx_x] = 0;
-  for (int i=i_start; i<i_end; i+=i_step)
-    buffer[hipThreadIdx_x] += gradOutput_k[i*stride0] * output_k[i*stride0];
+    float sum_k = 0.0f;
+    for (int i = 0; i < dim; i++)
+      sum_k += gradOutput[offset + (long) i * npos] * output[offset + (long) i * npos];
 
-  __syncthreads();
+    for (int i = 0; i < dim; i++) {
+      long j = offset + (long) i * npos;
+      gradInput[j] = output[j] * (gradOutput[j] - sum_k);
+    }
+  }
+}
 
-  // reduce
-  if (hipThreadIdx_x == 0)
-  {
-    float sum_k = 0;
-    for (int i=0; i<hipBlockDim_x; i++)
-      sum_k += buffer[i];
-    buffer[0] = sum_k;
+// Splits a contiguous tensor into nframe x dim x npos, dim being the class dim
+static void THNN_CudaSoftMax_shape(THCudaTensor *t, long *nframe, long *dim, long *npos)
+{
+  if (t->nDimension == 1) {
+    *nframe = 1;
+    *dim = t->size[0];
+    *npos = 1;
+  } else if (t->nDimension == 2) {
+    *nframe = t->size[0];
+    *dim = t->size[1];
+    *npos = 1;
+  } else if (t->nDimension == 3) {
+    *nframe = 1;
+    *dim = t->size[0];
+    *npos = t->size[1] * t->size[2];
+  } else if (t->nDimension == 4) {
+    *nframe = t->size[0];
+    *dim = t->size[1];
+    *npos = t->size[2] * t->size[3];
+  } else {
+    THError("1D, 2D, 3D or 4D tensor expected");
   }
+}
 
-  __syncthreads();
+static int THNN_CudaSoftMax_blockThreads(long dim, bool vec)
+{
+  long work = vec ? dim / 4 : dim;
+  int threads = WAVEFRONT_SIZE;
+  while (threads < work && threads < SOFTMAX_MAX_THREADS)
+    threads *= 2;
+  return threads;
+}
 
-  float sum_k = buffer[0];
-  for (int i=i_start; i<i_end; i+=i_step)
-    gradInput_k[i*stride0] = output_k[i*stride0] * (gradOutput_k[i*stride0] - sum_k);
+static bool THNN_CudaSoftMax_canVectorize(long dim, float *a, float *b, float *c)
+{
+  return dim % 4 == 0
+    && ((size_t) a) % 16 == 0
+    && ((size_t) b) % 16 == 0
+    && (c == NULL || ((size_t) c) % 16 == 0);
 }
 
 void THNN_CudaSoftMax_updateOutput(THCState *state, THCudaTensor *input, THCudaTensor *output)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   THCUNN_assertSameGPU(state, 2, input, output);
 
   input = THCudaTensor_newContiguous(state, input);
   THCudaTensor_resizeAs(state, output, input);
-  long batchSize, dim, stride0, stride1 = 1;
-  long blocksY = 1, blocksZ = 1;
-
-  if (input->nDimension == 1)
-  {
-    batchSize = 1;
-    dim = input->size[0];
-    stride0 = 1;
-  }
-  else if (input->nDimension == 2)
-  {
-    batchSize = input->size[0];
-    dim = input->size[1];
-    stride0 = 1;
-  }
-  else if (input->nDimension == 3)
-  {
-    batchSize = 1;
-    dim = input->size[0];
-    blocksY = input->size[1];
-    blocksZ = input->size[2];
-    stride0 = blocksY * blocksZ;
-    stride1 = blocksZ;
-  }
-  else if (input->nDimension == 4)
-  {
-    batchSize = input->size[0];
-    dim = input->size[1];
-    blocksY = input->size[2];
-    blocksZ = input->size[3];
-    stride0 = blocksY * blocksZ;
-    stride1 = blocksZ;
-  }
-  else
-  {
-    THError("1D, 2D, 3D or 4D tensor expected");
-  }
 
-  // when possible use only 2d grid of thread blocks to stay compatible with compute capability 2.X devices.
-  if (blocksY * blocksZ < 65536)
-  {
-    blocksY *= blocksZ;
-    blocksZ = 1;
-    if (input->nDimension == 3 || input->nDimension == 4) {
-      stride0 = blocksY * blocksZ;
-      stride1 = blocksZ;
-    }
+  long nframe, dim, npos;
+  THNN_CudaSoftMax_shape(input, &nframe, &dim, &npos);
+
+  float *input_data = THCudaTensor_data(state, input);
+  float *output_data = THCudaTensor_data(state, output);
+  hipStream_t stream = THCState_getCurrentStream(state);
+
+  if (npos > 1) {
+    long n = nframe * npos;
+    hipLaunchKernelGGL((cunn_SoftMax_updateOutput_spatial_kernel), dim3(GET_BLOCKS(n)), dim3(CUDA_NUM_THREADS), 0, stream, 
+      output_data, input_data, nframe, dim, npos);
+  } else if (dim <= SOFTMAX_WARP_MAX_DIM) {
+    dim3 threads(WAVEFRONT_SIZE, SOFTMAX_THREADS / WAVEFRONT_SIZE);
+    dim3 blocks((nframe + threads.y - 1) / threads.y);
+    THCUNN_PROFILE_LAUNCH(blocks, threads);
+    hipLaunchKernelGGL((cunn_SoftMax_updateOutput_warp_kernel), dim3(blocks), dim3(threads), 0, stream, 
+      output_data, input_data, nframe, dim);
+  } else if (THNN_CudaSoftMax_canVectorize(dim, input_data, output_data, NULL)) {
+    THCUNN_PROFILE_LAUNCH(nframe, dim3(THNN_CudaSoftMax_blockThreads(dim, true)));
+    hipLaunchKernelGGL((cunn_SoftMax_updateOutput_block_kernel<true>), dim3(nframe), dim3(THNN_CudaSoftMax_blockThreads(dim, true)), 0, stream, 
+      output_data, input_data, dim);
+  } else {
+    THCUNN_PROFILE_LAUNCH(nframe, dim3(THNN_CudaSoftMax_blockThreads(dim, false)));
+    hipLaunchKernelGGL((cunn_SoftMax_updateOutput_block_kernel<false>), dim3(nframe), dim3(THNN_CudaSoftMax_blockThreads(dim, false)), 0, stream, 
+      output_data, input_data, dim);
   }
-
-  dim3 blocks(batchSize, blocksY, blocksZ);
-  dim3 threads(SOFTMAX_THREADS);
-  hipLaunchKernelGGL((cunn_SoftMax_updateOutput_kernel), dim3(blocks), dim3(threads), 0, THCState_getCurrentStream(state), 
-    THCudaTensor_data(state, output),
-    THCudaTensor_data(state, input),
-    batchSize, dim, stride0, stride1
-  );
   THCudaCheck(hipGetLastError());
 
   THCudaTensor_free(state, input);
@@ -177,69 +317,42 @@ void THNN_CudaSoftMax_updateOutput(THCState *state, THCudaTensor *input, THCudaT
 
 void THNN_CudaSoftMax_updateGradInput(THCState *state, THCudaTensor *input, THCudaTensor *gradOutput, THCudaTensor *gradInput, THCudaTensor *output)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   THCUNN_assertSameGPU(state, 3, output, gradOutput, gradInput);
 
   output = THCudaTensor_newContiguous(state, output);
   gradOutput = THCudaTensor_newContiguous(state, gradOutput);
 
   THCudaTensor_resizeAs(state, gradInput, output);
-  long batchSize, dim, stride0, stride1 = 1;
-  long blocksY = 1, blocksZ = 1;
 
-  if (gradInput->nDimension == 1)
-  {
-    batchSize = 1;
-    dim = gradInput->size[0];
-    stride0 = 1;
+  long nframe, dim, npos;
+  THNN_CudaSoftMax_shape(gradInput, &nframe, &dim, &npos);
+
+  float *gradInput_data = THCudaTensor_data(state, gradInput);
+  float *output_data = THCudaTensor_data(state, output);
+  float *gradOutput_data = THCudaTensor_data(state, gradOutput);
+  hipStream_t stream = THCState_getCurrentStream(state);
+
+  if (npos > 1) {
+    long n = nframe * npos;
+    hipLaunchKernelGGL((cunn_SoftMax_updateGradInput_spatial_kernel), dim3(GET_BLOCKS(n)), dim3(CUDA_NUM_THREADS), 0, stream, 
+      gradInput_data, output_data, gradOutput_data, nframe, dim, npos);
+  } else if (dim <= SOFTMAX_WARP_MAX_DIM) {
+    dim3 threads(WAVEFRONT_SIZE, SOFTMAX_THREADS / WAVEFRONT_SIZE);
+    dim3 blocks((nframe + threads.y - 1) / threads.y);
+    THCUNN_PROFILE_LAUNCH(blocks, threads);
+    hipLaunchKernelGGL((cunn_SoftMax_updateGradInput_warp_kernel), dim3(blocks), dim3(threads), 0, stream, 
+      gradInput_data, output_data, gradOutput_data, nframe, dim);
+  } else if (THNN_CudaSoftMax_canVectorize(dim, gradInput_data, output_data, gradOutput_data)) {
+    THCUNN_PROFILE_LAUNCH(nframe, dim3(THNN_CudaSoftMax_blockThreads(dim, true)));
+    hipLaunchKernelGGL((cunn_SoftMax_updateGradInput_block_kernel<true>), dim3(nframe), dim3(THNN_CudaSoftMax_blockThreads(dim, true)), 0, stream, 
+      gradInput_data, output_data, gradOutput_data, dim);
+  } else {
+    THCUNN_PROFILE_LAUNCH(nframe, dim3(THNN_CudaSoftMax_blockThreads(dim, false)));
+    hipLaunchKernelGGL((cunn_SoftMax_updateGradInput_block_kernel<false>), dim3(nframe), dim3(THNN_CudaSoftMax_blockThreads(dim, false)), 0, stream, 
+      gradInput_data, output_data, gradOutput_data, dim);
   }
-  else if (gradInput->nDimension == 2)
-  {
-    batchSize = gradInput->size[0];
-    dim = gradInput->size[1];
-    stride0 = 1;
-  }
-  else if (gradInput->nDimension == 3)
-  {
-    batchSize = 1;
-    dim = gradInput->size[0];
-    blocksY = gradInput->size[1];
-    blocksZ = gradInput->size[2];
-    stride0 = blocksY * blocksZ;
-    stride1 = blocksZ;
-  }
-  else if (gradInput->nDimension == 4)
-  {
-    batchSize = gradInput->size[0];
-    dim = gradInput->size[1];
-    blocksY = gradInput->size[2];
-    blocksZ = gradInput->size[3];
-    stride0 = blocksY * blocksZ;
-    stride1 = blocksZ;
-  }
-  else
-  {
-    THError("1D, 2D, 3D or 4D tensor expected");
-  }
-
-  // when possible use only 2d grid of thread blocks to stay compatible with compute capability 2.X devices.
-  if (blocksY * blocksZ < 65536)
-  {
-    blocksY *= blocksZ;
-    blocksZ = 1;
-    if (input->nDimension == 3 || input->nDimension == 4) {
-      stride0 = blocksY * blocksZ;
-      stride1 = blocksZ;
-    }
-  }
-
-  dim3 blocks(batchSize, blocksY, blocksZ);
-  dim3 threads(SOFTMAX_THREADS);
-  hipLaunchKernelGGL((cunn_SoftMax_updateGradInput_kernel), dim3(blocks), dim3(threads), 0, THCState_getCurrentStream(state), 
-    THCudaTensor_data(state, gradInput),
-    THCudaTensor_data(state, output),
-    THCudaTensor_data(state, gradOutput),
-    batchSize, dim, stride0, stride1
-  );
   THCudaCheck(hipGetLastError());
 
   THCudaTensor_free(state, gradOutput);
@@ -247,3 +360,5 @@ void THNN_CudaSoftMax_updateGradInput(THCState *state, THCudaTensor *input, THCu
 }
 
 #undef SOFTMAX_THREADS
+#undef SOFTMAX_MAX_THREADS
+#undef SOFTMAX_WARP_MAX_DIM
@@ -24,6 +24,8 @@ struct softPlusupdateOutput_functor
 
 void THNN_CudaSoftPlus_updateOutput(THCState *state, THCudaTensor *input, THCudaTensor *output, float beta, float threshold)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   THCUNN_assertSameGPU(state, 2, input, output);
   THCudaTensor_resizeAs(state, output, input);
   THC_pointwiseApply2(state, output, input, softPlusupdateOutput_functor(threshold, beta));
@@ -54,6 +56,8 @@ struct softPlusupdateGradInput_functor
 void THNN_CudaSoftPlus_updateGradInput(THCState *state, THCudaTensor *input, THCudaTensor *gradOutput, THCudaTensor *gradInput,
   THCudaTensor *output, float beta, float threshold)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   THCUNN_assertSameGPU(state, 4, input, output, gradOutput, gradInput);
   THCudaTensor_resizeAs(state, gradInput, output);
   THC_pointwiseApply3(state, gradInput, output, gradOutput, softPlusupdateGradInput_functor(threshold, beta));
@@ -1,4 +1,6 @@
+#include "hip/hip_runtime.h"
 #include "THCUNN.h"
+#include "common.h"
 
 #ifdef __NVCC__
   #include <cusparse.h>
@@ -37,12 +39,169 @@ static bool checkSize1D(THCudaTensor* t, long size0)
   return t->nDimension == 1 && t->size[0] == size0;
 }
 
+#ifndef __NVCC__
+// Native CSR x dense kernels, used where cuSPARSE is not available.
+//
+// All products have the form
+//   out[r * ldOutRow + o * ldOutCol] += alpha * sum_j val[j] * dense[(col[j]-1) * ldDenseRow + o * ldDenseCol]
+// for the entries j of row r, with one-based row and column indices as stored
+// in the nnz x 3 input. Forward uses the rows of the input, accGradParameters
+// the columns (the input sorted by column is a CSC matrix, i.e. the CSR of
+// its transpose).
+
+#ifndef DIVUP
+#define DIVUP(x, y) (((x) + (y) - 1) / (y))
+#endif
+
+#define SPARSE_THREADS 128
+// Entries handled by one block of the nnz-balanced kernel
+#define SPARSE_NNZ_PER_BLOCK 256
+// Switch to the nnz-balanced kernel when the longest row holds this many
+// times the average row, or when there are too few rows to fill the device
+#define SPARSE_IMBALANCE 4
+
+// COO -> CSR: csrPtrs[r] is the first entry of (zero-based) row r
+__global__ void cunn_SparseLinear_coo2csr(
+    const int *rowInds, int *csrPtrs, int nnz, int nRows)
+{
+  CUDA_KERNEL_LOOP(i, nnz + 1) {
+    int lo = i == 0 ? 0 : rowInds[i - 1];
+    int hi = i == nnz ? nRows : rowInds[i] - 1;
+    for (int r = lo; r <= hi; r++) {
+      csrPtrs[r] = i;
+    }
+  }
+}
+
+__global__ void cunn_SparseLinear_maxRowLength(
+    const int *csrPtrs, int *maxLength, int nRows)
+{
+  CUDA_KERNEL_LOOP(r, nRows) {
+    atomicMax(maxLength, csrPtrs[r + 1] - csrPtrs[r]);
+  }
+}
+
+// One block per row; no two blocks touch the same output row, so the
+// accumulation is deterministic and needs no atomics. Does nothing when the
+// longest row is above maxBalanced; the nnz-balanced kernel takes over then.
+__global__ void cunn_SparseLinear_csrmmRowSplit(
+    const int *csrPtrs, const int *colInds, const float *values,
+    const float *dense, long ldDenseRow, long ldDenseCol,
+    float *out, long ldOutRow, long ldOutCol,
+    int nRows, int nOut, float alpha,
+    const int *maxLength, float maxBalanced)
+{
+  if (*maxLength > maxBalanced)
+    return;
+  for (int r = hipBlockIdx_x; r < nRows; r += hipGridDim_x) {
+    int start = csrPtrs[r];
+    int end = csrPtrs[r + 1];
+    for (int o = hipThreadIdx_x; o < nOut; o += hipBlockDim_x) {
+      float acc = 0;
+      for (int j = start; j < end; j++) {
+        acc += values[j] * dense[(colInds[j] - 1) * ldDenseRow + o * ldDenseCol];
+      }
+      out[r * ldOutRow + o * ldOutCol] += alpha * acc;
+    }
+  }
+}
+
+// Every block takes SPARSE_NNZ_PER_BLOCK consecutive entries regardless of
+// row boundaries and flushes a partial row whenever the row changes. Rows that
+// straddle blocks are combined with atomics. Unless maxLength is NULL, does
+// nothing when the longest row is at most maxBalanced.
+__global__ void cunn_SparseLinear_csrmmNnzBalanced(
+    const int *rowInds, const int *colInds, const float *values,
+    const float *dense, long ldDenseRow, long ldDenseCol,
+    float *out, long ldOutRow, long ldOutCol,
+    int nnz, int nOut, float alpha,
+    const int *maxLength, float maxBalanced)
+{
+  if (maxLength && *maxLength <= maxBalanced)
+    return;
+  __shared__ int rows[SPARSE_NNZ_PER_BLOCK];
+  __shared__ int cols[SPARSE_NNZ_PER_BLOCK];
+  __shared__ float vals[SPARSE_NNZ_PER_BLOCK];
+
+  int start = hipBlockIdx_x * SPARSE_NNZ_PER_BLOCK;
+  int count = min(SPARSE_NNZ_PER_BLOCK, nnz - start);
+  for (int j = hipThreadIdx_x; j < count; j += hipBlockDim_x) {
+    rows[j] = rowInds[start + j] - 1;
+    cols[j] = colInds[start + j] - 1;
+    vals[j] = values[start + j];
+  }
+  __syncthreads();
+
+  for (int o = hipThreadIdx_x; o < nOut; o += hipBlockDim_x) {
+    int row = rows[0];
+    float acc = 0;
+    for (int j = 0; j < count; j++) {
+      if (rows[j] != row) {
+        atomicAdd(&out[row * ldOutRow + o * ldOutCol], alpha * acc);
+        row = rows[j];
+        acc = 0;
+      }
+      acc += vals[j] * dense[cols[j] * ldDenseRow + o * ldDenseCol];
+    }
+    atomicAdd(&out[row * ldOutRow + o * ldOutCol], alpha * acc);
+  }
+}
+
+// Builds the row pointers of the (row-sorted) COO matrix and runs whichever
+// kernel suits its nnz/row distribution. The longest row is only known on the
+// device, so rather than waiting for it both kernels are queued and the one
+// that does not apply returns straight away.
+static void sparseLinear_csrmm(THCState *state,
+    THCudaIntTensor *rowInds, THCudaIntTensor *csrPtrs,
+    THCudaIntTensor *colInds, THCudaTensor *values,
+    long nnz, long nRows,
+    float *dense, long ldDenseRow, long ldDenseCol,
+    float *out, long ldOutRow, long ldOutCol,
+    long nOut, float alpha)
+{
+  hipStream_t stream = THCState_getCurrentStream(state);
+  if (nnz == 0)
+    return;
+
+  // csrPtrs[nRows + 1] holds the longest row
+  THCudaIntTensor_resize1d(state, csrPtrs, nRows + 2);
+  int *csrPtrs_data = THCudaIntTensor_data(state, csrPtrs);
+  hipLaunchKernelGGL((cunn_SparseLinear_coo2csr), dim3(GET_BLOCKS(nnz + 1)), dim3(CUDA_NUM_THREADS), 0, stream, 
+      THCudaIntTensor_data(state, rowInds), csrPtrs_data, nnz, nRows);
+  THCudaCheck(hipGetLastError());
+
+  // Too few rows to fill the device: no need to look at their lengths
+  int numSM = THCState_getCurrentDeviceProperties(state)->multiProcessorCount;
+  int *maxLength = NULL;
+  float maxBalanced = SPARSE_IMBALANCE * ((float) nnz / nRows);
+  if (nRows >= numSM) {
+    maxLength = csrPtrs_data + nRows + 1;
+    THCudaCheck(hipMemsetAsync(maxLength, 0, sizeof(int), stream));
+    hipLaunchKernelGGL((cunn_SparseLinear_maxRowLength), dim3(GET_BLOCKS(nRows)), dim3(CUDA_NUM_THREADS), 0, stream, 
+        csrPtrs_data, maxLength, nRows);
+    THCudaCheck(hipGetLastError());
+    hipLaunchKernelGGL((cunn_SparseLinear_csrmmRowSplit), dim3(nRows < 65535 ? nRows : 65535), dim3(SPARSE_THREADS), 0, stream, 
+        csrPtrs_data, THCudaIntTensor_data(state, colInds),
+        THCudaTensor_data(state, values), dense, ldDenseRow, ldDenseCol,
+        out, ldOutRow, ldOutCol, nRows, nOut, alpha, maxLength, maxBalanced);
+    THCudaCheck(hipGetLastError());
+  }
+  hipLaunchKernelGGL((cunn_SparseLinear_csrmmNnzBalanced), dim3(DIVUP(nnz, SPARSE_NNZ_PER_BLOCK)), dim3(SPARSE_THREADS), 0, stream, 
+      THCudaIntTensor_data(state, rowInds), THCudaIntTensor_data(state, colInds),
+      THCudaTensor_data(state, values), dense, ldDenseRow, ldDenseCol,
+      out, ldOutRow, ldOutCol, nnz, nOut, alpha, maxLength, maxBalanced);
+  THCudaCheck(hipGetLastError());
+}
+#endif
+
 void THNN_CudaSparseLinear_updateOutput(THCState *state,
           THCudaTensor *input,
           THCudaTensor *output,
           THCudaTensor *weight,
           THCudaTensor *bias)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   THAssert(THCudaTensor_checkGPU(state, 4, input, output, weight, bias));
 
   long h;
@@ -94,7 +253,12 @@ void THNN_CudaSparseLinear_updateOutput(THCState *state,
   }
 
   // output = W * x
-#ifdef __NVCC__
+#ifndef __NVCC__
+  sparseLinear_csrmm(state, rowbuf, csrPtrs, colInds, values, nnz, batchnum,
+      THCudaTensor_data(state, weight), 1, inDim,
+      THCudaTensor_data(state, buffer), 1, batchnum,
+      outDim, 1);
+#else
   float one = 1;
   cusparseMatDescr_t descr = 0;
   cusparseCreateMatDescr(&descr);
@@ -140,6 +304,8 @@ void THNN_CudaSparseLinear_accGradParameters(
           double weightDecay,
           double scale)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   long outDim = THCudaTensor_size(state, weight, 0);
   long inDim = THCudaTensor_size(state, weight, 1);
 
@@ -193,8 +359,14 @@ void THNN_CudaSparseLinear_accGradParameters(
   THCudaTensor_copy(state, buf, gradOutput);
   THCudaTensor_transpose(state, gradOutput, NULL, 0, 1); // Restore gradOutput
 
-#ifdef __NVCC__
+#ifndef __NVCC__
+  sparseLinear_csrmm(state, colbuf, colPtrs, rowInds, values, nnz, inDim,
+      THCudaTensor_data(state, buf), 1, batchnum,
+      THCudaTensor_data(state, gradWeight), 1, inDim,
+      outDim, scale);
+#else
   float one = 1;
+  float alpha = scale;
   cusparseMatDescr_t descr = 0;
   cusparseCreateMatDescr(&descr);
   cusparseSetMatType(descr,CUSPARSE_MATRIX_TYPE_GENERAL);
@@ -202,7 +374,7 @@ void THNN_CudaSparseLinear_accGradParameters(
   cusparseScsrmm(cusparse_handle,
       CUSPARSE_OPERATION_NON_TRANSPOSE,
       inDim, outDim, batchnum, nnz,
-      &one,
+      &alpha,
       descr,
       THCudaTensor_data(state, values),
       THCudaIntTensor_data(state, colPtrs),
@@ -238,6 +410,8 @@ void THNN_CudaSparseLinear_legacyUpdateOutput(
           THCudaTensor *output,
           THCudaTensor *weight,
           THCudaTensor *bias) {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   THError("CUDA does not support legacy input format, please use a table of nnz x 2 vectors");
 }
 void THNN_CudaSparseLinear_legacyAccGradParameters(
@@ -250,6 +424,8 @@ void THNN_CudaSparseLinear_legacyAccGradParameters(
           THCudaTensor *bias,
           double weightDecay,
           double scale) {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   THError("CUDA does not support legacy input format, please use a table of nnz x 2 vectors");
 }
 
@@ -259,6 +435,7 @@ void THNN_CudaSparseLinear_zeroGradParameters(
           THCudaTensor *gradWeight,
           THCudaTensor *gradBias,
           THCudaTensor *lastInput) {
+  THCUNN_PROFILE_FUNC(state);
   THCudaTensor_zero(state, gradWeight);
   THCudaTensor_zero(state, gradBias);
 }
@@ -271,9 +448,11 @@ TH_API void THNN_CudaSparseLinear_updateParameters(
           THCudaTensor *gradBias,
           THCudaTensor *lastInput,
           double learningRate) {
+  THCUNN_PROFILE_FUNC(state);
   THCudaTensor_cadd(state, weight, weight, -learningRate, gradWeight);
   THCudaTensor_cadd(state, bias, bias, -learningRate, gradBias);
 }
 
 void THNN_CudaSparseLinear_cudaClearState(THCState *state) {
+  THCUNN_PROFILE_FUNC(state);
 }
@@ -188,6 +188,8 @@ __global__ void atomicadaptivemaxgradinput(
 
 void THNN_CudaSpatialAdaptiveMaxPooling_updateOutput(THCState *state, THCudaTensor *input, THCudaTensor *output, THCudaTensor *indices, int nOutputCols, int nOutputRows)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   THCUNN_assertSameGPU(state, 3, input, output, indices);
 
   float *indices_data;
@@ -220,6 +222,7 @@ void THNN_CudaSpatialAdaptiveMaxPooling_updateOutput(THCState *state, THCudaTens
     dim3 threads(32,8);
 
     // run maxpool kernel
+    THCUNN_PROFILE_LAUNCH(blocks, threads);
     hipLaunchKernelGGL((adaptivemaxpool), dim3(blocks), dim3(threads), 0, THCState_getCurrentStream(state), input_data, output_data,
                                    indices_data+nInputPlane*nOutputCols*nOutputRows, indices_data,
                                    nInputPlane, nInputRows, nInputCols, nOutputRows, nOutputCols,
@@ -252,6 +255,7 @@ void THNN_CudaSpatialAdaptiveMaxPooling_updateOutput(THCState *state, THCudaTens
     dim3 threads(32,8);
 
     // run maxpool kernel
+    THCUNN_PROFILE_LAUNCH(blocks, threads);
     hipLaunchKernelGGL((adaptivemaxpool), dim3(blocks), dim3(threads), 0, THCState_getCurrentStream(state), input_data, output_data,
                                    indices_data+nbatch*nInputPlane*nOutputCols*nOutputRows, indices_data,
                                    nInputPlane, nInputRows, nInputCols, nOutputRows, nOutputCols,
@@ -264,6 +268,8 @@ void THNN_CudaSpatialAdaptiveMaxPooling_updateOutput(THCState *state, THCudaTens
 
 void THNN_CudaSpatialAdaptiveMaxPooling_updateGradInput(THCState *state, THCudaTensor *input, THCudaTensor *gradOutput, THCudaTensor *gradInput, THCudaTensor *indices)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   bool atomic = true; // suboptimal, but without atomic it doesn't pass the tests
 
   THCUNN_assertSameGPU(state, 4, input, indices, gradOutput, gradInput);
@@ -299,6 +305,7 @@ void THNN_CudaSpatialAdaptiveMaxPooling_updateGradInput(THCState *state, THCudaT
     if(atomic)
     {
       // run updateGradInput kernel, accumulate gradients atomically
+      THCUNN_PROFILE_LAUNCH(blocks, threads);
       hipLaunchKernelGGL((atomicadaptivemaxgradinput), dim3(blocks), dim3(threads), 0, THCState_getCurrentStream(state), gradInput_data, gradOutput_data,
                                           indices_data+nInputPlane*nOutputCols*nOutputRows, indices_data,
                                           nInputPlane, nInputRows, nInputCols, nOutputRows, nOutputCols);
@@ -306,6 +313,7 @@ void THNN_CudaSpatialAdaptiveMaxPooling_updateGradInput(THCState *state, THCudaT
     else
     {
       // run updateGradInput kernel
+      THCUNN_PROFILE_LAUNCH(blocks, threads);
       hipLaunchKernelGGL((atomicadaptivemaxgradinput), dim3(blocks), dim3(threads), 0, THCState_getCurrentStream(state), gradInput_data, gradOutput_data,
                                           indices_data+nInputPlane*nOutputCols*nOutputRows, indices_data,
                                           nInputPlane, nInputRows, nInputCols, nOutputRows, nOutputCols);
@@ -337,6 +345,7 @@ void THNN_CudaSpatialAdaptiveMaxPooling_updateGradInput(THCState *state, THCudaT
     if(atomic)
     {
       // run updateGradInput kernel, accumulate gradients atomically
+      THCUNN_PROFILE_LAUNCH(blocks, threads);
       hipLaunchKernelGGL((atomicadaptivemaxgradinput), dim3(blocks), dim3(threads), 0, THCState_getCurrentStream(state), gradInput_data, gradOutput_data,
                                           indices_data+nbatch*nInputPlane*nOutputCols*nOutputRows, indices_data,
                                           nInputPlane, nInputRows, nInputCols, nOutputRows, nOutputCols);
@@ -344,6 +353,7 @@ void THNN_CudaSpatialAdaptiveMaxPooling_updateGradInput(THCState *state, THCudaT
     else
     {
       // run updateGradInput kernel, accumulate gradients atomically
+      THCUNN_PROFILE_LAUNCH(blocks, threads);
       hipLaunchKernelGGL((adaptivemaxgradinput), dim3(blocks), dim3(threads), 0, THCState_getCurrentStream(state), gradInput_data, gradOutput_data,
                                           indices_data+nbatch*nInputPlane*nOutputCols*nOutputRows, indices_data,
                                           nInputPlane, nInputRows, nInputCols, nOutputRows, nOutputCols);
@@ -1,67 +1,47 @@
 #include "hip/hip_runtime.h"
 #include "THCUNN.h"
 #include "common.h"
+#include "nll_reduce.h"
 
 #include <stdio.h>
 #include <assert.h>
 
-#if THRUST_PATH
-    #include <thrust/functional.h>
-#else
-    #include <bolt/amp/functional.h>
-#endif
-
+// First stage of the loss reduction over all batch_size * map_nelem pixels;
+// see nll_reduce.h for the second one.
 __global__ void cunn_SpatialClassNLLCriterion_updateOutput_kernel( 
-          float *output,
-          float *total_weight,
+          float *partials,
           float *input,
           long *target,
           float *weights,
-          int size_average,
           int batch_size,
           int n_classes,
-          int map_nelem,
-          int blocks_per_sample)
+          int map_nelem)
 {
-  __shared__ float partial_sums[CUDA_NUM_THREADS];
-
-  int i, t;
+  int t;
   float cur_weight;
   float input_sum = 0;
   float acc_weight = 0;
 
-  int sample = hipBlockIdx_x / blocks_per_sample;
-  int toffset = sample * map_nelem;
-  int ioffset = sample * map_nelem * n_classes;
-  int step = hipBlockDim_x * blocks_per_sample;
-  for (i = (hipBlockIdx_x % blocks_per_sample) * hipBlockDim_x + hipThreadIdx_x;
-       i < map_nelem;
-       i += step) {
-    t = target[toffset + i] - TH_INDEX_BASE;
+  long nelem = (long) batch_size * map_nelem;
+  for (long i = hipBlockIdx_x * hipBlockDim_x + hipThreadIdx_x;
+       i < nelem;
+       i += hipBlockDim_x * hipGridDim_x) {
+    long sample = i / map_nelem;
+    long pos = i % map_nelem;
+    t = target[i] - TH_INDEX_BASE;
 #if defined(__HIP_PLATFORM_NVCC__)
     assert(t >= 0 && t < n_classes);
 #endif
     cur_weight = weights ? weights[t] : 1.0f;
-    input_sum -= input[ioffset + i + map_nelem * t] * cur_weight;
+    input_sum -= input[(sample * n_classes + t) * map_nelem + pos] * cur_weight;
     acc_weight += cur_weight;
   }
 
-  __syncthreads();
-
-#if THRUST_PATH
-  input_sum = reduceBlock(partial_sums, hipBlockDim_x, input_sum, thrust::plus<float>(), 0.0f);
-  acc_weight = reduceBlock(partial_sums, hipBlockDim_x, acc_weight, thrust::plus<float>(), 0.0f);
-#else
-  input_sum = reduceBlock(partial_sums, hipBlockDim_x, input_sum, bolt::amp::plus<float>(), 0.0f);
-  acc_weight = reduceBlock(partial_sums, hipBlockDim_x, acc_weight, bolt::amp::plus<float>(), 0.0f);
-#endif
+  nllReduceBlock(input_sum, acc_weight);
 
   if (hipThreadIdx_x == 0) {
-    atomicAdd(total_weight, acc_weight);
-    if (size_average && acc_weight > 0)
-      atomicAdd(output, input_sum / acc_weight / hipGridDim_x);
-    else
-      atomicAdd(output, input_sum);
+    partials[2 * hipBlockIdx_x] = input_sum;
+    partials[2 * hipBlockIdx_x + 1] = acc_weight;
   }
 }
 
@@ -106,6 +86,8 @@ void THNN_CudaSpatialClassNLLCriterion_updateOutput(
           THCudaTensor *weights,
           THCudaTensor *total_weight)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   THArgCheck(THCudaLongTensor_nDimension(state, target) == 3, 1,
                "only batches of spatial targets supported (3D tensors)");
   THArgCheck(THCudaTensor_nDimension(state, input) == 4, 2,
@@ -131,29 +113,32 @@ void THNN_CudaSpatialClassNLLCriterion_updateOutput(
 
   long batch_size = THCudaLongTensor_size(state, target, 0);
   long map_nelem = THCudaLongTensor_nElement(state, target) / batch_size;
-  int blocks_per_sample = GET_BLOCKS(map_nelem) / 128;
-  blocks_per_sample = (blocks_per_sample == 0) ? 1 : blocks_per_sample;
-  int total_blocks = blocks_per_sample * batch_size;
+  int blocks = NLL_REDUCE_BLOCKS(batch_size * map_nelem);
+  THCudaTensor *partials = THCudaTensor_newWithSize1d(state, 2 * blocks);
 
-  THCudaTensor_fill(state, output, 0);
-  THCudaTensor_fill(state, total_weight, 0);
-
-  hipLaunchKernelGGL((cunn_SpatialClassNLLCriterion_updateOutput_kernel), dim3(total_blocks), dim3(CUDA_NUM_THREADS), 0, THCState_getCurrentStream(state), 
-      output_data,
-      total_weight_data,
+  hipLaunchKernelGGL((cunn_SpatialClassNLLCriterion_updateOutput_kernel), dim3(blocks), dim3(NLL_REDUCE_THREADS), 0, THCState_getCurrentStream(state), 
+      THCudaTensor_data(state, partials),
       input_data,
       target_data,
       weights_data,
-      sizeAverage,
       THCudaTensor_size(state, input, 0),
       THCudaTensor_size(state, input, 1),
-      THCudaTensor_size(state, input, 2) * THCudaTensor_size(state, input, 3),
-      blocks_per_sample
+      THCudaTensor_size(state, input, 2) * THCudaTensor_size(state, input, 3)
+  );
+  THCudaCheck(hipGetLastError());
+
+  hipLaunchKernelGGL((cunn_NLLCriterion_reducePartials_kernel), dim3(1), dim3(NLL_REDUCE_THREADS), 0, THCState_getCurrentStream(state), 
+      output_data,
+      total_weight_data,
+      THCudaTensor_data(state, partials),
+      blocks,
+      sizeAverage
   );
   THCudaCheck(hipGetLastError());
 
   if (weights)
     THCudaTensor_free(state, weights);
+  THCudaTensor_free(state, partials);
   THCudaLongTensor_free(state, target);
   THCudaTensor_free(state, input);
 }
@@ -167,6 +152,8 @@ void THNN_CudaSpatialClassNLLCriterion_updateGradInput(
           THCudaTensor *weights,
           THCudaTensor *total_weight)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   THArgCheck(THCudaLongTensor_nDimension(state, target) == 3, 1,
                "only batches of spatial targets supported (3D tensors)");
   THArgCheck(THCudaTensor_nDimension(state, input) == 4, 2,
@@ -193,7 +180,7 @@ void THNN_CudaSpatialClassNLLCriterion_updateGradInput(
 
   long batch_size = THCudaLongTensor_size(state, target, 0);
   long map_nelem = THCudaLongTensor_nElement(state, target) / batch_size;
-  int blocks_per_sample = GET_BLOCKS(map_nelem) / 128;
+  int blocks_per_sample = (map_nelem + CUDA_NUM_THREADS - 1) / CUDA_NUM_THREADS / 128;
   blocks_per_sample = (blocks_per_sample == 0) ? 1 : blocks_per_sample;
   int total_blocks = blocks_per_sample * batch_size;
 
@@ -1,7 +1,90 @@
 #include "THCUNN.h"
+#include "workspace.h"
 #include "common.h"
 #include "im2col.h"
 
+#define LOCAL_TILE 16
+
+// Every output position p has its own weight matrix (weight is
+// oH*oW x nOutputPlane x nInputPlane*kH*kW), so each pass is a batch of oH*oW
+// small GEMMs. They all run in one launch: blockIdx.x picks the position and
+// blockIdx.y/z a LOCAL_TILE x LOCAL_TILE tile of
+//   C_p = alpha * A_p * B_p + beta * C_p (+ bias_p)
+// with A_p (M x L), B_p (L x N) and C_p (M x N) addressed through strides, so
+// that the same kernel reads weight, gradOutput and the unfolded input in
+// whichever order a pass needs them. The columns of all samples are unfolded
+// side by side (im2col_batched), nInputPlane*kH*kW x batchSize*oH*oW.
+__global__ void cunn_SpatialConvolutionLocal_batchedGemm(
+    int M, int N, int L, float alpha,
+    const float *A, long sAp, long sAm, long sAl,
+    const float *B, long sBp, long sBl, long sBn,
+    float beta,
+    float *C, long sCp, long sCm, long sCn,
+    const float *bias, long sBiasP, long sBiasM)
+{
+  __shared__ float As[LOCAL_TILE][LOCAL_TILE + 1];
+  __shared__ float Bs[LOCAL_TILE][LOCAL_TILE + 1];
+
+  long p = hipBlockIdx_x;
+  int tx = hipThreadIdx_x;
+  int ty = hipThreadIdx_y;
+  int m = hipBlockIdx_y * LOCAL_TILE + ty;
+  int n = hipBlockIdx_z * LOCAL_TILE + tx;
+  A += p * sAp;
+  B += p * sBp;
+  C += p * sCp;
+
+  float acc = 0;
+  for (int l0 = 0; l0 < L; l0 += LOCAL_TILE) {
+    As[ty][tx] = (m < M && l0 + tx < L) ? A[m * sAm + (l0 + tx) * sAl] : 0;
+    Bs[ty][tx] = (l0 + ty < L && n < N) ? B[(l0 + ty) * sBl + n * sBn] : 0;
+    __syncthreads();
+#pragma unroll
+    for (int i = 0; i < LOCAL_TILE; i++)
+      acc += As[ty][i] * Bs[i][tx];
+    __syncthreads();
+  }
+
+  if (m < M && n < N) {
+    float *c = C + m * sCm + n * sCn;
+    float val = alpha * acc;
+    if (beta != 0)
+      val += beta * *c;
+    if (bias)
+      val += bias[p * sBiasP + m * sBiasM];
+    *c = val;
+  }
+}
+
+// gradBias[o][p] += scale * sum_b gradOutput[b][o][p]
+__global__ void cunn_SpatialConvolutionLocal_accGradBias(
+    int n, const float *gradOutput, float *gradBias, int batchSize, float scale)
+{
+  CUDA_KERNEL_LOOP(index, n) {
+    float sum = 0;
+    for (int b = 0; b < batchSize; b++)
+      sum += gradOutput[(long)b * n + index];
+    gradBias[index] += scale * sum;
+  }
+}
+
+static void spatialConvolutionLocal_batchedGemm(
+    THCState *state, long P, int M, int N, int L, float alpha,
+    const float *A, long sAp, long sAm, long sAl,
+    const float *B, long sBp, long sBl, long sBn,
+    float beta,
+    float *C, long sCp, long sCm, long sCn,
+    const float *bias = NULL, long sBiasP = 0, long sBiasM = 0)
+{
+  dim3 threads(LOCAL_TILE, LOCAL_TILE);
+  dim3 blocks(P, (M + LOCAL_TILE - 1) / LOCAL_TILE, (N + LOCAL_TILE - 1) / LOCAL_TILE);
+  THCUNN_PROFILE_LAUNCH(blocks, threads);
+  hipLaunchKernelGGL((cunn_SpatialConvolutionLocal_batchedGemm), dim3(blocks), dim3(threads), 0, THCState_getCurrentStream(state),
+      M, N, L, alpha, A, sAp, sAm, sAl, B, sBp, sBl, sBn,
+      beta, C, sCp, sCm, sCn, bias, sBiasP, sBiasM);
+  THCudaCheck(hipGetLastError());
+}
+
 void THNN_CudaSpatialConvolutionLocal_updateOutput(
     THCState *state,
     THCudaTensor *input,
@@ -16,6 +99,8 @@ void THNN_CudaSpatialConvolutionLocal_updateOutput(
     long inputWidth, long inputHeight,
     long outputWidth, long outputHeight)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   THCUNN_assertSameGPU(state, 5, input, output, weight,
                                  bias, finput);
 
@@ -31,77 +116,40 @@ void THNN_CudaSpatialConvolutionLocal_updateOutput(
 
   // Batch size + input planes
   long batchSize = input->size[0];
+  long plane = outputHeight*outputWidth;
+  long k = nInputPlane*kW*kH;
 
   // Resize output
   THCudaTensor_resize4d(state, output, batchSize, nOutputPlane, outputHeight, outputWidth);
 
-  // Augment the input
-  THCudaTensor_resize3d(state, finput, batchSize, nInputPlane*kW*kH, outputHeight*outputWidth);
-
-  // Helpers
-  THCudaTensor *input_n = THCudaTensor_new(state);
-  THCudaTensor *finput_n = THCudaTensor_new(state);
-  THCudaTensor *output_n = THCudaTensor_new(state);
-
-  // For each elt in batch, do:
-  for (int elt = 0; elt < batchSize; elt ++) {
-    THCudaTensor *finput3d, *output3d;
-    THCudaTensor *wslice = THCudaTensor_new(state);
-    THCudaTensor *islice = THCudaTensor_new(state);
-    THCudaTensor *oslice = THCudaTensor_new(state);
-
-    // Matrix mulitply per output:
-    THCudaTensor_select(state, input_n, input, 0, elt);
-    THCudaTensor_select(state, finput_n, finput, 0, elt);
-    THCudaTensor_select(state, output_n, output, 0, elt);
-
-    // Extract columns:
-    im2col(
-      THCState_getCurrentStream(state),
-      THCudaTensor_data(state, input_n),
-      nInputPlane, inputHeight, inputWidth, kH, kW, padH, padW, dH, dW,
-      1, 1, THCudaTensor_data(state, finput_n)
-    );
-
-    output3d = THCudaTensor_newWithStorage3d(state, output_n->storage, output_n->storageOffset,
-                                             outputHeight*outputWidth, 1,
-                                             nOutputPlane, outputHeight*outputWidth,
-                                             1, nOutputPlane*outputHeight*outputWidth);
-
-    finput3d = THCudaTensor_newWithStorage3d(state, finput_n->storage, finput_n->storageOffset,
-                                             outputHeight*outputWidth, 1,
-                                             kW*kH*nInputPlane, outputHeight*outputWidth,
-                                             1, kW*kH*nInputPlane*outputHeight*outputWidth);
-
-    THCudaTensor_copy(state, output_n, bias);
-
-    for (int i = 0; i < outputHeight; i++) {
-      for(int j = 0; j < outputWidth; j++) {
-        int sliceidx = i * outputWidth + j;
-        THCudaTensor_select(state, wslice, weight, 0, sliceidx);
-        THCudaTensor_select(state, islice, finput3d, 0, sliceidx);
-        THCudaTensor_select(state, oslice, output3d, 0, sliceidx);
-        THCudaTensor_addmm(state, oslice, 1.0, oslice, 1.0, wslice, islice);
-      }
-    }
-
-
-    // weight:    oH*oW x nOutputPlane x nInputPlane*kH*kW
-    // finput3d:  oH*oW x nInputPlane*kH*kW x 1
-    // THCudaTensor_baddbmm(state, output3d, 1.0, output3d, 1.0, weight, finput3d);
-    // output3d:  oH*oW x nOutputPlane x 1
-
-    THCudaTensor_free(state, output3d);
-    THCudaTensor_free(state, finput3d);
-    THCudaTensor_free(state, wslice);
-    THCudaTensor_free(state, islice);
-    THCudaTensor_free(state, oslice);
-  }
-
-  // Free
-  THCudaTensor_free(state, input_n);
-  THCudaTensor_free(state, finput_n);
-  THCudaTensor_free(state, output_n);
+  THCudaTensor *input_c = THCudaTensor_newContiguous(state, input);
+  THCudaTensor *weight_c = THCudaTensor_newContiguous(state, weight);
+  THCudaTensor *bias_c = THCudaTensor_newContiguous(state, bias);
+
+  THCUNNWorkspace workspace(state);
+
+  // Unfold the whole batch
+  workspace.borrow2d(finput, k, batchSize*plane);
+  im2col_batched(
+    THCState_getCurrentStream(state),
+    THCudaTensor_data(state, input_c),
+    batchSize, nInputPlane, inputHeight, inputWidth, kH, kW, padH, padW, dH, dW,
+    1, 1, THCudaTensor_data(state, finput)
+  );
+
+  // output[b][o][p] = bias[o][p] + sum_k weight[p][o][k] * finput[k][b*P + p]
+  spatialConvolutionLocal_batchedGemm(
+    state, plane, nOutputPlane, batchSize, k, 1,
+    THCudaTensor_data(state, weight_c), nOutputPlane*k, k, 1,
+    THCudaTensor_data(state, finput), 1, batchSize*plane, plane,
+    0,
+    THCudaTensor_data(state, output), 1, plane, nOutputPlane*plane,
+    THCudaTensor_data(state, bias_c), 1, plane
+  );
+
+  THCudaTensor_free(state, input_c);
+  THCudaTensor_free(state, weight_c);
+  THCudaTensor_free(state, bias_c);
 
   // Resize output
   if (batch == 0) {
@@ -124,6 +172,8 @@ void THNN_CudaSpatialConvolutionLocal_updateGradInput(
     long inputWidth, long inputHeight,
     long outputWidth, long outputHeight)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   THCUNN_assertSameGPU(state, 5, input, gradOutput, weight,
                                  fgradInput, gradInput);
 
@@ -140,75 +190,37 @@ void THNN_CudaSpatialConvolutionLocal_updateGradInput(
 
   // Batch size + input planes
   long batchSize = input->size[0];
+  long plane = outputHeight*outputWidth;
+  long k = nInputPlane*kW*kH;
 
   // Resize output
   THCudaTensor_resize4d(state, gradInput, batchSize, nInputPlane, inputHeight, inputWidth);
 
-  // Resize temporary columns
-  THCudaTensor_resize3d(state, fgradInput, batchSize, nInputPlane*kW*kH, outputHeight*outputWidth);
-
-  // Helpers
-  THCudaTensor *gradInput_n = THCudaTensor_new(state);
-  THCudaTensor *fgradInput_n = THCudaTensor_new(state);
-  THCudaTensor *gradOutput_n = THCudaTensor_new(state);
-
-  THCudaTensor_transpose(state, weight, weight, 1, 2);
-
-  // For each elt in batch, do:
-  for (int elt = 0; elt < batchSize; elt ++) {
-    THCudaTensor *gradOutput3d, *fgradInput3d;
-    THCudaTensor *wslice = THCudaTensor_new(state);
-    THCudaTensor *gislice = THCudaTensor_new(state);
-    THCudaTensor *goslice = THCudaTensor_new(state);
-
-    // Matrix mulitply per sample:
-    THCudaTensor_select(state, gradInput_n, gradInput, 0, elt);
-    THCudaTensor_select(state, fgradInput_n, fgradInput, 0, elt);
-    THCudaTensor_select(state, gradOutput_n, gradOutput, 0, elt);
-
-    gradOutput3d = THCudaTensor_newWithStorage3d(state, gradOutput_n->storage, gradOutput_n->storageOffset,
-                                               outputHeight*outputWidth, 1,
-                                               nOutputPlane, outputHeight*outputWidth,
-                                               1, nOutputPlane*outputHeight*outputWidth);
-    fgradInput3d = THCudaTensor_newWithStorage3d(state, fgradInput_n->storage, fgradInput_n->storageOffset,
-                                               outputHeight*outputWidth, 1,
-                                               kW*kH*nInputPlane, outputHeight*outputWidth,
-                                               1, kW*kH*nInputPlane*outputHeight*outputWidth);
-
-    for (int i = 0; i < outputHeight; i++) {
-      for(int j = 0; j < outputWidth; j++) {
-        int sliceidx = i * outputWidth + j;
-        THCudaTensor_select(state, wslice, weight, 0, sliceidx);
-        THCudaTensor_select(state, gislice, fgradInput3d, 0, sliceidx);
-        THCudaTensor_select(state, goslice, gradOutput3d, 0, sliceidx);
-        THCudaTensor_addmm(state, gislice, 0.0, gislice, 1.0, wslice, goslice);
-      }
-    }
-
-    // weight:        oH*oW x nInputPlane*kH*kW x nOutputPlane
-    // gradOutput3d:  oH*oW x nOutputPlane x 1
-    //THCudaTensor_baddbmm(state, fgradInput3d, 0.0, fgradInput3d, 1.0, weight, gradOutput3d);
-    // fgradInput3d:  oH*oW x nInputPlane*kH*kW x 1
-
-    // Unpack columns back into input:
-    col2im(
-      THCState_getCurrentStream(state),
-      THCudaTensor_data(state, fgradInput_n),
-      nInputPlane, inputHeight, inputWidth, kH, kW, padH, padW, dH, dW,
-      1, 1, THCudaTensor_data(state, gradInput_n)
-    );
-
-    THCudaTensor_free(state, gradOutput3d);
-    THCudaTensor_free(state, fgradInput3d);
-    THCudaTensor_free(state, wslice);
-    THCudaTensor_free(state, gislice);
-    THCudaTensor_free(state, goslice);
-  }
+  THCudaTensor *gradOutput_c = THCudaTensor_newContiguous(state, gradOutput);
+  THCudaTensor *weight_c = THCudaTensor_newContiguous(state, weight);
+
+  THCUNNWorkspace workspace(state);
+
+  // fgradInput[k][b*P + p] = sum_o weight[p][o][k] * gradOutput[b][o][p]
+  workspace.borrow2d(fgradInput, k, batchSize*plane);
+  spatialConvolutionLocal_batchedGemm(
+    state, plane, k, batchSize, nOutputPlane, 1,
+    THCudaTensor_data(state, weight_c), nOutputPlane*k, 1, k,
+    THCudaTensor_data(state, gradOutput_c), 1, plane, nOutputPlane*plane,
+    0,
+    THCudaTensor_data(state, fgradInput), 1, batchSize*plane, plane
+  );
 
-  // Free
-  THCudaTensor_free(state, gradInput_n);
-  THCudaTensor_free(state, fgradInput_n);
-  THCudaTensor_free(state, gradOutput_n);
+  // Unpack columns back into input:
+  col2im_batched(
+    THCState_getCurrentStream(state),
+    THCudaTensor_data(state, fgradInput),
+    batchSize, nInputPlane, inputHeight, inputWidth, kH, kW, padH, padW, dH, dW,
+    1, 1, THCudaTensor_data(state, gradInput)
+  );
+
+  THCudaTensor_free(state, gradOutput_c);
+  THCudaTensor_free(state, weight_c);
 
   // Resize output
   if (batch == 0) {
@@ -216,8 +228,6 @@ void THNN_CudaSpatialConvolutionLocal_updateGradInput(
     THCudaTensor_resize3d(state, input, nInputPlane, inputHeight, inputWidth);
     THCudaTensor_resize3d(state, gradInput, nInputPlane, inputHeight, inputWidth);
   }
-
-  THCudaTensor_transpose(state, weight, weight, 1, 2);
 }
 
 void THNN_CudaSpatialConvolutionLocal_accGradParameters(
@@ -235,6 +245,8 @@ void THNN_CudaSpatialConvolutionLocal_accGradParameters(
     long outputWidth, long outputHeight,
     float scale)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   THCUNN_assertSameGPU(state, 5, input, gradOutput, gradWeight,
                                  gradBias, finput);
 
@@ -251,68 +263,44 @@ void THNN_CudaSpatialConvolutionLocal_accGradParameters(
 
   // Batch size + input planes
   long batchSize = input->size[0];
-
-  // Helpers
-  THCudaTensor *input_n = THCudaTensor_new(state);
-  THCudaTensor *finput_n = THCudaTensor_new(state);
-  THCudaTensor *gradOutput_n = THCudaTensor_new(state);
-
-  // For each elt in batch, do:
-  for (int elt = 0; elt < batchSize; elt ++) {
-    THCudaTensor *gradOutput3d, *finput3d;
-    THCudaTensor *gwslice = THCudaTensor_new(state);
-    THCudaTensor *islice = THCudaTensor_new(state);
-    THCudaTensor *goslice = THCudaTensor_new(state);
-
-    // Matrix mulitply per output:
-    THCudaTensor_select(state, input_n, input, 0, elt);
-    THCudaTensor_select(state, finput_n, finput, 0, elt);
-    THCudaTensor_select(state, gradOutput_n, gradOutput, 0, elt);
-
-    gradOutput3d = THCudaTensor_newWithStorage3d(state, gradOutput_n->storage, gradOutput_n->storageOffset,
-                                                 outputHeight*outputWidth, 1,
-                                                 nOutputPlane, outputHeight*outputWidth,
-                                                 1, nOutputPlane*outputHeight*outputWidth);
-    finput3d = THCudaTensor_newWithStorage3d(state, finput_n->storage, finput_n->storageOffset,
-                                             outputHeight*outputWidth, 1,
-                                             1, kW*kH*nInputPlane*outputHeight*outputWidth,
-                                             kW*kH*nInputPlane, outputHeight*outputWidth);
-
-    // Extract columns:
-    im2col(
-      THCState_getCurrentStream(state),
-      THCudaTensor_data(state, input_n),
-      nInputPlane, inputHeight, inputWidth, kH, kW, padH, padW, dH, dW,
-      1, 1, THCudaTensor_data(state, finput_n)
-    );
-
-    for (int i = 0; i < outputHeight; i++) {
-      for(int j = 0; j < outputWidth; j++) {
-        int sliceidx = i * outputWidth + j;
-        THCudaTensor_select(state, gwslice, gradWeight, 0, sliceidx);
-        THCudaTensor_select(state, goslice, gradOutput3d, 0, sliceidx);
-        THCudaTensor_select(state, islice, finput3d, 0, sliceidx);
-        THCudaTensor_addmm(state, gwslice, 1.0, gwslice, scale, goslice, islice);
-      }
-    }
-    // gradOutput3d:  oH*oW x nOutputPlane x 1
-    // finput3d:      oH*oW x 1 x kW*kH*nInputPlane
-    //THCudaTensor_baddbmm(state, gradWeight, 1.0, gradWeight, scale, gradOutput3d, finput3d);
-    // gradWeight:    oH*oW x nOutputPlane x kW*kH*nInputPlane
-
-    THCudaTensor_cadd(state, gradBias, gradBias, scale, gradOutput_n);
-
-    THCudaTensor_free(state, gradOutput3d);
-    THCudaTensor_free(state, finput3d);
-    THCudaTensor_free(state, gwslice);
-    THCudaTensor_free(state, goslice);
-    THCudaTensor_free(state, islice);
-  }
-
-  // Free
-  THCudaTensor_free(state, input_n);
-  THCudaTensor_free(state, finput_n);
-  THCudaTensor_free(state, gradOutput_n);
+  long plane = outputHeight*outputWidth;
+  long k = nInputPlane*kW*kH;
+
+  THCudaTensor *input_c = THCudaTensor_newContiguous(state, input);
+  THCudaTensor *gradOutput_c = THCudaTensor_newContiguous(state, gradOutput);
+  THCudaTensor *gradWeight_c = THCudaTensor_newContiguous(state, gradWeight);
+  THCudaTensor *gradBias_c = THCudaTensor_newContiguous(state, gradBias);
+
+  THCUNNWorkspace workspace(state);
+
+  // Columns are rebuilt here, so they need not survive updateOutput
+  workspace.borrow2d(finput, k, batchSize*plane);
+  im2col_batched(
+    THCState_getCurrentStream(state),
+    THCudaTensor_data(state, input_c),
+    batchSize, nInputPlane, inputHeight, inputWidth, kH, kW, padH, padW, dH, dW,
+    1, 1, THCudaTensor_data(state, finput)
+  );
+
+  // gradWeight[p][o][k] += scale * sum_b gradOutput[b][o][p] * finput[k][b*P + p]
+  spatialConvolutionLocal_batchedGemm(
+    state, plane, nOutputPlane, k, batchSize, scale,
+    THCudaTensor_data(state, gradOutput_c), 1, plane, nOutputPlane*plane,
+    THCudaTensor_data(state, finput), 1, plane, batchSize*plane,
+    1,
+    THCudaTensor_data(state, gradWeight_c), nOutputPlane*k, k, 1
+  );
+
+  int n = nOutputPlane*plane;
+  hipLaunchKernelGGL((cunn_SpatialConvolutionLocal_accGradBias), dim3(GET_BLOCKS(n)), dim3(CUDA_NUM_THREADS), 0, THCState_getCurrentStream(state),
+      n, THCudaTensor_data(state, gradOutput_c), THCudaTensor_data(state, gradBias_c),
+      batchSize, scale);
+  THCudaCheck(hipGetLastError());
+
+  THCudaTensor_free(state, input_c);
+  THCudaTensor_free(state, gradOutput_c);
+  THCudaTensor_freeCopyTo(state, gradWeight_c, gradWeight);
+  THCudaTensor_freeCopyTo(state, gradBias_c, gradBias);
 
   // Resize
   if (batch == 0) {
@@ -320,3 +308,5 @@ void THNN_CudaSpatialConvolutionLocal_accGradParameters(
     THCudaTensor_resize3d(state, input, nInputPlane, inputHeight, inputWidth);
   }
 }
+
+#undef LOCAL_TILE
@@ -1,10 +1,74 @@
 #include "THCUNN.h"
+#include "workspace.h"
 #include "common.h"
 #include "im2col.h"
+#include "implicit_gemm.h"
+#include "winograd.h"
+#include "conv_activation.h"
+
+// Upper bound, in bytes, on the columns buffer when several samples are unfolded
+// into it at once. 0 keeps the one-sample-at-a-time loop.
+static long spatialConvolutionMM_columnsLimit = 0;
+
+void THNN_CudaSpatialConvolutionMM_setColumnsLimit(THCState *state, long limit) {
+  THCUNN_PROFILE_FUNC(state);
+  THArgCheck(limit >= 0, 2, "columns limit should be non-negative");
+  spatialConvolutionMM_columnsLimit = limit;
+}
 
+// Number of samples unfolded per GEMM. Each sample needs `rows` rows of `plane`
+// floats: the unfolded input plus a staging area for the output (or gradOutput)
+// laid out as nOutputPlane x (chunk*plane).
+static long spatialConvolutionMM_chunkSize(long batchSize, long rows, long plane) {
+  long perSample = rows * plane * sizeof(float);
+  long chunk = spatialConvolutionMM_columnsLimit / perSample;
+  if (chunk > batchSize)
+    chunk = batchSize;
+  return chunk < 1 ? 1 : chunk;
+}
 
-void THNN_CudaSpatialConvolutionMM_updateOutput(THCState *state, THCudaTensor *input, THCudaTensor *output, THCudaTensor *weight, THCudaTensor *bias, THCudaTensor *columns, THCudaTensor *ones, int kW, int kH, int dW, int dH, int padW, int padH) {
+// staging is nOutputPlane x (chunk*plane); output is chunk x nOutputPlane x plane.
+// The bias and activation are applied on the way out, replacing the ones x
+// bias GEMM.
+__global__ void cunn_SpatialConvolutionMM_scatterOutput(
+    const int n, const float *staging, const float *bias, float *output,
+    const int chunk, const int nOutputPlane, const int plane, const ConvActivation act) {
+  CUDA_KERNEL_LOOP(index, n) {
+    int p = index % plane;
+    int m = (index / plane) % nOutputPlane;
+    int elt = index / (plane * nOutputPlane);
+    float val = staging[(m * chunk + elt) * plane + p];
+    output[index] = act(bias ? val + bias[m] : val);
+  }
+}
+
+// Bias and activation in one pass over output (batch x nOutputPlane x plane),
+// for the per-sample path when an activation is fused.
+__global__ void cunn_SpatialConvolutionMM_biasActivation(
+    const int n, const float *bias, float *output,
+    const int nOutputPlane, const int plane, const ConvActivation act) {
+  CUDA_KERNEL_LOOP(index, n) {
+    int m = (index / plane) % nOutputPlane;
+    float val = output[index];
+    output[index] = act(bias ? val + bias[m] : val);
+  }
+}
+
+// Inverse of the above: gathers chunk x nOutputPlane x plane gradOutput into
+// nOutputPlane x (chunk*plane) so a single GEMM covers the whole chunk.
+__global__ void cunn_SpatialConvolutionMM_gatherGradOutput(
+    const int n, const float *gradOutput, float *staging,
+    const int chunk, const int nOutputPlane, const int plane) {
+  CUDA_KERNEL_LOOP(index, n) {
+    int p = index % plane;
+    int m = (index / plane) % nOutputPlane;
+    int elt = index / (plane * nOutputPlane);
+    staging[(m * chunk + elt) * plane + p] = gradOutput[index];
+  }
+}
 
+
+static void SpatialConvolutionMM_updateOutput(THCState *state, THCudaTensor *input, THCudaTensor *output, THCudaTensor *weight, THCudaTensor *bias, THCudaTensor *columns, THCudaTensor *ones, int kW, int kH, int dW, int dH, int padW, int padH, const ConvActivation &act) {
   THCUNN_assertSameGPU(state, 5, input, output, weight, columns, ones);
   if (bias) {
     THCUNN_assertSameGPU(state, 2, weight, bias);
@@ -53,81 +117,154 @@ void THNN_CudaSpatialConvolutionMM_updateOutput(THCState *state, THCudaTensor *i
   // Resize output
   THCudaTensor_resize4d(state, output, batchSize, nOutputPlane, outputHeight, outputWidth);
 
-  // Resize temporary columns
-  THCudaTensor_resize2d(state, columns, nInputPlane*kW*kH, outputHeight*outputWidth);
+  long chunk = spatialConvolutionMM_chunkSize(batchSize, nInputPlane*kW*kH + nOutputPlane,
+                                              outputHeight*outputWidth);
+
+  THCUNNWorkspace workspace(state);
+  ImplicitGemmChoice gemmChoice(state, "SpatialConvolutionMM_updateOutput");
+
+  ConvGeometry geometry = convGeometry2d(batchSize, nInputPlane, nOutputPlane,
+                                         inputHeight, inputWidth, outputHeight, outputWidth,
+                                         kH, kW, padH, padW, dH, dW, 1, 1);
+
+  int winogradTile = kW == 3 && kH == 3 && dW == 1 && dH == 1 && THCudaTensor_isContiguous(state, input) ?
+      winograd_tileSize() : 0;
+  int path = winogradTile > 0 || !THCudaTensor_isContiguous(state, input) ?
+      IMPLICIT_GEMM_COLUMNS : gemmChoice.path(geometry, winogradTile < 0);
+  if (winogradTile < 0)
+    winogradTile = path == IMPLICIT_GEMM_WINOGRAD ? 2 : 0;
+
+  if (winogradTile) {
+    winograd_updateOutput(state, workspace, input, output, weight, bias, columns, padW, padH, winogradTile, act);
+  } else if (path == IMPLICIT_GEMM_IMPLICIT) {
+    implicitGemm(state, ImplicitGemmForward(
+        geometry, THCudaTensor_data(state, input), THCudaTensor_data(state, weight),
+        bias ? THCudaTensor_data(state, bias) : NULL, THCudaTensor_data(state, output), act));
+  } else if (chunk > 1) {
+    long plane = outputHeight * outputWidth;
+    long k = nInputPlane*kH*kW;
 
-  // Define a buffer of ones, for bias accumulation
-  // Note: this buffer can be shared with other modules, it only ever gets increased,
-  // and always contains ones.
-  if (ones->nDimension != 2 || ones->size[0]*ones->size[1] < outputHeight*outputWidth) {
-    // Resize plane and fill with ones...
-    THCudaTensor_resize2d(state, ones, outputHeight, outputWidth);
-    THCudaTensor_fill(state, ones, 1);
-  }
+    // Columns for the whole chunk, followed by the GEMM result before it is
+    // permuted back into batch-major order
+    workspace.borrow2d(columns, k + nOutputPlane, chunk*plane);
+    float *columns_data = THCudaTensor_data(state, columns);
+
+    for (long elt = 0; elt < batchSize; elt += chunk) {
+      long nElt = chunk < batchSize - elt ? chunk : batchSize - elt;
+      long n = nElt * plane;
+      float *staging = columns_data + k*n;
+
+      // Extract columns for nElt samples side by side:
+      im2col_batched(
+        THCState_getCurrentStream(state),
+        THCudaTensor_data(state, input) + elt*input->stride[0],
+        nElt, nInputPlane, inputHeight, inputWidth, kH, kW, padH, padW, dH, dW,
+        1, 1, columns_data
+      );
 
-  // Helpers
-  THCudaTensor *input_n = THCudaTensor_new(state);
-  THCudaTensor *output_n = THCudaTensor_new(state);
-
-  // For each elt in batch, do:
-  for (int elt = 0; elt < batchSize; elt ++) {
-    // Matrix mulitply per output:
-    THCudaTensor_select(state, input_n, input, 0, elt);
-    THCudaTensor_select(state, output_n, output, 0, elt);
-
-    // Do Bias first:
-    // M,N,K are dims of matrix A and B
-    // (see http://docs.nvidia.com/cuda/cublas/#cublas-lt-t-gt-gemm)
-    long m_ = nOutputPlane;
-    long n_ = outputHeight * outputWidth;
-    long k_ = 1;
-
-    // Do GEMM (note: this is a bit confusing because gemm assumes column-major matrices)
-    if (bias) {
+      // Do GEMM (note: this is a bit confusing because gemm assumes column-major matrices)
       THCudaBlas_Sgemm(
           state,
-          't', 'n',
-          n_, m_, k_,
+          'n', 'n',
+          n, nOutputPlane, k,
           1,
-          THCudaTensor_data(state, ones), k_,
-          THCudaTensor_data(state, bias), k_,
+          columns_data, n,
+          THCudaTensor_data(state, weight), k,
           0,
-          THCudaTensor_data(state, output_n), n_
+          staging, n
       );
-    } else {
-      THCudaTensor_zero(state, output_n);
+
+      int num_kernels = nElt * nOutputPlane * plane;
+      hipLaunchKernelGGL((cunn_SpatialConvolutionMM_scatterOutput), dim3(GET_BLOCKS(num_kernels)), dim3(CUDA_NUM_THREADS), 0, THCState_getCurrentStream(state), 
+          num_kernels, staging, bias ? THCudaTensor_data(state, bias) : NULL,
+          THCudaTensor_data(state, output) + elt*output->stride[0],
+          nElt, nOutputPlane, plane, act);
+      THCudaCheck(hipGetLastError());
     }
+  } else {
+    // With an activation the bias goes into the pass that applies it
+    bool fused = act.kind != CONV_ACTIVATION_NONE;
+
+    // Resize temporary columns
+    workspace.borrow2d(columns, nInputPlane*kW*kH, outputHeight*outputWidth);
+
+    // Define a buffer of ones, for bias accumulation
+    if (!fused)
+      workspace.ones2d(ones, outputHeight, outputWidth);
+
+    // Helpers
+    THCudaTensor *input_n = THCudaTensor_new(state);
+    THCudaTensor *output_n = THCudaTensor_new(state);
+
+    // For each elt in batch, do:
+    for (int elt = 0; elt < batchSize; elt ++) {
+      // Matrix mulitply per output:
+      THCudaTensor_select(state, input_n, input, 0, elt);
+      THCudaTensor_select(state, output_n, output, 0, elt);
+
+      // Do Bias first:
+      // M,N,K are dims of matrix A and B
+      // (see http://docs.nvidia.com/cuda/cublas/#cublas-lt-t-gt-gemm)
+      long m_ = nOutputPlane;
+      long n_ = outputHeight * outputWidth;
+      long k_ = 1;
+
+      // Do GEMM (note: this is a bit confusing because gemm assumes column-major matrices)
+      // When fused, the GEMM below overwrites output_n instead
+      if (bias && !fused) {
+        THCudaBlas_Sgemm(
+            state,
+            't', 'n',
+            n_, m_, k_,
+            1,
+            THCudaTensor_data(state, ones), k_,
+            THCudaTensor_data(state, bias), k_,
+            0,
+            THCudaTensor_data(state, output_n), n_
+        );
+      } else if (!fused) {
+        THCudaTensor_zero(state, output_n);
+      }
+
+      // Extract columns:
+      im2col(
+        THCState_getCurrentStream(state),
+        THCudaTensor_data(state, input_n),
+        nInputPlane, inputHeight, inputWidth, kH, kW, padH, padW, dH, dW,
+        1, 1, THCudaTensor_data(state, columns)
+      );
 
-    // Extract columns:
-    im2col(
-      THCState_getCurrentStream(state),
-      THCudaTensor_data(state, input_n),
-      nInputPlane, inputHeight, inputWidth, kH, kW, padH, padW, dH, dW,
-      1, 1, THCudaTensor_data(state, columns)
-    );
-
-    // M,N,K are dims of matrix A and B
-    // (see http://docs.nvidia.com/cuda/cublas/#cublas-lt-t-gt-gemm)
-    long m = nOutputPlane;
-    long n = columns->size[1];
-    long k = nInputPlane*kH*kW;
+      // M,N,K are dims of matrix A and B
+      // (see http://docs.nvidia.com/cuda/cublas/#cublas-lt-t-gt-gemm)
+      long m = nOutputPlane;
+      long n = columns->size[1];
+      long k = nInputPlane*kH*kW;
 
-    // Do GEMM (note: this is a bit confusing because gemm assumes column-major matrices)
-    THCudaBlas_Sgemm(
-        state,
-        'n', 'n',
-        n, m, k,
-        1,
-        THCudaTensor_data(state, columns), n,
-        THCudaTensor_data(state, weight), k,
-        1,
-        THCudaTensor_data(state, output_n), n
-    );
-  }
+      // Do GEMM (note: this is a bit confusing because gemm assumes column-major matrices)
+      THCudaBlas_Sgemm(
+          state,
+          'n', 'n',
+          n, m, k,
+          1,
+          THCudaTensor_data(state, columns), n,
+          THCudaTensor_data(state, weight), k,
+          fused ? 0 : 1,
+          THCudaTensor_data(state, output_n), n
+      );
+    }
 
-  // Free
-  THCudaTensor_free(state, input_n);
-  THCudaTensor_free(state, output_n);
+    if (fused) {
+      int num_kernels = batchSize * nOutputPlane * outputHeight * outputWidth;
+      hipLaunchKernelGGL((cunn_SpatialConvolutionMM_biasActivation), dim3(GET_BLOCKS(num_kernels)), dim3(CUDA_NUM_THREADS), 0, THCState_getCurrentStream(state), 
+          num_kernels, bias ? THCudaTensor_data(state, bias) : NULL,
+          THCudaTensor_data(state, output), nOutputPlane, outputHeight * outputWidth, act);
+      THCudaCheck(hipGetLastError());
+    }
+
+    // Free
+    THCudaTensor_free(state, input_n);
+    THCudaTensor_free(state, output_n);
+  }
   if (freeWeight)
     THCudaTensor_free(state, weight);
 
@@ -138,7 +275,26 @@ void THNN_CudaSpatialConvolutionMM_updateOutput(THCState *state, THCudaTensor *i
   }
 }
 
+void THNN_CudaSpatialConvolutionMM_updateOutput(THCState *state, THCudaTensor *input, THCudaTensor *output, THCudaTensor *weight, THCudaTensor *bias, THCudaTensor *columns, THCudaTensor *ones, int kW, int kH, int dW, int dH, int padW, int padH) {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
+  SpatialConvolutionMM_updateOutput(state, input, output, weight, bias, columns, ones,
+                                    kW, kH, dW, dH, padW, padH, convActivation_none());
+}
+
+void THNN_CudaSpatialConvolutionMM_updateOutputActivation(THCState *state, THCudaTensor *input, THCudaTensor *output, THCudaTensor *weight, THCudaTensor *bias, THCudaTensor *columns, THCudaTensor *ones, int kW, int kH, int dW, int dH, int padW, int padH, int activation, float activationA, float activationB) {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
+  THArgCheck(activation >= CONV_ACTIVATION_NONE && activation <= CONV_ACTIVATION_LEAKY_RELU, 14,
+             "unknown activation");
+  ConvActivation act = { activation, activationA, activationB };
+  SpatialConvolutionMM_updateOutput(state, input, output, weight, bias, columns, ones,
+                                    kW, kH, dW, dH, padW, padH, act);
+}
+
 void THNN_CudaSpatialConvolutionMM_updateGradInput(THCState *state, THCudaTensor *input, THCudaTensor *gradOutput, THCudaTensor *gradInput, THCudaTensor *weight, THCudaTensor *gradColumns, THCudaTensor *ones, int kW, int kH, int dW, int dH, int padW, int padH) {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
 
   THCUNN_assertSameGPU(state, 5, input, gradOutput, weight,
                                  gradColumns, gradInput);
@@ -178,49 +334,104 @@ void THNN_CudaSpatialConvolutionMM_updateGradInput(THCState *state, THCudaTensor
   // Resize output
   THCudaTensor_resize4d(state, gradInput, batchSize, nInputPlane, inputHeight, inputWidth);
 
-  // Resize temporary columns
-  THCudaTensor_resize2d(state, gradColumns, nInputPlane*kW*kH, outputHeight*outputWidth);
+  long chunk = spatialConvolutionMM_chunkSize(batchSize, nInputPlane*kW*kH + nOutputPlane,
+                                              outputHeight*outputWidth);
 
-  // Helpers
-  THCudaTensor *gradInput_n = THCudaTensor_new(state);
-  THCudaTensor *gradOutput_n = THCudaTensor_new(state);
+  THCUNNWorkspace workspace(state);
+  ImplicitGemmChoice gemmChoice(state, "SpatialConvolutionMM_updateGradInput");
 
-  // For each elt in batch, do:
-  for (int elt = 0; elt < batchSize; elt ++) {
-    // Matrix mulitply per sample:
-    THCudaTensor_select(state, gradInput_n, gradInput, 0, elt);
-    THCudaTensor_select(state, gradOutput_n, gradOutput, 0, elt);
+  ConvGeometry geometry = convGeometry2d(batchSize, nInputPlane, nOutputPlane,
+                                         inputHeight, inputWidth, outputHeight, outputWidth,
+                                         kH, kW, padH, padW, dH, dW, 1, 1);
 
-    // M,N,K are dims of matrix A and B
-    // (see http://docs.nvidia.com/cuda/cublas/#cublas-lt-t-gt-gemm)
+  if (THCudaTensor_isContiguous(state, gradOutput) && gemmChoice.use(geometry)) {
+    implicitGemm(state, ImplicitGemmGradInput(
+        geometry, THCudaTensor_data(state, gradOutput), THCudaTensor_data(state, weight),
+        THCudaTensor_data(state, gradInput)));
+  } else if (chunk > 1) {
+    long plane = outputHeight * outputWidth;
     long m = nInputPlane*kW*kH;
-    long n = gradColumns->size[1];
-    long k = nOutputPlane;
-
-    // Do GEMM (note: this is a bit confusing because gemm assumes column-major matrices)
-    THCudaBlas_Sgemm(
-        state,
-        'n', 't',
-        n, m, k,
-        1,
-        THCudaTensor_data(state, gradOutput_n), n,
-        THCudaTensor_data(state, weight), m,
-        0,
-        THCudaTensor_data(state, gradColumns), n
-    );
-
-    // Unpack columns back into input:
-    col2im(
-      THCState_getCurrentStream(state),
-      THCudaTensor_data(state, gradColumns),
-      nInputPlane, inputHeight, inputWidth, kH, kW, padH, padW, dH, dW,
-      1, 1, THCudaTensor_data(state, gradInput_n)
-    );
-  }
 
-  // Free
-  THCudaTensor_free(state, gradInput_n);
-  THCudaTensor_free(state, gradOutput_n);
+    // Gradient columns for the whole chunk, followed by the permuted gradOutput
+    workspace.borrow2d(gradColumns, m + nOutputPlane, chunk*plane);
+    float *gradColumns_data = THCudaTensor_data(state, gradColumns);
+
+    for (long elt = 0; elt < batchSize; elt += chunk) {
+      long nElt = chunk < batchSize - elt ? chunk : batchSize - elt;
+      long n = nElt * plane;
+      float *staging = gradColumns_data + m*n;
+
+      int num_kernels = nElt * nOutputPlane * plane;
+      hipLaunchKernelGGL((cunn_SpatialConvolutionMM_gatherGradOutput), dim3(GET_BLOCKS(num_kernels)), dim3(CUDA_NUM_THREADS), 0, THCState_getCurrentStream(state), 
+          num_kernels, THCudaTensor_data(state, gradOutput) + elt*gradOutput->stride[0],
+          staging, nElt, nOutputPlane, plane);
+      THCudaCheck(hipGetLastError());
+
+      // Do GEMM (note: this is a bit confusing because gemm assumes column-major matrices)
+      THCudaBlas_Sgemm(
+          state,
+          'n', 't',
+          n, m, nOutputPlane,
+          1,
+          staging, n,
+          THCudaTensor_data(state, weight), m,
+          0,
+          gradColumns_data, n
+      );
+
+      // Unpack columns back into input:
+      col2im_batched(
+        THCState_getCurrentStream(state),
+        gradColumns_data,
+        nElt, nInputPlane, inputHeight, inputWidth, kH, kW, padH, padW, dH, dW,
+        1, 1, THCudaTensor_data(state, gradInput) + elt*gradInput->stride[0]
+      );
+    }
+  } else {
+    // Resize temporary columns
+    workspace.borrow2d(gradColumns, nInputPlane*kW*kH, outputHeight*outputWidth);
+
+    // Helpers
+    THCudaTensor *gradInput_n = THCudaTensor_new(state);
+    THCudaTensor *gradOutput_n = THCudaTensor_new(state);
+
+    // For each elt in batch, do:
+    for (int elt = 0; elt < batchSize; elt ++) {
+      // Matrix mulitply per sample:
+      THCudaTensor_select(state, gradInput_n, gradInput, 0, elt);
+      THCudaTensor_select(state, gradOutput_n, gradOutput, 0, elt);
+
+      // M,N,K are dims of matrix A and B
+      // (see http://docs.nvidia.com/cuda/cublas/#cublas-lt-t-gt-gemm)
+      long m = nInputPlane*kW*kH;
+      long n = gradColumns->size[1];
+      long k = nOutputPlane;
+
+      // Do GEMM (note: this is a bit confusing because gemm assumes column-major matrices)
+      THCudaBlas_Sgemm(
+          state,
+          'n', 't',
+          n, m, k,
+          1,
+          THCudaTensor_data(state, gradOutput_n), n,
+          THCudaTensor_data(state, weight), m,
+          0,
+          THCudaTensor_data(state, gradColumns), n
+      );
+
+      // Unpack columns back into input:
+      col2im(
+        THCState_getCurrentStream(state),
+        THCudaTensor_data(state, gradColumns),
+        nInputPlane, inputHeight, inputWidth, kH, kW, padH, padW, dH, dW,
+        1, 1, THCudaTensor_data(state, gradInput_n)
+      );
+    }
+
+    // Free
+    THCudaTensor_free(state, gradInput_n);
+    THCudaTensor_free(state, gradOutput_n);
+  }
   if (freeWeight)
     THCudaTensor_free(state, weight);
 
@@ -233,6 +444,8 @@ void THNN_CudaSpatialConvolutionMM_updateGradInput(THCState *state, THCudaTensor
 }
 
 void THNN_CudaSpatialConvolutionMM_accGradParameters(THCState *state, THCudaTensor *input, THCudaTensor *gradOutput, THCudaTensor *gradWeight, THCudaTensor *gradBias, THCudaTensor *columns, THCudaTensor *ones, int kW, int kH, int dW, int dH, int padW, int padH, float scale) {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
 
   THCUNN_assertSameGPU(state, 5, input, gradOutput, gradWeight, columns, ones);
   if (gradBias) {
@@ -272,76 +485,145 @@ void THNN_CudaSpatialConvolutionMM_accGradParameters(THCState *state, THCudaTens
   // Batch size + input planes
   long batchSize = input->size[0];
 
-  // Define a buffer of ones, for bias accumulation
-  if (ones->nDimension != 2 || ones->size[0]*ones->size[1] < outputHeight*outputWidth) {
-    // Resize plane and fill with ones...
-    THCudaTensor_resize2d(state, ones, outputHeight, outputWidth);
-    THCudaTensor_fill(state, ones, 1);
-  }
+  long chunk = spatialConvolutionMM_chunkSize(batchSize, nInputPlane*kW*kH + nOutputPlane,
+                                              outputHeight*outputWidth);
 
-  // Resize temporary columns
-  THCudaTensor_resize2d(state, columns, nInputPlane*kW*kH, outputHeight*outputWidth);
-
-  // Helpers
-  THCudaTensor *input_n = THCudaTensor_new(state);
-  THCudaTensor *gradOutput_n = THCudaTensor_new(state);
-
-  // For each elt in batch, do:
-  for (int elt = 0; elt < batchSize; elt ++) {
-    // Matrix mulitply per output:
-    THCudaTensor_select(state, input_n, input, 0, elt);
-    THCudaTensor_select(state, gradOutput_n, gradOutput, 0, elt);
-
-    // Extract columns:
-    im2col(
-      THCState_getCurrentStream(state),
-      THCudaTensor_data(state, input_n),
-      nInputPlane, inputHeight, inputWidth, kH, kW, padH, padW, dH, dW,
-      1, 1, THCudaTensor_data(state, columns)
-    );
-
-    // M,N,K are dims of matrix A and B
-    // (see http://docs.nvidia.com/cuda/cublas/#cublas-lt-t-gt-gemm)
-    long m = nOutputPlane;
+  THCUNNWorkspace workspace(state);
+  ImplicitGemmChoice gemmChoice(state, "SpatialConvolutionMM_accGradParameters", true);
+
+  ConvGeometry geometry = convGeometry2d(batchSize, nInputPlane, nOutputPlane,
+                                         inputHeight, inputWidth, outputHeight, outputWidth,
+                                         kH, kW, padH, padW, dH, dW, 1, 1);
+
+  if (THCudaTensor_isContiguous(state, input) && THCudaTensor_isContiguous(state, gradOutput) &&
+      gemmChoice.use(geometry)) {
+    implicitGemm(state, ImplicitGemmGradWeight(
+        geometry, THCudaTensor_data(state, input), THCudaTensor_data(state, gradOutput),
+        THCudaTensor_data(state, gradWeight), gradBias ? THCudaTensor_data(state, gradBias) : NULL,
+        scale));
+  } else if (chunk > 1) {
+    long plane = outputHeight * outputWidth;
     long n = nInputPlane*kW*kH;
-    long k = columns->size[1];
-
-    // Do GEMM (note: this is a bit confusing because gemm assumes column-major matrices)
-    THCudaBlas_Sgemm(
-        state,
-        't', 'n',
-        n, m, k,
-        scale,
-        THCudaTensor_data(state, columns), k,
-        THCudaTensor_data(state, gradOutput_n), k,
-        1,
-        THCudaTensor_data(state, gradWeight), n
-    );
-
-    // Do Bias:
-    // M,N,K are dims of matrix A and B
-    // (see http://docs.nvidia.com/cuda/cublas/#cublas-lt-t-gt-gemm)
-    long m_ = nOutputPlane;
-    long k_ = outputHeight * outputWidth;
-
-    // Do GEMV (note: this is a bit confusing because gemv assumes column-major matrices)
-    if (gradBias) {
-      THCudaBlas_Sgemv(
+
+    // Define a buffer of ones, for bias accumulation over a whole chunk
+    workspace.ones2d(ones, chunk, plane);
+
+    // Columns for the whole chunk, followed by the permuted gradOutput
+    workspace.borrow2d(columns, n + nOutputPlane, chunk*plane);
+    float *columns_data = THCudaTensor_data(state, columns);
+
+    for (long elt = 0; elt < batchSize; elt += chunk) {
+      long nElt = chunk < batchSize - elt ? chunk : batchSize - elt;
+      long k = nElt * plane;
+      float *staging = columns_data + n*k;
+
+      im2col_batched(
+        THCState_getCurrentStream(state),
+        THCudaTensor_data(state, input) + elt*input->stride[0],
+        nElt, nInputPlane, inputHeight, inputWidth, kH, kW, padH, padW, dH, dW,
+        1, 1, columns_data
+      );
+
+      int num_kernels = nElt * nOutputPlane * plane;
+      hipLaunchKernelGGL((cunn_SpatialConvolutionMM_gatherGradOutput), dim3(GET_BLOCKS(num_kernels)), dim3(CUDA_NUM_THREADS), 0, THCState_getCurrentStream(state), 
+          num_kernels, THCudaTensor_data(state, gradOutput) + elt*gradOutput->stride[0],
+          staging, nElt, nOutputPlane, plane);
+      THCudaCheck(hipGetLastError());
+
+      // Do GEMM (note: this is a bit confusing because gemm assumes column-major matrices)
+      THCudaBlas_Sgemm(
           state,
-          't',
-          k_, m_,
+          't', 'n',
+          n, nOutputPlane, k,
           scale,
-          THCudaTensor_data(state, gradOutput_n), k_,
-          THCudaTensor_data(state, ones), 1,
+          columns_data, k,
+          staging, k,
           1,
-          THCudaTensor_data(state, gradBias), 1
+          THCudaTensor_data(state, gradWeight), n
       );
+
+      // Do GEMV (note: this is a bit confusing because gemv assumes column-major matrices)
+      if (gradBias) {
+        THCudaBlas_Sgemv(
+            state,
+            't',
+            k, nOutputPlane,
+            scale,
+            staging, k,
+            THCudaTensor_data(state, ones), 1,
+            1,
+            THCudaTensor_data(state, gradBias), 1
+        );
+      }
     }
-  }
+  } else {
+    // Define a buffer of ones, for bias accumulation
+    workspace.ones2d(ones, outputHeight, outputWidth);
+
+    // Resize temporary columns
+    workspace.borrow2d(columns, nInputPlane*kW*kH, outputHeight*outputWidth);
+
+    // Helpers
+    THCudaTensor *input_n = THCudaTensor_new(state);
+    THCudaTensor *gradOutput_n = THCudaTensor_new(state);
+
+    // For each elt in batch, do:
+    for (int elt = 0; elt < batchSize; elt ++) {
+      // Matrix mulitply per output:
+      THCudaTensor_select(state, input_n, input, 0, elt);
+      THCudaTensor_select(state, gradOutput_n, gradOutput, 0, elt);
+
+      // Extract columns:
+      im2col(
+        THCState_getCurrentStream(state),
+        THCudaTensor_data(state, input_n),
+        nInputPlane, inputHeight, inputWidth, kH, kW, padH, padW, dH, dW,
+        1, 1, THCudaTensor_data(state, columns)
+      );
+
+      // M,N,K are dims of matrix A and B
+      // (see http://docs.nvidia.com/cuda/cublas/#cublas-lt-t-gt-gemm)
+      long m = nOutputPlane;
+      long n = nInputPlane*kW*kH;
+      long k = columns->size[1];
 
-  // Free
-  THCudaTensor_free(state, input_n);
-  THCudaTensor_free(state, gradOutput_n);
+      // Do GEMM (note: this is a bit confusing because gemm assumes column-major matrices)
+      THCudaBlas_Sgemm(
+          state,
+          't', 'n',
+          n, m, k,
+          scale,
+          THCudaTensor_data(state, columns), k,
+          THCudaTensor_data(state, gradOutput_n), k,
+          1,
+          THCudaTensor_data(state, gradWeight), n
+      );
+
+      // Do Bias:
+      // M,N,K are dims of matrix A and B
+      // (see http://docs.nvidia.com/cuda/cublas/#cublas-lt-t-gt-gemm)
+      long m_ = nOutputPlane;
+      long k_ = outputHeight * outputWidth;
+
+      // Do GEMV (note: this is a bit confusing because gemv assumes column-major matrices)
+      if (gradBias) {
+        THCudaBlas_Sgemv(
+            state,
+            't',
+            k_, m_,
+            scale,
+            THCudaTensor_data(state, gradOutput_n), k_,
+            THCudaTensor_data(state, ones), 1,
+            1,
+            THCudaTensor_data(state, gradBias), 1
+        );
+      }
+    }
+
+    // Free
+    THCudaTensor_free(state, input_n);
+    THCudaTensor_free(state, gradOutput_n);
+  }
   if (freeWeight)
     THCudaTensor_free(state, gradWeight);
 
@@ -0,0 +1,419 @@
+#include "THCUNN.h"
+#include "workspace.h"
+#include "common.h"
+#include "winograd.h"
+
+#include <math.h>
+#include <map>
+#include <mutex>
+#include <vector>
+
+// Upper bound, in bytes, on the transformed input and GEMM output of one
+// batch chunk
+#define WINOGRAD_BUFFER_LIMIT (256L * 1024 * 1024)
+
+// -1: never, 0: F(2x2) where it times faster, 2 or 4: always, with that tile
+// size. F(4x4) rounds with transform constants up to 8, so it is opt-in.
+static int winograd_mode = 0;
+
+void THNN_CudaSpatialConvolutionMM_setWinograd(THCState *state, int mode) {
+  THCUNN_PROFILE_FUNC(state);
+  THArgCheck(mode == -1 || mode == 0 || mode == 2 || mode == 4, 2, "mode should be -1, 0, 2 or 4");
+  winograd_mode = mode;
+}
+
+int winograd_tileSize() {
+  return winograd_mode < 0 ? 0 : winograd_mode == 0 ? -1 : winograd_mode;
+}
+
+// Pre-transformed filters of the weights registered for inference with
+// THNN_CudaSpatialConvolutionMM_cacheWinogradFilter, keyed by weight data.
+// Weights may change in place while cached (an optimizer step on flattened
+// parameters, batch normalization folding, a copy from a loaded model), so
+// every lookup revalidates on the device: each filter keeps the 3x3 weights
+// it was transformed from and is transformed again when they differ. No host
+// round-trip is needed and an unchanged filter costs a read of its weights.
+//
+// An entry holds a reference on the weight storage, so its address cannot be
+// reused by another tensor while the entry exists. Entries whose storage is
+// no longer referenced anywhere else, or has been reallocated, are freed on
+// the next lookup.
+struct WinogradFilterCache
+{
+  THCudaStorage *weight;
+  long offset;
+  int nInputPlane, nOutputPlane;
+  THCudaTensor *filters[2];    // F(2x2), F(4x4); built on first use
+  THCudaTensor *snapshot[2];   // weights each was transformed from
+};
+
+static std::mutex winograd_cacheMutex;
+static std::map<const float*, WinogradFilterCache> winograd_cache;
+
+template <int M>
+__device__ void winograd_storeFilter(const float *w, float *u, int index, int n) {
+  const int alpha = Winograd<M>::alpha;
+  float g[3][3], t[alpha][alpha];
+  for (int i = 0; i < 3; i++)
+    for (int j = 0; j < 3; j++)
+      g[i][j] = w[i * 3 + j];
+  winograd_filterTransform<M>(g, t);
+  for (int i = 0; i < alpha; i++)
+    for (int j = 0; j < alpha; j++)
+      u[(i * alpha + j) * n + index] = t[i][j];
+}
+
+// weight is nOutputPlane x nInputPlane x 3 x 3; u is alpha^2 x nOutputPlane x nInputPlane
+template <int M>
+__global__ void cunn_SpatialConvolutionWinograd_filter(
+    const int n, const float *weight, float *u, const int nInputPlane, const int nOutputPlane) {
+  CUDA_KERNEL_LOOP(index, n) {
+    winograd_storeFilter<M>(weight + index * 9, u, index, n);
+  }
+}
+
+// Transforms again the cached filters whose weights differ from snapshot,
+// and updates it. The snapshot starts out as NaN, which compares unequal to
+// everything, so the first call transforms every filter.
+template <int M>
+__global__ void cunn_SpatialConvolutionWinograd_refreshFilter(
+    const int n, const float *weight, float *snapshot, float *u) {
+  CUDA_KERNEL_LOOP(index, n) {
+    const float *w = weight + index * 9;
+    float *s = snapshot + index * 9;
+    bool same = true;
+    for (int k = 0; k < 9; k++)
+      same = same && w[k] == s[k];
+    if (!same) {
+      for (int k = 0; k < 9; k++)
+        s[k] = w[k];
+      winograd_storeFilter<M>(w, u, index, n);
+    }
+  }
+}
+
+// One thread per (input plane, tile); v is alpha^2 x nInputPlane x tiles with
+// tiles running over the chunk's samples, then tile rows, then tile columns.
+template <int M>
+__global__ void cunn_SpatialConvolutionWinograd_input(
+    const int n, const float *input, float *v,
+    const int nInputPlane, const int inputHeight, const int inputWidth,
+    const int tilesH, const int tilesW, const int padH, const int padW) {
+  const int alpha = Winograd<M>::alpha;
+  const int tiles = n / nInputPlane;
+  CUDA_KERNEL_LOOP(index, n) {
+    int t = index % tiles;
+    int c = index / tiles;
+    int tw = t % tilesW;
+    int th = (t / tilesW) % tilesH;
+    int b = t / (tilesW * tilesH);
+    const float *plane = input + (b * nInputPlane + c) * inputHeight * inputWidth;
+    int y0 = th * M - padH;
+    int x0 = tw * M - padW;
+
+    float d[alpha][alpha], r[alpha][alpha];
+    for (int i = 0; i < alpha; i++) {
+      int y = y0 + i;
+      for (int j = 0; j < alpha; j++) {
+        int x = x0 + j;
+        d[i][j] = (y >= 0 && y < inputHeight && x >= 0 && x < inputWidth) ? plane[y * inputWidth + x] : 0;
+      }
+    }
+    winograd_inputTransform<M>(d, r);
+    for (int i = 0; i < alpha; i++)
+      for (int j = 0; j < alpha; j++)
+        v[(i * alpha + j) * n + index] = r[i][j];
+  }
+}
+
+// One thread per (output plane, tile); m is alpha^2 x nOutputPlane x tiles.
+// The bias and activation are applied on the way out.
+template <int M>
+__global__ void cunn_SpatialConvolutionWinograd_output(
+    const int n, const float *m, const float *bias, float *output,
+    const int nOutputPlane, const int outputHeight, const int outputWidth,
+    const int tilesH, const int tilesW, const ConvActivation act) {
+  const int alpha = Winograd<M>::alpha;
+  const int tiles = n / nOutputPlane;
+  CUDA_KERNEL_LOOP(index, n) {
+    int t = index % tiles;
+    int o = index / tiles;
+    int tw = t % tilesW;
+    int th = (t / tilesW) % tilesH;
+    int b = t / (tilesW * tilesH);
+
+    float s[alpha][alpha], y[M][M];
+    for (int i = 0; i < alpha; i++)
+      for (int j = 0; j < alpha; j++)
+        s[i][j] = m[(i * alpha + j) * n + index];
+    winograd_outputTransform<M>(s, y);
+
+    float beta = bias ? bias[o] : 0;
+    float *plane = output + (b * nOutputPlane + o) * outputHeight * outputWidth;
+    for (int i = 0; i < M; i++) {
+      int oy = th * M + i;
+      for (int j = 0; j < M; j++) {
+        int ox = tw * M + j;
+        if (oy < outputHeight && ox < outputWidth)
+          plane[oy * outputWidth + ox] = act(y[i][j] + beta);
+      }
+    }
+  }
+}
+
+template <int M>
+static void winograd_transformFilter(THCState *state, const float *weight, float *u,
+                                     int nInputPlane, int nOutputPlane) {
+  int n = nInputPlane * nOutputPlane;
+  hipLaunchKernelGGL((cunn_SpatialConvolutionWinograd_filter<M>), dim3(GET_BLOCKS(n)), dim3(CUDA_NUM_THREADS), 0, THCState_getCurrentStream(state),
+      n, weight, u, nInputPlane, nOutputPlane);
+  THCudaCheck(hipGetLastError());
+}
+
+static void winograd_freeEntry(THCState *state, WinogradFilterCache &entry) {
+  for (int i = 0; i < 2; i++) {
+    if (entry.filters[i])
+      THCudaTensor_free(state, entry.filters[i]);
+    if (entry.snapshot[i])
+      THCudaTensor_free(state, entry.snapshot[i]);
+  }
+  THCudaStorage_free(state, entry.weight);
+}
+
+// Frees the entries whose weights were released by everyone else, or moved.
+// Called with winograd_cacheMutex held.
+static void winograd_sweepCache(THCState *state) {
+  std::map<const float*, WinogradFilterCache>::iterator it = winograd_cache.begin();
+  while (it != winograd_cache.end()) {
+    WinogradFilterCache &entry = it->second;
+    if (entry.weight->refcount <= 1 ||
+        THCudaStorage_data(state, entry.weight) + entry.offset != it->first) {
+      winograd_freeEntry(state, entry);
+      it = winograd_cache.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+// Returns the filters of weight for tile size M, brought up to date with its
+// current values, or NULL when weight is not registered.
+template <int M>
+static const float *winograd_cachedFilter(THCState *state, const float *weight,
+                                          int nInputPlane, int nOutputPlane) {
+  std::lock_guard<std::mutex> lock(winograd_cacheMutex);
+  winograd_sweepCache(state);
+  std::map<const float*, WinogradFilterCache>::iterator it = winograd_cache.find(weight);
+  if (it == winograd_cache.end() ||
+      it->second.nInputPlane != nInputPlane || it->second.nOutputPlane != nOutputPlane)
+    return NULL;
+  int n = nInputPlane * nOutputPlane;
+  THCudaTensor *&filters = it->second.filters[M == 2 ? 0 : 1];
+  THCudaTensor *&snapshot = it->second.snapshot[M == 2 ? 0 : 1];
+  if (filters == NULL) {
+    const int alpha = Winograd<M>::alpha;
+    filters = THCudaTensor_newWithSize1d(state, (long)alpha * alpha * n);
+    snapshot = THCudaTensor_newWithSize1d(state, (long)n * 9);
+    THCudaTensor_fill(state, snapshot, NAN);
+  }
+  hipLaunchKernelGGL((cunn_SpatialConvolutionWinograd_refreshFilter<M>), dim3(GET_BLOCKS(n)), dim3(CUDA_NUM_THREADS), 0, THCState_getCurrentStream(state),
+      n, weight, THCudaTensor_data(state, snapshot), THCudaTensor_data(state, filters));
+  THCudaCheck(hipGetLastError());
+  return THCudaTensor_data(state, filters);
+}
+
+template <int M>
+static void winograd_run(THCState *state, THCUNNWorkspace &workspace,
+                         THCudaTensor *input, THCudaTensor *output,
+                         THCudaTensor *weight, THCudaTensor *bias,
+                         THCudaTensor *columns, int padW, int padH,
+                         const ConvActivation &act) {
+  const int alpha = Winograd<M>::alpha;
+  long batchSize = input->size[0];
+  int nInputPlane = input->size[1];
+  int inputHeight = input->size[2];
+  int inputWidth = input->size[3];
+  int nOutputPlane = output->size[1];
+  int outputHeight = output->size[2];
+  int outputWidth = output->size[3];
+  int tilesH = (outputHeight + M - 1) / M;
+  int tilesW = (outputWidth + M - 1) / M;
+  long tilesPerSample = (long)tilesH * tilesW;
+
+  long perSample = (long)alpha * alpha * (nInputPlane + nOutputPlane) * tilesPerSample;
+  long chunk = WINOGRAD_BUFFER_LIMIT / (perSample * sizeof(float));
+  if (chunk > batchSize)
+    chunk = batchSize;
+  if (chunk < 1)
+    chunk = 1;
+
+  const float *weight_data = THCudaTensor_data(state, weight);
+  const float *u = winograd_cachedFilter<M>(state, weight_data, nInputPlane, nOutputPlane);
+  long filterSize = u ? 0 : (long)alpha * alpha * nOutputPlane * nInputPlane;
+
+  // [filters] transformed input | GEMM output
+  workspace.borrow2d(columns, 1, filterSize + chunk * perSample);
+  float *columns_data = THCudaTensor_data(state, columns);
+  if (!u) {
+    winograd_transformFilter<M>(state, weight_data, columns_data, nInputPlane, nOutputPlane);
+    u = columns_data;
+  }
+  float *v = columns_data + filterSize;
+
+  for (long elt = 0; elt < batchSize; elt += chunk) {
+    long nElt = chunk < batchSize - elt ? chunk : batchSize - elt;
+    long tiles = nElt * tilesPerSample;
+    float *m = v + (long)alpha * alpha * nInputPlane * tiles;
+
+    int num_kernels = nInputPlane * tiles;
+    hipLaunchKernelGGL((cunn_SpatialConvolutionWinograd_input<M>), dim3(GET_BLOCKS(num_kernels)), dim3(CUDA_NUM_THREADS), 0, THCState_getCurrentStream(state),
+        num_kernels, THCudaTensor_data(state, input) + elt * input->stride[0], v,
+        nInputPlane, inputHeight, inputWidth, tilesH, tilesW, padH, padW);
+    THCudaCheck(hipGetLastError());
+
+    // One GEMM per transform element: m[xi] = u[xi] * v[xi]
+    // (note: this is a bit confusing because gemm assumes column-major matrices)
+    for (int xi = 0; xi < alpha * alpha; xi++) {
+      THCudaBlas_Sgemm(
+          state,
+          'n', 'n',
+          tiles, nOutputPlane, nInputPlane,
+          1,
+          v + (long)xi * nInputPlane * tiles, tiles,
+          u + (long)xi * nOutputPlane * nInputPlane, nInputPlane,
+          0,
+          m + (long)xi * nOutputPlane * tiles, tiles
+      );
+    }
+
+    num_kernels = nOutputPlane * tiles;
+    hipLaunchKernelGGL((cunn_SpatialConvolutionWinograd_output<M>), dim3(GET_BLOCKS(num_kernels)), dim3(CUDA_NUM_THREADS), 0, THCState_getCurrentStream(state),
+        num_kernels, m, bias ? THCudaTensor_data(state, bias) : NULL,
+        THCudaTensor_data(state, output) + elt * output->stride[0],
+        nOutputPlane, outputHeight, outputWidth, tilesH, tilesW, act);
+    THCudaCheck(hipGetLastError());
+  }
+}
+
+void winograd_updateOutput(THCState *state, THCUNNWorkspace &workspace,
+                           THCudaTensor *input, THCudaTensor *output,
+                           THCudaTensor *weight, THCudaTensor *bias,
+                           THCudaTensor *columns, int padW, int padH, int tile,
+                           const ConvActivation &act) {
+  if (tile == 4)
+    winograd_run<4>(state, workspace, input, output, weight, bias, columns, padW, padH, act);
+  else
+    winograd_run<2>(state, workspace, input, output, weight, bias, columns, padW, padH, act);
+}
+
+void THNN_CudaSpatialConvolutionMM_cacheWinogradFilter(THCState *state, THCudaTensor *weight, bool enabled) {
+  THCUNN_PROFILE_FUNC(state);
+  THArgCheck(THCudaTensor_isContiguous(state, weight), 2, "weight should be contiguous");
+  THArgCheck(weight->nDimension >= 2 && THCudaTensor_nElement(state, weight) % (weight->size[0] * 9) == 0, 2,
+             "weight of nOutputPlane x nInputPlane x 3 x 3 expected");
+  const float *key = THCudaTensor_data(state, weight);
+
+  std::lock_guard<std::mutex> lock(winograd_cacheMutex);
+  std::map<const float*, WinogradFilterCache>::iterator it = winograd_cache.find(key);
+  if (it != winograd_cache.end()) {
+    winograd_freeEntry(state, it->second);
+    winograd_cache.erase(it);
+  }
+  winograd_sweepCache(state);
+  if (enabled) {
+    int nOutputPlane = weight->size[0];
+    int nInputPlane = THCudaTensor_nElement(state, weight) / (nOutputPlane * 9);
+    WinogradFilterCache entry = { weight->storage, weight->storageOffset,
+                                  nInputPlane, nOutputPlane, {NULL, NULL}, {NULL, NULL} };
+    THCudaStorage_retain(state, weight->storage);
+    winograd_cache[key] = entry;
+  }
+}
+
+// Host reference of the forward pass, running the same transforms on the CPU
+template <int M>
+static void winograd_reference(const float *input, const float *weight, const float *bias,
+                               float *output, long batchSize, int nInputPlane, int nOutputPlane,
+                               int inputHeight, int inputWidth, int outputHeight, int outputWidth,
+                               int padH, int padW) {
+  const int alpha = Winograd<M>::alpha;
+  std::vector<float> u((size_t)nOutputPlane * nInputPlane * alpha * alpha);
+  for (int k = 0; k < nOutputPlane * nInputPlane; k++) {
+    float g[3][3], t[alpha][alpha];
+    for (int i = 0; i < 3; i++)
+      for (int j = 0; j < 3; j++)
+        g[i][j] = weight[k * 9 + i * 3 + j];
+    winograd_filterTransform<M>(g, t);
+    for (int i = 0; i < alpha; i++)
+      for (int j = 0; j < alpha; j++)
+        u[(size_t)k * alpha * alpha + i * alpha + j] = t[i][j];
+  }
+
+  std::vector<float> v((size_t)nInputPlane * alpha * alpha);
+  for (long b = 0; b < batchSize; b++) {
+    for (int y0 = 0; y0 < outputHeight; y0 += M) {
+      for (int x0 = 0; x0 < outputWidth; x0 += M) {
+        for (int c = 0; c < nInputPlane; c++) {
+          const float *plane = input + (b * nInputPlane + c) * inputHeight * inputWidth;
+          float d[alpha][alpha], t[alpha][alpha];
+          for (int i = 0; i < alpha; i++)
+            for (int j = 0; j < alpha; j++) {
+              int y = y0 - padH + i, x = x0 - padW + j;
+              d[i][j] = (y >= 0 && y < inputHeight && x >= 0 && x < inputWidth) ? plane[y * inputWidth + x] : 0;
+            }
+          winograd_inputTransform<M>(d, t);
+          for (int i = 0; i < alpha; i++)
+            for (int j = 0; j < alpha; j++)
+              v[(size_t)c * alpha * alpha + i * alpha + j] = t[i][j];
+        }
+        for (int o = 0; o < nOutputPlane; o++) {
+          float s[alpha][alpha], y[M][M];
+          for (int i = 0; i < alpha; i++)
+            for (int j = 0; j < alpha; j++) {
+              float acc = 0;
+              for (int c = 0; c < nInputPlane; c++)
+                acc += u[((size_t)o * nInputPlane + c) * alpha * alpha + i * alpha + j] *
+                       v[(size_t)c * alpha * alpha + i * alpha + j];
+              s[i][j] = acc;
+            }
+          winograd_outputTransform<M>(s, y);
+          float *plane = output + (b * nOutputPlane + o) * outputHeight * outputWidth;
+          for (int i = 0; i < M && y0 + i < outputHeight; i++)
+            for (int j = 0; j < M && x0 + j < outputWidth; j++)
+              plane[(y0 + i) * outputWidth + x0 + j] = y[i][j] + (bias ? bias[o] : 0);
+        }
+      }
+    }
+  }
+}
+
+void THNN_CudaSpatialConvolutionMM_winogradReference(THCState *state, THFloatTensor *input, THFloatTensor *output, THFloatTensor *weight, THFloatTensor *bias, int padW, int padH, int tile) {
+  THArgCheck(input->nDimension == 4 && THFloatTensor_isContiguous(input), 2, "contiguous 4D (batch mode) tensor is expected");
+  THArgCheck(THFloatTensor_isContiguous(weight) && weight->size[0] > 0 &&
+             THFloatTensor_nElement(weight) == weight->size[0] * input->size[1] * 9, 4,
+             "contiguous weight of nOutputPlane x nInputPlane x 3 x 3 is expected");
+  THArgCheck(!bias || THFloatTensor_nElement(bias) == weight->size[0], 5, "nOutputPlane mismatch in weight and bias");
+  THArgCheck(tile == 2 || tile == 4, 8, "tile should be 2 or 4");
+
+  long batchSize = input->size[0];
+  int nInputPlane = input->size[1];
+  int nOutputPlane = weight->size[0];
+  int inputHeight = input->size[2];
+  int inputWidth = input->size[3];
+  int outputHeight = inputHeight + 2*padH - 2;
+  int outputWidth = inputWidth + 2*padW - 2;
+  THArgCheck(outputHeight > 0 && outputWidth > 0, 2, "input is smaller than the kernel");
+
+  THFloatTensor_resize4d(output, batchSize, nOutputPlane, outputHeight, outputWidth);
+  const float *bias_data = bias ? THFloatTensor_data(bias) : NULL;
+  if (tile == 4)
+    winograd_reference<4>(THFloatTensor_data(input), THFloatTensor_data(weight), bias_data,
+                          THFloatTensor_data(output), batchSize, nInputPlane, nOutputPlane,
+                          inputHeight, inputWidth, outputHeight, outputWidth, padH, padW);
+  else
+    winograd_reference<2>(THFloatTensor_data(input), THFloatTensor_data(weight), bias_data,
+                          THFloatTensor_data(output), batchSize, nInputPlane, nOutputPlane,
+                          inputHeight, inputWidth, outputHeight, outputWidth, padH, padW);
+}
+
+#undef WINOGRAD_BUFFER_LIMIT
@@ -210,6 +210,8 @@ void THNN_CudaSpatialCrossMapLRN_updateOutput(
     float beta,
     float k)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   LRNforward(state, input, output, scale, size, alpha, beta, k);
 }
 
@@ -225,5 +227,7 @@ void THNN_CudaSpatialCrossMapLRN_updateGradInput(
     float beta,
     float k)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   LRNbackward(state, input, output, gradOutput, gradInput, scale, size, alpha, beta, k);
 }
@@ -1,6 +1,8 @@
 #include "THCUNN.h"
+#include "workspace.h"
 #include "common.h"
 #include "im2col.h"
+#include "implicit_gemm.h"
 
 
 void THNN_CudaSpatialDilatedConvolution_updateOutput(THCState *state,
@@ -8,6 +10,8 @@ void THNN_CudaSpatialDilatedConvolution_updateOutput(THCState *state,
             THCudaTensor *bias, THCudaTensor *columns,
             THCudaTensor *ones, int kW, int kH, int dW, int dH,
             int padW, int padH, int dilationW, int dilationH) {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
 
   THCUNN_assertSameGPU(state, 5, input, output, weight, columns, ones);
   if (bias) {
@@ -48,83 +52,90 @@ void THNN_CudaSpatialDilatedConvolution_updateOutput(THCState *state,
   // Resize output
   THCudaTensor_resize4d(state, output, batchSize, nOutputPlane, outputHeight, outputWidth);
 
-  // Resize temporary columns
-  THCudaTensor_resize2d(state, columns, nInputPlane*kW*kH, outputHeight*outputWidth);
+  THCUNNWorkspace workspace(state);
+  ImplicitGemmChoice gemmChoice(state, "SpatialDilatedConvolution_updateOutput");
 
-  // Define a buffer of ones, for bias accumulation
-  // Note: this buffer can be shared with other modules, it only ever gets increased,
-  // and always contains ones.
-  if (ones->nDimension != 2 || ones->size[0]*ones->size[1] < outputHeight*outputWidth) {
-    // Resize plane and fill with ones...
-    THCudaTensor_resize2d(state, ones, outputHeight, outputWidth);
-    THCudaTensor_fill(state, ones, 1);
-  }
+  ConvGeometry geometry = convGeometry2d(batchSize, nInputPlane, nOutputPlane,
+                                         inputHeight, inputWidth, outputHeight, outputWidth,
+                                         kH, kW, padH, padW, dH, dW, dilationH, dilationW);
+
+  if (THCudaTensor_isContiguous(state, input) && gemmChoice.use(geometry)) {
+    implicitGemm(state, ImplicitGemmForward(
+        geometry, THCudaTensor_data(state, input), THCudaTensor_data(state, weight),
+        bias ? THCudaTensor_data(state, bias) : NULL, THCudaTensor_data(state, output)));
+  } else {
+    // Resize temporary columns
+    workspace.borrow2d(columns, nInputPlane*kW*kH, outputHeight*outputWidth);
+
+    // Define a buffer of ones, for bias accumulation
+    workspace.ones2d(ones, outputHeight, outputWidth);
+
+    // Helpers
+    THCudaTensor *input_n = THCudaTensor_new(state);
+    THCudaTensor *output_n = THCudaTensor_new(state);
+
+    // For each elt in batch, do:
+    for (int elt = 0; elt < batchSize; elt ++) {
+      // Matrix mulitply per output:
+      THCudaTensor_select(state, input_n, input, 0, elt);
+      THCudaTensor_select(state, output_n, output, 0, elt);
+
+      // Do Bias first:
+      // M,N,K are dims of matrix A and B
+      // (see http://docs.nvidia.com/cuda/cublas/#cublas-lt-t-gt-gemm)
+      long m_ = nOutputPlane;
+      long n_ = outputHeight * outputWidth;
+      long k_ = 1;
+
+      // Do GEMM (note: this is a bit confusing because gemm assumes column-major matrices)
+      if (bias) {
+        THCudaBlas_Sgemm(
+            state,
+            't', 'n',
+            n_, m_, k_,
+            1,
+            THCudaTensor_data(state, ones), k_,
+            THCudaTensor_data(state, bias), k_,
+            0,
+            THCudaTensor_data(state, output_n), n_
+        );
+      } else {
+        THCudaTensor_zero(state, output_n);
+      }
+
+      // Extract columns:
+      im2col(
+        THCState_getCurrentStream(state),
+        THCudaTensor_data(state, input_n),
+        nInputPlane, inputHeight, inputWidth, kH, kW, padH, padW, dH, dW,
+        dilationH, dilationW,
+        THCudaTensor_data(state, columns)
+      );
+
+      // M,N,K are dims of matrix A and B
+      // (see http://docs.nvidia.com/cuda/cublas/#cublas-lt-t-gt-gemm)
+      long m = nOutputPlane;
+      long n = columns->size[1];
+      long k = nInputPlane*kH*kW;
 
-  // Helpers
-  THCudaTensor *input_n = THCudaTensor_new(state);
-  THCudaTensor *output_n = THCudaTensor_new(state);
-
-  // For each elt in batch, do:
-  for (int elt = 0; elt < batchSize; elt ++) {
-    // Matrix mulitply per output:
-    THCudaTensor_select(state, input_n, input, 0, elt);
-    THCudaTensor_select(state, output_n, output, 0, elt);
-
-    // Do Bias first:
-    // M,N,K are dims of matrix A and B
-    // (see http://docs.nvidia.com/cuda/cublas/#cublas-lt-t-gt-gemm)
-    long m_ = nOutputPlane;
-    long n_ = outputHeight * outputWidth;
-    long k_ = 1;
-
-    // Do GEMM (note: this is a bit confusing because gemm assumes column-major matrices)
-    if (bias) {
+      // Do GEMM (note: this is a bit confusing because gemm assumes column-major matrices)
       THCudaBlas_Sgemm(
           state,
-          't', 'n',
-          n_, m_, k_,
+          'n', 'n',
+          n, m, k,
           1,
-          THCudaTensor_data(state, ones), k_,
-          THCudaTensor_data(state, bias), k_,
-          0,
-          THCudaTensor_data(state, output_n), n_
+          THCudaTensor_data(state, columns), n,
+          THCudaTensor_data(state, weight), k,
+          1,
+          THCudaTensor_data(state, output_n), n
       );
-    } else {
-      THCudaTensor_zero(state, output_n);
     }
 
-    // Extract columns:
-    im2col(
-      THCState_getCurrentStream(state),
-      THCudaTensor_data(state, input_n),
-      nInputPlane, inputHeight, inputWidth, kH, kW, padH, padW, dH, dW,
-      dilationH, dilationW,
-      THCudaTensor_data(state, columns)
-    );
-
-    // M,N,K are dims of matrix A and B
-    // (see http://docs.nvidia.com/cuda/cublas/#cublas-lt-t-gt-gemm)
-    long m = nOutputPlane;
-    long n = columns->size[1];
-    long k = nInputPlane*kH*kW;
-
-    // Do GEMM (note: this is a bit confusing because gemm assumes column-major matrices)
-    THCudaBlas_Sgemm(
-        state,
-        'n', 'n',
-        n, m, k,
-        1,
-        THCudaTensor_data(state, columns), n,
-        THCudaTensor_data(state, weight), k,
-        1,
-        THCudaTensor_data(state, output_n), n
-    );
+    // Free
+    THCudaTensor_free(state, input_n);
+    THCudaTensor_free(state, output_n);
   }
 
-  // Free
-  THCudaTensor_free(state, input_n);
-  THCudaTensor_free(state, output_n);
-
   // Resize output
   if (batch == 0) {
     THCudaTensor_resize3d(state, output, nOutputPlane, outputHeight, outputWidth);
@@ -138,6 +149,8 @@ void THNN_CudaSpatialDilatedConvolution_updateGradInput(THCState *state,
                THCudaTensor *gradColumns,
                int kW, int kH, int dW, int dH, int padW, int padH,
                int dilationW, int dilationH ) {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
 
   THCUNN_assertSameGPU(state, 5, input, gradOutput, weight,
                                  gradColumns, gradInput);
@@ -169,50 +182,63 @@ void THNN_CudaSpatialDilatedConvolution_updateGradInput(THCState *state,
   // Resize output
   THCudaTensor_resize4d(state, gradInput, batchSize, nInputPlane, inputHeight, inputWidth);
 
-  // Resize temporary columns
-  THCudaTensor_resize2d(state, gradColumns, nInputPlane*kW*kH, outputHeight*outputWidth);
-
-  // Helpers
-  THCudaTensor *gradInput_n = THCudaTensor_new(state);
-  THCudaTensor *gradOutput_n = THCudaTensor_new(state);
-
-  // For each elt in batch, do:
-  for (int elt = 0; elt < batchSize; elt ++) {
-    // Matrix mulitply per sample:
-    THCudaTensor_select(state, gradInput_n, gradInput, 0, elt);
-    THCudaTensor_select(state, gradOutput_n, gradOutput, 0, elt);
-
-    // M,N,K are dims of matrix A and B
-    // (see http://docs.nvidia.com/cuda/cublas/#cublas-lt-t-gt-gemm)
-    long m = nInputPlane*kW*kH;
-    long n = gradColumns->size[1];
-    long k = nOutputPlane;
-
-    // Do GEMM (note: this is a bit confusing because gemm assumes column-major matrices)
-    THCudaBlas_Sgemm(
-        state,
-        'n', 't',
-        n, m, k,
-        1,
-        THCudaTensor_data(state, gradOutput_n), n,
-        THCudaTensor_data(state, weight), m,
-        0,
-        THCudaTensor_data(state, gradColumns), n
-    );
-
-    // Unpack columns back into input:
-    col2im(
-      THCState_getCurrentStream(state),
-      THCudaTensor_data(state, gradColumns),
-      nInputPlane, inputHeight, inputWidth, kH, kW, padH, padW, dH, dW,
-      dilationH, dilationW,
-      THCudaTensor_data(state, gradInput_n)
-    );
-  }
+  THCUNNWorkspace workspace(state);
+  ImplicitGemmChoice gemmChoice(state, "SpatialDilatedConvolution_updateGradInput");
+
+  ConvGeometry geometry = convGeometry2d(batchSize, nInputPlane, nOutputPlane,
+                                         inputHeight, inputWidth, outputHeight, outputWidth,
+                                         kH, kW, padH, padW, dH, dW, dilationH, dilationW);
 
-  // Free
-  THCudaTensor_free(state, gradInput_n);
-  THCudaTensor_free(state, gradOutput_n);
+  if (THCudaTensor_isContiguous(state, gradOutput) && gemmChoice.use(geometry)) {
+    implicitGemm(state, ImplicitGemmGradInput(
+        geometry, THCudaTensor_data(state, gradOutput), THCudaTensor_data(state, weight),
+        THCudaTensor_data(state, gradInput)));
+  } else {
+    // Resize temporary columns
+    workspace.borrow2d(gradColumns, nInputPlane*kW*kH, outputHeight*outputWidth);
+
+    // Helpers
+    THCudaTensor *gradInput_n = THCudaTensor_new(state);
+    THCudaTensor *gradOutput_n = THCudaTensor_new(state);
+
+    // For each elt in batch, do:
+    for (int elt = 0; elt < batchSize; elt ++) {
+      // Matrix mulitply per sample:
+      THCudaTensor_select(state, gradInput_n, gradInput, 0, elt);
+      THCudaTensor_select(state, gradOutput_n, gradOutput, 0, elt);
+
+      // M,N,K are dims of matrix A and B
+      // (see http://docs.nvidia.com/cuda/cublas/#cublas-lt-t-gt-gemm)
+      long m = nInputPlane*kW*kH;
+      long n = gradColumns->size[1];
+      long k = nOutputPlane;
+
+      // Do GEMM (note: this is a bit confusing because gemm assumes column-major matrices)
+      THCudaBlas_Sgemm(
+          state,
+          'n', 't',
+          n, m, k,
+          1,
+          THCudaTensor_data(state, gradOutput_n), n,
+          THCudaTensor_data(state, weight), m,
+          0,
+          THCudaTensor_data(state, gradColumns), n
+      );
+
+      // Unpack columns back into input:
+      col2im(
+        THCState_getCurrentStream(state),
+        THCudaTensor_data(state, gradColumns),
+        nInputPlane, inputHeight, inputWidth, kH, kW, padH, padW, dH, dW,
+        dilationH, dilationW,
+        THCudaTensor_data(state, gradInput_n)
+      );
+    }
+
+    // Free
+    THCudaTensor_free(state, gradInput_n);
+    THCudaTensor_free(state, gradOutput_n);
+  }
 
   // Resize output
   if (batch == 0) {
@@ -228,6 +254,8 @@ void THNN_CudaSpatialDilatedConvolution_accGradParameters(THCState *state,
                      THCudaTensor *columns, THCudaTensor *ones,
                      int kW, int kH, int dW, int dH,
                      int padW, int padH, int dilationW, int dilationH, float scale) {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
 
   THCUNN_assertSameGPU(state, 5, input, gradOutput, gradWeight, columns, ones);
   if (gradBias) {
@@ -259,77 +287,88 @@ void THNN_CudaSpatialDilatedConvolution_accGradParameters(THCState *state,
   // Batch size + input planes
   long batchSize = input->size[0];
 
-  // Define a buffer of ones, for bias accumulation
-  if (ones->nDimension != 2 || ones->size[0]*ones->size[1] < outputHeight*outputWidth) {
-    // Resize plane and fill with ones...
-    THCudaTensor_resize2d(state, ones, outputHeight, outputWidth);
-    THCudaTensor_fill(state, ones, 1);
-  }
+  THCUNNWorkspace workspace(state);
+  ImplicitGemmChoice gemmChoice(state, "SpatialDilatedConvolution_accGradParameters", true);
+
+  ConvGeometry geometry = convGeometry2d(batchSize, nInputPlane, nOutputPlane,
+                                         inputHeight, inputWidth, outputHeight, outputWidth,
+                                         kH, kW, padH, padW, dH, dW, dilationH, dilationW);
+
+  if (THCudaTensor_isContiguous(state, input) && THCudaTensor_isContiguous(state, gradOutput) &&
+      gemmChoice.use(geometry)) {
+    implicitGemm(state, ImplicitGemmGradWeight(
+        geometry, THCudaTensor_data(state, input), THCudaTensor_data(state, gradOutput),
+        THCudaTensor_data(state, gradWeight), gradBias ? THCudaTensor_data(state, gradBias) : NULL,
+        scale));
+  } else {
+    // Define a buffer of ones, for bias accumulation
+    workspace.ones2d(ones, outputHeight, outputWidth);
+
+    // Resize temporary columns
+    workspace.borrow2d(columns, nInputPlane*kW*kH, outputHeight*outputWidth);
+
+    // Helpers
+    THCudaTensor *input_n = THCudaTensor_new(state);
+    THCudaTensor *gradOutput_n = THCudaTensor_new(state);
+
+    // For each elt in batch, do:
+    for (int elt = 0; elt < batchSize; elt ++) {
+      // Matrix mulitply per output:
+      THCudaTensor_select(state, input_n, input, 0, elt);
+      THCudaTensor_select(state, gradOutput_n, gradOutput, 0, elt);
+
+      // Extract columns:
+      im2col(
+        THCState_getCurrentStream(state),
+        THCudaTensor_data(state, input_n),
+        nInputPlane, inputHeight, inputWidth, kH, kW, padH, padW, dH, dW,
+        dilationH, dilationW,
+        THCudaTensor_data(state, columns)
+      );
 
-  // Resize temporary columns
-  THCudaTensor_resize2d(state, columns, nInputPlane*kW*kH, outputHeight*outputWidth);
-
-  // Helpers
-  THCudaTensor *input_n = THCudaTensor_new(state);
-  THCudaTensor *gradOutput_n = THCudaTensor_new(state);
-
-  // For each elt in batch, do:
-  for (int elt = 0; elt < batchSize; elt ++) {
-    // Matrix mulitply per output:
-    THCudaTensor_select(state, input_n, input, 0, elt);
-    THCudaTensor_select(state, gradOutput_n, gradOutput, 0, elt);
-
-    // Extract columns:
-    im2col(
-      THCState_getCurrentStream(state),
-      THCudaTensor_data(state, input_n),
-      nInputPlane, inputHeight, inputWidth, kH, kW, padH, padW, dH, dW,
-      dilationH, dilationW,
-      THCudaTensor_data(state, columns)
-    );
-
-    // M,N,K are dims of matrix A and B
-    // (see http://docs.nvidia.com/cuda/cublas/#cublas-lt-t-gt-gemm)
-    long m = nOutputPlane;
-    long n = nInputPlane*kW*kH;
-    long k = columns->size[1];
-
-    // Do GEMM (note: this is a bit confusing because gemm assumes column-major matrices)
-    THCudaBlas_Sgemm(
-        state,
-        't', 'n',
-        n, m, k,
-        scale,
-        THCudaTensor_data(state, columns), k,
-        THCudaTensor_data(state, gradOutput_n), k,
-        1,
-        THCudaTensor_data(state, gradWeight), n
-    );
-
-    // Do Bias:
-    // M,N,K are dims of matrix A and B
-    // (see http://docs.nvidia.com/cuda/cublas/#cublas-lt-t-gt-gemm)
-    long m_ = nOutputPlane;
-    long k_ = outputHeight * outputWidth;
-
-    // Do GEMV (note: this is a bit confusing because gemv assumes column-major matrices)
-    if (gradBias) {
-      THCudaBlas_Sgemv(
+      // M,N,K are dims of matrix A and B
+      // (see http://docs.nvidia.com/cuda/cublas/#cublas-lt-t-gt-gemm)
+      long m = nOutputPlane;
+      long n = nInputPlane*kW*kH;
+      long k = columns->size[1];
+
+      // Do GEMM (note: this is a bit confusing because gemm assumes column-major matrices)
+      THCudaBlas_Sgemm(
           state,
-          't',
-          k_, m_,
+          't', 'n',
+          n, m, k,
           scale,
-          THCudaTensor_data(state, gradOutput_n), k_,
-          THCudaTensor_data(state, ones), 1,
+          THCudaTensor_data(state, columns), k,
+          THCudaTensor_data(state, gradOutput_n), k,
           1,
-          THCudaTensor_data(state, gradBias), 1
+          THCudaTensor_data(state, gradWeight), n
       );
+
+      // Do Bias:
+      // M,N,K are dims of matrix A and B
+      // (see http://docs.nvidia.com/cuda/cublas/#cublas-lt-t-gt-gemm)
+      long m_ = nOutputPlane;
+      long k_ = outputHeight * outputWidth;
+
+      // Do GEMV (note: this is a bit confusing because gemv assumes column-major matrices)
+      if (gradBias) {
+        THCudaBlas_Sgemv(
+            state,
+            't',
+            k_, m_,
+            scale,
+            THCudaTensor_data(state, gradOutput_n), k_,
+            THCudaTensor_data(state, ones), 1,
+            1,
+            THCudaTensor_data(state, gradBias), 1
+        );
+      }
     }
-  }
 
-  // Free
-  THCudaTensor_free(state, input_n);
-  THCudaTensor_free(state, gradOutput_n);
+    // Free
+    THCudaTensor_free(state, input_n);
+    THCudaTensor_free(state, gradOutput_n);
+  }
 
   // Resize
   if (batch == 0) {
@@ -1,16 +1,19 @@
 #include "hip/hip_runtime.h"
 #include "THCUNN.h"
 #include "common.h"
+#include "pooling_indices.h"
 
-// kernels borrowed from Caffe
-template <typename Dtype>
+// kernels borrowed from Caffe; Mask is float or unsigned char, see
+// pooling_indices.h
+template <typename Dtype, typename Mask>
 __global__ void MaxPoolForward( const int nthreads, const Dtype* bottom_data,
     const int num, const int channels, const int height,
     const int width, const int pooled_height, const int pooled_width,
     const int kernel_h, const int kernel_w, const int stride_h,
     const int stride_w, const int pad_h, const int pad_w,
     const int dilation_h, const int dilation_w, Dtype* top_data,
-    Dtype* top_mask) {
+    Mask* top_mask) {
+  const PoolingWindow2d g = { width, kernel_w, stride_h, stride_w, pad_h, pad_w, dilation_h, dilation_w };
   CUDA_KERNEL_LOOP(index, nthreads) {
     int pw = index % pooled_width;
     int ph = (index / pooled_width) % pooled_height;
@@ -25,30 +28,32 @@ __global__ void MaxPoolForward( const int nthreads, const Dtype* bottom_data,
     while(wstart < 0)
       wstart += dilation_w;
     Dtype maxval = -FLT_MAX;
-    int maxidx = -1;
+    int maxh = -1, maxw = -1;
     bottom_data += (n * channels + c) * height * width;
     for (int h = hstart; h < hend; h += dilation_h) {
       for (int w = wstart; w < wend; w += dilation_w) {
         if (bottom_data[h * width + w] > maxval) {
-          maxidx = h * width + w;
-          maxval = bottom_data[maxidx];
+          maxh = h;
+          maxw = w;
+          maxval = bottom_data[h * width + w];
         }
       }
     }
     top_data[index] = maxval;
-    top_mask[index] = maxidx + TH_INDEX_BASE;
+    pooling_store(top_mask, index, g, ph, pw, maxh, maxw);
   }
 }
 
 
-template <typename Dtype>
+template <typename Dtype, typename Mask>
 __global__ void MaxPoolBackward( const int nthreads, const Dtype* top_diff,
-    const Dtype* top_mask, const int num, const int channels,
+    const Mask* top_mask, const int num, const int channels,
     const int height, const int width, const int pooled_height,
     const int pooled_width, const int kernel_h, const int kernel_w,
     const int stride_h, const int stride_w, const int pad_h, const int pad_w,
     const int dilation_h, const int dilation_w,
     Dtype* bottom_diff) {
+  const PoolingWindow2d g = { width, kernel_w, stride_h, stride_w, pad_h, pad_w, dilation_h, dilation_w };
   CUDA_KERNEL_LOOP(index, nthreads) {
     // find out the local index
     // find out the local offset
@@ -69,7 +74,7 @@ __global__ void MaxPoolBackward( const int nthreads, const Dtype* top_diff,
     top_mask += offset;
     for (int ph = phstart; ph < phend; ++ph) {
       for (int pw = pwstart; pw < pwend; ++pw) {
-	if (top_mask[ph * pooled_width + pw] - TH_INDEX_BASE == h * width + w) {
+	if (pooling_load(top_mask, ph * pooled_width + pw, g, ph, pw) == h * width + w) {
 	  gradient += top_diff[ph * pooled_width + pw];
 	}
       }
@@ -78,9 +83,56 @@ __global__ void MaxPoolBackward( const int nthreads, const Dtype* top_diff,
   }
 }
 
-void THNN_CudaSpatialDilatedMaxPooling_updateOutput(THCState *state, THCudaTensor *input, THCudaTensor *output, THCudaTensor *indices, int kW, int kH, int dW, int dH, int padW, int padH, int dilationW, int dilationH, bool ceil_mode)
+// Scatter backward: one thread per pooled output of the pass, the outputs
+// (phase_h + i * step_h, phase_w + j * step_w) of every plane, each adding its
+// gradient at its argmax. step_h and step_w are large enough that the windows
+// of one pass do not overlap, so the += needs no atomics; passes run in a
+// fixed order, which keeps the sums deterministic.
+template <typename Dtype, typename Mask>
+__global__ void MaxPoolScatter( const int nthreads, const Dtype* top_diff,
+    const Mask* top_mask, const int height, const int width,
+    const int pooled_height, const int pooled_width,
+    const int pass_height, const int pass_width,
+    const int phase_h, const int phase_w, const int step_h, const int step_w,
+    const PoolingWindow2d g, Dtype* bottom_diff) {
+  CUDA_KERNEL_LOOP(index, nthreads) {
+    int pw = phase_w + (index % pass_width) * step_w;
+    int ph = phase_h + ((index / pass_width) % pass_height) * step_h;
+    int plane = index / pass_width / pass_height;
+    int top = (plane * pooled_height + ph) * pooled_width + pw;
+    int maxind = pooling_load(top_mask, top, g, ph, pw);
+    if (maxind >= 0)
+      bottom_diff[plane * height * width + maxind] += top_diff[top];
+  }
+}
+
+// Pools whose windows do not overlap scatter in one pass. Overlapping ones
+// need a pass per output phase, which pays off once the output is this many
+// times smaller than the input: the gather kernel runs a thread per input.
+#define MAXPOOL_SCATTER_MIN_SHRINK 8
+
+// -1: always gather, 0: choose per call, 1: always scatter
+static int maxPoolScatter_mode = 0;
+
+void THNN_CudaSpatialDilatedMaxPooling_setScatterBackward(THCState *state, int mode)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THArgCheck(mode >= -1 && mode <= 1, 2, "mode should be -1, 0 or 1");
+  maxPoolScatter_mode = mode;
+}
 
+static bool maxPoolScatter_use(int passes, long inputSize, long outputSize)
+{
+  if (maxPoolScatter_mode != 0)
+    return maxPoolScatter_mode > 0;
+  return passes == 1 || inputSize >= MAXPOOL_SCATTER_MIN_SHRINK * outputSize;
+}
+
+#undef MAXPOOL_SCATTER_MIN_SHRINK
+
+template <typename Mask, typename IndexTensor>
+static void SpatialDilatedMaxPooling_updateOutput(THCState *state, THCudaTensor *input, THCudaTensor *output, IndexTensor *indices, int kW, int kH, int dW, int dH, int padW, int padH, int dilationW, int dilationH, bool ceil_mode)
+{
   THCUNN_assertSameGPU(state, 3, input, output, indices);
   THArgCheck(input->nDimension == 3 || input->nDimension == 4, 2, "3D or 4D (batch) tensor expected");
 
@@ -130,14 +182,13 @@ if (padW || padH)
   float* input_data = THCudaTensor_data(state, input);
 
   THCudaTensor_resize4d(state, output, batchSize, nInputPlane, nOutputRows, nOutputCols);
-  THCudaTensor_resizeAs(state, indices, output);
-
-  float* indices_data = THCudaTensor_data(state, indices);
+  Mask* indices_data =
+    pooling_resizeIndices(state, indices, batchSize, nInputPlane, nOutputRows, nOutputCols);
   float* output_data = THCudaTensor_data(state, output);
 
   int count = THCudaTensor_nElement(state, output);
 
-  hipLaunchKernelGGL((MaxPoolForward), dim3(GET_BLOCKS(count)), dim3(CUDA_NUM_THREADS), 0, THCState_getCurrentStream(state) , count, input_data,
+  hipLaunchKernelGGL((MaxPoolForward<float, Mask>), dim3(GET_BLOCKS(count)), dim3(CUDA_NUM_THREADS), 0, THCState_getCurrentStream(state) , count, input_data,
       batchSize, nInputPlane, nInputRows, nInputCols, nOutputRows, nOutputCols,
       kH, kW, dH, dW, padH, padW, dilationH, dilationW, output_data, indices_data);
   THCudaCheck(hipGetLastError());
@@ -148,7 +199,25 @@ if (padW || padH)
   THCudaTensor_free(state, input);
 }
 
-void THNN_CudaSpatialDilatedMaxPooling_updateGradInput(THCState *state, THCudaTensor *input, THCudaTensor *gradOutput, THCudaTensor *gradInput, THCudaTensor *indices, int kW, int kH, int dW, int dH, int padW, int padH, int dilationW, int dilationH, bool ceil_mode)
+void THNN_CudaSpatialDilatedMaxPooling_updateOutput(THCState *state, THCudaTensor *input, THCudaTensor *output, THCudaTensor *indices, int kW, int kH, int dW, int dH, int padW, int padH, int dilationW, int dilationH, bool ceil_mode)
+{
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
+  SpatialDilatedMaxPooling_updateOutput<float>(
+    state, input, output, indices, kW, kH, dW, dH, padW, padH, dilationW, dilationH, ceil_mode);
+}
+
+void THNN_CudaSpatialDilatedMaxPooling_updateOutputCompact(THCState *state, THCudaTensor *input, THCudaTensor *output, THCudaByteTensor *indices, int kW, int kH, int dW, int dH, int padW, int padH, int dilationW, int dilationH, bool ceil_mode)
+{
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
+  THArgCheck(kW * kH <= POOLING_COMPACT_MAX_WINDOW, 5, "compact indices need a window of at most 255 elements");
+  SpatialDilatedMaxPooling_updateOutput<unsigned char>(
+    state, input, output, indices, kW, kH, dW, dH, padW, padH, dilationW, dilationH, ceil_mode);
+}
+
+template <typename Mask, typename IndexTensor>
+static void SpatialDilatedMaxPooling_updateGradInput(THCState *state, THCudaTensor *input, THCudaTensor *gradOutput, THCudaTensor *gradInput, IndexTensor *indices, int kW, int kH, int dW, int dH, int padW, int padH, int dilationW, int dilationH, bool ceil_mode)
 {
   THCUNN_assertSameGPU(state, 4, input, gradOutput, indices, gradInput);
 
@@ -185,18 +254,52 @@ void THNN_CudaSpatialDilatedMaxPooling_updateGradInput(THCState *state, THCudaTe
     THError("Given input size: (%dx%dx%d). Calculated output size: (%dx%dx%d). Output size is too small",
             nInputPlane,nInputRows,nInputCols,nInputPlane,nOutputRows,nOutputCols);
 
+  // updateOutput drops a last window that starts in the padding; the indices
+  // have the shape of gradOutput
+  nOutputCols = gradOutput->size[gradOutput->nDimension - 1];
+  nOutputRows = gradOutput->size[gradOutput->nDimension - 2];
+
   gradOutput = THCudaTensor_newContiguous(state, gradOutput);
   THCudaTensor_resizeAs(state, gradInput, input);
 
   int count = THCudaTensor_nElement(state, input);
 
-  hipLaunchKernelGGL((MaxPoolBackward), dim3(GET_BLOCKS(count)), dim3(CUDA_NUM_THREADS), 0, THCState_getCurrentStream(state) , count,
-      THCudaTensor_data(state, gradOutput),
-      THCudaTensor_data(state, indices),
-      batchSize, nInputPlane, nInputRows, nInputCols, nOutputRows, nOutputCols,
-      kH, kW, dH, dW, padH, padW, dilationH, dilationW,
-      THCudaTensor_data(state, gradInput));
-  THCudaCheck(hipGetLastError());
+  Mask* indices_data = pooling_indicesData(state, indices);
+
+  // outputs this many rows (columns) apart have disjoint windows
+  int stepH = (dilationH * (kH - 1) + 1 + dH - 1) / dH;
+  int stepW = (dilationW * (kW - 1) + 1 + dW - 1) / dW;
+  if (stepH > nOutputRows)
+    stepH = nOutputRows;
+  if (stepW > nOutputCols)
+    stepW = nOutputCols;
+
+  if (maxPoolScatter_use(stepH * stepW, count, THCudaTensor_nElement(state, gradOutput))) {
+    const PoolingWindow2d g = { (int)nInputCols, kW, dH, dW, padH, padW, dilationH, dilationW };
+    THCudaTensor_zero(state, gradInput);
+    for (int phaseH = 0; phaseH < stepH; phaseH++) {
+      for (int phaseW = 0; phaseW < stepW; phaseW++) {
+        int passHeight = (nOutputRows - phaseH + stepH - 1) / stepH;
+        int passWidth = (nOutputCols - phaseW + stepW - 1) / stepW;
+        int passCount = batchSize * nInputPlane * passHeight * passWidth;
+        hipLaunchKernelGGL((MaxPoolScatter<float, Mask>), dim3(GET_BLOCKS(passCount)), dim3(CUDA_NUM_THREADS), 0, THCState_getCurrentStream(state) , passCount,
+            THCudaTensor_data(state, gradOutput),
+            indices_data,
+            nInputRows, nInputCols, nOutputRows, nOutputCols,
+            passHeight, passWidth, phaseH, phaseW, stepH, stepW, g,
+            THCudaTensor_data(state, gradInput));
+        THCudaCheck(hipGetLastError());
+      }
+    }
+  } else {
+    hipLaunchKernelGGL((MaxPoolBackward<float, Mask>), dim3(GET_BLOCKS(count)), dim3(CUDA_NUM_THREADS), 0, THCState_getCurrentStream(state) , count,
+        THCudaTensor_data(state, gradOutput),
+        indices_data,
+        batchSize, nInputPlane, nInputRows, nInputCols, nOutputRows, nOutputCols,
+        kH, kW, dH, dW, padH, padW, dilationH, dilationW,
+        THCudaTensor_data(state, gradInput));
+    THCudaCheck(hipGetLastError());
+  }
 
   THCudaTensor_free(state, gradOutput);
 
@@ -204,3 +307,20 @@ void THNN_CudaSpatialDilatedMaxPooling_updateGradInput(THCState *state, THCudaTe
   THCudaTensor_free(state, input);
   THCudaTensor_free(state, gradOutput);
 }
+
+void THNN_CudaSpatialDilatedMaxPooling_updateGradInput(THCState *state, THCudaTensor *input, THCudaTensor *gradOutput, THCudaTensor *gradInput, THCudaTensor *indices, int kW, int kH, int dW, int dH, int padW, int padH, int dilationW, int dilationH, bool ceil_mode)
+{
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
+  SpatialDilatedMaxPooling_updateGradInput<float>(
+    state, input, gradOutput, gradInput, indices, kW, kH, dW, dH, padW, padH, dilationW, dilationH, ceil_mode);
+}
+
+void THNN_CudaSpatialDilatedMaxPooling_updateGradInputCompact(THCState *state, THCudaTensor *input, THCudaTensor *gradOutput, THCudaTensor *gradInput, THCudaByteTensor *indices, int kW, int kH, int dW, int dH, int padW, int padH, int dilationW, int dilationH, bool ceil_mode)
+{
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
+  THArgCheck(kW * kH <= POOLING_COMPACT_MAX_WINDOW, 6, "compact indices need a window of at most 255 elements");
+  SpatialDilatedMaxPooling_updateGradInput<unsigned char>(
+    state, input, gradOutput, gradInput, indices, kW, kH, dW, dH, padW, padH, dilationW, dilationH, ceil_mode);
+}
@@ -84,6 +84,8 @@ void THNN_CudaSpatialFractionalMaxPooling_updateOutput(
     THCudaTensor *indices,
     THCudaTensor *randomSamples)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   int planeDim = 0;
   int dimh = 1;
   int dimw = 2;
@@ -151,6 +153,7 @@ void THNN_CudaSpatialFractionalMaxPooling_updateOutput(
 #define SFMP_UPDATE_OUTPUT_CASE(POOL_W)                 \
   case POOL_W: SFMP_UPDATE_OUTPUT(POOL_W); break
 
+  THCUNN_PROFILE_LAUNCH(grid, block);
   switch (poolSizeW) {
     SFMP_UPDATE_OUTPUT_CASE(2);
     SFMP_UPDATE_OUTPUT_CASE(3);
@@ -203,6 +206,8 @@ void THNN_CudaSpatialFractionalMaxPooling_updateGradInput(
     int poolSizeW, int poolSizeH,
     THCudaTensor *indices)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   int dimh = 1;
   int dimw = 2;
 
@@ -248,6 +253,7 @@ void THNN_CudaSpatialFractionalMaxPooling_updateGradInput(
             devGradInput.getSize(0));
   dim3 block(outputPlaneSize > 128 ? 128 : outputPlaneSize);
 
+  THCUNN_PROFILE_LAUNCH(grid, block);
   hipLaunchKernelGGL((SpatialFractionalMaxPooling_updateGradInput), dim3(grid), dim3(block), 0, THCState_getCurrentStream(state), 
       devGradInput, devGradOutput, devIndices);
   THCudaCheck(hipGetLastError());
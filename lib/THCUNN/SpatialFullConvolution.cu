@@ -1,4 +1,5 @@
 #include "THCUNN.h"
+#include "workspace.h"
 #include "im2col.h"
 
 
@@ -15,6 +16,8 @@ void THNN_CudaSpatialFullConvolution_updateOutput(
     int padW, int padH,
     int adjW, int adjH)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
 
   int nInputPlane = THCudaTensor_size(state, weight, 0);
   int nOutputPlane = THCudaTensor_size(state, weight, 1);
@@ -45,17 +48,13 @@ void THNN_CudaSpatialFullConvolution_updateOutput(
   // Resize output
   THCudaTensor_resize4d(state, output, batchSize, nOutputPlane, outputHeight, outputWidth);
 
+  THCUNNWorkspace workspace(state);
+
   // Resize temporary columns
-  THCudaTensor_resize2d(state, columns, nOutputPlane*kW*kH, inputHeight*inputWidth);
+  workspace.borrow2d(columns, nOutputPlane*kW*kH, inputHeight*inputWidth);
 
   // Define a buffer of ones, for bias accumulation
-  // Note: this buffer can be shared with other modules, it only ever gets increased,
-  // and always contains ones.
-  if (ones->nDimension != 2 || ones->size[0]*ones->size[1] < outputHeight*outputWidth) {
-    // Resize plane and fill with ones...
-    THCudaTensor_resize2d(state, ones, outputHeight, outputWidth);
-    THCudaTensor_fill(state, ones, 1);
-  }
+  workspace.ones2d(ones, outputHeight, outputWidth);
 
   // Helpers
   THCudaTensor *input_n = THCudaTensor_new(state);
@@ -139,6 +138,8 @@ void THNN_CudaSpatialFullConvolution_updateGradInput(
     int padW, int padH,
     int adjW, int adjH)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   int nInputPlane = THCudaTensor_size(state, weight, 0);
   int nOutputPlane = THCudaTensor_size(state, weight, 1);
 
@@ -165,8 +166,10 @@ void THNN_CudaSpatialFullConvolution_updateGradInput(
   // Resize output
   THCudaTensor_resize4d(state, gradInput, batchSize, nInputPlane, inputHeight, inputWidth);
 
+  THCUNNWorkspace workspace(state);
+
   // Resize temporary columns
-  THCudaTensor_resize2d(state, gradColumns, nOutputPlane*kW*kH, inputHeight*inputWidth);
+  workspace.borrow2d(gradColumns, nOutputPlane*kW*kH, inputHeight*inputWidth);
 
   // Helpers
   THCudaTensor *gradInput_n = THCudaTensor_new(state);
@@ -234,6 +237,8 @@ void THNN_CudaSpatialFullConvolution_accGradParameters(
     int adjW, int adjH,
     float scale)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   int nInputPlane = THCudaTensor_size(state, gradWeight, 0);
   int nOutputPlane = THCudaTensor_size(state, gradWeight, 1);
 
@@ -258,15 +263,13 @@ void THNN_CudaSpatialFullConvolution_accGradParameters(
   // Batch size + input planes
   long batchSize = input->size[0];
 
+  THCUNNWorkspace workspace(state);
+
   // Define a buffer of ones, for bias accumulation
-  if (ones->nDimension != 2 || ones->size[0]*ones->size[1] < outputHeight*outputWidth) {
-    // Resize plane and fill with ones...
-    THCudaTensor_resize2d(state, ones, outputHeight, outputWidth);
-    THCudaTensor_fill(state, ones, 1);
-  }
+  workspace.ones2d(ones, outputHeight, outputWidth);
 
   // Resize temporary columns
-  THCudaTensor_resize2d(state, columns, nOutputPlane*kW*kH, inputHeight*inputWidth);
+  workspace.borrow2d(columns, nOutputPlane*kW*kH, inputHeight*inputWidth);
 
   // Helpers
   THCudaTensor *input_n = THCudaTensor_new(state);
@@ -3,6 +3,8 @@
 
 void THNN_CudaSpatialMaxPooling_updateOutput(THCState *state, THCudaTensor *input, THCudaTensor *output, THCudaTensor *indices, int kW, int kH, int dW, int dH, int padW, int padH, bool ceil_mode)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   THNN_CudaSpatialDilatedMaxPooling_updateOutput(
     state, input, output, indices, 
     kW, kH, dW, dH, padW, padH, 1, 1, ceil_mode);
@@ -11,6 +13,8 @@ void THNN_CudaSpatialMaxPooling_updateOutput(THCState *state, THCudaTensor *inpu
 
 void THNN_CudaSpatialMaxPooling_updateGradInput(THCState *state, THCudaTensor *input, THCudaTensor *gradOutput, THCudaTensor *gradInput, THCudaTensor *indices, int kW, int kH, int dW, int dH, int padW, int padH, bool ceil_mode)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   THNN_CudaSpatialDilatedMaxPooling_updateGradInput(
     state, input, gradOutput, gradInput, indices,
     kW, kH, dW, dH, padW, padH, 1, 1, ceil_mode);
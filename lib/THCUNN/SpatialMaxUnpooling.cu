@@ -1,36 +1,45 @@
 #include "hip/hip_runtime.h"
 #include "THCUNN.h"
 #include "common.h"
-
-template <typename Dtype>
-__global__ void MaxUnpoolForward( const int nthreads, const Dtype* bottom_data, const Dtype* bottom_mask,
-    const int num, const int channels, const int iheight, const int iwidth, const int oheight, const int owidth, Dtype* top_data) {
+#include "pooling_indices.h"
+
+// Mask is float or unsigned char, see pooling_indices.h; g describes the
+// pooling windows, and is only used by the compact format
+template <typename Dtype, typename Mask>
+__global__ void MaxUnpoolForward( const int nthreads, const Dtype* bottom_data, const Mask* bottom_mask,
+    const int num, const int channels, const int iheight, const int iwidth, const int oheight, const int owidth,
+    const PoolingWindow2d g, Dtype* top_data) {
   CUDA_KERNEL_LOOP(index, nthreads) { //index here indices the input pixels
+    int pw = index % iwidth;
+    int ph = (index / iwidth) % iheight;
     int c = (index / iwidth / iheight) % channels;
     int n = index / iwidth / iheight / channels;
     top_data += (n*channels + c)*oheight*owidth;
-    int maxind = bottom_mask[index] - TH_INDEX_BASE;
+    int maxind = pooling_load(bottom_mask, index, g, ph, pw);
 
     top_data[maxind] = bottom_data[index];
   }
 }
 
-template <typename Dtype>
-__global__ void MaxUnpoolBackward( const int nthreads, const Dtype* top_diff, const Dtype* bottom_mask,
-    const int num, const int channels, const int iheight, const int iwidth, const int oheight, const int owidth, Dtype* bottom_diff) {
+template <typename Dtype, typename Mask>
+__global__ void MaxUnpoolBackward( const int nthreads, const Dtype* top_diff, const Mask* bottom_mask,
+    const int num, const int channels, const int iheight, const int iwidth, const int oheight, const int owidth,
+    const PoolingWindow2d g, Dtype* bottom_diff) {
   CUDA_KERNEL_LOOP(index, nthreads) {
+    int pw = index % iwidth;
+    int ph = (index / iwidth) % iheight;
     int c = (index / iwidth / iheight) % channels;
     int n = index / iwidth / iheight / channels;
     top_diff += (n*channels + c)*oheight*owidth;
-    int maxind = bottom_mask[index] - TH_INDEX_BASE;
+    int maxind = pooling_load(bottom_mask, index, g, ph, pw);
 
     bottom_diff[index] = top_diff[maxind];
   }
 }
 
-void THNN_CudaSpatialMaxUnpooling_updateOutput(THCState *state, THCudaTensor *input, THCudaTensor *output, THCudaTensor *indices, int owidth, int oheight)
+template <typename Mask>
+static void SpatialMaxUnpooling_updateOutput(THCState *state, THCudaTensor *input, THCudaTensor *output, const Mask *indices_data, int owidth, int oheight, const PoolingWindow2d &g)
 {
-  THCUNN_assertSameGPU(state, 3, input, output, indices);
   THArgCheck(input->nDimension == 3 || input->nDimension == 4, 2, "3D or 4D (batch) tensor expected");
 
   long nInputCols, nInputRows, nInputPlane, batchSize;
@@ -50,14 +59,13 @@ void THNN_CudaSpatialMaxUnpooling_updateOutput(THCState *state, THCudaTensor *in
   }
 
   input = THCudaTensor_newContiguous(state, input);
-  indices = THCudaTensor_newContiguous(state, indices);
   THCudaTensor_resize4d(state, output, batchSize, nInputPlane, oheight, owidth);
   THCudaTensor_zero(state, output);
 
   int count = THCudaTensor_nElement(state, input);
 
-  hipLaunchKernelGGL((MaxUnpoolForward), dim3(GET_BLOCKS(count)), dim3(CUDA_NUM_THREADS), 0, THCState_getCurrentStream(state) , count, THCudaTensor_data(state, input), THCudaTensor_data(state, indices),
-      batchSize, nInputPlane, nInputRows, nInputCols, oheight, owidth, THCudaTensor_data(state, output));
+  hipLaunchKernelGGL((MaxUnpoolForward<float, Mask>), dim3(GET_BLOCKS(count)), dim3(CUDA_NUM_THREADS), 0, THCState_getCurrentStream(state) , count, THCudaTensor_data(state, input), indices_data,
+      batchSize, nInputPlane, nInputRows, nInputCols, oheight, owidth, g, THCudaTensor_data(state, output));
   THCudaCheck(hipGetLastError());
 
   if(input->nDimension == 3)
@@ -67,10 +75,9 @@ void THNN_CudaSpatialMaxUnpooling_updateOutput(THCState *state, THCudaTensor *in
 
 }
 
-void THNN_CudaSpatialMaxUnpooling_updateGradInput(THCState *state, THCudaTensor *input, THCudaTensor *gradOutput, THCudaTensor *gradInput, THCudaTensor *indices, int owidth, int oheight)
+template <typename Mask>
+static void SpatialMaxUnpooling_updateGradInput(THCState *state, THCudaTensor *input, THCudaTensor *gradOutput, THCudaTensor *gradInput, const Mask *indices_data, int owidth, int oheight, const PoolingWindow2d &g)
 {
-  THCUNN_assertSameGPU(state, 4, input, gradOutput, indices, gradInput);
-
   long nInputCols, nInputRows, nInputPlane, batchSize;
 
   if (input->nDimension == 3) {
@@ -88,17 +95,58 @@ void THNN_CudaSpatialMaxUnpooling_updateGradInput(THCState *state, THCudaTensor
   }
 
   input = THCudaTensor_newContiguous(state, input);
-  indices = THCudaTensor_newContiguous(state, indices);
   gradOutput = THCudaTensor_newContiguous(state, gradOutput);
   THCudaTensor_resizeAs(state, gradInput, input);
 
   int count = THCudaTensor_nElement(state, input);
 
-  hipLaunchKernelGGL((MaxUnpoolBackward), dim3(GET_BLOCKS(count)), dim3(CUDA_NUM_THREADS), 0, THCState_getCurrentStream(state) , count, THCudaTensor_data(state, gradOutput), THCudaTensor_data(state, indices),
-      batchSize, nInputPlane, nInputRows, nInputCols, oheight, owidth, THCudaTensor_data(state, gradInput));
+  hipLaunchKernelGGL((MaxUnpoolBackward<float, Mask>), dim3(GET_BLOCKS(count)), dim3(CUDA_NUM_THREADS), 0, THCState_getCurrentStream(state) , count, THCudaTensor_data(state, gradOutput), indices_data,
+      batchSize, nInputPlane, nInputRows, nInputCols, oheight, owidth, g, THCudaTensor_data(state, gradInput));
   THCudaCheck(hipGetLastError());
 
   // clean
   THCudaTensor_free(state, input);
   THCudaTensor_free(state, gradOutput);
 }
+
+void THNN_CudaSpatialMaxUnpooling_updateOutput(THCState *state, THCudaTensor *input, THCudaTensor *output, THCudaTensor *indices, int owidth, int oheight)
+{
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
+  THCUNN_assertSameGPU(state, 3, input, output, indices);
+  indices = THCudaTensor_newContiguous(state, indices);
+  PoolingWindow2d g = { owidth };
+  SpatialMaxUnpooling_updateOutput(state, input, output, THCudaTensor_data(state, indices), owidth, oheight, g);
+  THCudaTensor_free(state, indices);
+}
+
+void THNN_CudaSpatialMaxUnpooling_updateGradInput(THCState *state, THCudaTensor *input, THCudaTensor *gradOutput, THCudaTensor *gradInput, THCudaTensor *indices, int owidth, int oheight)
+{
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
+  THCUNN_assertSameGPU(state, 4, input, gradOutput, indices, gradInput);
+  indices = THCudaTensor_newContiguous(state, indices);
+  PoolingWindow2d g = { owidth };
+  SpatialMaxUnpooling_updateGradInput(state, input, gradOutput, gradInput, THCudaTensor_data(state, indices), owidth, oheight, g);
+  THCudaTensor_free(state, indices);
+}
+
+void THNN_CudaSpatialMaxUnpooling_updateOutputCompact(THCState *state, THCudaTensor *input, THCudaTensor *output, THCudaByteTensor *indices, int owidth, int oheight, int kW, int kH, int dW, int dH, int padW, int padH, int dilationW, int dilationH)
+{
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
+  THCUNN_assertSameGPU(state, 3, input, output, indices);
+  THArgCheck(THCudaByteTensor_isContiguous(state, indices), 4, "indices should be contiguous");
+  PoolingWindow2d g = { owidth, kW, dH, dW, padH, padW, dilationH, dilationW };
+  SpatialMaxUnpooling_updateOutput(state, input, output, THCudaByteTensor_data(state, indices), owidth, oheight, g);
+}
+
+void THNN_CudaSpatialMaxUnpooling_updateGradInputCompact(THCState *state, THCudaTensor *input, THCudaTensor *gradOutput, THCudaTensor *gradInput, THCudaByteTensor *indices, int owidth, int oheight, int kW, int kH, int dW, int dH, int padW, int padH, int dilationW, int dilationH)
+{
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
+  THCUNN_assertSameGPU(state, 4, input, gradOutput, indices, gradInput);
+  THArgCheck(THCudaByteTensor_isContiguous(state, indices), 5, "indices should be contiguous");
+  PoolingWindow2d g = { owidth, kW, dH, dW, padH, padW, dilationH, dilationW };
+  SpatialMaxUnpooling_updateGradInput(state, input, gradOutput, gradInput, THCudaByteTensor_data(state, indices), owidth, oheight, g);
+}
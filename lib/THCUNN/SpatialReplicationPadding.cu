@@ -1,5 +1,6 @@
 #include "hip/hip_runtime.h"
 #include "THCUNN.h"
+#include "common.h"
 
 #include "THCDeviceTensor.cuh"
 #include "THCDeviceTensorUtils.cuh"
@@ -38,6 +39,8 @@ void THNN_CudaSpatialReplicationPadding_updateOutput(THCState *state,
                                                      int padL, int padR,
                                                      int padT, int padB
                                                     ) {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   THArgCheck(TensorUtils<THCudaTensor>::canUse32BitIndexMath(state, input), 2,
              "input tensor must fit into 32-bit index math");
 
@@ -121,6 +124,8 @@ void THNN_CudaSpatialReplicationPadding_updateGradInput(THCState *state,
                                                         THCudaTensor *gradInput,
                                                         int padL, int padR,
                                                         int padT, int padB) {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
 
   THArgCheck(TensorUtils<THCudaTensor>::canUse32BitIndexMath(state, input), 2,
                 "input tensor must fit into 32-bit index math");
@@ -1,6 +1,7 @@
 #include "hip/hip_runtime.h"
 #include "THCUNN.h"
 #include "common.h"
+#include "tuning.h"
 
 #define CUDA_MAX_THREADS 1024   // this is safe, in reality 256 is our limit
 
@@ -242,8 +243,29 @@ __global__ void subgradinputAtomic( float *gradInput, float *gradOutput, float *
   }
 }
 
+// Thread block shapes the tuner tries for subsample; the first is the default
+static const int SUBSAMPLE_THREADS[][2] = {{32, 8}, {64, 4}, {16, 16}, {32, 16}, {64, 8}};
+#define SUBSAMPLE_NUM_THREADS 5
+
+struct SubsampleLaunch
+{
+  THCState *state;
+  dim3 blocks;
+  float *input, *output, *weight, *bias;
+  int input_n, input_h, input_w, kH, kW, dH, dW;
+
+  void operator()(int i) const
+  {
+    dim3 threads(SUBSAMPLE_THREADS[i][0], SUBSAMPLE_THREADS[i][1]);
+    hipLaunchKernelGGL((subsample), dim3(blocks), dim3(threads), 0, THCState_getCurrentStream(state),
+      input, output, weight, bias, input_n, input_h, input_w, kH, kW, dH, dW);
+  }
+};
+
 void THNN_CudaSpatialSubSampling_updateOutput(THCState *state, THCudaTensor *input, THCudaTensor *output, THCudaTensor *weight, THCudaTensor *bias, int kW, int kH, int dW, int dH)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   float *weight_data = THCudaTensor_data(state, weight);
   float *bias_data = THCudaTensor_data(state, bias);
   float *output_data;
@@ -273,12 +295,14 @@ void THNN_CudaSpatialSubSampling_updateOutput(THCState *state, THCudaTensor *inp
     int yblocks = (int)(16L / nInputPlane);
     yblocks = yblocks < 1 ? 1 : yblocks;
     dim3 blocks(nInputPlane,yblocks);
-    dim3 threads(32,8);
 
     // run subsample kernel
-    hipLaunchKernelGGL((subsample), dim3(blocks), dim3(threads), 0, THCState_getCurrentStream(state), 
-      input_data, output_data, weight_data, bias_data,
-      nInputPlane, nInputRows, nInputCols, kH, kW, dH, dW);
+    SubsampleLaunch launch = {
+      state, blocks, input_data, output_data, weight_data, bias_data,
+      nInputPlane, (int)nInputRows, (int)nInputCols, kH, kW, dH, dW
+    };
+    launch(tuning_choose(state, "SpatialSubSampling_updateOutput", nOutputRows*nOutputCols,
+                         SUBSAMPLE_NUM_THREADS, launch));
     THCudaCheck(hipGetLastError());
   } else {
     long nInputCols = input->size[3];
@@ -300,12 +324,14 @@ void THNN_CudaSpatialSubSampling_updateOutput(THCState *state, THCudaTensor *inp
     int yblocks = (int)(16L / nInputPlane);
     yblocks = yblocks < 1 ? 1 : yblocks;
     dim3 blocks(nInputPlane*nbatch,yblocks);
-    dim3 threads(32,8);
 
     // run subsample kernel
-    hipLaunchKernelGGL((subsample), dim3(blocks), dim3(threads), 0, THCState_getCurrentStream(state), 
-      input_data, output_data, weight_data, bias_data,
-      nInputPlane, nInputRows, nInputCols, kH, kW, dH, dW);
+    SubsampleLaunch launch = {
+      state, blocks, input_data, output_data, weight_data, bias_data,
+      nInputPlane, (int)nInputRows, (int)nInputCols, kH, kW, dH, dW
+    };
+    launch(tuning_choose(state, "SpatialSubSampling_updateOutput", nOutputRows*nOutputCols,
+                         SUBSAMPLE_NUM_THREADS, launch));
     THCudaCheck(hipGetLastError());
   }
 
@@ -316,6 +342,8 @@ void THNN_CudaSpatialSubSampling_updateOutput(THCState *state, THCudaTensor *inp
 
 void THNN_CudaSpatialSubSampling_updateGradInput(THCState *state, THCudaTensor *input, THCudaTensor *gradOutput, THCudaTensor *gradInput, THCudaTensor *weight, int kW, int kH, int dW, int dH)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   THCUNN_assertSameGPU(state, 4, input, gradOutput, weight, gradInput);
 
   int nInputPlane = THCudaTensor_size(state, weight, 0);
@@ -384,6 +412,8 @@ void THNN_CudaSpatialSubSampling_updateGradInput(THCState *state, THCudaTensor *
 
 void THNN_CudaSpatialSubSampling_accGradParameters(THCState *state, THCudaTensor *input, THCudaTensor *gradOutput, THCudaTensor *gradWeight, THCudaTensor *gradBias, int kW, int kH, int dW, int dH, float scale)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   THCUNN_assertSameGPU(state, 4, input, gradOutput, gradWeight, gradBias);
 
   int nInputPlane = THCudaTensor_size(state, gradWeight, 0);
@@ -444,3 +474,4 @@ void THNN_CudaSpatialSubSampling_accGradParameters(THCState *state, THCudaTensor
 }
 
 #undef CUDA_MAX_THREADS
+#undef SUBSAMPLE_NUM_THREADS
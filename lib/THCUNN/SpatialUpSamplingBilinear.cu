@@ -64,6 +64,8 @@ void THNN_CudaSpatialUpSamplingBilinear_updateOutput(
           THCudaTensor *output,
 	  int outputHeight,
           int outputWidth) {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   input = THCudaTensor_newContiguous(state, input);
   output = THCudaTensor_newContiguous(state, output);
   THCUNN_assertSameGPU(state, 2, input, output);
@@ -153,6 +155,7 @@ void THNN_CudaSpatialUpSamplingBilinear_updateGradInput(
           int inputWidth,
           int outputHeight,
           int outputWidth) {
+  THCUNN_PROFILE_FUNC(state);
   gradInput = THCudaTensor_newContiguous(state, gradInput);
   gradOutput = THCudaTensor_newContiguous(state, gradOutput);
   THCUNN_assertSameGPU(state, 2, gradOutput, gradInput);
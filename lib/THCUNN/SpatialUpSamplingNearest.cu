@@ -62,6 +62,8 @@ __global__ void upscale( float *input, float *output, long no_elements,
 
 void THNN_CudaSpatialUpSamplingNearest_updateOutput(THCState *state, THCudaTensor *input, THCudaTensor *output, int scale_factor)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   THCudaTensor_zero(state, output);
 
   THCUNN_assertSameGPU(state, 2, input, output);
@@ -133,6 +135,8 @@ __global__ void downscale( float *gradInput_data, float *gradOutput_data, long n
 
 void THNN_CudaSpatialUpSamplingNearest_updateGradInput(THCState *state, THCudaTensor *input, THCudaTensor *gradOutput, THCudaTensor *gradInput, int scale_factor)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   THCUNN_assertSameGPU(state, 2, gradOutput, gradInput);
 
   THCudaTensor_zero(state, gradInput);
@@ -83,6 +83,25 @@ TH_API void THNN_CudaSpatialClassNLLCriterion_updateGradInput(
           THCudaTensor *weights,       // [OPTIONAL]
           THCudaTensor *total_weight);
 
+TH_API void THNN_CudaCrossEntropy_updateOutput(
+          THCState *state,
+          THCudaTensor *input,
+          THIndexTensor *target,
+          THCudaTensor *output,
+          bool sizeAverage,
+          THCudaTensor *weights,       // [OPTIONAL]
+          THCudaTensor *total_weight,
+          THCudaTensor *logsum);
+TH_API void THNN_CudaCrossEntropy_updateGradInput(
+          THCState *state,
+          THCudaTensor *input,
+          THIndexTensor *target,
+          THCudaTensor *gradInput,     // may be input
+          bool sizeAverage,
+          THCudaTensor *weights,       // [OPTIONAL]
+          THCudaTensor *total_weight,
+          THCudaTensor *logsum);
+
 TH_API void THNN_CudaDistKLDivCriterion_updateOutput(
           THCState *state,
           THCudaTensor *input,
@@ -425,6 +444,22 @@ TH_API void THNN_CudaThreshold_updateGradInput(
           double val,
           bool inplace);
 
+TH_API void THNN_CudaPointwiseFused_updateOutput(
+          THCState *state,
+          THCudaTensor *input,
+          THCudaTensor *output,
+          int nOps,                    // 1 to 8
+          const int *ops,              // PointwiseOpCode of each op, first applied first
+          const float *params);        // 2 per op
+TH_API void THNN_CudaPointwiseFused_updateGradInput(
+          THCState *state,
+          THCudaTensor *input,
+          THCudaTensor *gradOutput,
+          THCudaTensor *gradInput,
+          int nOps,
+          const int *ops,
+          const float *params);
+
 TH_API void THNN_CudaTemporalConvolution_updateOutput(
           THCState *state,
           THCudaTensor *input,
@@ -526,6 +561,15 @@ TH_API void THNN_CudaBatchNormalization_updateOutput(
           bool train,
           double momentum,
           double eps);
+TH_API void THNN_CudaBatchNormalization_foldConvolution(
+          THCState *state,
+          THCudaTensor *convWeight,
+          THCudaTensor *convBias,
+          THCudaTensor *weight,        // [OPTIONAL]
+          THCudaTensor *bias,          // [OPTIONAL]
+          THCudaTensor *runningMean,
+          THCudaTensor *runningVar,
+          double eps);
 TH_API void THNN_CudaBatchNormalization_backward(
           THCState *state,
           THCudaTensor *input,
@@ -553,6 +597,20 @@ TH_API void THNN_CudaSpatialConvolutionMM_updateOutput(
           int kW, int kH,
           int dW, int dH,
           int padW, int padH);
+TH_API void THNN_CudaSpatialConvolutionMM_updateOutputActivation(
+          THCState *state,
+          THCudaTensor *input,
+          THCudaTensor *output,
+          THCudaTensor *weight,
+          THCudaTensor *bias,          // [OPTIONAL]
+          THCudaTensor *columns,
+          THCudaTensor *ones,
+          int kW, int kH,
+          int dW, int dH,
+          int padW, int padH,
+          int activation,              // 0 none, 1 Threshold, 2 ELU, 3 LeakyReLU
+          float activationA,           // threshold, ELU alpha or LeakyReLU negval
+          float activationB);          // Threshold value
 TH_API void THNN_CudaSpatialConvolutionMM_updateGradInput(
           THCState *state,
           THCudaTensor *input,
@@ -576,6 +634,27 @@ TH_API void THNN_CudaSpatialConvolutionMM_accGradParameters(
           int dW, int dH,
           int padW, int padH,
           float scale);
+TH_API void THNN_CudaSpatialConvolutionMM_setColumnsLimit(
+          THCState *state,
+          long limit);                 // bytes; 0 disables batched unfolding
+TH_API void THNN_CudaSpatialConvolutionMM_setWinograd(
+          THCState *state,
+          int mode);                   // -1 never, 0 per-layer choice, 2 or 4 force F(2x2) or F(4x4)
+TH_API void THNN_CudaSpatialConvolutionMM_cacheWinogradFilter(
+          THCState *state,
+          THCudaTensor *weight,
+          bool enabled);               // keep transformed filters until disabled
+TH_API void THNN_CudaSpatialConvolutionMM_winogradReference(
+          THCState *state,
+          THFloatTensor *input,        // host reference of the 3x3 stride-1 forward pass
+          THFloatTensor *output,
+          THFloatTensor *weight,
+          THFloatTensor *bias,         // [OPTIONAL]
+          int padW, int padH,
+          int tile);
+TH_API void THNN_CudaConvolution_setImplicitGemm(
+          THCState *state,
+          int mode);                   // -1 columns path, 0 timed per shape, 1 implicit GEMM
 
 TH_API void THNN_CudaSpatialConvolutionLocal_updateOutput(
           THCState *state,
@@ -790,6 +869,31 @@ TH_API void THNN_CudaSpatialDilatedMaxPooling_updateGradInput(
           int padW, int padH,
           int dilationW, int dilationH,
           bool ceil_mode);
+TH_API void THNN_CudaSpatialDilatedMaxPooling_updateOutputCompact(
+          THCState *state,
+          THCudaTensor *input,
+          THCudaTensor *output,
+          THCudaByteTensor *indices,
+          int kW, int kH,
+          int dW, int dH,
+          int padW, int padH,
+          int dilationW, int dilationH,
+          bool ceil_mode);
+TH_API void THNN_CudaSpatialDilatedMaxPooling_updateGradInputCompact(
+          THCState *state,
+          THCudaTensor *input,
+          THCudaTensor *gradOutput,
+          THCudaTensor *gradInput,
+          THCudaByteTensor *indices,
+          int kW, int kH,
+          int dW, int dH,
+          int padW, int padH,
+          int dilationW, int dilationH,
+          bool ceil_mode);
+
+TH_API void THNN_CudaSpatialDilatedMaxPooling_setScatterBackward(
+          THCState *state,
+          int mode);                   // -1 gather per input, 0 per-call choice, 1 scatter from the outputs
 
 TH_API void THNN_CudaSpatialMaxUnpooling_updateOutput(
           THCState *state,
@@ -804,6 +908,27 @@ TH_API void THNN_CudaSpatialMaxUnpooling_updateGradInput(
           THCudaTensor *gradInput,
           THCudaTensor *indices,
           int owidth, int oheight);
+TH_API void THNN_CudaSpatialMaxUnpooling_updateOutputCompact(
+          THCState *state,
+          THCudaTensor *input,
+          THCudaTensor *output,
+          THCudaByteTensor *indices,
+          int owidth, int oheight,
+          int kW, int kH,
+          int dW, int dH,
+          int padW, int padH,
+          int dilationW, int dilationH);
+TH_API void THNN_CudaSpatialMaxUnpooling_updateGradInputCompact(
+          THCState *state,
+          THCudaTensor *input,
+          THCudaTensor *gradOutput,
+          THCudaTensor *gradInput,
+          THCudaByteTensor *indices,
+          int owidth, int oheight,
+          int kW, int kH,
+          int dW, int dH,
+          int padW, int padH,
+          int dilationW, int dilationH);
 
 TH_API void THNN_CudaSpatialFractionalMaxPooling_updateOutput(
           THCState *state,
@@ -1033,6 +1158,26 @@ TH_API void THNN_CudaVolumetricDilatedMaxPooling_updateGradInput(
           int dT, int dW, int dH,
           int padT, int padW, int padH,
           int dilationT, int dilationW, int dilationH);
+TH_API void THNN_CudaVolumetricDilatedMaxPooling_updateOutputCompact(
+          THCState *state,
+          THCudaTensor *input,
+          THCudaTensor *output,
+          THCudaByteTensor *indices,
+          int kT, int kW, int kH,
+          int dT, int dW, int dH,
+          int padT, int padW, int padH,
+          int dilationT, int dilationW, int dilationH,
+          bool ceilMode);
+TH_API void THNN_CudaVolumetricDilatedMaxPooling_updateGradInputCompact(
+          THCState *state,
+          THCudaTensor *input,
+          THCudaTensor *gradOutput,
+          THCudaTensor *gradInput,
+          THCudaByteTensor *indices,
+          int kT, int kW, int kH,
+          int dT, int dW, int dH,
+          int padT, int padW, int padH,
+          int dilationT, int dilationW, int dilationH);
 
 TH_API void THNN_CudaVolumetricMaxUnpooling_updateOutput(
           THCState *state,
@@ -1051,6 +1196,25 @@ TH_API void THNN_CudaVolumetricMaxUnpooling_updateGradInput(
           int outputTime, int outputWidth, int outputHeight,
           int dT, int dW, int dH,
           int padT, int padW, int padH);
+TH_API void THNN_CudaVolumetricMaxUnpooling_updateOutputCompact(
+          THCState *state,
+          THCudaTensor *input,
+          THCudaTensor *output,
+          THCudaByteTensor *indices,
+          int outputTime, int outputWidth, int outputHeight,
+          int kT, int kW, int kH,
+          int dT, int dW, int dH,
+          int padT, int padW, int padH);
+TH_API void THNN_CudaVolumetricMaxUnpooling_updateGradInputCompact(
+          THCState *state,
+          THCudaTensor *input,
+          THCudaTensor *gradOutput,
+          THCudaTensor *gradInput,
+          THCudaByteTensor *indices,
+          int outputTime, int outputWidth, int outputHeight,
+          int kT, int kW, int kH,
+          int dT, int dW, int dH,
+          int padT, int padW, int padH);
 
 TH_API void THNN_CudaSpatialReflectionPadding_updateOutput(
           THCState *state,
@@ -1095,3 +1259,56 @@ TH_API void THNN_CudaVolumetricReplicationPadding_updateGradInput(
           int pleft, int pright,
           int ptop, int pbottom,
           int pfront, int pback);
+
+TH_API void THNN_CudaProfiler_setEnabled(
+          THCState *state,
+          bool enabled);
+TH_API void THNN_CudaProfiler_dump(
+          THCState *state,
+          const char *tracePath,       // Chrome trace JSON; NULL or "" to skip
+          const char *summaryPath);    // aggregated table; NULL or "" for stderr
+TH_API void THNN_CudaProfiler_reset(
+          THCState *state);
+
+TH_API void THNN_CudaWorkspace_setEnabled(
+          THCState *state,
+          bool enabled);
+TH_API void THNN_CudaWorkspace_getStats(
+          THCState *state,
+          long *stats);                // [capacity bytes, high-water bytes, borrows, grows] on the current device
+TH_API void THNN_CudaWorkspace_release(
+          THCState *state);
+
+TH_API void THNN_CudaTuning_setEnabled(
+          THCState *state,
+          bool enabled);
+TH_API void THNN_CudaTuning_setCacheFile(
+          THCState *state,
+          const char *path);           // loads it; "" keeps choices in memory only, NULL goes back to $THCUNN_TUNING_CACHE
+TH_API void THNN_CudaTuning_clear(
+          THCState *state);
+TH_API void THNN_CudaTuning_record(
+          THCState *state,
+          const char *device,
+          const char *kernel,
+          long size,
+          int candidates,
+          int choice);
+TH_API void THNN_CudaTuning_lookup(
+          THCState *state,
+          const char *device,
+          const char *kernel,
+          long size,
+          int candidates,
+          int *choice);                // -1 when nothing is recorded
+TH_API void THNN_CudaTuning_fastest(
+          THCState *state,
+          int n,
+          const float *times,          // negative: the candidate failed to launch
+          int *choice);
+
+TH_API void THNN_CudaWavefront_reduce(
+          THCState *state,
+          THCudaTensor *input,
+          THCudaTensor *output,        // [OUT] sum and max of input
+          int blockSize);              // threads in the one block, up to 1024
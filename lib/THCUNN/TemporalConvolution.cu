@@ -1,6 +1,123 @@
+#include "hip/hip_runtime.h"
 #include "THCUNN.h"
+#include "workspace.h"
 #include "common.h"
 
+// Every pass treats the (sample, output frame) pairs of the whole batch as the
+// rows of one matrix. The kW input frames seen by an output frame are
+// contiguous in memory, so unfolding a row is a plain copy of kW*inputFrameSize
+// floats; the unfolded rows then go through a single GEMM per pass instead of
+// one strided addmm per window offset and per sample. Rows are processed in
+// chunks whose columns buffer stays under this many bytes.
+#define TEMPORAL_COLUMNS_LIMIT (64 << 20)
+
+// Rows of the unfolded input per GEMM
+static long temporalConvolution_chunkRows(long nRows, long rowSize) {
+  long rows = TEMPORAL_COLUMNS_LIMIT / (rowSize * (long)sizeof(float));
+  if (rows > nRows)
+    rows = nRows;
+  return rows < 1 ? 1 : rows;
+}
+
+// columns[r - r0] holds the input window of row r = sample * nOutputFrame + frame
+__global__ void cunn_TemporalConvolution_unfold(
+    const int n, const float *input, float *columns, const int r0,
+    const int nOutputFrame, const int nInputFrame, const int rowSize,
+    const int frameSize, const int dW) {
+  CUDA_KERNEL_LOOP(index, n) {
+    int j = index % rowSize;
+    int r = r0 + index / rowSize;
+    int sample = r / nOutputFrame;
+    int frame = r - sample * nOutputFrame;
+    columns[index] = input[(sample * nInputFrame + frame * dW) * frameSize + j];
+  }
+}
+
+// Adds to gradInput[sample][s] the window gradients of rows r0..r0+nRows-1
+// whose window covers input frame s
+__global__ void cunn_TemporalConvolution_fold(
+    const int n, const float *gradColumns, float *gradInput, const int sample0,
+    const int r0, const int nRows, const int nOutputFrame, const int nInputFrame,
+    const int frameSize, const int kW, const int dW) {
+  CUDA_KERNEL_LOOP(index, n) {
+    int f = index % frameSize;
+    int s = (index / frameSize) % nInputFrame;
+    int sample = sample0 + index / (frameSize * nInputFrame);
+    int tStart = s < kW ? 0 : (s - kW) / dW + 1;
+    int tEnd = min(s / dW + 1, nOutputFrame);
+    float sum = 0;
+    for (int t = tStart; t < tEnd; t++) {
+      int r = sample * nOutputFrame + t - r0;
+      if (r >= 0 && r < nRows)
+        sum += gradColumns[(r * kW + s - t * dW) * frameSize + f];
+    }
+    gradInput[(sample * nInputFrame + s) * frameSize + f] += sum;
+  }
+}
+
+// output[r][f] = bias[f], for the GEMM to accumulate onto
+__global__ void cunn_TemporalConvolution_fillBias(
+    const int n, float *output, const float *bias, const int outputFrameSize) {
+  CUDA_KERNEL_LOOP(index, n) {
+    output[index] = bias[index % outputFrameSize];
+  }
+}
+
+#define BIAS_TILE 32
+#define BIAS_ROWS 8
+// Fewest rows a block of the first bias pass sums
+#define BIAS_SLICE_ROWS 256
+
+// partial[slice][f] = sum_r gradOutput[r][f] over the sliceRows rows of the
+// slice; block (BIAS_TILE, BIAS_ROWS) at (x, slice) covers BIAS_TILE features,
+// its rows of threads stride over the slice
+__global__ void cunn_TemporalConvolution_biasPartial(
+    const float *gradOutput, float *partial, const int nRows, const int sliceRows,
+    const int outputFrameSize) {
+  __shared__ float rowSums[BIAS_ROWS][BIAS_TILE];
+  int f = hipBlockIdx_x * BIAS_TILE + hipThreadIdx_x;
+  int r0 = hipBlockIdx_y * sliceRows;
+  int r1 = min(r0 + sliceRows, nRows);
+  float sum = 0;
+  if (f < outputFrameSize) {
+    for (int r = r0 + hipThreadIdx_y; r < r1; r += BIAS_ROWS)
+      sum += gradOutput[r * outputFrameSize + f];
+  }
+  rowSums[hipThreadIdx_y][hipThreadIdx_x] = sum;
+  __syncthreads();
+  if (hipThreadIdx_y == 0 && f < outputFrameSize) {
+    for (int y = 1; y < BIAS_ROWS; y++)
+      sum += rowSums[y][hipThreadIdx_x];
+    partial[hipBlockIdx_y * outputFrameSize + f] = sum;
+  }
+}
+
+// gradBias[f] += scale * sum_slice partial[slice][f], summed in slice order
+// so the result does not depend on how the blocks were scheduled
+__global__ void cunn_TemporalConvolution_accGradBias(
+    const int n, const float *partial, float *gradBias, const int slices,
+    const float scale) {
+  CUDA_KERNEL_LOOP(f, n) {
+    float sum = 0;
+    for (int slice = 0; slice < slices; slice++)
+      sum += partial[slice * n + f];
+    gradBias[f] += scale * sum;
+  }
+}
+
+static void THNN_CudaTemporalConvolution_shapeCheck(
+    THCState *state, THCudaTensor *input, int kW, int dW, int *nBatch,
+    int *nInputFrame, int *frameSize) {
+  THArgCheck(input->nDimension == 2 || input->nDimension == 3, 2,
+             "2D or 3D(batch mode) tensor expected");
+  THArgCheck(kW > 0 && dW > 0, 5, "kernel size and stride should be greater than zero");
+  int dimS = input->nDimension == 3 ? 1 : 0;
+  *nBatch = input->nDimension == 3 ? input->size[0] : 1;
+  *nInputFrame = input->size[dimS];
+  *frameSize = input->size[dimS + 1];
+  THArgCheck(*nInputFrame >= kW, 2, "input sequence smaller than kernel size");
+}
+
 void THNN_CudaTemporalConvolution_updateOutput(
           THCState *state,
           THCudaTensor *input,
@@ -10,124 +127,60 @@ void THNN_CudaTemporalConvolution_updateOutput(
           int kW, int dW,
           int inputFrameSize,
           int outputFrameSize) {
-
-  THCudaTensor *outputWindow, *inputWindow;
-  int nInputFrame, nOutputFrame;
-  long k, i;
-
-  int dimS = 0; // sequence dimension
-  int dimF = 1; // feature dimension
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
 
   THCUNN_assertSameGPU(state, 4, input, output, weight, bias);
-  THArgCheck( input->nDimension == 2 || input->nDimension == 3, 2, "2D or 3D(batch mode) tensor expected");
+  int nBatch, nInputFrame, frameSize;
+  THNN_CudaTemporalConvolution_shapeCheck(state, input, kW, dW, &nBatch, &nInputFrame, &frameSize);
+  THArgCheck(frameSize == inputFrameSize, 2, "invalid input frame size");
 
-  if (input->nDimension == 3)
-  {
-    dimS = 1;
-    dimF = 2;
-  }
-  THArgCheck( input->size[dimF] == inputFrameSize, 2, "invalid input frame size");
-  THArgCheck( input->size[dimS] >= kW, 2, "input sequence smaller than kernel size");
+  int nOutputFrame = (nInputFrame - kW) / dW + 1;
+  long nRows = (long)nBatch * nOutputFrame;
+  long rowSize = (long)kW * inputFrameSize;
 
   input = THCudaTensor_newContiguous(state, input);
-  outputWindow = THCudaTensor_new(state);
-  inputWindow = THCudaTensor_new(state);
-
-  nInputFrame = input->size[dimS];
-  nOutputFrame = (nInputFrame - kW) / dW + 1;
-
+  weight = THCudaTensor_newContiguous(state, weight);
   if (input->nDimension == 2)
-  {
-    THCudaTensor_resize2d(state, output,
-                          nOutputFrame,
-                          outputFrameSize);
-
-    /* bias first */
-    for(k = 0; k < nOutputFrame; k++)
-    {
-      THCudaTensor_select(state, outputWindow, output, 0, k);
-      THCudaTensor_copy(state, outputWindow, bias);
-    }
-
-
-    /* ouch */
-    for(k = 0; nOutputFrame > 0; k++)
-    {
-      long outputFrameStride = (kW-1)/dW+1;
-      long inputFrameStride = outputFrameStride*dW;
-      long nFrame = (nInputFrame-k*dW-kW)/inputFrameStride + 1;
-      nOutputFrame -= nFrame;
-
-      THCudaTensor_setStorage2d(state, inputWindow, input->storage,
-                              input->storageOffset+k*dW*input->size[1],
-                              nFrame, inputFrameStride*input->size[1],
-                              kW*input->size[1], 1);
+    THCudaTensor_resize2d(state, output, nOutputFrame, outputFrameSize);
+  else
+    THCudaTensor_resize3d(state, output, nBatch, nOutputFrame, outputFrameSize);
 
-      THCudaTensor_setStorage2d(state, outputWindow, output->storage,
-                              output->storageOffset + k*output->size[1],
-                              nFrame, outputFrameStride*output->size[1],
-                              output->size[1], 1);
+  hipStream_t stream = THCState_getCurrentStream(state);
+  long n = nRows * outputFrameSize;
+  hipLaunchKernelGGL((cunn_TemporalConvolution_fillBias), dim3(GET_BLOCKS(n)), dim3(CUDA_NUM_THREADS), 0, stream,
+      n, THCudaTensor_data(state, output), THCudaTensor_data(state, bias), outputFrameSize);
 
-      THCudaTensor_transpose(state, weight, NULL, 0, 1);
-      THCudaTensor_addmm(state, outputWindow, 1, outputWindow, 1, inputWindow, weight);
-      THCudaTensor_transpose(state, weight, NULL, 0, 1);
-    }
-  }
-  else
+  long chunk = temporalConvolution_chunkRows(nRows, rowSize);
+  THCudaTensor *columns = THCudaTensor_new(state);
   {
-    THCudaTensor *outputSample = THCudaTensor_new(state);
-    THCudaTensor *inputSample = THCudaTensor_new(state);
-    int nBatchFrame = input->size[0];
-
-    THCudaTensor_resize3d(state, output,
-                          nBatchFrame,
-                          nOutputFrame,
-                          outputFrameSize);
-
-    for(i = 0; i < nBatchFrame; i++)
-    {
-      THCudaTensor_select(state, outputSample, output, 0, i);
-      THCudaTensor_select(state, inputSample, input, 0, i);
-      long nOutputSampleFrame = nOutputFrame;
-
-      /* bias first */
-      for(k = 0; k < nOutputFrame; k++)
-      {
-        THCudaTensor_select(state, outputWindow, outputSample, 0, k);
-        THCudaTensor_copy(state, outputWindow, bias);
-      }
-
-      /* ouch */
-      for(k = 0; nOutputSampleFrame > 0; k++)
-      {
-        long outputFrameStride = (kW-1)/dW+1;
-        long inputFrameStride = outputFrameStride*dW;
-        long nFrame = (nInputFrame-k*dW-kW)/inputFrameStride + 1;
-        nOutputSampleFrame -= nFrame;
-
-        THCudaTensor_setStorage2d(state, inputWindow, inputSample->storage,
-                                inputSample->storageOffset+k*dW*inputSample->size[1],
-                                nFrame, inputFrameStride*inputSample->size[1],
-                                kW*inputSample->size[1], 1);
-
-        THCudaTensor_setStorage2d(state, outputWindow, outputSample->storage,
-                                outputSample->storageOffset + k*outputSample->size[1],
-                                nFrame, outputFrameStride*outputSample->size[1],
-                                outputSample->size[1], 1);
-
-        THCudaTensor_transpose(state, weight, NULL, 0, 1);
-        THCudaTensor_addmm(state, outputWindow, 1, outputWindow, 1, inputWindow, weight);
-        THCudaTensor_transpose(state, weight, NULL, 0, 1);
-      }
+    THCUNNWorkspace workspace(state);
+    workspace.borrow2d(columns, chunk, rowSize);
+    for (long r0 = 0; r0 < nRows; r0 += chunk) {
+      long rows = nRows - r0 < chunk ? nRows - r0 : chunk;
+      n = rows * rowSize;
+      hipLaunchKernelGGL((cunn_TemporalConvolution_unfold), dim3(GET_BLOCKS(n)), dim3(CUDA_NUM_THREADS), 0, stream,
+          n, THCudaTensor_data(state, input), THCudaTensor_data(state, columns), r0,
+          nOutputFrame, nInputFrame, rowSize, inputFrameSize, dW);
+
+      // output[r0:r0+rows] += columns * weight^T
+      THCudaBlas_Sgemm(
+          state,
+          't', 'n',
+          outputFrameSize, rows, rowSize,
+          1,
+          THCudaTensor_data(state, weight), rowSize,
+          THCudaTensor_data(state, columns), rowSize,
+          1,
+          THCudaTensor_data(state, output) + r0 * outputFrameSize, outputFrameSize
+      );
     }
-    THCudaTensor_free(state, outputSample);
-    THCudaTensor_free(state, inputSample);
   }
+  THCudaCheck(hipGetLastError());
 
-  THCudaTensor_free(state, outputWindow);
-  THCudaTensor_free(state, inputWindow);
+  THCudaTensor_free(state, columns);
+  THCudaTensor_free(state, weight);
   THCudaTensor_free(state, input);
-
 }
 
 void THNN_CudaTemporalConvolution_updateGradInput(
@@ -137,96 +190,58 @@ void THNN_CudaTemporalConvolution_updateGradInput(
           THCudaTensor *gradInput,
           THCudaTensor *weight,
           int kW, int dW) {
-
-  long nInputFrame;
-  long nOutputFrame;
-
-  THCudaTensor *gradOutputWindow;
-  THCudaTensor *gradInputWindow;
-  long k, i;
-
-  int dimS = 0; // sequence dimension
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
 
   THCUNN_assertSameGPU(state, 4, input, gradOutput, weight, gradInput);
+  int nBatch, nInputFrame, frameSize;
+  THNN_CudaTemporalConvolution_shapeCheck(state, input, kW, dW, &nBatch, &nInputFrame, &frameSize);
 
-  if (gradOutput->nDimension == 3)
-  {
-    dimS = 1;
-  }
-
-  nInputFrame = input->size[dimS];
-  nOutputFrame = gradOutput->size[dimS];
-
-
-  /* Not necessary with partial backprop: */
-  gradOutputWindow = THCudaTensor_new(state);
-  gradInputWindow = THCudaTensor_new(state);
+  int nOutputFrame = (nInputFrame - kW) / dW + 1;
+  int outputFrameSize = weight->size[0];
+  long nRows = (long)nBatch * nOutputFrame;
+  long rowSize = (long)kW * frameSize;
 
+  gradOutput = THCudaTensor_newContiguous(state, gradOutput);
+  weight = THCudaTensor_newContiguous(state, weight);
   THCudaTensor_resizeAs(state, gradInput, input);
   THCudaTensor_zero(state, gradInput);
 
-  if (gradOutput->nDimension == 2)
-  {
-    /* ouch */
-    for(k = 0; nOutputFrame > 0; k++)
-    {
-      long outputFrameStride = (kW-1)/dW+1;
-      long inputFrameStride = outputFrameStride*dW;
-      long nFrame = (nInputFrame-k*dW-kW)/inputFrameStride + 1;
-      nOutputFrame -= nFrame;
-
-      THCudaTensor_setStorage2d(state, gradOutputWindow, gradOutput->storage,
-                              gradOutput->storageOffset + k*gradOutput->size[1],
-                              nFrame, outputFrameStride*gradOutput->size[1],
-                              gradOutput->size[1], 1);
-
-      THCudaTensor_setStorage2d(state, gradInputWindow, gradInput->storage,
-                              gradInput->storageOffset+k*dW*gradInput->size[1],
-                              nFrame, inputFrameStride*gradInput->size[1],
-                              kW*gradInput->size[1], 1);
-
-      THCudaTensor_addmm(state, gradInputWindow, 1, gradInputWindow, 1, gradOutputWindow, weight);
-    }
-  }
-  else
+  hipStream_t stream = THCState_getCurrentStream(state);
+  long chunk = temporalConvolution_chunkRows(nRows, rowSize);
+  THCudaTensor *gradColumns = THCudaTensor_new(state);
   {
-    THCudaTensor *gradOutputSample = THCudaTensor_new(state);
-    THCudaTensor *gradInputSample = THCudaTensor_new(state);
-    long nBatchFrame = input->size[0];
-    for(i = 0; i < nBatchFrame; i++)
-    {
-      THCudaTensor_select(state, gradOutputSample, gradOutput, 0, i);
-      THCudaTensor_select(state, gradInputSample, gradInput, 0, i);
-      long nOutputSampleFrame = nOutputFrame;
-
-      /* ouch */
-      for(k = 0; nOutputSampleFrame > 0; k++)
-      {
-        long outputFrameStride = (kW-1)/dW+1;
-        long inputFrameStride = outputFrameStride*dW;
-        long nFrame = (nInputFrame-k*dW-kW)/inputFrameStride + 1;
-        nOutputSampleFrame -= nFrame;
-
-        THCudaTensor_setStorage2d(state, gradOutputWindow, gradOutputSample->storage,
-                                gradOutputSample->storageOffset + k*gradOutputSample->size[1],
-                                nFrame, outputFrameStride*gradOutputSample->size[1],
-                                gradOutputSample->size[1], 1);
-
-        THCudaTensor_setStorage2d(state, gradInputWindow, gradInputSample->storage,
-                                gradInputSample->storageOffset+k*dW*gradInputSample->size[1],
-                                nFrame, inputFrameStride*gradInputSample->size[1],
-                                kW*gradInputSample->size[1], 1);
-
-        THCudaTensor_addmm(state, gradInputWindow, 1, gradInputWindow, 1, gradOutputWindow, weight);
-      }
+    THCUNNWorkspace workspace(state);
+    workspace.borrow2d(gradColumns, chunk, rowSize);
+    for (long r0 = 0; r0 < nRows; r0 += chunk) {
+      long rows = nRows - r0 < chunk ? nRows - r0 : chunk;
+
+      // gradColumns = gradOutput[r0:r0+rows] * weight
+      THCudaBlas_Sgemm(
+          state,
+          'n', 'n',
+          rowSize, rows, outputFrameSize,
+          1,
+          THCudaTensor_data(state, weight), rowSize,
+          THCudaTensor_data(state, gradOutput) + r0 * outputFrameSize, outputFrameSize,
+          0,
+          THCudaTensor_data(state, gradColumns), rowSize
+      );
+
+      // only the samples these rows belong to receive gradients
+      long sample0 = r0 / nOutputFrame;
+      long sample1 = (r0 + rows - 1) / nOutputFrame;
+      long n = (sample1 - sample0 + 1) * nInputFrame * frameSize;
+      hipLaunchKernelGGL((cunn_TemporalConvolution_fold), dim3(GET_BLOCKS(n)), dim3(CUDA_NUM_THREADS), 0, stream,
+          n, THCudaTensor_data(state, gradColumns), THCudaTensor_data(state, gradInput),
+          sample0, r0, rows, nOutputFrame, nInputFrame, frameSize, kW, dW);
     }
-    THCudaTensor_free(state, gradOutputSample);
-    THCudaTensor_free(state, gradInputSample);
   }
+  THCudaCheck(hipGetLastError());
 
-  THCudaTensor_free(state, gradOutputWindow);
-  THCudaTensor_free(state, gradInputWindow);
-
+  THCudaTensor_free(state, gradColumns);
+  THCudaTensor_free(state, weight);
+  THCudaTensor_free(state, gradOutput);
 }
 
 void THNN_CudaTemporalConvolution_accGradParameters(
@@ -237,109 +252,83 @@ void THNN_CudaTemporalConvolution_accGradParameters(
           THCudaTensor *gradBias,
           int kW, int dW,
           float scale) {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
 
-  long nInputFrame;
-  long nOutputFrame;
-
-  THCudaTensor *gradOutputWindow;
-  THCudaTensor *inputWindow;
-  long k, i;
-
-  int dimS = 0; // sequence dimension
-
-  if (gradOutput->nDimension == 3)
-  {
-    dimS = 1;
-  }
+  int nBatch, nInputFrame, frameSize;
+  THNN_CudaTemporalConvolution_shapeCheck(state, input, kW, dW, &nBatch, &nInputFrame, &frameSize);
+  THArgCheck(THCudaTensor_isContiguous(state, gradWeight), 4, "gradWeight needs to be contiguous");
+  THArgCheck(THCudaTensor_isContiguous(state, gradBias), 5, "gradBias needs to be contiguous");
 
-  nInputFrame = input->size[dimS];
-  nOutputFrame = gradOutput->size[dimS];
+  int nOutputFrame = (nInputFrame - kW) / dW + 1;
+  int outputFrameSize = gradWeight->size[0];
+  long nRows = (long)nBatch * nOutputFrame;
+  long rowSize = (long)kW * frameSize;
 
-  /* Not necessary with partial backprop: */
   input = THCudaTensor_newContiguous(state, input);
-  gradOutputWindow = THCudaTensor_new(state);
-  inputWindow = THCudaTensor_new(state);
-
-  if (input->nDimension == 2)
+  gradOutput = THCudaTensor_newContiguous(state, gradOutput);
+
+  hipStream_t stream = THCState_getCurrentStream(state);
+
+  // The rows are split into slices that give every compute unit a few
+  // blocks, each holding at least BIAS_SLICE_ROWS rows; a second pass adds
+  // up the slices
+  dim3 biasBlock(BIAS_TILE, BIAS_ROWS);
+  dim3 biasGrid((outputFrameSize + BIAS_TILE - 1) / BIAS_TILE);
+  long wanted = 4L * THCState_getCurrentDeviceProperties(state)->multiProcessorCount;
+  long slices = (wanted + biasGrid.x - 1) / biasGrid.x;
+  long maxSlices = (nRows + BIAS_SLICE_ROWS - 1) / BIAS_SLICE_ROWS;
+  if (slices > maxSlices)
+    slices = maxSlices;
+  if (slices < 1)
+    slices = 1;
+  long sliceRows = (nRows + slices - 1) / slices;
+  slices = (nRows + sliceRows - 1) / sliceRows;
+  biasGrid.y = slices;
+
+  long chunk = temporalConvolution_chunkRows(nRows, rowSize);
+  THCudaTensor *columns = THCudaTensor_new(state);
+  THCudaTensor *biasPartial = THCudaTensor_new(state);
   {
-    /* bias first */
-    for(k = 0; k < nOutputFrame; k++)
-    {
-      THCudaTensor_select(state, gradOutputWindow, gradOutput, 0, k);
-      THCudaTensor_cadd(state, gradBias, gradBias, scale, gradOutputWindow);
+    THCUNNWorkspace workspace(state);
+    workspace.borrow2d(biasPartial, slices, outputFrameSize);
+    hipLaunchKernelGGL((cunn_TemporalConvolution_biasPartial), dim3(biasGrid), dim3(biasBlock), 0, stream,
+        THCudaTensor_data(state, gradOutput), THCudaTensor_data(state, biasPartial),
+        nRows, sliceRows, outputFrameSize);
+    hipLaunchKernelGGL((cunn_TemporalConvolution_accGradBias), dim3(GET_BLOCKS(outputFrameSize)), dim3(CUDA_NUM_THREADS), 0, stream,
+        outputFrameSize, THCudaTensor_data(state, biasPartial), THCudaTensor_data(state, gradBias),
+        slices, scale);
+
+    workspace.borrow2d(columns, chunk, rowSize);
+    for (long r0 = 0; r0 < nRows; r0 += chunk) {
+      long rows = nRows - r0 < chunk ? nRows - r0 : chunk;
+      long n = rows * rowSize;
+      hipLaunchKernelGGL((cunn_TemporalConvolution_unfold), dim3(GET_BLOCKS(n)), dim3(CUDA_NUM_THREADS), 0, stream,
+          n, THCudaTensor_data(state, input), THCudaTensor_data(state, columns), r0,
+          nOutputFrame, nInputFrame, rowSize, frameSize, dW);
+
+      // gradWeight += scale * gradOutput[r0:r0+rows]^T * columns
+      THCudaBlas_Sgemm(
+          state,
+          'n', 't',
+          rowSize, outputFrameSize, rows,
+          scale,
+          THCudaTensor_data(state, columns), rowSize,
+          THCudaTensor_data(state, gradOutput) + r0 * outputFrameSize, outputFrameSize,
+          1,
+          THCudaTensor_data(state, gradWeight), rowSize
+      );
     }
-
-    /* ouch */
-    for(k = 0; nOutputFrame > 0; k++)
-    {
-      long outputFrameStride = (kW-1)/dW+1;
-      long inputFrameStride = outputFrameStride*dW;
-      long nFrame = (nInputFrame-k*dW-kW)/inputFrameStride + 1;
-      nOutputFrame -= nFrame;
-
-      THCudaTensor_setStorage2d(state, inputWindow, input->storage,
-                              input->storageOffset+k*dW*input->size[1],
-                              nFrame, inputFrameStride*input->size[1],
-                              kW*input->size[1], 1);
-
-      THCudaTensor_setStorage2d(state, gradOutputWindow, gradOutput->storage,
-                              gradOutput->storageOffset + k*gradOutput->size[1],
-                              nFrame, outputFrameStride*gradOutput->size[1],
-                              gradOutput->size[1], 1);
-
-      THCudaTensor_transpose(state, gradOutputWindow, NULL, 0, 1);
-      THCudaTensor_addmm(state, gradWeight, 1, gradWeight, scale, gradOutputWindow, inputWindow);
-      THCudaTensor_transpose(state, gradOutputWindow, NULL, 0, 1);
-    }
-  }
-  else
-  {
-    THCudaTensor *gradOutputSample = THCudaTensor_new(state);
-    THCudaTensor *inputSample = THCudaTensor_new(state);
-    long nBatchFrame = input->size[0];
-
-    for(i = 0; i < nBatchFrame; i++)
-    {
-      THCudaTensor_select(state, gradOutputSample, gradOutput, 0, i);
-      THCudaTensor_select(state, inputSample, input, 0, i);
-      long nOutputSampleFrame = nOutputFrame;
-
-      /* bias first */
-      for(k = 0; k < nOutputFrame; k++)
-      {
-        THCudaTensor_select(state, gradOutputWindow, gradOutputSample, 0, k);
-        THCudaTensor_cadd(state, gradBias, gradBias, scale, gradOutputWindow);
-      }
-
-      /* ouch */
-      for(k = 0; nOutputSampleFrame > 0; k++)
-      {
-        long outputFrameStride = (kW-1)/dW+1;
-        long inputFrameStride = outputFrameStride*dW;
-        long nFrame = (nInputFrame-k*dW-kW)/inputFrameStride + 1;
-        nOutputSampleFrame -= nFrame;
-
-        THCudaTensor_setStorage2d(state, inputWindow, inputSample->storage,
-                                inputSample->storageOffset+k*dW*inputSample->size[1],
-                                nFrame, inputFrameStride*inputSample->size[1],
-                                kW*inputSample->size[1], 1);
-
-        THCudaTensor_setStorage2d(state, gradOutputWindow, gradOutputSample->storage,
-                                gradOutputSample->storageOffset + k*gradOutputSample->size[1],
-                                nFrame, outputFrameStride*gradOutputSample->size[1],
-                                gradOutputSample->size[1], 1);
-
-        THCudaTensor_transpose(state, gradOutputWindow, NULL, 0, 1);
-        THCudaTensor_addmm(state, gradWeight, 1, gradWeight, scale, gradOutputWindow, inputWindow);
-        THCudaTensor_transpose(state, gradOutputWindow, NULL, 0, 1);
-      }
-    }
-    THCudaTensor_free(state, gradOutputSample);
-    THCudaTensor_free(state, inputSample);
   }
+  THCudaCheck(hipGetLastError());
 
-  THCudaTensor_free(state, gradOutputWindow);
-  THCudaTensor_free(state, inputWindow);
+  THCudaTensor_free(state, biasPartial);
+  THCudaTensor_free(state, columns);
+  THCudaTensor_free(state, gradOutput);
   THCudaTensor_free(state, input);
-
 }
+
+#undef BIAS_TILE
+#undef BIAS_ROWS
+#undef BIAS_SLICE_ROWS
+#undef TEMPORAL_COLUMNS_LIMIT
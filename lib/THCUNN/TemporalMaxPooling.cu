@@ -1,6 +1,7 @@
 #include "hip/hip_runtime.h"
 #include "THCUNN.h"
 #include "common.h"
+#include "wavefront.h"
 
 #define TEMPORAL_MAX_POOLING_THREADS 1024
 
@@ -81,6 +82,8 @@ void THNN_CudaTemporalMaxPooling_updateOutput(
           THCudaTensor *output,
           THCudaTensor *indices,
           int kW, int dW) {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
 
   int dimT = 0; // Temporal dimension
   int dimF = 1; // Feature dimension
@@ -128,9 +131,9 @@ void THNN_CudaTemporalMaxPooling_updateOutput(
   indices_data = THCudaTensor_data(state, indices);
 
   dim3 blocks(batch);
-  nthreads = (output_w / 32) * 32;
-  if (output_w % 32 > 0) {
-    nthreads += 32;
+  nthreads = (output_w / WAVEFRONT_SIZE) * WAVEFRONT_SIZE;
+  if (output_w % WAVEFRONT_SIZE > 0) {
+    nthreads += WAVEFRONT_SIZE;
   }
 
   if (nthreads > TEMPORAL_MAX_POOLING_THREADS) {
@@ -142,6 +145,7 @@ void THNN_CudaTemporalMaxPooling_updateOutput(
   }
 
   dim3 threads(nthreads);
+  THCUNN_PROFILE_LAUNCH(blocks, threads);
   hipLaunchKernelGGL((cunn_TemporalMaxPooling_updateOutputKernel), dim3(blocks), dim3(threads), 0, THCState_getCurrentStream(state) , 
       input_data, output_data, indices_data, input_w, input_n, output_w, kW, dW);
   THCudaCheck(hipGetLastError());
@@ -156,6 +160,8 @@ void THNN_CudaTemporalMaxPooling_updateGradInput(
           THCudaTensor *gradInput,
           THCudaTensor *indices,
           int kW, int dW) {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
 
   int dimT = 0; // Temporal dimension
   int dimF = 1; // Feature dimension
@@ -195,9 +201,9 @@ void THNN_CudaTemporalMaxPooling_updateGradInput(
   indices_data = THCudaTensor_data(state, indices);
 
   dim3 blocks(batch);
-  nthreads = (output_w / 32) * 32;
-  if (output_w % 32 > 0) {
-    nthreads += 32;
+  nthreads = (output_w / WAVEFRONT_SIZE) * WAVEFRONT_SIZE;
+  if (output_w % WAVEFRONT_SIZE > 0) {
+    nthreads += WAVEFRONT_SIZE;
   }
 
   if (nthreads > TEMPORAL_MAX_POOLING_THREADS) {
@@ -210,9 +216,11 @@ void THNN_CudaTemporalMaxPooling_updateGradInput(
 
   dim3 threads(nthreads);
   if (kW <= dW) {
+    THCUNN_PROFILE_LAUNCH(blocks, threads);
     hipLaunchKernelGGL((cunn_TemporalMaxPooling_updateGradInputKernel), dim3(blocks), dim3(threads), 0, THCState_getCurrentStream(state) , 
         gradInput_data, gradOutput_data, indices_data, input_w, input_n, output_w, kW, dW);
   } else {
+    THCUNN_PROFILE_LAUNCH(blocks, threads);
     hipLaunchKernelGGL((cunn_TemporalMaxPooling_updateGradInputKernelAtomic), dim3(blocks), dim3(threads), 0, THCState_getCurrentStream(state) , 
         gradInput_data, gradOutput_data, indices_data, input_w, input_n, output_w, kW, dW);
   }
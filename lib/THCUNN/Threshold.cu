@@ -46,6 +46,8 @@ struct ThresholdUpdateOutputIP
 void THNN_CudaThreshold_updateOutput(THCState *state, THCudaTensor *input, THCudaTensor *output,
   double threshold, double val, bool inplace)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   THCUNN_assertSameGPU(state, 2, input, output);
 
   if (inplace)
@@ -107,6 +109,8 @@ struct ThresholdUpdateGradInputIP
 void THNN_CudaThreshold_updateGradInput(THCState *state, THCudaTensor *input, THCudaTensor *gradOutput,
   THCudaTensor *gradInput, double threshold, double val, bool inplace)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   THCUNN_assertSameGPU(state, 3, input, gradInput, gradOutput);
 
   if (inplace)
@@ -0,0 +1,101 @@
+#include "THCUNN.h"
+#include "common.h"
+#include "tuning.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <mutex>
+#include <sstream>
+
+static std::mutex tuning_mutex;
+static THCUNNTuningCache tuning_cache;
+static std::atomic<bool> tuning_isEnabled(true);
+static bool tuning_loaded = false;
+static std::string tuning_path;
+
+// Choices stay in memory unless $THCUNN_TUNING_CACHE names a file to keep
+// them in. Called with tuning_mutex held.
+static void tuning_init()
+{
+  if (tuning_loaded)
+    return;
+  tuning_loaded = true;
+  const char *env = getenv("THCUNN_TUNING_CACHE");
+  if (env && env[0]) {
+    tuning_path = env;
+    tuning_cache.load(tuning_path.c_str());
+  }
+}
+
+bool tuning_enabled()
+{
+  return tuning_isEnabled.load();
+}
+
+std::string tuning_device(THCState *state)
+{
+  hipDeviceProp_t *prop = THCState_getCurrentDeviceProperties(state);
+  std::ostringstream s;
+  s << prop->name << '/' << prop->multiProcessorCount;
+  return s.str();
+}
+
+bool tuning_lookup(const std::string &device, const char *kernel, long size, int candidates, int *choice)
+{
+  std::lock_guard<std::mutex> lock(tuning_mutex);
+  tuning_init();
+  return tuning_cache.lookup(device, kernel, size, candidates, choice);
+}
+
+void tuning_record(const std::string &device, const char *kernel, long size, int candidates, int choice)
+{
+  std::lock_guard<std::mutex> lock(tuning_mutex);
+  tuning_init();
+  tuning_cache.record(device, kernel, size, candidates, choice);
+  if (!tuning_path.empty() && !tuning_cache.save(tuning_path.c_str()))
+    fprintf(stderr, "THCUNN: could not write tuning cache %s\n", tuning_path.c_str());
+}
+
+void THNN_CudaTuning_setEnabled(THCState *state, bool enabled)
+{
+  tuning_isEnabled = enabled;
+}
+
+void THNN_CudaTuning_setCacheFile(THCState *state, const char *path)
+{
+  std::lock_guard<std::mutex> lock(tuning_mutex);
+  tuning_path = "";
+  tuning_loaded = path != NULL;
+  if (!path) {
+    tuning_init();
+  } else if (path[0]) {
+    tuning_path = path;
+    tuning_cache.load(path);
+  }
+}
+
+void THNN_CudaTuning_clear(THCState *state)
+{
+  std::lock_guard<std::mutex> lock(tuning_mutex);
+  tuning_cache.clear();
+}
+
+void THNN_CudaTuning_record(THCState *state, const char *device, const char *kernel,
+                            long size, int candidates, int choice)
+{
+  THArgCheck(choice >= 0 && choice < candidates, 6, "choice should index the candidates");
+  tuning_record(device, kernel, size, candidates, choice);
+}
+
+void THNN_CudaTuning_lookup(THCState *state, const char *device, const char *kernel,
+                            long size, int candidates, int *choice)
+{
+  if (!tuning_lookup(device, kernel, size, candidates, choice))
+    *choice = -1;
+}
+
+void THNN_CudaTuning_fastest(THCState *state, int n, const float *times, int *choice)
+{
+  *choice = THCUNNTuningCache::fastest(std::vector<float>(times, times + n));
+}
@@ -104,6 +104,8 @@ void THNN_CudaVolumetricAveragePooling_updateOutput(
   int kT, int kW, int kH,
   int dT, int dW, int dH)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   int batchSize;
   int inputSlices;
   int inputTime;
@@ -188,6 +190,7 @@ void THNN_CudaVolumetricAveragePooling_updateOutput(
               totalZ > 65535 ? 65535 : totalZ);
 
     float normFactor = 1.0f / static_cast<float>(kT * kH * kW);
+    THCUNN_PROFILE_LAUNCH(grid, block);
     switch (kW)
       {
         LAUNCH_UPDATE_OUTPUT_KERNEL_WIDTH(1);
@@ -320,6 +323,8 @@ void THNN_CudaVolumetricAveragePooling_updateGradInput(
   int kT, int kW, int kH,
   int dT, int dW, int dH)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   bool kernelsOverlap = (dT < kT) || (dH < kH) || (dW < kW);
 
   // Resize and initialize result tensor.
@@ -391,6 +396,7 @@ void THNN_CudaVolumetricAveragePooling_updateGradInput(
       dim3 grid(THCCeilDiv(inputWidth, static_cast<int>(block.x)),
                 THCCeilDiv(inputHeight, static_cast<int>(block.y)),
                 totalZ > 65535 ? 65535 : totalZ);
+      THCUNN_PROFILE_LAUNCH(grid, block);
       hipLaunchKernelGGL((cuda_VolumetricAveragePooling_updateGradInput_Stride1), dim3(grid), dim3(block), 0, 0, 
          cudaGradOutput, cudaGradInput, kT, kH, kW, 1.0f/(kT * kH * kW), offsetZ);
       THCudaCheck(hipGetLastError());
@@ -409,11 +415,13 @@ void THNN_CudaVolumetricAveragePooling_updateGradInput(
                 totalZ > 65535 ? 65535 : totalZ);
       if (kernelsOverlap)
         {
+          THCUNN_PROFILE_LAUNCH(grid, block);
           hipLaunchKernelGGL((cuda_VolumetricAveragePooling_updateGradInput_atomicAdd), dim3(grid), dim3(block), 0, 0, 
             cudaGradOutput, cudaGradInput, kT, kH, kW, dT, dH, dW, offsetZ);
         }
       else
         {
+          THCUNN_PROFILE_LAUNCH(grid, block);
           hipLaunchKernelGGL((cuda_VolumetricAveragePooling_updateGradInput), dim3(grid), dim3(block), 0, 0, 
              cudaGradOutput, cudaGradInput, kT, kH, kW, dT, dH, dW, offsetZ);
         }
@@ -1,6 +1,8 @@
 #include "hip/hip_runtime.h"
 #include "THCUNN.h"
+#include "workspace.h"
 #include "common.h"
+#include "implicit_gemm.h"
 
 // Kernel for fast unfold+copy
 // Borrowed from Theano
@@ -159,6 +161,8 @@ void THNN_CudaVolumetricConvolution_updateOutput(
   int dT, int dW, int dH,
   int padT, int padW, int padH)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   THCudaTensor *columns = finput;
   THCudaTensor *ones = fgradInput;
   THCUNN_assertSameGPU(state, 6, input, output, weight, bias, columns, ones);
@@ -200,79 +204,91 @@ void THNN_CudaVolumetricConvolution_updateOutput(
   THCudaTensor_resize5d(state, output, batchSize, nOutputPlane,
                         outputHeight, outputWidth, outputDepth);
 
-  // Resize temporary columns
-  THCudaTensor_resize2d(state, columns, nInputPlane*kW*kH*kT, outputDepth*outputHeight*outputWidth);
+  THCUNNWorkspace workspace(state);
+  ImplicitGemmChoice gemmChoice(state, "VolumetricConvolution_updateOutput");
 
-  // Define a buffer of ones, for bias accumulation
-  // Note: this buffer can be shared with other modules, it only ever gets increased,
-  // and always contains ones.
-  if (ones->nDimension != 3 || ones->size[0]*ones->size[1]*ones->size[2] < outputDepth*outputHeight*outputWidth)
+  // The columns are laid out over (height, width, depth) with the kernel
+  // taps (kT, kH, kW) along them, as in im3d2col
+  ConvGeometry geometry = convGeometry3d(batchSize, nInputPlane, nOutputPlane,
+                                         inputHeight, inputWidth, inputDepth,
+                                         outputHeight, outputWidth, outputDepth,
+                                         kT, kH, kW, padT, padH, padW, dT, dH, dW, 1, 1, 1);
+
+  if (THCudaTensor_isContiguous(state, input) && gemmChoice.use(geometry))
   {
-    // Resize plane and fill with ones...
-    THCudaTensor_resize3d(state, ones, outputHeight, outputWidth, outputDepth);
-    THCudaTensor_fill(state, ones, 1);
+    implicitGemm(state, ImplicitGemmForward(
+      geometry, THCudaTensor_data(state, input), THCudaTensor_data(state, weight),
+      THCudaTensor_data(state, bias), THCudaTensor_data(state, output)));
   }
+  else
+  {
+    // Resize temporary columns
+    workspace.borrow2d(columns, nInputPlane*kW*kH*kT, outputDepth*outputHeight*outputWidth);
 
-  // Helpers
-  THCudaTensor *input_n = THCudaTensor_new(state);
-  THCudaTensor *output_n = THCudaTensor_new(state);
+    // Define a buffer of ones, for bias accumulation
+    workspace.ones3d(ones, outputHeight, outputWidth, outputDepth);
 
-  // For each elt in batch, do:
-  for (int elt = 0; elt < batchSize; elt ++)
-  {
-    // Matrix mulitply per output:
-    THCudaTensor_select(state, input_n, input, 0, elt);
-    THCudaTensor_select(state, output_n, output, 0, elt);
-
-    // Do Bias first:
-    // M,N,K are dims of matrix A and B
-    // (see http://docs.nvidia.com/cuda/cublas/#cublas-lt-t-gt-gemm)
-    long m_ = nOutputPlane;
-    long n_ = outputDepth * outputHeight * outputWidth;
-    long k_ = 1;
-
-    // Do GEMM (note: this is a bit confusing because gemm assumes column-major matrices)
-    THCudaBlas_Sgemm(
-      state,
-      't', 'n',
-      n_, m_, k_,
-      1,
-      THCudaTensor_data(state, ones), k_,
-      THCudaTensor_data(state, bias), k_,
-      0,
-      THCudaTensor_data(state, output_n), n_
-    );
-
-    // Extract columns:
-    im3d2col(
-      THCState_getCurrentStream(state),
-      THCudaTensor_data(state, input_n),
-      nInputPlane, inputHeight, inputWidth, inputDepth, kT, kH, kW, padT, padH, padW, dT, dH, dW,
-      THCudaTensor_data(state, columns)
-    );
-
-    // M,N,K are dims of matrix A and B
-    // (see http://docs.nvidia.com/cuda/cublas/#cublas-lt-t-gt-gemm)
-    long m = weight->size[0];
-    long n = columns->size[1];
-    long k = weight->size[1]*weight->size[2]*weight->size[3]*weight->size[4];
-
-    // Do GEMM (note: this is a bit confusing because gemm assumes column-major matrices)
-    THCudaBlas_Sgemm(
-      state,
-      'n', 'n',
-      n, m, k,
-      1,
-      THCudaTensor_data(state, columns), n,
-      THCudaTensor_data(state, weight), k,
-      1,
-      THCudaTensor_data(state, output_n), n
-    );
-  }
+    // Helpers
+    THCudaTensor *input_n = THCudaTensor_new(state);
+    THCudaTensor *output_n = THCudaTensor_new(state);
 
-  // Free
-  THCudaTensor_free(state, input_n);
-  THCudaTensor_free(state, output_n);
+    // For each elt in batch, do:
+    for (int elt = 0; elt < batchSize; elt ++)
+    {
+      // Matrix mulitply per output:
+      THCudaTensor_select(state, input_n, input, 0, elt);
+      THCudaTensor_select(state, output_n, output, 0, elt);
+
+      // Do Bias first:
+      // M,N,K are dims of matrix A and B
+      // (see http://docs.nvidia.com/cuda/cublas/#cublas-lt-t-gt-gemm)
+      long m_ = nOutputPlane;
+      long n_ = outputDepth * outputHeight * outputWidth;
+      long k_ = 1;
+
+      // Do GEMM (note: this is a bit confusing because gemm assumes column-major matrices)
+      THCudaBlas_Sgemm(
+        state,
+        't', 'n',
+        n_, m_, k_,
+        1,
+        THCudaTensor_data(state, ones), k_,
+        THCudaTensor_data(state, bias), k_,
+        0,
+        THCudaTensor_data(state, output_n), n_
+      );
+
+      // Extract columns:
+      im3d2col(
+        THCState_getCurrentStream(state),
+        THCudaTensor_data(state, input_n),
+        nInputPlane, inputHeight, inputWidth, inputDepth, kT, kH, kW, padT, padH, padW, dT, dH, dW,
+        THCudaTensor_data(state, columns)
+      );
+
+      // M,N,K are dims of matrix A and B
+      // (see http://docs.nvidia.com/cuda/cublas/#cublas-lt-t-gt-gemm)
+      long m = weight->size[0];
+      long n = columns->size[1];
+      long k = weight->size[1]*weight->size[2]*weight->size[3]*weight->size[4];
+
+      // Do GEMM (note: this is a bit confusing because gemm assumes column-major matrices)
+      THCudaBlas_Sgemm(
+        state,
+        'n', 'n',
+        n, m, k,
+        1,
+        THCudaTensor_data(state, columns), n,
+        THCudaTensor_data(state, weight), k,
+        1,
+        THCudaTensor_data(state, output_n), n
+      );
+    }
+
+    // Free
+    THCudaTensor_free(state, input_n);
+    THCudaTensor_free(state, output_n);
+  }
 
   // Resize output
   if (batch == 0)
@@ -292,6 +308,8 @@ void THNN_CudaVolumetricConvolution_updateGradInput(
   int dT, int dW, int dH,
   int padT, int padW, int padH)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   THArgCheck(weight->nDimension == 5, 4,
     "5D weight tensor is expected (nOutputPlane x nInputPlane x kT x kH x kW)"
   );
@@ -331,53 +349,70 @@ void THNN_CudaVolumetricConvolution_updateGradInput(
   // Resize output
   THCudaTensor_resize5d(state, gradInput, batchSize, nInputPlane, inputHeight, inputWidth, inputDepth);
 
-  // Resize temporary columns
-  THCudaTensor_resize2d(state, gradColumns, nInputPlane*kH*kT*kW, outputDepth*outputHeight*outputWidth);
+  THCUNNWorkspace workspace(state);
+  ImplicitGemmChoice gemmChoice(state, "VolumetricConvolution_updateGradInput");
 
-  // Helpers
-  THCudaTensor *input_n = THCudaTensor_new(state);
-  THCudaTensor *gradInput_n = THCudaTensor_new(state);
-  THCudaTensor *gradOutput_n = THCudaTensor_new(state);
+  ConvGeometry geometry = convGeometry3d(batchSize, nInputPlane, nOutputPlane,
+                                         inputHeight, inputWidth, inputDepth,
+                                         outputHeight, outputWidth, outputDepth,
+                                         kT, kH, kW, padT, padH, padW, dT, dH, dW, 1, 1, 1);
 
-  // For each elt in batch, do:
-  for (int elt = 0; elt < batchSize; elt ++)
+  if (THCudaTensor_isContiguous(state, gradOutput) && gemmChoice.use(geometry))
   {
-    // Matrix mulitply per sample:
-    THCudaTensor_select(state, input_n, input, 0, elt);
-    THCudaTensor_select(state, gradInput_n, gradInput, 0, elt);
-    THCudaTensor_select(state, gradOutput_n, gradOutput, 0, elt);
-
-    // M,N,K are dims of matrix A and B
-    // (see http://docs.nvidia.com/cuda/cublas/#cublas-lt-t-gt-gemm)
-    long m = weight->size[1]*weight->size[2]*weight->size[3]*weight->size[4];
-    long n = gradColumns->size[1];
-    long k = weight->size[0];
-
-    // Do GEMM (note: this is a bit confusing because gemm assumes column-major matrices)
-    THCudaBlas_Sgemm(
-      state,
-      'n', 't',
-      n, m, k,
-      1,
-      THCudaTensor_data(state, gradOutput_n), n,
-      THCudaTensor_data(state, weight), m,
-      0,
-      THCudaTensor_data(state, gradColumns), n
-    );
-
-    // Unpack columns back into input:
-    col2im3d(
-      THCState_getCurrentStream(state),
-      THCudaTensor_data(state, gradColumns),
-      nInputPlane, inputHeight, inputWidth, inputDepth, kT, kH, kW, padT, padH, padW, dT, dH, dW,
-      THCudaTensor_data(state, gradInput_n)
-    );
+    implicitGemm(state, ImplicitGemmGradInput(
+      geometry, THCudaTensor_data(state, gradOutput), THCudaTensor_data(state, weight),
+      THCudaTensor_data(state, gradInput)));
   }
+  else
+  {
+    // Resize temporary columns
+    workspace.borrow2d(gradColumns, nInputPlane*kH*kT*kW, outputDepth*outputHeight*outputWidth);
+
+    // Helpers
+    THCudaTensor *input_n = THCudaTensor_new(state);
+    THCudaTensor *gradInput_n = THCudaTensor_new(state);
+    THCudaTensor *gradOutput_n = THCudaTensor_new(state);
+
+    // For each elt in batch, do:
+    for (int elt = 0; elt < batchSize; elt ++)
+    {
+      // Matrix mulitply per sample:
+      THCudaTensor_select(state, input_n, input, 0, elt);
+      THCudaTensor_select(state, gradInput_n, gradInput, 0, elt);
+      THCudaTensor_select(state, gradOutput_n, gradOutput, 0, elt);
+
+      // M,N,K are dims of matrix A and B
+      // (see http://docs.nvidia.com/cuda/cublas/#cublas-lt-t-gt-gemm)
+      long m = weight->size[1]*weight->size[2]*weight->size[3]*weight->size[4];
+      long n = gradColumns->size[1];
+      long k = weight->size[0];
+
+      // Do GEMM (note: this is a bit confusing because gemm assumes column-major matrices)
+      THCudaBlas_Sgemm(
+        state,
+        'n', 't',
+        n, m, k,
+        1,
+        THCudaTensor_data(state, gradOutput_n), n,
+        THCudaTensor_data(state, weight), m,
+        0,
+        THCudaTensor_data(state, gradColumns), n
+      );
+
+      // Unpack columns back into input:
+      col2im3d(
+        THCState_getCurrentStream(state),
+        THCudaTensor_data(state, gradColumns),
+        nInputPlane, inputHeight, inputWidth, inputDepth, kT, kH, kW, padT, padH, padW, dT, dH, dW,
+        THCudaTensor_data(state, gradInput_n)
+      );
+    }
 
-  // Free
-  THCudaTensor_free(state, input_n);
-  THCudaTensor_free(state, gradInput_n);
-  THCudaTensor_free(state, gradOutput_n);
+    // Free
+    THCudaTensor_free(state, input_n);
+    THCudaTensor_free(state, gradInput_n);
+    THCudaTensor_free(state, gradOutput_n);
+  }
 
   // Resize output
   if (batch == 0)
@@ -400,6 +435,8 @@ void THNN_CudaVolumetricConvolution_accGradParameters(
   int padT, int padW, int padH,
   float scale)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   THCudaTensor *columns = finput;
   THCudaTensor *ones = fgradInput;
   THCUNN_assertSameGPU(state, 6, input, gradOutput, gradWeight, gradBias, columns, ones);
@@ -438,76 +475,89 @@ void THNN_CudaVolumetricConvolution_accGradParameters(
   // Batch size + input planes
   long batchSize = input->size[0];
 
-  // Define a buffer of ones, for bias accumulation
-  if (ones->nDimension != 3 || ones->size[0]*ones->size[1]*ones->size[2] < outputDepth*outputHeight*outputWidth)
+  THCUNNWorkspace workspace(state);
+  ImplicitGemmChoice gemmChoice(state, "VolumetricConvolution_accGradParameters", true);
+
+  ConvGeometry geometry = convGeometry3d(batchSize, nInputPlane, nOutputPlane,
+                                         inputHeight, inputWidth, inputDepth,
+                                         outputHeight, outputWidth, outputDepth,
+                                         kT, kH, kW, padT, padH, padW, dT, dH, dW, 1, 1, 1);
+
+  if (THCudaTensor_isContiguous(state, input) && THCudaTensor_isContiguous(state, gradOutput) &&
+      gemmChoice.use(geometry))
   {
-    // Resize plane and fill with ones...
-    THCudaTensor_resize3d(state, ones, outputHeight, outputWidth, outputDepth);
-    THCudaTensor_fill(state, ones, 1);
+    implicitGemm(state, ImplicitGemmGradWeight(
+      geometry, THCudaTensor_data(state, input), THCudaTensor_data(state, gradOutput),
+      THCudaTensor_data(state, gradWeight), THCudaTensor_data(state, gradBias), scale));
   }
+  else
+  {
+    // Define a buffer of ones, for bias accumulation
+    workspace.ones3d(ones, outputHeight, outputWidth, outputDepth);
 
-  // Resize temporary columns
-  THCudaTensor_resize2d(state, columns, nInputPlane*kH*kT*kW, outputDepth*outputHeight*outputWidth);
+    // Resize temporary columns
+    workspace.borrow2d(columns, nInputPlane*kH*kT*kW, outputDepth*outputHeight*outputWidth);
 
-  // Helpers
-  THCudaTensor *input_n = THCudaTensor_new(state);
-  THCudaTensor *gradOutput_n = THCudaTensor_new(state);
+    // Helpers
+    THCudaTensor *input_n = THCudaTensor_new(state);
+    THCudaTensor *gradOutput_n = THCudaTensor_new(state);
 
-  // For each elt in batch, do:
-  for (int elt = 0; elt < batchSize; elt ++)
-  {
-    // Matrix mulitply per output:
-    THCudaTensor_select(state, input_n, input, 0, elt);
-    THCudaTensor_select(state, gradOutput_n, gradOutput, 0, elt);
-
-    // Extract columns:
-    im3d2col(
-      THCState_getCurrentStream(state),
-      THCudaTensor_data(state, input_n),
-      nInputPlane, inputHeight, inputWidth, inputDepth, kT, kH, kW, padT, padH, padW, dT, dH, dW,
-      THCudaTensor_data(state, columns)
-    );
-
-    // M,N,K are dims of matrix A and B
-    // (see http://docs.nvidia.com/cuda/cublas/#cublas-lt-t-gt-gemm)
-    long m = gradWeight->size[0];
-    long n = gradWeight->size[1]*gradWeight->size[2]*gradWeight->size[3]*gradWeight->size[4];
-    long k = columns->size[1];
-
-    // Do GEMM (note: this is a bit confusing because gemm assumes column-major matrices)
-    THCudaBlas_Sgemm(
-      state,
-      't', 'n',
-      n, m, k,
-      scale,
-      THCudaTensor_data(state, columns), k,
-      THCudaTensor_data(state, gradOutput_n), k,
-      1,
-      THCudaTensor_data(state, gradWeight), n
-    );
-
-    // Do Bias:
-    // M,N,K are dims of matrix A and B
-    // (see http://docs.nvidia.com/cuda/cublas/#cublas-lt-t-gt-gemm)
-    long m_ = nOutputPlane;
-    long k_ = outputDepth * outputHeight * outputWidth;
-
-    // Do GEMV (note: this is a bit confusing because gemv assumes column-major matrices)
-    THCudaBlas_Sgemv(
-      state,
-      't',
-      k_, m_,
-      scale,
-      THCudaTensor_data(state, gradOutput_n), k_,
-      THCudaTensor_data(state, ones), 1,
-      1,
-      THCudaTensor_data(state, gradBias), 1
-    );
-  }
+    // For each elt in batch, do:
+    for (int elt = 0; elt < batchSize; elt ++)
+    {
+      // Matrix mulitply per output:
+      THCudaTensor_select(state, input_n, input, 0, elt);
+      THCudaTensor_select(state, gradOutput_n, gradOutput, 0, elt);
+
+      // Extract columns:
+      im3d2col(
+        THCState_getCurrentStream(state),
+        THCudaTensor_data(state, input_n),
+        nInputPlane, inputHeight, inputWidth, inputDepth, kT, kH, kW, padT, padH, padW, dT, dH, dW,
+        THCudaTensor_data(state, columns)
+      );
+
+      // M,N,K are dims of matrix A and B
+      // (see http://docs.nvidia.com/cuda/cublas/#cublas-lt-t-gt-gemm)
+      long m = gradWeight->size[0];
+      long n = gradWeight->size[1]*gradWeight->size[2]*gradWeight->size[3]*gradWeight->size[4];
+      long k = columns->size[1];
+
+      // Do GEMM (note: this is a bit confusing because gemm assumes column-major matrices)
+      THCudaBlas_Sgemm(
+        state,
+        't', 'n',
+        n, m, k,
+        scale,
+        THCudaTensor_data(state, columns), k,
+        THCudaTensor_data(state, gradOutput_n), k,
+        1,
+        THCudaTensor_data(state, gradWeight), n
+      );
+
+      // Do Bias:
+      // M,N,K are dims of matrix A and B
+      // (see http://docs.nvidia.com/cuda/cublas/#cublas-lt-t-gt-gemm)
+      long m_ = nOutputPlane;
+      long k_ = outputDepth * outputHeight * outputWidth;
+
+      // Do GEMV (note: this is a bit confusing because gemv assumes column-major matrices)
+      THCudaBlas_Sgemv(
+        state,
+        't',
+        k_, m_,
+        scale,
+        THCudaTensor_data(state, gradOutput_n), k_,
+        THCudaTensor_data(state, ones), 1,
+        1,
+        THCudaTensor_data(state, gradBias), 1
+      );
+    }
 
-  // Free
-  THCudaTensor_free(state, input_n);
-  THCudaTensor_free(state, gradOutput_n);
+    // Free
+    THCudaTensor_free(state, input_n);
+    THCudaTensor_free(state, gradOutput_n);
+  }
 
   // Resize
   if (batch == 0)
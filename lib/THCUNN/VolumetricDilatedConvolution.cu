@@ -1,4 +1,5 @@
 #include "THCUNN.h"
+#include "workspace.h"
 #include "common.h"
 #include "vol2col.h"
 
@@ -15,6 +16,8 @@ void THNN_CudaVolumetricDilatedConvolution_updateOutput(
   int dT, int dW, int dH,
   int padT, int padW, int padH,
   int dilationT, int dilationW, int dilationH) {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
 
   THCUNN_assertSameGPU(state, 5, input, output, weight, columns, ones);
   if (bias) {
@@ -57,17 +60,13 @@ void THNN_CudaVolumetricDilatedConvolution_updateOutput(
   // Resize output
   THCudaTensor_resize5d(state, output, batchSize, nOutputPlane, outputDepth, outputHeight, outputWidth);
 
+  THCUNNWorkspace workspace(state);
+
   // Resize temporary columns
-  THCudaTensor_resize2d(state, columns, nInputPlane*kT*kW*kH, outputDepth*outputHeight*outputWidth);
+  workspace.borrow2d(columns, nInputPlane*kT*kW*kH, outputDepth*outputHeight*outputWidth);
 
   // Define a buffer of ones, for bias accumulation
-  // Note: this buffer can be shared with other modules, it only ever gets increased,
-  // and always contains ones.
-  if (ones->nDimension != 2 || ones->size[0]*ones->size[1]*ones->size[2] < outputDepth*outputHeight*outputWidth) {
-    // Resize plane and fill with ones...
-    THCudaTensor_resize3d(state, ones, outputDepth, outputHeight, outputWidth);
-    THCudaTensor_fill(state, ones, 1);
-  }
+  workspace.ones3d(ones, outputDepth, outputHeight, outputWidth);
 
   // Helpers
   THCudaTensor *input_n = THCudaTensor_new(state);
@@ -153,6 +152,8 @@ void THNN_CudaVolumetricDilatedConvolution_updateGradInput(
   int dT, int dW, int dH,
   int padT, int padW, int padH,
   int dilationT, int dilationW, int dilationH) {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
 
   THCUNN_assertSameGPU(state, 5, input, gradOutput, weight,
                                  gradColumns, gradInput);
@@ -187,8 +188,10 @@ void THNN_CudaVolumetricDilatedConvolution_updateGradInput(
   // Resize output
   THCudaTensor_resize5d(state, gradInput, batchSize, nInputPlane, inputDepth, inputHeight, inputWidth);
 
+  THCUNNWorkspace workspace(state);
+
   // Resize temporary columns
-  THCudaTensor_resize2d(state, gradColumns, nInputPlane*kT*kW*kH, outputDepth*outputHeight*outputWidth);
+  workspace.borrow2d(gradColumns, nInputPlane*kT*kW*kH, outputDepth*outputHeight*outputWidth);
 
   // Helpers
   THCudaTensor *gradInput_n = THCudaTensor_new(state);
@@ -254,6 +257,8 @@ void THNN_CudaVolumetricDilatedConvolution_accGradParameters(
   int padT, int padW, int padH,
   int dilationT, int dilationW, int dilationH,
   float scale) {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
 
   THCUNN_assertSameGPU(state, 5, input, gradOutput, gradWeight, columns, ones);
   if (gradBias) {
@@ -287,15 +292,13 @@ void THNN_CudaVolumetricDilatedConvolution_accGradParameters(
   // Batch size + input planes
   long batchSize = input->size[0];
 
+  THCUNNWorkspace workspace(state);
+
   // Define a buffer of ones, for bias accumulation
-  if (ones->nDimension != 3 || ones->size[0]*ones->size[1]*ones->size[2] < outputDepth*outputHeight*outputWidth) {
-    // Resize plane and fill with ones...
-    THCudaTensor_resize3d(state, ones, outputDepth, outputHeight, outputWidth);
-    THCudaTensor_fill(state, ones, 1);
-  }
+  workspace.ones3d(ones, outputDepth, outputHeight, outputWidth);
 
   // Resize temporary columns
-  THCudaTensor_resize2d(state, columns, nInputPlane*kT*kW*kH, outputDepth*outputHeight*outputWidth);
+  workspace.borrow2d(columns, nInputPlane*kT*kW*kH, outputDepth*outputHeight*outputWidth);
 
   // Helpers
   THCudaTensor *input_n = THCudaTensor_new(state);
@@ -4,12 +4,16 @@
 #include "THCDeviceTensor.cuh"
 #include "THCDeviceTensorUtils.cuh"
 #include "THCDeviceUtils.cuh"
+#include "pooling_indices.h"
 
 #include <cfloat>
 
+// Indices is THCDeviceTensor<float, 4> or CompactIndices4d, see
+// pooling_indices.h
+template <typename Indices>
 __global__ void cuda_VolumetricDilatedMaxPooling_updateOutput( 
   THCDeviceTensor<float, 4> input,
-  THCDeviceTensor<float, 4> indices,
+  Indices indices,
   THCDeviceTensor<float, 4> output,
   int kT, int kH, int kW,
   int dT, int dH, int dW,
@@ -63,17 +67,13 @@ __global__ void cuda_VolumetricDilatedMaxPooling_updateOutput(
     }
 
     output[slice][oFrame][oRow][oColumn] = max;
-    float *idx = &indices[slice][oFrame][oRow][oColumn];
-    ((unsigned char*)(idx))[0] = maxFrame;
-    ((unsigned char*)(idx))[1] = maxRow;
-    ((unsigned char*)(idx))[2] = maxColumn;
-    ((unsigned char*)(idx))[3] = 0;
+    pooling_store3d(pooling_at(indices, slice, oFrame, oRow, oColumn), kH, kW, maxFrame, maxRow, maxColumn);
   }
 }
 
-template <int KERNEL_WIDTH>
+template <int KERNEL_WIDTH, typename Indices>
 __global__ void cuda_VolumetricDilatedMaxPooling_updateOutput( 
-  THCDeviceTensor<float, 4> input, THCDeviceTensor<float, 4> indices,
+  THCDeviceTensor<float, 4> input, Indices indices,
   THCDeviceTensor<float, 4> output,
   int kT, int kH,
   int dT, int dH, int dW,
@@ -94,7 +94,7 @@ __global__ void cuda_VolumetricDilatedMaxPooling_updateOutput(
 
     int maxColumn = 0;
     int maxRow = 0;
-    int maxFrame;
+    int maxFrame = 0;
 
     float max = -FLT_MAX;
 
@@ -127,29 +127,27 @@ __global__ void cuda_VolumetricDilatedMaxPooling_updateOutput(
     }
 
     output[slice][oFrame][oRow][oColumn] = max;
-    float *idx = &indices[slice][oFrame][oRow][oColumn];
-    ((unsigned char*)(idx))[0] = maxFrame;
-    ((unsigned char*)(idx))[1] = maxRow;
-    ((unsigned char*)(idx))[2] = maxColumn;
-    ((unsigned char*)(idx))[3] = 0;
+    pooling_store3d(pooling_at(indices, slice, oFrame, oRow, oColumn), kH, KERNEL_WIDTH, maxFrame, maxRow, maxColumn);
   }
 }
 
 #define UPDATE_OUTPUT_KERNEL_WIDTH(KW) case KW:                         \
-  hipLaunchKernelGGL(cuda_VolumetricDilatedMaxPooling_updateOutput<KW>, grid, block,             \
+  hipLaunchKernelGGL((cuda_VolumetricDilatedMaxPooling_updateOutput<KW, Indices>), grid, block, \
     0, THCState_getCurrentStream(state),                             \
     cudaInput, cudaIndices, cudaOutput, kT, kH, dT, dH, dW, padT, padH, padW,\
     dilationT, dilationH, dilationW, offsetZ); \
     break
 
-
-void THNN_CudaVolumetricDilatedMaxPooling_updateOutput(
-  THCState *state, THCudaTensor *input, THCudaTensor *output, THCudaTensor *indices,
+// Checks the arguments, computes the output size and resizes output
+static void VolumetricDilatedMaxPooling_resizeOutput(
+  THCState *state, THCudaTensor *input, THCudaTensor *output,
   int kT, int kW, int kH,
   int dT, int dW, int dH,
   int padT, int padW, int padH,
   int dilationT, int dilationW, int dilationH,
-  bool ceilMode)
+  bool ceilMode,
+  int *batchSizeOut, int *inputSlicesOut,
+  int *outputTimeOut, int *outputHeightOut, int *outputWidthOut)
 {
   int batchSize;
   int inputSlices;
@@ -160,8 +158,6 @@ void THNN_CudaVolumetricDilatedMaxPooling_updateOutput(
   int outputHeight;
   int outputWidth;
 
-  THCUNN_assertSameGPU(state, 3, input, indices, output);
-
   if (THCudaTensor_nDimension(state, input) == 4)
   {
     THArgCheck(
@@ -235,20 +231,30 @@ void THNN_CudaVolumetricDilatedMaxPooling_updateOutput(
     /* resize output */
     THCudaTensor_resize4d(state, output, inputSlices,
                           outputTime, outputHeight, outputWidth);
-    /* indices pack ti,i,j locations for each output point as uchar into
-     each float of the tensor */
-    THCudaTensor_resize4d(state, indices, inputSlices,
-                          outputTime, outputHeight, outputWidth);
   }
   else
   { /* 5D */
     THCudaTensor_resize5d(state, output, batchSize, inputSlices,
                           outputTime, outputHeight, outputWidth);
-    // Index tensor packs index offsets as uchars into floats
-    THCudaTensor_resize5d(state, indices, batchSize, inputSlices,
-                          outputTime, outputHeight, outputWidth);
   }
 
+  *batchSizeOut = batchSize;
+  *inputSlicesOut = inputSlices;
+  *outputTimeOut = outputTime;
+  *outputHeightOut = outputHeight;
+  *outputWidthOut = outputWidth;
+}
+
+template <typename Indices>
+static void VolumetricDilatedMaxPooling_launchOutput(
+  THCState *state, THCudaTensor *input, THCudaTensor *output, Indices cudaIndices,
+  int kT, int kW, int kH,
+  int dT, int dW, int dH,
+  int padT, int padW, int padH,
+  int dilationT, int dilationW, int dilationH,
+  int batchSize, int inputSlices,
+  int outputTime, int outputHeight, int outputWidth)
+{
   input = THCudaTensor_newContiguous(state, input);
 
   // Collapse batch and feature dimensions
@@ -265,21 +271,6 @@ void THNN_CudaVolumetricDilatedMaxPooling_updateOutput(
     cudaOutput = toDeviceTensor<float, 5>(state, output).downcastOuter<4>();
   }
 
-  THLongStorage *indicesSize = THLongStorage_newWithSize(4);
-  long indicesSizeRaw[4] = { batchSize * inputSlices,
-                            outputTime, outputHeight, outputWidth };
-  THLongStorage_rawCopy(indicesSize, indicesSizeRaw);
-
-  THCudaTensor *indices1 = THCudaTensor_newWithStorage(
-    state, THCudaTensor_storage(state, indices),
-    THCudaTensor_storageOffset(state, indices),
-    indicesSize, NULL);
-
-  THLongStorage_free(indicesSize);
-
-  THCDeviceTensor<float, 4> cudaIndices =
-    toDeviceTensor<float, 4>(state, indices1);
-
   int totalZ = outputTime * inputSlices * batchSize;
   int offsetZ = 0;
   dim3 block(32, 8);
@@ -289,6 +280,7 @@ void THNN_CudaVolumetricDilatedMaxPooling_updateOutput(
               THCCeilDiv(outputHeight, static_cast<int>(block.y)),
               totalZ > 65535 ? 65535 : totalZ);
 
+    THCUNN_PROFILE_LAUNCH(grid, block);
     switch (kW)
       {
         UPDATE_OUTPUT_KERNEL_WIDTH(1);
@@ -299,7 +291,7 @@ void THNN_CudaVolumetricDilatedMaxPooling_updateOutput(
         UPDATE_OUTPUT_KERNEL_WIDTH(6);
         UPDATE_OUTPUT_KERNEL_WIDTH(7);
       default:
-        hipLaunchKernelGGL((cuda_VolumetricDilatedMaxPooling_updateOutput), dim3(grid), dim3(block), 0, THCState_getCurrentStream(state), 
+        hipLaunchKernelGGL((cuda_VolumetricDilatedMaxPooling_updateOutput<Indices>), dim3(grid), dim3(block), 0, THCState_getCurrentStream(state), 
                              cudaInput, cudaIndices, cudaOutput,
                              kT, kH, kW, dT, dH, dW,
                              padT, padH, padW, dilationT, dilationH, dilationW, offsetZ);
@@ -310,15 +302,107 @@ void THNN_CudaVolumetricDilatedMaxPooling_updateOutput(
   }
 
   THCudaTensor_free(state, input);
-  THCudaTensor_free(state, indices1);
 }
 
 #undef UPDATE_OUTPUT_KERNEL_WIDTH
 
+// Float indices of the given output shape, viewed with batch and feature
+// dimensions collapsed; free the returned tensor after use
+static THCudaTensor *VolumetricDilatedMaxPooling_indices4d(
+  THCState *state, THCudaTensor *indices,
+  int batchSize, int inputSlices, int outputTime, int outputHeight, int outputWidth)
+{
+  THLongStorage *indicesSize = THLongStorage_newWithSize(4);
+  long indicesSizeRaw[4] = { batchSize * inputSlices,
+                            outputTime, outputHeight, outputWidth };
+  THLongStorage_rawCopy(indicesSize, indicesSizeRaw);
+
+  THCudaTensor *indices1 = THCudaTensor_newWithStorage(
+    state, THCudaTensor_storage(state, indices),
+    THCudaTensor_storageOffset(state, indices),
+    indicesSize, NULL);
+
+  THLongStorage_free(indicesSize);
+  return indices1;
+}
+
+void THNN_CudaVolumetricDilatedMaxPooling_updateOutput(
+  THCState *state, THCudaTensor *input, THCudaTensor *output, THCudaTensor *indices,
+  int kT, int kW, int kH,
+  int dT, int dW, int dH,
+  int padT, int padW, int padH,
+  int dilationT, int dilationW, int dilationH,
+  bool ceilMode)
+{
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
+  THCUNN_assertSameGPU(state, 3, input, indices, output);
+
+  int batchSize, inputSlices, outputTime, outputHeight, outputWidth;
+  VolumetricDilatedMaxPooling_resizeOutput(
+    state, input, output, kT, kW, kH, dT, dW, dH, padT, padW, padH,
+    dilationT, dilationW, dilationH, ceilMode,
+    &batchSize, &inputSlices, &outputTime, &outputHeight, &outputWidth);
+
+  /* indices pack ti,i,j locations for each output point as uchar into
+   each float of the tensor */
+  if (input->nDimension == 4)
+    THCudaTensor_resize4d(state, indices, inputSlices,
+                          outputTime, outputHeight, outputWidth);
+  else
+    THCudaTensor_resize5d(state, indices, batchSize, inputSlices,
+                          outputTime, outputHeight, outputWidth);
+
+  THCudaTensor *indices1 = VolumetricDilatedMaxPooling_indices4d(
+    state, indices, batchSize, inputSlices, outputTime, outputHeight, outputWidth);
+  VolumetricDilatedMaxPooling_launchOutput(
+    state, input, output, toDeviceTensor<float, 4>(state, indices1),
+    kT, kW, kH, dT, dW, dH, padT, padW, padH, dilationT, dilationW, dilationH,
+    batchSize, inputSlices, outputTime, outputHeight, outputWidth);
+  THCudaTensor_free(state, indices1);
+}
+
+void THNN_CudaVolumetricDilatedMaxPooling_updateOutputCompact(
+  THCState *state, THCudaTensor *input, THCudaTensor *output, THCudaByteTensor *indices,
+  int kT, int kW, int kH,
+  int dT, int dW, int dH,
+  int padT, int padW, int padH,
+  int dilationT, int dilationW, int dilationH,
+  bool ceilMode)
+{
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
+  THCUNN_assertSameGPU(state, 3, input, indices, output);
+  THArgCheck(kT * kW * kH <= POOLING_COMPACT_MAX_WINDOW, 5,
+             "compact indices need a window of at most 255 elements");
+
+  int batchSize, inputSlices, outputTime, outputHeight, outputWidth;
+  VolumetricDilatedMaxPooling_resizeOutput(
+    state, input, output, kT, kW, kH, dT, dW, dH, padT, padW, padH,
+    dilationT, dilationW, dilationH, ceilMode,
+    &batchSize, &inputSlices, &outputTime, &outputHeight, &outputWidth);
+
+  if (input->nDimension == 4)
+    THCudaByteTensor_resize4d(state, indices, inputSlices,
+                              outputTime, outputHeight, outputWidth);
+  else
+    THCudaByteTensor_resize5d(state, indices, batchSize, inputSlices,
+                              outputTime, outputHeight, outputWidth);
+
+  CompactIndices4d cudaIndices = { THCudaByteTensor_data(state, indices),
+                                   outputTime, outputHeight, outputWidth };
+  VolumetricDilatedMaxPooling_launchOutput(
+    state, input, output, cudaIndices,
+    kT, kW, kH, dT, dW, dH, padT, padW, padH, dilationT, dilationW, dilationH,
+    batchSize, inputSlices, outputTime, outputHeight, outputWidth);
+}
+
+template <typename Indices>
 __global__ void cuda_VolumetricDilatedMaxPooling_updateGradInput(
   THCDeviceTensor<float, 4> gradOutput,
-  THCDeviceTensor<float, 4> indices,
+  Indices indices,
   THCDeviceTensor<float, 4> gradInput,
+  int kH, int kW,
   int dT, int dH, int dW,
   int padT, int padH, int padW, 
   int dilationT, int dilationH, int dilationW,
@@ -331,54 +415,28 @@ __global__ void cuda_VolumetricDilatedMaxPooling_updateGradInput(
 
   if (oRow < gradOutput.getSize(2) && oColumn < gradOutput.getSize(3))
   {
-    float *idx = &indices[slice][oFrame][oRow][oColumn];
-    int iFrame  = ((unsigned char*)(idx))[0] * dilationT + oFrame  * dT - padT;
-    int iRow    = ((unsigned char*)(idx))[1] * dilationH + oRow    * dH - padH;
-    int iColumn = ((unsigned char*)(idx))[2] * dilationW + oColumn * dW - padW;
+    int t, r, c;
+    pooling_load3d(pooling_at(indices, slice, oFrame, oRow, oColumn), kH, kW, t, r, c);
+    int iFrame  = t * dilationT + oFrame  * dT - padT;
+    int iRow    = r * dilationH + oRow    * dH - padH;
+    int iColumn = c * dilationW + oColumn * dW - padW;
     atomicAdd(&gradInput[slice][iFrame][iRow][iColumn],
               gradOutput[slice][oFrame][oRow][oColumn]);
   }
 }
 
-void THNN_CudaVolumetricDilatedMaxPooling_updateGradInput(
+// Zeroes gradInput and scatters gradOutput into it
+template <typename Indices>
+static void VolumetricDilatedMaxPooling_launchGradInput(
   THCState *state, THCudaTensor *input, THCudaTensor *gradOutput, THCudaTensor *gradInput,
-  THCudaTensor *indices,
+  Indices cudaIndices,
+  int kW, int kH,
   int dT, int dW, int dH,
   int padT, int padW, int padH,
-  int dilationT, int dilationW, int dilationH)
+  int dilationT, int dilationW, int dilationH,
+  int batchSize, int inputSlices,
+  int outputTime, int outputHeight, int outputWidth)
 {
-  // Resize and initialize result tensor.
-  THCudaTensor_resizeAs(state, gradInput, input);
-  THCudaTensor_zero(state, gradInput);
-
-  int batchSize;
-  int inputSlices;
-
-  int outputTime;
-  int outputHeight;
-  int outputWidth;
-
-  THCUNN_assertSameGPU(state, 4, input, indices, gradOutput, gradInput);
-
-  if (THCudaTensor_nDimension(state, input) == 4) /* 4D */
-  {
-    batchSize = 1;
-    inputSlices  = THCudaTensor_size(state, input, 0);
-
-    outputTime   = THCudaTensor_size(state, gradOutput, 1);
-    outputHeight = THCudaTensor_size(state, gradOutput, 2);
-    outputWidth  = THCudaTensor_size(state, gradOutput, 3);
-  }
-  else
-  {
-    batchSize    = THCudaTensor_size(state, input, 0);
-    inputSlices  = THCudaTensor_size(state, input, 1);
-
-    outputTime   = THCudaTensor_size(state, gradOutput, 2);
-    outputHeight = THCudaTensor_size(state, gradOutput, 3);
-    outputWidth  = THCudaTensor_size(state, gradOutput, 4);
-  }
-
   gradOutput = THCudaTensor_newContiguous(state, gradOutput);
 
   // Collapse batch and feature dimensions
@@ -397,18 +455,6 @@ void THNN_CudaVolumetricDilatedMaxPooling_updateGradInput(
       toDeviceTensor<float, 5>(state, gradOutput).downcastOuter<4>();
   }
 
-  THLongStorage *indicesSize = THLongStorage_newWithSize(4);
-  long indicesSizeRaw[4] = { batchSize * inputSlices,
-                           outputTime, outputHeight, outputWidth };
-  THLongStorage_rawCopy(indicesSize, indicesSizeRaw);
-  THCudaTensor *indices1 = THCudaTensor_newWithStorage(
-    state, THCudaTensor_storage(state, indices),
-    THCudaTensor_storageOffset(state, indices), indicesSize, NULL);
-  THLongStorage_free(indicesSize);
-
-  THCDeviceTensor<float, 4> cudaIndices =
-    toDeviceTensor<float, 4>(state, indices1);
-
   int totalZ = outputTime * inputSlices * batchSize;
   int offsetZ = 0;
   dim3 block(32, 8);
@@ -418,10 +464,12 @@ void THNN_CudaVolumetricDilatedMaxPooling_updateGradInput(
               THCCeilDiv(outputHeight, static_cast<int>(block.y)),
               totalZ > 65535 ? 65535 : totalZ);
 
-    hipLaunchKernelGGL((cuda_VolumetricDilatedMaxPooling_updateGradInput), dim3(grid), dim3(block), 0, THCState_getCurrentStream(state), 
+    THCUNN_PROFILE_LAUNCH(grid, block);
+    hipLaunchKernelGGL((cuda_VolumetricDilatedMaxPooling_updateGradInput<Indices>), dim3(grid), dim3(block), 0, THCState_getCurrentStream(state), 
                                              cudaGradOutput,
                                              cudaIndices,
                                              cudaGradInput,
+                                             kH, kW,
                                              dT, dH, dW,
                                              padT, padH, padW, 
                                              dilationT, dilationH, dilationW, offsetZ);
@@ -432,5 +480,88 @@ void THNN_CudaVolumetricDilatedMaxPooling_updateGradInput(
 
   // cleanup
   THCudaTensor_free(state, gradOutput);
+}
+
+// Sizes of the batch, feature and output dimensions
+static void VolumetricDilatedMaxPooling_gradSizes(
+  THCState *state, THCudaTensor *input, THCudaTensor *gradOutput,
+  int *batchSize, int *inputSlices, int *outputTime, int *outputHeight, int *outputWidth)
+{
+  if (THCudaTensor_nDimension(state, input) == 4) /* 4D */
+  {
+    *batchSize = 1;
+    *inputSlices  = THCudaTensor_size(state, input, 0);
+
+    *outputTime   = THCudaTensor_size(state, gradOutput, 1);
+    *outputHeight = THCudaTensor_size(state, gradOutput, 2);
+    *outputWidth  = THCudaTensor_size(state, gradOutput, 3);
+  }
+  else
+  {
+    *batchSize    = THCudaTensor_size(state, input, 0);
+    *inputSlices  = THCudaTensor_size(state, input, 1);
+
+    *outputTime   = THCudaTensor_size(state, gradOutput, 2);
+    *outputHeight = THCudaTensor_size(state, gradOutput, 3);
+    *outputWidth  = THCudaTensor_size(state, gradOutput, 4);
+  }
+}
+
+void THNN_CudaVolumetricDilatedMaxPooling_updateGradInput(
+  THCState *state, THCudaTensor *input, THCudaTensor *gradOutput, THCudaTensor *gradInput,
+  THCudaTensor *indices,
+  int dT, int dW, int dH,
+  int padT, int padW, int padH,
+  int dilationT, int dilationW, int dilationH)
+{
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
+  // Resize and initialize result tensor.
+  THCudaTensor_resizeAs(state, gradInput, input);
+  THCudaTensor_zero(state, gradInput);
+
+  THCUNN_assertSameGPU(state, 4, input, indices, gradOutput, gradInput);
+
+  int batchSize, inputSlices, outputTime, outputHeight, outputWidth;
+  VolumetricDilatedMaxPooling_gradSizes(
+    state, input, gradOutput, &batchSize, &inputSlices, &outputTime, &outputHeight, &outputWidth);
+
+  // the float format does not need the kernel size
+  THCudaTensor *indices1 = VolumetricDilatedMaxPooling_indices4d(
+    state, indices, batchSize, inputSlices, outputTime, outputHeight, outputWidth);
+  VolumetricDilatedMaxPooling_launchGradInput(
+    state, input, gradOutput, gradInput, toDeviceTensor<float, 4>(state, indices1),
+    0, 0, dT, dW, dH, padT, padW, padH, dilationT, dilationW, dilationH,
+    batchSize, inputSlices, outputTime, outputHeight, outputWidth);
   THCudaTensor_free(state, indices1);
 }
+
+void THNN_CudaVolumetricDilatedMaxPooling_updateGradInputCompact(
+  THCState *state, THCudaTensor *input, THCudaTensor *gradOutput, THCudaTensor *gradInput,
+  THCudaByteTensor *indices,
+  int kT, int kW, int kH,
+  int dT, int dW, int dH,
+  int padT, int padW, int padH,
+  int dilationT, int dilationW, int dilationH)
+{
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
+  THCudaTensor_resizeAs(state, gradInput, input);
+  THCudaTensor_zero(state, gradInput);
+
+  THCUNN_assertSameGPU(state, 4, input, indices, gradOutput, gradInput);
+  THArgCheck(THCudaByteTensor_isContiguous(state, indices), 5, "indices should be contiguous");
+  THArgCheck(kT * kW * kH <= POOLING_COMPACT_MAX_WINDOW, 6,
+             "compact indices need a window of at most 255 elements");
+
+  int batchSize, inputSlices, outputTime, outputHeight, outputWidth;
+  VolumetricDilatedMaxPooling_gradSizes(
+    state, input, gradOutput, &batchSize, &inputSlices, &outputTime, &outputHeight, &outputWidth);
+
+  CompactIndices4d cudaIndices = { THCudaByteTensor_data(state, indices),
+                                   outputTime, outputHeight, outputWidth };
+  VolumetricDilatedMaxPooling_launchGradInput(
+    state, input, gradOutput, gradInput, cudaIndices,
+    kW, kH, dT, dW, dH, padT, padW, padH, dilationT, dilationW, dilationH,
+    batchSize, inputSlices, outputTime, outputHeight, outputWidth);
+}
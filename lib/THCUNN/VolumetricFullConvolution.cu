@@ -1,4 +1,5 @@
 #include "THCUNN.h"
+#include "workspace.h"
 #include "common.h"
 #include "vol2col.h"
 
@@ -15,6 +16,8 @@ void THNN_CudaVolumetricFullConvolution_updateOutput(
     int padT, int padW, int padH,
     int adjT, int adjW, int adjH)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
 
   THCudaTensor *columns = finput;
   THCudaTensor *ones    = fgradInput;
@@ -52,17 +55,13 @@ void THNN_CudaVolumetricFullConvolution_updateOutput(
   // Resize output
   THCudaTensor_resize5d(state, output, batchSize, nOutputPlane, outputDepth, outputHeight, outputWidth);
 
+  THCUNNWorkspace workspace(state);
+
   // Resize temporary columns
-  THCudaTensor_resize2d(state, columns, nOutputPlane*kW*kH*kT, inputDepth*inputHeight*inputWidth);
+  workspace.borrow2d(columns, nOutputPlane*kW*kH*kT, inputDepth*inputHeight*inputWidth);
 
   // Define a buffer of ones, for bias accumulation
-  // Note: this buffer can be shared with other modules, it only ever gets increased,
-  // and always contains ones.
-  if (ones->nDimension != 3 || ones->size[0]*ones->size[1]*ones->size[2] < outputDepth*outputHeight*outputWidth) {
-    // Resize plane and fill with ones...
-    THCudaTensor_resize3d(state, ones, outputDepth, outputHeight, outputWidth);
-    THCudaTensor_fill(state, ones, 1);
-  }
+  workspace.ones3d(ones, outputDepth, outputHeight, outputWidth);
 
   // Helpers
   THCudaTensor *input_n = THCudaTensor_new(state);
@@ -145,6 +144,8 @@ void THNN_CudaVolumetricFullConvolution_updateGradInput(
     int padT, int padW, int padH,
     int adjT, int adjW, int adjH)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   THCudaTensor *gradColumns = finput;
 
   int nInputPlane = THCudaTensor_size(state, weight, 0);
@@ -178,8 +179,10 @@ void THNN_CudaVolumetricFullConvolution_updateGradInput(
   // Resize output
   THCudaTensor_resize5d(state, gradInput, batchSize, nInputPlane, inputDepth, inputHeight, inputWidth);
 
+  THCUNNWorkspace workspace(state);
+
   // Resize temporary columns
-  THCudaTensor_resize2d(state, gradColumns, nOutputPlane*kW*kH*kT, inputDepth*inputHeight*inputWidth);
+  workspace.borrow2d(gradColumns, nOutputPlane*kW*kH*kT, inputDepth*inputHeight*inputWidth);
 
   // Helpers
   THCudaTensor *gradInput_n = THCudaTensor_new(state);
@@ -247,6 +250,8 @@ void THNN_CudaVolumetricFullConvolution_accGradParameters(
     int adjT, int adjW, int adjH,
     float scale)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   THCudaTensor *columns = finput;
   THCudaTensor *ones = fgradInput;
 
@@ -278,15 +283,13 @@ void THNN_CudaVolumetricFullConvolution_accGradParameters(
   // Batch size + input planes
   long batchSize = input->size[0];
 
+  THCUNNWorkspace workspace(state);
+
   // Define a buffer of ones, for bias accumulation
-  if (ones->nDimension != 3 || ones->size[0]*ones->size[1]*ones->size[2] < outputDepth*outputHeight*outputWidth) {
-    // Resize plane and fill with ones...
-    THCudaTensor_resize3d(state, ones, outputDepth, outputHeight, outputWidth);
-    THCudaTensor_fill(state, ones, 1);
-  }
+  workspace.ones3d(ones, outputDepth, outputHeight, outputWidth);
 
   // Resize temporary columns
-  THCudaTensor_resize2d(state, columns, nOutputPlane*kW*kH*kT, inputDepth*inputHeight*inputWidth);
+  workspace.borrow2d(columns, nOutputPlane*kW*kH*kT, inputDepth*inputHeight*inputWidth);
 
   // Helpers
   THCudaTensor *input_n = THCudaTensor_new(state);
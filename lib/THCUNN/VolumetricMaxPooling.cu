@@ -13,6 +13,8 @@ void THNN_CudaVolumetricMaxPooling_updateOutput(
   int padT, int padW, int padH,
   bool ceilMode)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   THNN_CudaVolumetricDilatedMaxPooling_updateOutput(
     state, input, output, indices,
     kT, kW, kH, dT, dW, dH, padT, padW, padH, 1, 1, 1, ceilMode);
@@ -25,6 +27,8 @@ void THNN_CudaVolumetricMaxPooling_updateGradInput(
   int dT, int dW, int dH,
   int padT, int padW, int padH)
 {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   THNN_CudaVolumetricDilatedMaxPooling_updateGradInput(
     state, input, gradOutput, gradInput, indices,
     dT, dW, dH, padT, padW, padH, 1, 1, 1);
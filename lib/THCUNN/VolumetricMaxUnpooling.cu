@@ -4,13 +4,18 @@
 #include "THCDeviceTensor.cuh"
 #include "THCDeviceTensorUtils.cuh"
 #include "THCDeviceUtils.cuh"
+#include "pooling_indices.h"
 
 #include <cfloat>
 
+// Indices is THCDeviceTensor<float, 4> or CompactIndices4d, see
+// pooling_indices.h; kH and kW are only used by the compact format
+template <typename Indices>
 __global__ void cuda_VolumetricMaxUnpooling_updateOutput( 
   THCDeviceTensor<float, 4> input,
-  THCDeviceTensor<float, 4> indices,
+  Indices indices,
   THCDeviceTensor<float, 4> output,
+  int kH, int kW,
   int dT, int dH, int dW,
   int padT, int padH, int padW, int offsetZ)
 {
@@ -27,19 +32,18 @@ __global__ void cuda_VolumetricMaxUnpooling_updateOutput(
 
     float val = input[slice][iFrame][iRow][iColumn];
     
-    float *idx = &indices[slice][iFrame][iRow][iColumn];
-    long maxz = ((unsigned char*)(idx))[0];
-    long maxy = ((unsigned char*)(idx))[1];
-    long maxx = ((unsigned char*)(idx))[2];
+    int maxz, maxy, maxx;
+    pooling_load3d(pooling_at(indices, slice, iFrame, iRow, iColumn), kH, kW, maxz, maxy, maxx);
     output[slice][start_t + maxz][start_h + maxy][start_w + maxx] = val;
   }
 }
 
-void THNN_CudaVolumetricMaxUnpooling_updateOutput(
-  THCState *state, THCudaTensor *input, THCudaTensor *output, THCudaTensor *indices,
+// Sizes of input, and output resized to outputTime x outputHeight x outputWidth
+static void VolumetricMaxUnpooling_resizeOutput(
+  THCState *state, THCudaTensor *input, THCudaTensor *output,
   int outputTime, int outputWidth, int outputHeight,
-  int dT, int dW, int dH,
-  int padT, int padW, int padH)
+  int *batchSizeOut, int *inputSlicesOut,
+  int *inputTimeOut, int *inputHeightOut, int *inputWidthOut)
 {
   int batchSize;
   int inputSlices;
@@ -47,8 +51,6 @@ void THNN_CudaVolumetricMaxUnpooling_updateOutput(
   int inputHeight;
   int inputWidth;
 
-  THCUNN_assertSameGPU(state, 3, input, indices, output);
-
   if (THCudaTensor_nDimension(state, input) == 4)
   {
     /* sizes */
@@ -84,26 +86,38 @@ void THNN_CudaVolumetricMaxUnpooling_updateOutput(
                           outputTime, outputHeight, outputWidth);
   }
 
+  *batchSizeOut = batchSize;
+  *inputSlicesOut = inputSlices;
+  *inputTimeOut = inputTime;
+  *inputHeightOut = inputHeight;
+  *inputWidthOut = inputWidth;
+}
+
+template <typename Indices>
+static void VolumetricMaxUnpooling_launchOutput(
+  THCState *state, THCudaTensor *input, THCudaTensor *output, Indices cudaIndices,
+  int kH, int kW,
+  int dT, int dW, int dH,
+  int padT, int padW, int padH,
+  int batchSize, int inputSlices,
+  int inputTime, int inputHeight, int inputWidth)
+{
   input = THCudaTensor_newContiguous(state, input);
-  indices = THCudaTensor_newContiguous(state, indices);
   THCudaTensor_zero(state, output);
-  
+
   // Collapse batch and feature dimensions
   THCDeviceTensor<float, 4> cudaInput;
   THCDeviceTensor<float, 4> cudaOutput;
-  THCDeviceTensor<float, 4> cudaIndices;
 
   if (THCudaTensor_nDimension(state, input) == 4)
   {
     cudaInput  = toDeviceTensor<float, 4>(state, input);
     cudaOutput = toDeviceTensor<float, 4>(state, output);
-    cudaIndices = toDeviceTensor<float, 4>(state, indices);
   }
   else
   {
     cudaInput  = toDeviceTensor<float, 5>(state, input).downcastOuter<4>();
     cudaOutput = toDeviceTensor<float, 5>(state, output).downcastOuter<4>();
-    cudaIndices = toDeviceTensor<float, 5>(state, indices).downcastOuter<4>();
   }
 
   int totalZ = inputTime * inputSlices * batchSize;
@@ -115,8 +129,9 @@ void THNN_CudaVolumetricMaxUnpooling_updateOutput(
               THCCeilDiv(inputHeight, static_cast<int>(block.y)),
               totalZ > 65535 ? 65535 : totalZ);
 
-    hipLaunchKernelGGL((cuda_VolumetricMaxUnpooling_updateOutput), dim3(grid), dim3(block), 0, THCState_getCurrentStream(state), 
+    hipLaunchKernelGGL((cuda_VolumetricMaxUnpooling_updateOutput<Indices>), dim3(grid), dim3(block), 0, THCState_getCurrentStream(state), 
                              cudaInput, cudaIndices, cudaOutput,
+                             kH, kW,
                              dT, dH, dW,
                              padT, padH, padW, offsetZ);
     THCudaCheck(hipGetLastError());
@@ -125,13 +140,71 @@ void THNN_CudaVolumetricMaxUnpooling_updateOutput(
   }
 
   THCudaTensor_free(state, input);
+}
+
+// Float indices viewed with batch and feature dimensions collapsed
+static THCDeviceTensor<float, 4> VolumetricMaxUnpooling_floatIndices(
+  THCState *state, THCudaTensor *input, THCudaTensor *indices)
+{
+  if (THCudaTensor_nDimension(state, input) == 4)
+    return toDeviceTensor<float, 4>(state, indices);
+  return toDeviceTensor<float, 5>(state, indices).downcastOuter<4>();
+}
+
+void THNN_CudaVolumetricMaxUnpooling_updateOutput(
+  THCState *state, THCudaTensor *input, THCudaTensor *output, THCudaTensor *indices,
+  int outputTime, int outputWidth, int outputHeight,
+  int dT, int dW, int dH,
+  int padT, int padW, int padH)
+{
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
+  THCUNN_assertSameGPU(state, 3, input, indices, output);
+
+  int batchSize, inputSlices, inputTime, inputHeight, inputWidth;
+  VolumetricMaxUnpooling_resizeOutput(
+    state, input, output, outputTime, outputWidth, outputHeight,
+    &batchSize, &inputSlices, &inputTime, &inputHeight, &inputWidth);
+
+  indices = THCudaTensor_newContiguous(state, indices);
+  VolumetricMaxUnpooling_launchOutput(
+    state, input, output, VolumetricMaxUnpooling_floatIndices(state, input, indices),
+    0, 0, dT, dW, dH, padT, padW, padH,
+    batchSize, inputSlices, inputTime, inputHeight, inputWidth);
   THCudaTensor_free(state, indices);
 }
 
+void THNN_CudaVolumetricMaxUnpooling_updateOutputCompact(
+  THCState *state, THCudaTensor *input, THCudaTensor *output, THCudaByteTensor *indices,
+  int outputTime, int outputWidth, int outputHeight,
+  int kT, int kW, int kH,
+  int dT, int dW, int dH,
+  int padT, int padW, int padH)
+{
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
+  THCUNN_assertSameGPU(state, 3, input, indices, output);
+  THArgCheck(THCudaByteTensor_isContiguous(state, indices), 4, "indices should be contiguous");
+
+  int batchSize, inputSlices, inputTime, inputHeight, inputWidth;
+  VolumetricMaxUnpooling_resizeOutput(
+    state, input, output, outputTime, outputWidth, outputHeight,
+    &batchSize, &inputSlices, &inputTime, &inputHeight, &inputWidth);
+
+  CompactIndices4d cudaIndices = { THCudaByteTensor_data(state, indices),
+                                   inputTime, inputHeight, inputWidth };
+  VolumetricMaxUnpooling_launchOutput(
+    state, input, output, cudaIndices,
+    kH, kW, dT, dW, dH, padT, padW, padH,
+    batchSize, inputSlices, inputTime, inputHeight, inputWidth);
+}
+
+template <typename Indices>
 __global__ void cuda_VolumetricMaxUnpooling_updateGradInput( 
   THCDeviceTensor<float, 4> gradOutput,
-  THCDeviceTensor<float, 4> indices,
+  Indices indices,
   THCDeviceTensor<float, 4> gradInput,
+  int kH, int kW,
   int dT, int dH, int dW,
   int padT, int padH, int padW, int offsetZ)
 {
@@ -147,10 +220,8 @@ __global__ void cuda_VolumetricMaxUnpooling_updateGradInput(
     long start_h = iRow * dH - padH;
     long start_w = iColumn * dW - padW;
 
-    float *idx = &indices[slice][iFrame][iRow][iColumn];
-    long maxz = ((unsigned char*)(idx))[0];
-    long maxy = ((unsigned char*)(idx))[1];
-    long maxx = ((unsigned char*)(idx))[2];
+    int maxz, maxy, maxx;
+    pooling_load3d(pooling_at(indices, slice, iFrame, iRow, iColumn), kH, kW, maxz, maxy, maxx);
 
     float grad_val = gradOutput[slice][start_t + maxz][start_h + maxy][start_w + maxx];
 
@@ -158,41 +229,40 @@ __global__ void cuda_VolumetricMaxUnpooling_updateGradInput(
   }
 }
 
-void THNN_CudaVolumetricMaxUnpooling_updateGradInput(
-  THCState *state, THCudaTensor *input, THCudaTensor *gradOutput, THCudaTensor *gradInput,
-  THCudaTensor *indices,
-  int outputTime, int outputWidth, int outputHeight,
-  int dT, int dW, int dH,
-  int padT, int padW, int padH)
+// Sizes of input, which gradInput is resized to
+static void VolumetricMaxUnpooling_inputSizes(
+  THCState *state, THCudaTensor *input,
+  int *batchSize, int *inputSlices, int *inputTime, int *inputHeight, int *inputWidth)
 {
-  
-  int batchSize;
-  int inputSlices;
-  int inputTime;
-  int inputHeight;
-  int inputWidth;
-  
-  THCUNN_assertSameGPU(state, 4, input, indices, gradOutput, gradInput);
-
   if (THCudaTensor_nDimension(state, input) == 4) /* 4D */
   {
-    batchSize = 1;
-    inputSlices  = THCudaTensor_size(state, input, 0);
-    inputTime   = THCudaTensor_size(state, input, 1);
-    inputHeight = THCudaTensor_size(state, input, 2);
-    inputWidth  = THCudaTensor_size(state, input, 3);
+    *batchSize = 1;
+    *inputSlices = THCudaTensor_size(state, input, 0);
+    *inputTime   = THCudaTensor_size(state, input, 1);
+    *inputHeight = THCudaTensor_size(state, input, 2);
+    *inputWidth  = THCudaTensor_size(state, input, 3);
   }
   else
   {
-    batchSize    = THCudaTensor_size(state, input, 0);
-    inputSlices  = THCudaTensor_size(state, input, 1);
-    inputTime   = THCudaTensor_size(state, input, 2);
-    inputHeight = THCudaTensor_size(state, input, 3);
-    inputWidth  = THCudaTensor_size(state, input, 4);
+    *batchSize   = THCudaTensor_size(state, input, 0);
+    *inputSlices = THCudaTensor_size(state, input, 1);
+    *inputTime   = THCudaTensor_size(state, input, 2);
+    *inputHeight = THCudaTensor_size(state, input, 3);
+    *inputWidth  = THCudaTensor_size(state, input, 4);
   }
+}
 
+template <typename Indices>
+static void VolumetricMaxUnpooling_launchGradInput(
+  THCState *state, THCudaTensor *input, THCudaTensor *gradOutput, THCudaTensor *gradInput,
+  Indices cudaIndices,
+  int kH, int kW,
+  int dT, int dW, int dH,
+  int padT, int padW, int padH,
+  int batchSize, int inputSlices,
+  int inputTime, int inputHeight, int inputWidth)
+{
   input = THCudaTensor_newContiguous(state, input);
-  indices = THCudaTensor_newContiguous(state, indices);
   gradOutput = THCudaTensor_newContiguous(state, gradOutput);
   THCudaTensor_resizeAs(state, gradInput, input);
   THCudaTensor_zero(state, gradInput);
@@ -200,13 +270,11 @@ void THNN_CudaVolumetricMaxUnpooling_updateGradInput(
   // Collapse batch and feature dimensions
   THCDeviceTensor<float, 4> cudaGradInput;
   THCDeviceTensor<float, 4> cudaGradOutput;
-  THCDeviceTensor<float, 4> cudaIndices;
   
   if (THCudaTensor_nDimension(state, input) == 4)
   {
     cudaGradInput  = toDeviceTensor<float, 4>(state, gradInput);
     cudaGradOutput = toDeviceTensor<float, 4>(state, gradOutput);
-    cudaIndices = toDeviceTensor<float, 4>(state, indices);
   }
   else
   {
@@ -214,8 +282,6 @@ void THNN_CudaVolumetricMaxUnpooling_updateGradInput(
       toDeviceTensor<float, 5>(state, gradInput).downcastOuter<4>();
     cudaGradOutput =
       toDeviceTensor<float, 5>(state, gradOutput).downcastOuter<4>();
-    cudaIndices =
-      toDeviceTensor<float, 5>(state, indices).downcastOuter<4>();
   }
 
   int totalZ = inputTime * inputSlices * batchSize;
@@ -227,10 +293,11 @@ void THNN_CudaVolumetricMaxUnpooling_updateGradInput(
               THCCeilDiv(inputHeight, static_cast<int>(block.y)),
               totalZ > 65535 ? 65535 : totalZ);
 
-    hipLaunchKernelGGL((cuda_VolumetricMaxUnpooling_updateGradInput), dim3(grid), dim3(block), 0, THCState_getCurrentStream(state), 
+    hipLaunchKernelGGL((cuda_VolumetricMaxUnpooling_updateGradInput<Indices>), dim3(grid), dim3(block), 0, THCState_getCurrentStream(state), 
                                              cudaGradOutput,
                                              cudaIndices,
                                              cudaGradInput,
+                                             kH, kW,
                                              dT, dH, dW,
                                              padT, padH, padW, offsetZ);
     THCudaCheck(hipGetLastError());
@@ -241,5 +308,53 @@ void THNN_CudaVolumetricMaxUnpooling_updateGradInput(
   // cleanup
   THCudaTensor_free(state, input);
   THCudaTensor_free(state, gradOutput);
+}
+
+void THNN_CudaVolumetricMaxUnpooling_updateGradInput(
+  THCState *state, THCudaTensor *input, THCudaTensor *gradOutput, THCudaTensor *gradInput,
+  THCudaTensor *indices,
+  int outputTime, int outputWidth, int outputHeight,
+  int dT, int dW, int dH,
+  int padT, int padW, int padH)
+{
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
+  THCUNN_assertSameGPU(state, 4, input, indices, gradOutput, gradInput);
+
+  int batchSize, inputSlices, inputTime, inputHeight, inputWidth;
+  VolumetricMaxUnpooling_inputSizes(
+    state, input, &batchSize, &inputSlices, &inputTime, &inputHeight, &inputWidth);
+
+  indices = THCudaTensor_newContiguous(state, indices);
+  VolumetricMaxUnpooling_launchGradInput(
+    state, input, gradOutput, gradInput,
+    VolumetricMaxUnpooling_floatIndices(state, input, indices),
+    0, 0, dT, dW, dH, padT, padW, padH,
+    batchSize, inputSlices, inputTime, inputHeight, inputWidth);
   THCudaTensor_free(state, indices);
 }
+
+void THNN_CudaVolumetricMaxUnpooling_updateGradInputCompact(
+  THCState *state, THCudaTensor *input, THCudaTensor *gradOutput, THCudaTensor *gradInput,
+  THCudaByteTensor *indices,
+  int outputTime, int outputWidth, int outputHeight,
+  int kT, int kW, int kH,
+  int dT, int dW, int dH,
+  int padT, int padW, int padH)
+{
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
+  THCUNN_assertSameGPU(state, 4, input, indices, gradOutput, gradInput);
+  THArgCheck(THCudaByteTensor_isContiguous(state, indices), 5, "indices should be contiguous");
+
+  int batchSize, inputSlices, inputTime, inputHeight, inputWidth;
+  VolumetricMaxUnpooling_inputSizes(
+    state, input, &batchSize, &inputSlices, &inputTime, &inputHeight, &inputWidth);
+
+  CompactIndices4d cudaIndices = { THCudaByteTensor_data(state, indices),
+                                   inputTime, inputHeight, inputWidth };
+  VolumetricMaxUnpooling_launchGradInput(
+    state, input, gradOutput, gradInput, cudaIndices,
+    kH, kW, dT, dW, dH, padT, padW, padH,
+    batchSize, inputSlices, inputTime, inputHeight, inputWidth);
+}
@@ -1,6 +1,7 @@
 #include "hip/hip_runtime.h"
 
 #include "THCUNN.h"
+#include "common.h"
 
 #include "THCDeviceTensor.cuh"
 #include "THCDeviceTensorUtils.cuh"
@@ -48,6 +49,8 @@ void THNN_CudaVolumetricReplicationPadding_updateOutput(THCState *state,
                                                         int pleft, int pright,
                                                         int ptop, int pbottom,
                                                         int pfront, int pback) {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   THArgCheck(TensorUtils<THCudaTensor>::canUse32BitIndexMath(state, input), 2,
              "input tensor must fit into 32-bit index math");
 
@@ -146,6 +149,8 @@ void THNN_CudaVolumetricReplicationPadding_updateGradInput(
   THCState *state, THCudaTensor *input, THCudaTensor *gradOutput,
   THCudaTensor *gradInput, int pleft, int pright, int ptop, int pbottom,
   int pfront, int pback) {
+  THCUNN_PROFILE_FUNC(state);
+  THCUNN_PROFILE_TENSOR(input);
   THArgCheck(TensorUtils<THCudaTensor>::canUse32BitIndexMath(state, input), 2,
              "input tensor must fit into 32-bit index math");
   THArgCheck(TensorUtils<THCudaTensor>::canUse32BitIndexMath(state, gradOutput),
@@ -0,0 +1,38 @@
+#include "hip/hip_runtime.h"
+#include "THCUNN.h"
+#include "common.h"
+#include "wavefront.h"
+
+#include <float.h>
+
+// One block sums and takes the max of input through blockReduce; used by the
+// tests to cover block sizes that are not a whole number of wavefronts.
+__global__ void cunn_Wavefront_reduceKernel(const float *input, int n, float *output)
+{
+  float sum = 0;
+  float max = -FLT_MAX;
+  for (int i = hipThreadIdx_x; i < n; i += hipBlockDim_x) {
+    sum += input[i];
+    max = fmaxf(max, input[i]);
+  }
+  sum = blockReduce(sum, WaveSum(), 0.0f);
+  max = blockReduce(max, WaveMax(), -FLT_MAX);
+  if (hipThreadIdx_x == 0) {
+    output[0] = sum;
+    output[1] = max;
+  }
+}
+
+void THNN_CudaWavefront_reduce(THCState *state, THCudaTensor *input, THCudaTensor *output, int blockSize)
+{
+  THCUNN_assertSameGPU(state, 2, input, output);
+  THArgCheck(blockSize >= 1 && blockSize <= WAVEFRONT_MAX_BLOCK, 4,
+             "block size should be between 1 and %d", WAVEFRONT_MAX_BLOCK);
+  input = THCudaTensor_newContiguous(state, input);
+  THCudaTensor_resize1d(state, output, 2);
+
+  hipLaunchKernelGGL((cunn_Wavefront_reduceKernel), dim3(1), dim3(blockSize), 0, THCState_getCurrentStream(state),
+      THCudaTensor_data(state, input), (int)THCudaTensor_nElement(state, input), THCudaTensor_data(state, output));
+  THCudaCheck(hipGetLastError());
+  THCudaTensor_free(state, input);
+}
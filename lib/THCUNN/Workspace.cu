@@ -0,0 +1,209 @@
+#include "hip/hip_runtime.h"
+#include "THCUNN.h"
+#include "common.h"
+#include "workspace.h"
+
+#include <map>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+// Borrowed regions start on 256-byte boundaries so float4 accesses stay aligned
+#define WORKSPACE_ALIGN 64
+
+struct THCUNNArena
+{
+  THCudaStorage *storage;
+  THCudaStorage *ones;
+  long used;       // elements borrowed by the calls currently open
+  long highWater;  // largest `used` seen since the last reset
+  long borrows;
+  long grows;
+  // Calls currently open on this arena, by thread. Calls do not nest, so
+  // one per thread.
+  std::map<std::thread::id, long> open;
+};
+
+typedef std::pair<int, hipStream_t> THCUNNArenaKey;
+
+static bool thcunn_workspaceEnabled = true;
+static std::mutex thcunn_workspaceMutex;
+static std::map<THCUNNArenaKey, THCUNNArena> thcunn_arenas;
+
+static long thcunn_workspaceNumel(int nDimension, long *size)
+{
+  long n = 1;
+  for (int d = 0; d < nDimension; d++)
+    n *= size[d];
+  return n;
+}
+
+// A THError inside a call longjmps past ~THCUNNWorkspace, leaving the call
+// open. Since calls do not nest, a call the current thread still has open
+// when it starts another (or releases the arenas) is such a call; it is
+// closed here instead. Called with thcunn_workspaceMutex held.
+static void thcunn_workspaceClose(THCUNNArena &arena)
+{
+  arena.open.erase(std::this_thread::get_id());
+  // other threads' regions may lie past ours, so only an idle arena rewinds
+  if (arena.open.empty())
+    arena.used = 0;
+}
+
+THCUNNWorkspace::THCUNNWorkspace(THCState *state)
+  : state_(state), arena_(NULL), mark_(0)
+{
+  if (!thcunn_workspaceEnabled)
+    return;
+  int device;
+  THCudaCheck(hipGetDevice(&device));
+  THCUNNArenaKey key(device, THCState_getCurrentStream(state));
+
+  std::lock_guard<std::mutex> lock(thcunn_workspaceMutex);
+  THCUNNArena &arena = thcunn_arenas[key];
+  thcunn_workspaceClose(arena);
+  arena_ = &arena;
+  mark_ = arena.used;
+  arena.open[std::this_thread::get_id()] = mark_;
+}
+
+THCUNNWorkspace::~THCUNNWorkspace()
+{
+  for (size_t i = 0; i < borrowed_.size(); i++)
+    THCudaTensor_setStorageNd(state_, borrowed_[i], NULL, 0, 0, NULL, NULL);
+  if (arena_) {
+    std::lock_guard<std::mutex> lock(thcunn_workspaceMutex);
+    thcunn_workspaceClose(*arena_);
+  }
+}
+
+void THCUNNWorkspace::borrow(THCudaTensor *t, int nDimension, long *size)
+{
+  if (!arena_) {
+    THCudaTensor_resizeNd(state_, t, nDimension, size, NULL);
+    return;
+  }
+
+  long n = thcunn_workspaceNumel(nDimension, size);
+  n = (n + WORKSPACE_ALIGN - 1) / WORKSPACE_ALIGN * WORKSPACE_ALIGN;
+
+  std::lock_guard<std::mutex> lock(thcunn_workspaceMutex);
+  long offset = arena_->used;
+  if (arena_->storage == NULL || arena_->storage->size < offset + n) {
+    // Regions borrowed earlier in this call keep the old storage alive
+    // through their views until the call returns
+    if (arena_->storage)
+      THCudaStorage_free(state_, arena_->storage);
+    arena_->storage = THCudaStorage_newWithSize(state_, offset + n);
+    arena_->grows++;
+  }
+  THCudaTensor_setStorageNd(state_, t, arena_->storage, offset, nDimension, size, NULL);
+  arena_->used = offset + n;
+  arena_->borrows++;
+  if (arena_->used > arena_->highWater)
+    arena_->highWater = arena_->used;
+  borrowed_.push_back(t);
+}
+
+void THCUNNWorkspace::ones(THCudaTensor *t, int nDimension, long *size)
+{
+  long n = thcunn_workspaceNumel(nDimension, size);
+  if (!arena_) {
+    if (t->nDimension != nDimension || THCudaTensor_nElement(state_, t) < n) {
+      THCudaTensor_resizeNd(state_, t, nDimension, size, NULL);
+      THCudaTensor_fill(state_, t, 1);
+    }
+    return;
+  }
+
+  // Kept per stream like the arena: a larger buffer replaces the old one,
+  // and only work queued on this stream is ordered after the fill and
+  // before the old buffer is reused
+  std::lock_guard<std::mutex> lock(thcunn_workspaceMutex);
+  THCudaStorage *&storage = arena_->ones;
+  if (storage == NULL || storage->size < n) {
+    if (storage)
+      THCudaStorage_free(state_, storage);
+    storage = THCudaStorage_newWithSize(state_, n);
+    THCudaStorage_fill(state_, storage, 1);
+  }
+  THCudaTensor_setStorageNd(state_, t, storage, 0, nDimension, size, NULL);
+  borrowed_.push_back(t);
+}
+
+void THCUNNWorkspace::borrow2d(THCudaTensor *t, long size0, long size1)
+{
+  long size[2] = {size0, size1};
+  borrow(t, 2, size);
+}
+
+void THCUNNWorkspace::borrow3d(THCudaTensor *t, long size0, long size1, long size2)
+{
+  long size[3] = {size0, size1, size2};
+  borrow(t, 3, size);
+}
+
+void THCUNNWorkspace::ones2d(THCudaTensor *t, long size0, long size1)
+{
+  long size[2] = {size0, size1};
+  ones(t, 2, size);
+}
+
+void THCUNNWorkspace::ones3d(THCudaTensor *t, long size0, long size1, long size2)
+{
+  long size[3] = {size0, size1, size2};
+  ones(t, 3, size);
+}
+
+void THNN_CudaWorkspace_setEnabled(THCState *state, bool enabled)
+{
+  thcunn_workspaceEnabled = enabled;
+}
+
+void THNN_CudaWorkspace_getStats(THCState *state, long *stats)
+{
+  int device;
+  THCudaCheck(hipGetDevice(&device));
+  long capacity = 0, highWater = 0, borrows = 0, grows = 0;
+
+  std::lock_guard<std::mutex> lock(thcunn_workspaceMutex);
+  for (std::map<THCUNNArenaKey, THCUNNArena>::iterator it = thcunn_arenas.begin();
+       it != thcunn_arenas.end(); ++it) {
+    if (it->first.first != device)
+      continue;
+    THCUNNArena &arena = it->second;
+    capacity += arena.storage ? arena.storage->size : 0;
+    highWater += arena.highWater;
+    borrows += arena.borrows;
+    grows += arena.grows;
+  }
+  stats[0] = capacity * sizeof(float);
+  stats[1] = highWater * sizeof(float);
+  stats[2] = borrows;
+  stats[3] = grows;
+}
+
+void THNN_CudaWorkspace_release(THCState *state)
+{
+  int device;
+  THCudaCheck(hipGetDevice(&device));
+
+  std::lock_guard<std::mutex> lock(thcunn_workspaceMutex);
+  for (std::map<THCUNNArenaKey, THCUNNArena>::iterator it = thcunn_arenas.begin();
+       it != thcunn_arenas.end(); ) {
+    THCUNNArena &arena = it->second;
+    if (it->first.first == device)
+      thcunn_workspaceClose(arena);
+    if (it->first.first == device && arena.open.empty()) {
+      if (arena.storage)
+        THCudaStorage_free(state, arena.storage);
+      if (arena.ones)
+        THCudaStorage_free(state, arena.ones);
+      thcunn_arenas.erase(it++);
+    } else {
+      ++it;
+    }
+  }
+}
+
+#undef WORKSPACE_ALIGN
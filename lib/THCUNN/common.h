@@ -14,13 +14,25 @@
 
 #define THCUNN_assertSameGPU(...) /* whitespace */
 
+// Entry point profiling (THCUNN.profile in Lua, or THCUNN_PROFILE=<prefix> in
+// the environment). Compiled out unless built with -DTHCUNN_PROFILE.
+#ifdef THCUNN_PROFILE
+#include "profile.h"
+#else
+#define THCUNN_PROFILE_FUNC(state) /* whitespace */
+#define THCUNN_PROFILE_TENSOR(t) /* whitespace */
+#define THCUNN_PROFILE_LAUNCH(grid, block) /* whitespace */
+#endif
+
 // Use 1024 threads per block, which requires cuda sm_2x or above
 const int CUDA_NUM_THREADS = 1024;
 
 // CUDA: number of blocks for threads.
 inline int GET_BLOCKS(const int N)
 {
-  return (N + CUDA_NUM_THREADS - 1) / CUDA_NUM_THREADS;
+  int blocks = (N + CUDA_NUM_THREADS - 1) / CUDA_NUM_THREADS;
+  THCUNN_PROFILE_LAUNCH(dim3(blocks), dim3(CUDA_NUM_THREADS));
+  return blocks;
 }
 
 #endif
@@ -0,0 +1,44 @@
+#include "hip/hip_runtime.h"
+#ifndef THCUNN_CONV_ACTIVATION_H
+#define THCUNN_CONV_ACTIVATION_H
+
+// Pointwise activation a convolution applies to its output on the way out,
+// together with the bias, so an inference pass needs no separate kernel for
+// it. The formulas are those of Threshold.cu, ELU.cu and LeakyReLU.cu. The
+// kinds are mirrored by ACTIVATION in ConvolutionActivationFusion.lua.
+
+enum ConvActivationKind
+{
+  CONV_ACTIVATION_NONE = 0,
+  CONV_ACTIVATION_THRESHOLD = 1,   // x > a ? x : b; ReLU is a = b = 0
+  CONV_ACTIVATION_ELU = 2,         // x <= 0 ? (exp(x) - 1) * a : x
+  CONV_ACTIVATION_LEAKY_RELU = 3,  // x > 0 ? x : x * a
+};
+
+struct ConvActivation
+{
+  int kind;
+  float a, b;
+
+  __host__ __device__ __forceinline__ float operator()(float x) const
+  {
+    switch (kind) {
+      case CONV_ACTIVATION_THRESHOLD:
+        return x > a ? x : b;
+      case CONV_ACTIVATION_ELU:
+        return x <= 0 ? (expf(x) - 1) * a : x;
+      case CONV_ACTIVATION_LEAKY_RELU:
+        return x > 0 ? x : x * a;
+      default:
+        return x;
+    }
+  }
+};
+
+inline ConvActivation convActivation_none()
+{
+  ConvActivation act = { CONV_ACTIVATION_NONE, 0, 0 };
+  return act;
+}
+
+#endif
@@ -62,6 +62,63 @@ void im2col(hipStream_t stream, const Dtype* data_im, const int channels,
   THCudaCheck(hipGetLastError());
 }
 
+// Batched unfold: samples [0, batch) of data_im are laid side by side along the
+// columns dimension, so data_col is (channels*ksize_h*ksize_w) x (batch*height_col*width_col)
+// and a whole chunk of the batch can be fed to a single GEMM.
+template <typename Dtype>
+__global__ void im2col_batched_kernel( const int n, const Dtype* data_im,
+                              const int batch, const int channels,
+                              const int height, const int width,
+                              const int ksize_h, const int ksize_w,
+                              const int pad_h, const int pad_w,
+                              const int stride_h, const int stride_w,
+                              const int dilation_h, const int dilation_w,
+                              const int height_col, const int width_col,
+    Dtype* data_col) {
+  CUDA_KERNEL_LOOP(index, n) {
+    int w_out = index % width_col;
+    int h_out = (index / width_col) % height_col;
+    int channel_in = (index / width_col / height_col) % channels;
+    int elt = index / width_col / height_col / channels;
+    int channel_out = channel_in * ksize_h * ksize_w;
+    int h_in = h_out * stride_h - pad_h;
+    int w_in = w_out * stride_w - pad_w;
+    int plane_col = height_col * width_col;
+    int ld_col = batch * plane_col;
+    Dtype* col = data_col + (long)channel_out * ld_col + elt * plane_col + h_out * width_col + w_out;
+    const Dtype* im = data_im + ((long)(elt * channels + channel_in) * height + h_in) * width + w_in;
+    for (int i = 0; i < ksize_h; ++i) {
+      for (int j = 0; j < ksize_w; ++j) {
+        int h = h_in + i * dilation_h;
+        int w = w_in + j * dilation_w;
+        *col = (h >= 0 && w >= 0 && h < height && w < width) ?
+          im[i * dilation_h * width + j * dilation_w] : 0;
+        col += ld_col;
+      }
+    }
+  }
+}
+
+template <typename Dtype>
+void im2col_batched(hipStream_t stream, const Dtype* data_im, const int batch,
+            const int channels, const int height, const int width,
+            const int ksize_h, const int ksize_w, const int pad_h,
+            const int pad_w, const int stride_h, const int stride_w,
+            const int dilation_h, const int dilation_w, Dtype* data_col) {
+  int height_col = (height + 2 * pad_h - (dilation_h * (ksize_h - 1) + 1))
+                   / stride_h + 1;
+  int width_col = (width + 2 * pad_w - (dilation_w * (ksize_w - 1) + 1))
+                  / stride_w + 1;
+  int num_kernels = batch * channels * height_col * width_col;
+  hipLaunchKernelGGL((im2col_batched_kernel), dim3(GET_BLOCKS(num_kernels)), dim3(CUDA_NUM_THREADS), 0, stream, 
+      num_kernels, data_im, batch, channels, height, width, ksize_h, ksize_w,
+      pad_h, pad_w, stride_h, stride_w,
+      dilation_h, dilation_w,
+      height_col, width_col, data_col
+  );
+  THCudaCheck(hipGetLastError());
+}
+
 template <typename Dtype>
 __global__ void col2im_kernel( const int n, const Dtype* data_col,
                                   const int height, const int width, const int channels,
@@ -125,4 +182,70 @@ void col2im(hipStream_t stream, const Dtype* data_col, const int channels,
   THCudaCheck(hipGetLastError());
 }
 
+// Inverse of im2col_batched: folds a (channels*patch_h*patch_w) x (batch*height_col*width_col)
+// buffer back into batch consecutive images.
+template <typename Dtype>
+__global__ void col2im_batched_kernel( const int n, const Dtype* data_col,
+                                  const int batch,
+                                  const int height, const int width, const int channels,
+                                  const int kernel_h, const int kernel_w,
+                                  const int pad_h, const int pad_w,
+                                  const int stride_h, const int stride_w,
+                                  const int dilation_h, const int dilation_w,
+                                  const int height_col, const int width_col,
+                                  Dtype* data_im) {
+  CUDA_KERNEL_LOOP(index, n) {
+    Dtype val = 0;
+    const int w_im = index % width + pad_w;
+    const int h_im = (index / width) % height + pad_h;
+    const int c_im = (index / (width * height)) % channels;
+    const int elt = index / (width * height * channels);
+    const int plane_col = height_col * width_col;
+    const long ld_col = (long)batch * plane_col;
+    int kernel_extent_w = (kernel_w - 1) * dilation_w + 1;
+    int kernel_extent_h = (kernel_h - 1) * dilation_h + 1;
+    // compute the start and end of the output
+    const int w_col_start =
+      (w_im < kernel_extent_w) ? 0 : (w_im - kernel_extent_w) / stride_w + 1;
+    const int w_col_end = min(w_im / stride_w + 1, width_col);
+    const int h_col_start =
+      (h_im < kernel_extent_h) ? 0 : (h_im - kernel_extent_h) / stride_h + 1;
+    const int h_col_end = min(h_im / stride_h + 1, height_col);
+    for (int h_col = h_col_start; h_col < h_col_end; h_col += 1) {
+      for (int w_col = w_col_start; w_col < w_col_end; w_col += 1) {
+        int h_k = (h_im - h_col * stride_h);
+        int w_k = (w_im - w_col * stride_w);
+        if (h_k % dilation_h == 0 && w_k % dilation_w == 0) {
+          h_k /= dilation_h;
+          w_k /= dilation_w;
+          long data_col_index = ((c_im * kernel_h + h_k) * kernel_w + w_k) * ld_col
+                                + elt * plane_col + h_col * width_col + w_col;
+          val += data_col[data_col_index];
+        }
+      }
+    }
+    data_im[index] = val;
+  }
+}
+
+template <typename Dtype>
+void col2im_batched(hipStream_t stream, const Dtype* data_col, const int batch,
+            const int channels, const int height, const int width,
+            const int patch_h, const int patch_w, const int pad_h,
+            const int pad_w, const int stride_h, const int stride_w,
+            const int dilation_h, const int dilation_w, Dtype* data_im) {
+  int height_col = (height + 2 * pad_h - (dilation_h * (patch_h - 1) + 1))
+                   / stride_h + 1;
+  int width_col = (width + 2 * pad_w - (dilation_w * (patch_w - 1) + 1))
+                   / stride_w + 1;
+  int num_kernels = batch * channels * height * width;
+  hipLaunchKernelGGL((col2im_batched_kernel), dim3(GET_BLOCKS(num_kernels)), dim3(CUDA_NUM_THREADS), 0, stream, 
+      num_kernels, data_col, batch, height, width, channels,
+      patch_h, patch_w, pad_h, pad_w, stride_h, stride_w,
+      dilation_h, dilation_w,
+      height_col, width_col, data_im
+  );
+  THCudaCheck(hipGetLastError());
+}
+
 #endif
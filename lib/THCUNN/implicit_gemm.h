@@ -0,0 +1,335 @@
+#include "hip/hip_runtime.h"
+#ifndef THCUNN_IMPLICIT_GEMM_H
+#define THCUNN_IMPLICIT_GEMM_H
+
+#include "THCUNN.h"
+#include "common.h"
+#include "conv_activation.h"
+
+#include <string>
+
+// Implicit-GEMM convolution.
+//
+// im2col/vol2col write the unfolded input (channels*kSize rows of outSize
+// columns per sample) to global memory, only for a BLAS GEMM to read it back.
+// The kernel below runs the same GEMMs but gathers every TILE_K x TILE_N tile
+// of the unfolded operand straight from the input (or gradOutput) into shared
+// memory, so the columns buffer never exists. The batch is folded into the
+// GEMM, so each pass is a single launch:
+//
+//   forward     output[b][o][p]     = sum_{c,r} weight[o][c][r] * unfold(input[b])[c,r][p] + bias[o]
+//   gradInput   gradInput[b][c][q]  = sum_{o,r} weight[o][c][r] * fold(gradOutput[b])[o,r][q]
+//   gradWeight  gradWeight[o][c,r] += scale * sum_{b,p} gradOutput[b][o][p] * unfold(input[b])[c,r][p]
+//
+// with r running over the kernel window, p over output and q over input
+// positions. gradWeight sums over the whole batch, so its reduction is split
+// across blocks and accumulated with atomics.
+
+#define IMPLICIT_GEMM_TILE_M 64
+#define IMPLICIT_GEMM_TILE_N 64
+#define IMPLICIT_GEMM_TILE_K 16
+#define IMPLICIT_GEMM_THREADS 16  // per block side; each thread owns a 4x4 sub-tile
+#define IMPLICIT_GEMM_SUB (IMPLICIT_GEMM_TILE_M / IMPLICIT_GEMM_THREADS)
+
+// Shape of a convolution of up to three spatial dimensions, outermost first.
+// 2-D convolutions have in[0] = out[0] = k[0] = 1.
+struct ConvGeometry
+{
+  int batch, channels, planes;
+  int in[3], out[3];
+  int k[3], pad[3], stride[3], dil[3];
+
+  __host__ __device__ int inSize() const { return in[0] * in[1] * in[2]; }
+  __host__ __device__ int outSize() const { return out[0] * out[1] * out[2]; }
+  __host__ __device__ int kSize() const { return k[0] * k[1] * k[2]; }
+};
+
+inline ConvGeometry convGeometry3d(long batch, long channels, long planes,
+                                   long in0, long in1, long in2,
+                                   long out0, long out1, long out2,
+                                   int k0, int k1, int k2,
+                                   int pad0, int pad1, int pad2,
+                                   int stride0, int stride1, int stride2,
+                                   int dil0, int dil1, int dil2)
+{
+  ConvGeometry g = {
+    (int)batch, (int)channels, (int)planes,
+    {(int)in0, (int)in1, (int)in2}, {(int)out0, (int)out1, (int)out2},
+    {k0, k1, k2}, {pad0, pad1, pad2}, {stride0, stride1, stride2}, {dil0, dil1, dil2}
+  };
+  return g;
+}
+
+inline ConvGeometry convGeometry2d(long batch, long channels, long planes,
+                                   long inH, long inW, long outH, long outW,
+                                   int kH, int kW, int padH, int padW,
+                                   int dH, int dW, int dilationH, int dilationW)
+{
+  return convGeometry3d(batch, channels, planes, 1, inH, inW, 1, outH, outW,
+                        1, kH, kW, 0, padH, padW, 1, dH, dW, 1, dilationH, dilationW);
+}
+
+// Paths a convolution pass can take
+#define IMPLICIT_GEMM_COLUMNS 0
+#define IMPLICIT_GEMM_IMPLICIT 1
+#define IMPLICIT_GEMM_WINOGRAD 2
+#define IMPLICIT_GEMM_PATHS 3
+
+// Chooses the path of one pass, following THCUNN.setImplicitGemm. In the
+// default mode the first passes of each (pass, GEMM shape bucket) alternate
+// between the candidate paths and time themselves; later passes take the
+// fastest, which is kept with the launch tuning choices (tuning.h). With
+// tuning disabled the columns path is used. Passes whose implicit kernel
+// accumulates with atomics (atomic set) only take it when it is forced, so
+// results stay reproducible by default.
+//
+// Declare one after the argument checks of the pass: a timed pass ends when
+// it goes out of scope, so every path is measured over the same work.
+class ImplicitGemmChoice
+{
+public:
+  ImplicitGemmChoice(THCState *state, const char *pass, bool atomic = false);
+  ~ImplicitGemmChoice();
+
+  // Path to take; called once, where the pass branches. With winograd set
+  // the Winograd path is timed against the others, and is never taken
+  // unmeasured.
+  int path(const ConvGeometry &g, bool winograd = false);
+  // Whether to run the implicit kernels
+  bool use(const ConvGeometry &g) { return path(g) == IMPLICIT_GEMM_IMPLICIT; }
+
+private:
+  THCState *state_;
+  const char *pass_;
+  bool atomic_;
+  std::string device_, kernel_;
+  int candidates_;  // as recorded in the tuning cache
+  long size_;
+  int path_;        // path being timed, -1 if none
+  int paths_;       // paths timed in its bucket
+  hipEvent_t start_, stop_;
+};
+
+// unfold(input[b])[row][p], row = (c, k0, k1, k2), p = (o0, o1, o2)
+__device__ __forceinline__ float implicitGemm_unfold(
+    const ConvGeometry &g, const float *input, int b, int row, int p)
+{
+  int r = row % g.kSize();
+  int c = row / g.kSize();
+  int k2 = r % g.k[2]; r /= g.k[2];
+  int k1 = r % g.k[1];
+  int k0 = r / g.k[1];
+  int o2 = p % g.out[2]; p /= g.out[2];
+  int o1 = p % g.out[1];
+  int o0 = p / g.out[1];
+  int i0 = o0 * g.stride[0] - g.pad[0] + k0 * g.dil[0];
+  int i1 = o1 * g.stride[1] - g.pad[1] + k1 * g.dil[1];
+  int i2 = o2 * g.stride[2] - g.pad[2] + k2 * g.dil[2];
+  if (i0 < 0 || i0 >= g.in[0] || i1 < 0 || i1 >= g.in[1] || i2 < 0 || i2 >= g.in[2])
+    return 0;
+  return input[(((b * g.channels + c) * g.in[0] + i0) * g.in[1] + i1) * g.in[2] + i2];
+}
+
+// The transpose of the above: the gradOutput element that input position
+// q = (i0, i1, i2) received through kernel tap row = (o, k0, k1, k2), or 0
+// when the tap does not land on an output position.
+__device__ __forceinline__ float implicitGemm_fold(
+    const ConvGeometry &g, const float *gradOutput, int b, int row, int q)
+{
+  int r = row % g.kSize();
+  int o = row / g.kSize();
+  int k2 = r % g.k[2]; r /= g.k[2];
+  int k1 = r % g.k[1];
+  int k0 = r / g.k[1];
+  int i2 = q % g.in[2]; q /= g.in[2];
+  int i1 = q % g.in[1];
+  int i0 = q / g.in[1];
+  int t0 = i0 + g.pad[0] - k0 * g.dil[0];
+  int t1 = i1 + g.pad[1] - k1 * g.dil[1];
+  int t2 = i2 + g.pad[2] - k2 * g.dil[2];
+  if (t0 < 0 || t1 < 0 || t2 < 0 ||
+      t0 % g.stride[0] || t1 % g.stride[1] || t2 % g.stride[2])
+    return 0;
+  int o0 = t0 / g.stride[0];
+  int o1 = t1 / g.stride[1];
+  int o2 = t2 / g.stride[2];
+  if (o0 >= g.out[0] || o1 >= g.out[1] || o2 >= g.out[2])
+    return 0;
+  return gradOutput[(((b * g.planes + o) * g.out[0] + o0) * g.out[1] + o1) * g.out[2] + o2];
+}
+
+// Each problem is a GEMM C[M][N] = A[M][K] * B[K][N] whose operands are read
+// through a(m, k) and b(k, n) and whose result goes out through store(m, n, v).
+// Problems with splitK set may be reduced over several blocks per tile.
+
+struct ImplicitGemmForward
+{
+  static const bool splitK = false;
+  ConvGeometry g;
+  const float *input, *weight, *bias;
+  float *output;
+  ConvActivation act;
+  int M, N, K;
+
+  ImplicitGemmForward(const ConvGeometry &g, const float *input, const float *weight,
+                      const float *bias, float *output,
+                      const ConvActivation &act = convActivation_none())
+    : g(g), input(input), weight(weight), bias(bias), output(output), act(act),
+      M(g.planes), N(g.batch * g.outSize()), K(g.channels * g.kSize()) {}
+
+  __device__ float a(int m, int k) const { return weight[m * K + k]; }
+  __device__ float b(int k, int n) const {
+    return implicitGemm_unfold(g, input, n / g.outSize(), k, n % g.outSize());
+  }
+  __device__ void store(int m, int n, float v) const {
+    int b = n / g.outSize();
+    output[(b * g.planes + m) * g.outSize() + n % g.outSize()] = act(bias ? v + bias[m] : v);
+  }
+};
+
+struct ImplicitGemmGradInput
+{
+  static const bool splitK = false;
+  ConvGeometry g;
+  const float *gradOutput, *weight;
+  float *gradInput;
+  int M, N, K;
+
+  ImplicitGemmGradInput(const ConvGeometry &g, const float *gradOutput, const float *weight,
+                        float *gradInput)
+    : g(g), gradOutput(gradOutput), weight(weight), gradInput(gradInput),
+      M(g.channels), N(g.batch * g.inSize()), K(g.planes * g.kSize()) {}
+
+  __device__ float a(int m, int k) const {
+    return weight[((k / g.kSize()) * g.channels + m) * g.kSize() + k % g.kSize()];
+  }
+  __device__ float b(int k, int n) const {
+    return implicitGemm_fold(g, gradOutput, n / g.inSize(), k, n % g.inSize());
+  }
+  __device__ void store(int m, int n, float v) const {
+    int b = n / g.inSize();
+    gradInput[(b * g.channels + m) * g.inSize() + n % g.inSize()] = v;
+  }
+};
+
+// The bias gradient rides along as one extra column of ones in B.
+struct ImplicitGemmGradWeight
+{
+  static const bool splitK = true;
+  ConvGeometry g;
+  const float *input, *gradOutput;
+  float *gradWeight, *gradBias;
+  float scale;
+  int rows, M, N, K;
+
+  ImplicitGemmGradWeight(const ConvGeometry &g, const float *input, const float *gradOutput,
+                         float *gradWeight, float *gradBias, float scale)
+    : g(g), input(input), gradOutput(gradOutput), gradWeight(gradWeight),
+      gradBias(gradBias), scale(scale), rows(g.channels * g.kSize()),
+      M(g.planes), N(rows + (gradBias ? 1 : 0)), K(g.batch * g.outSize()) {}
+
+  __device__ float a(int m, int k) const {
+    int b = k / g.outSize();
+    return gradOutput[(b * g.planes + m) * g.outSize() + k % g.outSize()];
+  }
+  __device__ float b(int k, int n) const {
+    if (n == rows)
+      return 1;
+    return implicitGemm_unfold(g, input, k / g.outSize(), n, k % g.outSize());
+  }
+  __device__ void store(int m, int n, float v) const {
+    atomicAdd(n == rows ? &gradBias[m] : &gradWeight[m * rows + n], scale * v);
+  }
+};
+
+template <typename Problem>
+__global__ void implicitGemm_kernel(const Problem p, const int kSlice)
+{
+  __shared__ float As[IMPLICIT_GEMM_TILE_K][IMPLICIT_GEMM_TILE_M];
+  __shared__ float Bs[IMPLICIT_GEMM_TILE_K][IMPLICIT_GEMM_TILE_N];
+
+  const int tx = hipThreadIdx_x;
+  const int ty = hipThreadIdx_y;
+  const int tid = ty * IMPLICIT_GEMM_THREADS + tx;
+  const int threads = IMPLICIT_GEMM_THREADS * IMPLICIT_GEMM_THREADS;
+  const int m0 = hipBlockIdx_y * IMPLICIT_GEMM_TILE_M;
+  const int n0 = hipBlockIdx_x * IMPLICIT_GEMM_TILE_N;
+  const int kBegin = hipBlockIdx_z * kSlice;
+  const int kEnd = min(kBegin + kSlice, p.K);
+
+  float acc[IMPLICIT_GEMM_SUB][IMPLICIT_GEMM_SUB];
+  for (int i = 0; i < IMPLICIT_GEMM_SUB; i++)
+    for (int j = 0; j < IMPLICIT_GEMM_SUB; j++)
+      acc[i][j] = 0;
+
+  for (int k0 = kBegin; k0 < kEnd; k0 += IMPLICIT_GEMM_TILE_K) {
+    // A is read along k, B along n: consecutive threads touch neighbouring
+    // weights and neighbouring output positions respectively
+    for (int e = tid; e < IMPLICIT_GEMM_TILE_K * IMPLICIT_GEMM_TILE_M; e += threads) {
+      int kk = e % IMPLICIT_GEMM_TILE_K;
+      int mm = e / IMPLICIT_GEMM_TILE_K;
+      int m = m0 + mm, k = k0 + kk;
+      As[kk][mm] = (m < p.M && k < kEnd) ? p.a(m, k) : 0;
+    }
+    for (int e = tid; e < IMPLICIT_GEMM_TILE_K * IMPLICIT_GEMM_TILE_N; e += threads) {
+      int nn = e % IMPLICIT_GEMM_TILE_N;
+      int kk = e / IMPLICIT_GEMM_TILE_N;
+      int n = n0 + nn, k = k0 + kk;
+      Bs[kk][nn] = (n < p.N && k < kEnd) ? p.b(k, n) : 0;
+    }
+    __syncthreads();
+
+    for (int kk = 0; kk < IMPLICIT_GEMM_TILE_K; kk++) {
+      float a[IMPLICIT_GEMM_SUB], b[IMPLICIT_GEMM_SUB];
+      for (int i = 0; i < IMPLICIT_GEMM_SUB; i++) {
+        a[i] = As[kk][ty + i * IMPLICIT_GEMM_THREADS];
+        b[i] = Bs[kk][tx + i * IMPLICIT_GEMM_THREADS];
+      }
+      for (int i = 0; i < IMPLICIT_GEMM_SUB; i++)
+        for (int j = 0; j < IMPLICIT_GEMM_SUB; j++)
+          acc[i][j] += a[i] * b[j];
+    }
+    __syncthreads();
+  }
+
+  for (int i = 0; i < IMPLICIT_GEMM_SUB; i++) {
+    int m = m0 + ty + i * IMPLICIT_GEMM_THREADS;
+    for (int j = 0; j < IMPLICIT_GEMM_SUB; j++) {
+      int n = n0 + tx + j * IMPLICIT_GEMM_THREADS;
+      if (m < p.M && n < p.N)
+        p.store(m, n, acc[i][j]);
+    }
+  }
+}
+
+// Split-K problems get enough slices of the reduction to give every compute
+// unit a few blocks, as long as each slice keeps at least 8 k-tiles.
+template <typename Problem>
+void implicitGemm(THCState *state, const Problem &p)
+{
+  dim3 grid((p.N + IMPLICIT_GEMM_TILE_N - 1) / IMPLICIT_GEMM_TILE_N,
+            (p.M + IMPLICIT_GEMM_TILE_M - 1) / IMPLICIT_GEMM_TILE_M);
+  dim3 block(IMPLICIT_GEMM_THREADS, IMPLICIT_GEMM_THREADS);
+
+  int kSlice = p.K;
+  if (Problem::splitK) {
+    long wanted = 4L * THCState_getCurrentDeviceProperties(state)->multiProcessorCount;
+    long tiles = (long)grid.x * grid.y;
+    long slices = (wanted + tiles - 1) / tiles;
+    long maxSlices = (p.K + 8 * IMPLICIT_GEMM_TILE_K - 1) / (8 * IMPLICIT_GEMM_TILE_K);
+    if (slices > maxSlices)
+      slices = maxSlices;
+    if (slices > 1) {
+      kSlice = (p.K + slices - 1) / slices;
+      kSlice = (kSlice + IMPLICIT_GEMM_TILE_K - 1) / IMPLICIT_GEMM_TILE_K * IMPLICIT_GEMM_TILE_K;
+      grid.z = (p.K + kSlice - 1) / kSlice;
+    }
+  }
+
+  THCUNN_PROFILE_LAUNCH(grid, block);
+  hipLaunchKernelGGL((implicitGemm_kernel<Problem>), grid, block, 0, THCState_getCurrentStream(state),
+      p, kSlice);
+  THCudaCheck(hipGetLastError());
+}
+
+#endif
@@ -0,0 +1,55 @@
+#include "hip/hip_runtime.h"
+#ifndef THCUNN_NLL_REDUCE_H
+#define THCUNN_NLL_REDUCE_H
+
+#include "common.h"
+#include "wavefront.h"
+
+// Two-stage, grid-wide reduction of (loss, weight) pairs shared by the NLL
+// criterions. Every block of the first stage writes its partial sums to
+// partials[2*blockIdx] and partials[2*blockIdx+1]; a single block then folds
+// the partials in a fixed order. Nothing is accumulated with atomics, so the
+// result only depends on the launch configuration, which in turn only depends
+// on the input shape: runs are bit-for-bit reproducible.
+
+const int NLL_REDUCE_THREADS = 256;
+// Upper bound on first-stage blocks; each thread then covers several frames
+const int NLL_REDUCE_MAX_BLOCKS = 512;
+
+inline int NLL_REDUCE_BLOCKS(const long n)
+{
+  long blocks = (n + NLL_REDUCE_THREADS - 1) / NLL_REDUCE_THREADS;
+  return blocks > NLL_REDUCE_MAX_BLOCKS ? NLL_REDUCE_MAX_BLOCKS : (blocks < 1 ? 1 : blocks);
+}
+
+// Reduction of one pair per thread; every thread gets the result.
+// hipBlockDim_x must be NLL_REDUCE_THREADS.
+__device__ __forceinline__ void nllReduceBlock(float &loss, float &weight)
+{
+  loss = blockReduce(loss, WaveSum(), 0.0f);
+  weight = blockReduce(weight, WaveSum(), 0.0f);
+}
+
+// Second stage: folds n_partials pairs into output and total_weight.
+__global__ void cunn_NLLCriterion_reducePartials_kernel(
+  float *output,
+  float *total_weight,
+  float *partials,
+  int n_partials,
+  int size_average)
+{
+  float loss = 0.0f;
+  float weight = 0.0f;
+  for (int i = hipThreadIdx_x; i < n_partials; i += NLL_REDUCE_THREADS) {
+    loss += partials[2 * i];
+    weight += partials[2 * i + 1];
+  }
+  nllReduceBlock(loss, weight);
+
+  if (hipThreadIdx_x == 0) {
+    *total_weight = weight;
+    *output = (size_average && weight > 0) ? loss / weight : loss;
+  }
+}
+
+#endif
@@ -0,0 +1,255 @@
+#include "hip/hip_runtime.h"
+#ifndef THCUNN_POINTWISE_FUSION_H
+#define THCUNN_POINTWISE_FUSION_H
+
+#include "THCUNN.h"
+#include "common.h"
+
+// Fused chains of pointwise activations.
+//
+// Each op below is the functor pair of one activation file (Square.cu,
+// Sqrt.cu, Tanh.cu, ...) with a common interface:
+//
+//   forward(x)          y = f(x)
+//   backward(x, y, g)   g * f'(x), given y = f(x)
+//
+// PointwiseChain<Op1, Op2, ...> composes them at compile time into one op
+// computing ... Op2(Op1(x)). Its backward recomputes the intermediate values
+// from the chain input, so both passes read and write the tensor once,
+// however long the chain. PointwiseProgram runs a chain chosen at run time
+// through the same ops.
+
+// Op codes of THNN_CudaPointwiseFused_*, mirrored by OP in PointwiseFused.lua;
+// a and b are the op parameters
+enum PointwiseOpCode
+{
+  POINTWISE_ABS = 1,
+  POINTWISE_SQUARE = 2,
+  POINTWISE_SQRT = 3,         // a: eps
+  POINTWISE_TANH = 4,
+  POINTWISE_SIGMOID = 5,
+  POINTWISE_THRESHOLD = 6,    // a: threshold, b: val
+  POINTWISE_HARDTANH = 7,     // a: min_val, b: max_val
+  POINTWISE_SOFTPLUS = 8,     // a: beta, b: threshold
+  POINTWISE_ELU = 9,          // a: alpha
+  POINTWISE_LEAKY_RELU = 10,  // a: negval
+};
+
+#define POINTWISE_MAX_OPS 8
+
+struct PointwiseAbs
+{
+  __host__ __device__ PointwiseAbs(float a = 0, float b = 0) {}
+  __device__ float forward(float x) const { return fabsf(x); }
+  __device__ float backward(float x, float y, float g) const { return x < 0 ? -g : g; }
+};
+
+struct PointwiseSquare
+{
+  __host__ __device__ PointwiseSquare(float a = 0, float b = 0) {}
+  __device__ float forward(float x) const { return x * x; }
+  __device__ float backward(float x, float y, float g) const { return 2.0f * g * x; }
+};
+
+struct PointwiseSqrt
+{
+  float eps;
+  __host__ __device__ PointwiseSqrt(float a = 0, float b = 0) : eps(a) {}
+  __device__ float forward(float x) const { return sqrt(x + eps); }
+  __device__ float backward(float x, float y, float g) const { return y == 0.0f ? 0.0f : (0.5f * g) / y; }
+};
+
+struct PointwiseTanh
+{
+  __host__ __device__ PointwiseTanh(float a = 0, float b = 0) {}
+  __device__ float forward(float x) const { return tanh(x); }
+  __device__ float backward(float x, float y, float g) const { return g * (1 - y * y); }
+};
+
+struct PointwiseSigmoid
+{
+  __host__ __device__ PointwiseSigmoid(float a = 0, float b = 0) {}
+  __device__ float forward(float x) const { return 1.f / (1.f + exp(-x)); }
+  __device__ float backward(float x, float y, float g) const { return g * (1.f - y) * y; }
+};
+
+struct PointwiseThreshold
+{
+  float threshold, val;
+  __host__ __device__ PointwiseThreshold(float a = 0, float b = 0) : threshold(a), val(b) {}
+  __device__ float forward(float x) const { return x > threshold ? x : val; }
+  __device__ float backward(float x, float y, float g) const { return x > threshold ? g : 0; }
+};
+
+struct PointwiseHardTanh
+{
+  float min_val, max_val;
+  __host__ __device__ PointwiseHardTanh(float a = -1, float b = 1) : min_val(a), max_val(b) {}
+  __device__ float forward(float x) const { return x < min_val ? min_val : (x <= max_val ? x : max_val); }
+  __device__ float backward(float x, float y, float g) const { return x < min_val || x > max_val ? 0 : g; }
+};
+
+struct PointwiseSoftPlus
+{
+  float beta, threshold;
+  __host__ __device__ PointwiseSoftPlus(float a = 1, float b = 20) : beta(a), threshold(b) {}
+  __device__ float forward(float x) const
+  {
+    float betain = beta * x;
+    return betain > threshold ? x : (1 / beta) * log1p(exp(betain));
+  }
+  __device__ float backward(float x, float y, float g) const
+  {
+    float betaout = beta * y;
+    float exp_bo = exp(betaout);
+    return betaout > threshold ? g : g * (exp_bo - 1) / exp_bo;
+  }
+};
+
+struct PointwiseELU
+{
+  float alpha;
+  __host__ __device__ PointwiseELU(float a = 1, float b = 0) : alpha(a) {}
+  __device__ float forward(float x) const { return x <= 0 ? (exp(x) - 1) * alpha : x; }
+  __device__ float backward(float x, float y, float g) const { return y <= 0 ? g * (y + alpha) : g; }
+};
+
+struct PointwiseLeakyReLU
+{
+  float negval;
+  __host__ __device__ PointwiseLeakyReLU(float a = 0.01f, float b = 0) : negval(a) {}
+  __device__ float forward(float x) const { return x > 0 ? x : x * negval; }
+  __device__ float backward(float x, float y, float g) const { return x > 0 ? g : g * negval; }
+};
+
+// Compile-time composition: Op first, then Rest...
+template <typename Op, typename... Rest>
+struct PointwiseChain
+{
+  Op op;
+  PointwiseChain<Rest...> rest;
+
+  __host__ __device__ PointwiseChain(const float *a, const float *b)
+    : op(a[0], b[0]), rest(a + 1, b + 1) {}
+
+  __device__ float forward(float x) const { return rest.forward(op.forward(x)); }
+  // gradient of the whole chain at its input x
+  __device__ float backward(float x, float g) const
+  {
+    float y = op.forward(x);
+    return op.backward(x, y, rest.backward(y, g));
+  }
+};
+
+template <typename Op>
+struct PointwiseChain<Op>
+{
+  Op op;
+
+  __host__ __device__ PointwiseChain(const float *a, const float *b) : op(a[0], b[0]) {}
+
+  __device__ float forward(float x) const { return op.forward(x); }
+  __device__ float backward(float x, float g) const { return op.backward(x, op.forward(x), g); }
+};
+
+// Run-time composition of up to POINTWISE_MAX_OPS ops, passed by value to
+// the kernel. Intermediate values are kept in registers for the backward.
+struct PointwiseProgram
+{
+  int n;
+  int op[POINTWISE_MAX_OPS];
+  float a[POINTWISE_MAX_OPS], b[POINTWISE_MAX_OPS];
+
+  __device__ static float forwardOp(int op, float a, float b, float x)
+  {
+    switch (op) {
+      case POINTWISE_ABS: return PointwiseAbs(a, b).forward(x);
+      case POINTWISE_SQUARE: return PointwiseSquare(a, b).forward(x);
+      case POINTWISE_SQRT: return PointwiseSqrt(a, b).forward(x);
+      case POINTWISE_TANH: return PointwiseTanh(a, b).forward(x);
+      case POINTWISE_SIGMOID: return PointwiseSigmoid(a, b).forward(x);
+      case POINTWISE_THRESHOLD: return PointwiseThreshold(a, b).forward(x);
+      case POINTWISE_HARDTANH: return PointwiseHardTanh(a, b).forward(x);
+      case POINTWISE_SOFTPLUS: return PointwiseSoftPlus(a, b).forward(x);
+      case POINTWISE_ELU: return PointwiseELU(a, b).forward(x);
+      default: return PointwiseLeakyReLU(a, b).forward(x);
+    }
+  }
+
+  __device__ static float backwardOp(int op, float a, float b, float x, float y, float g)
+  {
+    switch (op) {
+      case POINTWISE_ABS: return PointwiseAbs(a, b).backward(x, y, g);
+      case POINTWISE_SQUARE: return PointwiseSquare(a, b).backward(x, y, g);
+      case POINTWISE_SQRT: return PointwiseSqrt(a, b).backward(x, y, g);
+      case POINTWISE_TANH: return PointwiseTanh(a, b).backward(x, y, g);
+      case POINTWISE_SIGMOID: return PointwiseSigmoid(a, b).backward(x, y, g);
+      case POINTWISE_THRESHOLD: return PointwiseThreshold(a, b).backward(x, y, g);
+      case POINTWISE_HARDTANH: return PointwiseHardTanh(a, b).backward(x, y, g);
+      case POINTWISE_SOFTPLUS: return PointwiseSoftPlus(a, b).backward(x, y, g);
+      case POINTWISE_ELU: return PointwiseELU(a, b).backward(x, y, g);
+      default: return PointwiseLeakyReLU(a, b).backward(x, y, g);
+    }
+  }
+
+  __device__ float forward(float x) const
+  {
+    for (int i = 0; i < n; i++)
+      x = forwardOp(op[i], a[i], b[i], x);
+    return x;
+  }
+
+  __device__ float backward(float x, float g) const
+  {
+    float v[POINTWISE_MAX_OPS + 1];
+    v[0] = x;
+#pragma unroll
+    for (int i = 0; i < POINTWISE_MAX_OPS; i++)
+      if (i < n)
+        v[i + 1] = forwardOp(op[i], a[i], b[i], v[i]);
+#pragma unroll
+    for (int i = POINTWISE_MAX_OPS - 1; i >= 0; i--)
+      if (i < n)
+        g = backwardOp(op[i], a[i], b[i], v[i], v[i + 1], g);
+    return g;
+  }
+};
+
+template <typename Chain>
+struct pointwiseFusedUpdateOutput_functor
+{
+  Chain chain;
+
+  __host__ __device__
+  pointwiseFusedUpdateOutput_functor(const Chain &chain_)
+    : chain(chain_)
+  {}
+
+  __device__ void operator()(float *output, const float *input) const
+  {
+    *output = chain.forward(*input);
+  }
+
+  __device__ void operator()(float *x) const
+  {
+    *x = chain.forward(*x);
+  }
+};
+
+template <typename Chain>
+struct pointwiseFusedUpdateGradInput_functor
+{
+  Chain chain;
+
+  __host__ __device__
+  pointwiseFusedUpdateGradInput_functor(const Chain &chain_)
+    : chain(chain_)
+  {}
+
+  __device__ void operator()(float *gradInput, const float *input, const float *gradOutput) const
+  {
+    *gradInput = chain.backward(*input, *gradOutput);
+  }
+};
+
+#endif
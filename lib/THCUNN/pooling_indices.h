@@ -0,0 +1,149 @@
+#include "hip/hip_runtime.h"
+#ifndef THCUNN_POOLING_INDICES_H
+#define THCUNN_POOLING_INDICES_H
+
+#include "THCUNN.h"
+#include "THCDeviceTensor.cuh"
+
+// Argmax formats shared by the max-pooling and max-unpooling kernels, picked
+// by the element type of the indices tensor:
+//
+//  - float (THCudaTensor): for 2D, the offset h * width + w of the maximum in
+//    its input plane plus TH_INDEX_BASE, -1 + TH_INDEX_BASE if the window has
+//    no maximum; exact up to 2^24 elements per plane. For 3D, the frame, row
+//    and column inside the window packed as three bytes of the float.
+//  - unsigned char (THCudaByteTensor, the *Compact entry points): the
+//    position of the maximum inside the window, kh * kW + kw for 2D and
+//    (kt * kH + kh) * kW + kw for 3D, counted in (dilated) steps from the
+//    window origin. A quarter of the bytes, and independent of the plane size.
+//    Windows of up to POOLING_COMPACT_MAX_WINDOW elements.
+
+#define POOLING_COMPACT_NONE 255
+#define POOLING_COMPACT_MAX_WINDOW 255
+
+// Window geometry needed to turn a window position back into an offset
+struct PoolingWindow2d
+{
+  int width;  // of the unpooled plane
+  int kW;
+  int dH, dW;
+  int padH, padW;
+  int dilationH, dilationW;
+};
+
+// 2D: stores the argmax of output element `index`, found at (h, w) of the
+// input plane, the window of output (ph, pw). h is -1 if there is none.
+__device__ __forceinline__ void pooling_store(
+    float *mask, int index, const PoolingWindow2d &g, int ph, int pw, int h, int w)
+{
+  mask[index] = (h < 0 ? -1 : h * g.width + w) + TH_INDEX_BASE;
+}
+
+__device__ __forceinline__ void pooling_store(
+    unsigned char *mask, int index, const PoolingWindow2d &g, int ph, int pw, int h, int w)
+{
+  if (h < 0) {
+    mask[index] = POOLING_COMPACT_NONE;
+    return;
+  }
+  int kh = (h - (ph * g.dH - g.padH)) / g.dilationH;
+  int kw = (w - (pw * g.dW - g.padW)) / g.dilationW;
+  mask[index] = kh * g.kW + kw;
+}
+
+// 2D: offset in the unpooled plane of the argmax of output element `index`
+// at (ph, pw), or -1 if its window had none
+__device__ __forceinline__ int pooling_load(
+    const float *mask, int index, const PoolingWindow2d &g, int ph, int pw)
+{
+  return (int) mask[index] - TH_INDEX_BASE;
+}
+
+__device__ __forceinline__ int pooling_load(
+    const unsigned char *mask, int index, const PoolingWindow2d &g, int ph, int pw)
+{
+  int p = mask[index];
+  if (p == POOLING_COMPACT_NONE)
+    return -1;
+  int h = ph * g.dH - g.padH + (p / g.kW) * g.dilationH;
+  int w = pw * g.dW - g.padW + (p % g.kW) * g.dilationW;
+  return h * g.width + w;
+}
+
+// 3D: (frame, row, column) inside the window, in kernel steps
+__device__ __forceinline__ void pooling_store3d(float *idx, int kH, int kW, int t, int r, int c)
+{
+  ((unsigned char*)(idx))[0] = t;
+  ((unsigned char*)(idx))[1] = r;
+  ((unsigned char*)(idx))[2] = c;
+  ((unsigned char*)(idx))[3] = 0;
+}
+
+__device__ __forceinline__ void pooling_store3d(unsigned char *idx, int kH, int kW, int t, int r, int c)
+{
+  *idx = (t * kH + r) * kW + c;
+}
+
+__device__ __forceinline__ void pooling_load3d(const float *idx, int kH, int kW, int &t, int &r, int &c)
+{
+  t = ((const unsigned char*)(idx))[0];
+  r = ((const unsigned char*)(idx))[1];
+  c = ((const unsigned char*)(idx))[2];
+}
+
+__device__ __forceinline__ void pooling_load3d(const unsigned char *idx, int kH, int kW, int &t, int &r, int &c)
+{
+  int p = *idx;
+  c = p % kW;
+  r = (p / kW) % kH;
+  t = p / (kW * kH);
+}
+
+// Contiguous 4D view of compact 3D indices, laid out like the
+// THCDeviceTensor<float, 4> that holds the float format
+struct CompactIndices4d
+{
+  unsigned char *data;
+  int frames, rows, columns;
+};
+
+// Address of the argmax of output (slice, frame, row, column)
+__device__ __forceinline__ float *pooling_at(
+    THCDeviceTensor<float, 4> &indices, int slice, int frame, int row, int column)
+{
+  return &indices[slice][frame][row][column];
+}
+
+__device__ __forceinline__ unsigned char *pooling_at(
+    const CompactIndices4d &indices, int slice, int frame, int row, int column)
+{
+  return indices.data + (((long) slice * indices.frames + frame) * indices.rows + row) * indices.columns + column;
+}
+
+// Host side: resize indices to the output shape and return its data, for
+// either format
+inline float *pooling_resizeIndices(THCState *state, THCudaTensor *indices,
+                                    long d0, long d1, long d2, long d3)
+{
+  THCudaTensor_resize4d(state, indices, d0, d1, d2, d3);
+  return THCudaTensor_data(state, indices);
+}
+
+inline unsigned char *pooling_resizeIndices(THCState *state, THCudaByteTensor *indices,
+                                            long d0, long d1, long d2, long d3)
+{
+  THCudaByteTensor_resize4d(state, indices, d0, d1, d2, d3);
+  return THCudaByteTensor_data(state, indices);
+}
+
+inline float *pooling_indicesData(THCState *state, THCudaTensor *indices)
+{
+  return THCudaTensor_data(state, indices);
+}
+
+inline unsigned char *pooling_indicesData(THCState *state, THCudaByteTensor *indices)
+{
+  return THCudaByteTensor_data(state, indices);
+}
+
+#endif
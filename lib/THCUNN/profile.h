@@ -0,0 +1,51 @@
+#ifndef THCUNN_PROFILE_H
+#define THCUNN_PROFILE_H
+
+// Per entry point instrumentation, only compiled with -DTHCUNN_PROFILE (see
+// common.h for the no-op versions). A THCUNNProfileScope brackets the body of
+// a THNN_Cuda* function with events on the current stream; the elapsed device
+// time is resolved lazily, when the trace is dumped, so profiling does not add
+// synchronization points to the training loop.
+
+#include "hip/hip_runtime.h"
+#include <THC/THC.h>
+#include "profile_log.h"
+
+class THCUNNProfileScope
+{
+public:
+  THCUNNProfileScope(THCState *state, const char *name);
+  ~THCUNNProfileScope();
+
+  template <typename Tensor>
+  void tensor(Tensor *t)
+  {
+    if (!active_ || t == NULL)
+      return;
+    char buf[32];
+    if (!event_.shapes.empty())
+      event_.shapes += ", ";
+    if (t->nDimension == 0)
+      event_.shapes += "[]";
+    for (int d = 0; d < t->nDimension; d++) {
+      snprintf(buf, sizeof(buf), d == 0 ? "%ld" : "x%ld", t->size[d]);
+      event_.shapes += buf;
+    }
+  }
+
+  // Attributed to the innermost active scope, if any
+  static void launch(dim3 grid, dim3 block);
+
+private:
+  bool active_;
+  THCState *state_;
+  hipEvent_t start_;
+  THCUNNProfileEvent event_;
+  size_t depth_;  // index of this scope's launches, see Profiler.cu
+};
+
+#define THCUNN_PROFILE_FUNC(state) THCUNNProfileScope thcunn_profile_scope(state, __func__)
+#define THCUNN_PROFILE_TENSOR(t) thcunn_profile_scope.tensor(t)
+#define THCUNN_PROFILE_LAUNCH(grid, block) THCUNNProfileScope::launch(grid, block)
+
+#endif
@@ -0,0 +1,139 @@
+#ifndef THCUNN_PROFILE_LOG_H
+#define THCUNN_PROFILE_LOG_H
+
+// Host-side bookkeeping for the THCUNN profiler: a list of timed entry point
+// calls, their aggregation and the Chrome trace / text table writers.
+// Deliberately free of HIP and THC so that it builds with a plain host
+// compiler; the device timing lives in profile.h / Profiler.cu.
+
+#include <stdio.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+struct THCUNNProfileEvent
+{
+  std::string name;    // entry point, e.g. THNN_CudaSoftMax_updateOutput
+  std::string shapes;  // e.g. "128x1000"
+  std::string launch;  // e.g. "grid 128x1x1 block 256x1x1; grid 4x1x1 block 1024x1x1"
+  double start_us;     // host time at entry, microseconds
+  double device_us;    // device time between entry and exit, microseconds
+  int device;
+};
+
+struct THCUNNProfileSummary
+{
+  std::string name;
+  long calls;
+  double total_us;
+  double min_us;
+  double max_us;
+};
+
+class THCUNNProfileLog
+{
+public:
+  void add(const THCUNNProfileEvent &event)
+  {
+    events_.push_back(event);
+  }
+
+  void clear()
+  {
+    events_.clear();
+  }
+
+  const std::vector<THCUNNProfileEvent> &events() const
+  {
+    return events_;
+  }
+
+  // One row per entry point, most expensive first
+  std::vector<THCUNNProfileSummary> summarize() const
+  {
+    std::map<std::string, THCUNNProfileSummary> rows;
+    for (size_t i = 0; i < events_.size(); i++) {
+      const THCUNNProfileEvent &e = events_[i];
+      std::map<std::string, THCUNNProfileSummary>::iterator it = rows.find(e.name);
+      if (it == rows.end()) {
+        THCUNNProfileSummary s = { e.name, 1, e.device_us, e.device_us, e.device_us };
+        rows[e.name] = s;
+      } else {
+        THCUNNProfileSummary &s = it->second;
+        s.calls++;
+        s.total_us += e.device_us;
+        s.min_us = std::min(s.min_us, e.device_us);
+        s.max_us = std::max(s.max_us, e.device_us);
+      }
+    }
+
+    std::vector<THCUNNProfileSummary> result;
+    for (std::map<std::string, THCUNNProfileSummary>::iterator it = rows.begin(); it != rows.end(); ++it)
+      result.push_back(it->second);
+    std::stable_sort(result.begin(), result.end(), byTotalDescending);
+    return result;
+  }
+
+  // Chrome trace event format (chrome://tracing, Perfetto): one complete
+  // ("X") event per call, one track per device
+  void writeChromeTrace(FILE *f) const
+  {
+    fprintf(f, "{\"traceEvents\":[");
+    for (size_t i = 0; i < events_.size(); i++) {
+      const THCUNNProfileEvent &e = events_[i];
+      fprintf(f, "%s\n{\"name\":\"%s\",\"cat\":\"THCUNN\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,"
+              "\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"shapes\":\"%s\",\"launch\":\"%s\"}}",
+              i == 0 ? "" : ",",
+              escape(e.name).c_str(), e.device, e.start_us, e.device_us,
+              escape(e.shapes).c_str(), escape(e.launch).c_str());
+    }
+    fprintf(f, "\n],\"displayTimeUnit\":\"ms\"}\n");
+  }
+
+  void writeSummary(FILE *f) const
+  {
+    std::vector<THCUNNProfileSummary> rows = summarize();
+    double total = 0;
+    for (size_t i = 0; i < rows.size(); i++)
+      total += rows[i].total_us;
+
+    fprintf(f, "%-52s %8s %12s %10s %10s %10s %6s\n",
+            "entry point", "calls", "total (ms)", "avg (us)", "min (us)", "max (us)", "%");
+    for (size_t i = 0; i < rows.size(); i++) {
+      const THCUNNProfileSummary &s = rows[i];
+      fprintf(f, "%-52s %8ld %12.3f %10.1f %10.1f %10.1f %6.1f\n",
+              s.name.c_str(), s.calls, s.total_us / 1000.0, s.total_us / s.calls,
+              s.min_us, s.max_us, total > 0 ? 100.0 * s.total_us / total : 0.0);
+    }
+  }
+
+  static std::string escape(const std::string &s)
+  {
+    std::string out;
+    for (size_t i = 0; i < s.size(); i++) {
+      char c = s[i];
+      if (c == '"' || c == '\\') {
+        out += '\\';
+        out += c;
+      } else if ((unsigned char) c < 0x20) {
+        char buf[8];
+        snprintf(buf, sizeof(buf), "\\u%04x", (unsigned char) c);
+        out += buf;
+      } else {
+        out += c;
+      }
+    }
+    return out;
+  }
+
+private:
+  static bool byTotalDescending(const THCUNNProfileSummary &a, const THCUNNProfileSummary &b)
+  {
+    return a.total_us > b.total_us;
+  }
+
+  std::vector<THCUNNProfileEvent> events_;
+};
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef THCUNN_TEST_HOST_H
+#define THCUNN_TEST_HOST_H
+
+// Minimal checks for the host-only tests; a test binary exits non-zero if
+// any CHECK failed.
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+static int test_failures = 0;
+
+#define CHECK(cond) do {                                                \
+    if (!(cond)) {                                                      \
+      fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+      test_failures++;                                                  \
+    }                                                                   \
+  } while (0)
+
+#define CHECK_EQ(a, b) CHECK((a) == (b))
+
+inline std::string test_readFile(const char *path)
+{
+  std::string s;
+  FILE *f = fopen(path, "r");
+  if (!f)
+    return s;
+  char buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+    s.append(buf, n);
+  fclose(f);
+  return s;
+}
+
+inline int test_count(const std::string &s, const std::string &needle)
+{
+  int n = 0;
+  for (size_t i = s.find(needle); i != std::string::npos; i = s.find(needle, i + 1))
+    n++;
+  return n;
+}
+
+inline int test_result(const char *name)
+{
+  if (test_failures)
+    fprintf(stderr, "%s: %d check(s) failed\n", name, test_failures);
+  else
+    printf("%s: ok\n", name);
+  return test_failures ? 1 : 0;
+}
+
+#endif
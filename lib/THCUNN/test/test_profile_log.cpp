@@ -0,0 +1,88 @@
+#include "profile_log.h"
+#include "test_host.h"
+
+#include <stdlib.h>
+
+static THCUNNProfileEvent event(const char *name, double start, double device, const char *launch)
+{
+  THCUNNProfileEvent e;
+  e.name = name;
+  e.shapes = "16x100";
+  e.launch = launch;
+  e.start_us = start;
+  e.device_us = device;
+  e.device = 0;
+  return e;
+}
+
+static void testSummarize()
+{
+  THCUNNProfileLog log;
+  log.add(event("THNN_CudaSoftMax_updateOutput", 0, 10, ""));
+  log.add(event("THNN_CudaSoftMax_updateOutput", 20, 30, ""));
+  log.add(event("THNN_CudaSoftMax_updateGradInput", 60, 50, ""));
+
+  std::vector<THCUNNProfileSummary> rows = log.summarize();
+  CHECK_EQ(rows.size(), 2u);
+  // most expensive first
+  CHECK_EQ(rows[0].name, "THNN_CudaSoftMax_updateGradInput");
+  CHECK_EQ(rows[0].calls, 1);
+  CHECK_EQ(rows[1].name, "THNN_CudaSoftMax_updateOutput");
+  CHECK_EQ(rows[1].calls, 2);
+  CHECK_EQ(rows[1].total_us, 40);
+  CHECK_EQ(rows[1].min_us, 10);
+  CHECK_EQ(rows[1].max_us, 30);
+
+  log.clear();
+  CHECK(log.events().empty());
+  CHECK(log.summarize().empty());
+}
+
+static void testEscape()
+{
+  CHECK_EQ(THCUNNProfileLog::escape("a\"b\\c"), "a\\\"b\\\\c");
+  CHECK_EQ(THCUNNProfileLog::escape("a\nb"), "a\\u000ab");
+  CHECK_EQ(THCUNNProfileLog::escape("grid 1x1x1"), "grid 1x1x1");
+}
+
+static void testWriters()
+{
+  THCUNNProfileLog log;
+  log.add(event("THNN_CudaSoftMax_updateOutput", 5, 12.5, "grid 16x1x1 block 64x4x1"));
+  log.add(event("THNN_CudaSoftMax_updateOutput", 25, 7.5, "grid 16x1x1 block 64x4x1"));
+
+  char trace[] = "/tmp/thcunn_traceXXXXXX";
+  char summary[] = "/tmp/thcunn_summaryXXXXXX";
+  int fdTrace = mkstemp(trace), fdSummary = mkstemp(summary);
+  CHECK(fdTrace >= 0 && fdSummary >= 0);
+
+  FILE *f = fdopen(fdTrace, "w");
+  log.writeChromeTrace(f);
+  fclose(f);
+  std::string json = test_readFile(trace);
+  CHECK_EQ(test_count(json, "\"name\":\"THNN_CudaSoftMax_updateOutput\""), 2);
+  CHECK_EQ(test_count(json, "\"ph\":\"X\""), 2);
+  CHECK(json.find("\"shapes\":\"16x100\"") != std::string::npos);
+  CHECK(json.find("\"launch\":\"grid 16x1x1 block 64x4x1\"") != std::string::npos);
+  CHECK(json.find("\"dur\":12.500") != std::string::npos);
+
+  f = fdopen(fdSummary, "w");
+  log.writeSummary(f);
+  fclose(f);
+  std::string text = test_readFile(summary);
+  CHECK(text.find("entry point") != std::string::npos);
+  CHECK(text.find("THNN_CudaSoftMax_updateOutput") != std::string::npos);
+  CHECK(text.find(" 2 ") != std::string::npos);
+  CHECK(text.find("100.0") != std::string::npos);
+
+  remove(trace);
+  remove(summary);
+}
+
+int main()
+{
+  testSummarize();
+  testEscape();
+  testWriters();
+  return test_result("profile_log");
+}
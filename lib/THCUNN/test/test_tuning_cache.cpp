@@ -0,0 +1,124 @@
+#include "tuning_cache.h"
+#include "test_host.h"
+
+static void testBucket()
+{
+  CHECK_EQ(THCUNNTuningCache::bucket(1), 1);
+  CHECK_EQ(THCUNNTuningCache::bucket(2), 2);
+  CHECK_EQ(THCUNNTuningCache::bucket(3), 4);
+  CHECK_EQ(THCUNNTuningCache::bucket(1000), 1024);
+  CHECK_EQ(THCUNNTuningCache::bucket(1024), 1024);
+  CHECK_EQ(THCUNNTuningCache::bucket(1025), 2048);
+}
+
+static void testFastest()
+{
+  float times[] = {3, -1, 1, 2};
+  CHECK_EQ(THCUNNTuningCache::fastest(std::vector<float>(times, times + 4)), 2);
+  float failed[] = {-1, -1};
+  CHECK_EQ(THCUNNTuningCache::fastest(std::vector<float>(failed, failed + 2)), -1);
+  CHECK_EQ(THCUNNTuningCache::fastest(std::vector<float>()), -1);
+  // ties go to the earlier candidate, i.e. the default
+  float tie[] = {2, 2, 3};
+  CHECK_EQ(THCUNNTuningCache::fastest(std::vector<float>(tie, tie + 3)), 0);
+}
+
+static void testLookup()
+{
+  THCUNNTuningCache cache;
+  int choice = -1;
+  cache.record("Device A/60", "kernel", 100, 4, 3);
+  CHECK(cache.lookup("Device A/60", "kernel", 120, 4, &choice) && choice == 3);  // same bucket
+  CHECK(!cache.lookup("Device A/60", "kernel", 129, 4, &choice));  // next bucket
+  CHECK(!cache.lookup("Device B/60", "kernel", 100, 4, &choice));
+  CHECK(!cache.lookup("Device A/60", "other", 100, 4, &choice));
+  CHECK(!cache.lookup("Device A/60", "kernel", 100, 5, &choice));  // candidate list changed
+  cache.clear();
+  CHECK(!cache.lookup("Device A/60", "kernel", 100, 4, &choice));
+}
+
+static std::string tempPath()
+{
+  char path[] = "/tmp/thcunn_tuningXXXXXX";
+  int fd = mkstemp(path);
+  close(fd);
+  remove(path);
+  return path;
+}
+
+static void removeCache(const std::string &path)
+{
+  remove(path.c_str());
+  remove((path + ".lock").c_str());
+}
+
+static void testLoadSave()
+{
+  std::string path = tempPath();
+  int choice = -1;
+
+  THCUNNTuningCache missing;
+  CHECK(!missing.load(path.c_str()));
+
+  THCUNNTuningCache cache;
+  cache.record("Device A/60", "kernel", 100, 4, 3);
+  cache.record("Device A/60", "kernel", 5000, 4, 1);
+  CHECK(cache.save(path.c_str()));
+
+  THCUNNTuningCache loaded;
+  CHECK(loaded.load(path.c_str()));
+  CHECK_EQ(loaded.size(), 2u);
+  CHECK(loaded.lookup("Device A/60", "kernel", 100, 4, &choice) && choice == 3);
+  CHECK(loaded.lookup("Device A/60", "kernel", 5000, 4, &choice) && choice == 1);
+
+  // malformed lines and out of range choices are skipped
+  FILE *f = fopen(path.c_str(), "a");
+  fprintf(f, "garbage\n");
+  fprintf(f, "Device A/60\tbad\t128\t2\t5\n");
+  fprintf(f, "Device A/60\tgood\t128\t2\t1\n");
+  fclose(f);
+  THCUNNTuningCache appended;
+  CHECK(appended.load(path.c_str()));
+  CHECK_EQ(appended.size(), 3u);
+  CHECK(appended.lookup("Device A/60", "good", 128, 2, &choice) && choice == 1);
+  CHECK(!appended.lookup("Device A/60", "bad", 128, 2, &choice));
+
+  removeCache(path);
+}
+
+// Two processes sharing a cache file keep each other's choices
+static void testMerge()
+{
+  std::string path = tempPath();
+  int choice = -1;
+
+  THCUNNTuningCache first, second;
+  first.record("Device A/60", "kernel", 100, 4, 3);
+  CHECK(first.save(path.c_str()));
+  second.record("Device A/60", "kernel", 100, 4, 2);  // its own choice wins
+  second.record("Device B/80", "kernel", 100, 4, 1);
+  CHECK(second.save(path.c_str()));
+  CHECK_EQ(second.size(), 2u);
+
+  first.record("Device A/60", "other", 10, 2, 0);
+  CHECK(first.save(path.c_str()));
+
+  THCUNNTuningCache loaded;
+  CHECK(loaded.load(path.c_str()));
+  CHECK_EQ(loaded.size(), 3u);
+  CHECK(loaded.lookup("Device A/60", "kernel", 100, 4, &choice) && choice == 3);
+  CHECK(loaded.lookup("Device B/80", "kernel", 100, 4, &choice) && choice == 1);
+  CHECK(loaded.lookup("Device A/60", "other", 10, 2, &choice) && choice == 0);
+
+  removeCache(path);
+}
+
+int main()
+{
+  testBucket();
+  testFastest();
+  testLookup();
+  testLoadSave();
+  testMerge();
+  return test_result("tuning_cache");
+}
@@ -0,0 +1,72 @@
+#include "hip/hip_runtime.h"
+#ifndef THCUNN_TUNING_H
+#define THCUNN_TUNING_H
+
+#include "THCUNN.h"
+#include "common.h"
+#include "tuning_cache.h"
+#include <string>
+#include <vector>
+
+// Launch-configuration tuning.
+//
+// A kernel that can run with several launch configurations lists them as
+// candidates, the current default first, and asks tuning_choose for one by
+// kernel name and a size that characterises the shape. The first call for a
+// (device, kernel, shape bucket) times every candidate on the current stream
+// and keeps the fastest; later calls are a map lookup. Choices are kept in
+// memory, and in a cache file read back by the next process when one is
+// named by $THCUNN_TUNING_CACHE or THCUNN.setTuningCache.
+//
+// Tuning re-runs the kernel, so only kernels that overwrite their outputs
+// without reading them may be tuned.
+
+#define TUNING_REPEATS 3
+
+// Whether tuning is on; when off every kernel runs its first candidate
+bool tuning_enabled();
+// Name of the current device, as used in the cache
+std::string tuning_device(THCState *state);
+bool tuning_lookup(const std::string &device, const char *kernel, long size, int candidates, int *choice);
+void tuning_record(const std::string &device, const char *kernel, long size, int candidates, int choice);
+
+// Returns the index of the candidate to launch. `launch(i)` must launch
+// candidate i on the current stream.
+template <typename Launch>
+int tuning_choose(THCState *state, const char *kernel, long size, int candidates, const Launch &launch)
+{
+  if (!tuning_enabled() || candidates < 2)
+    return 0;
+  std::string device = tuning_device(state);
+  int choice;
+  if (tuning_lookup(device, kernel, size, candidates, &choice))
+    return choice;
+
+  hipStream_t stream = THCState_getCurrentStream(state);
+  hipEvent_t start, stop;
+  THCudaCheck(hipEventCreate(&start));
+  THCudaCheck(hipEventCreate(&stop));
+  std::vector<float> times(candidates, -1.0f);
+  for (int i = 0; i < candidates; i++) {
+    launch(i);  // warm up
+    if (hipGetLastError() != hipSuccess)
+      continue;  // e.g. too many resources requested for this device
+    THCudaCheck(hipEventRecord(start, stream));
+    for (int r = 0; r < TUNING_REPEATS; r++)
+      launch(i);
+    THCudaCheck(hipEventRecord(stop, stream));
+    THCudaCheck(hipEventSynchronize(stop));
+    THCudaCheck(hipGetLastError());
+    THCudaCheck(hipEventElapsedTime(&times[i], start, stop));
+  }
+  THCudaCheck(hipEventDestroy(start));
+  THCudaCheck(hipEventDestroy(stop));
+
+  choice = THCUNNTuningCache::fastest(times);
+  if (choice < 0)
+    THError("no launch configuration of %s could run", kernel);
+  tuning_record(device, kernel, size, candidates, choice);
+  return choice;
+}
+
+#endif
@@ -0,0 +1,162 @@
+#ifndef THCUNN_TUNING_CACHE_H
+#define THCUNN_TUNING_CACHE_H
+
+// Host-side table of launch-configuration choices per (device, kernel, shape
+// bucket) and its cache file. Deliberately free of HIP and THC so that it
+// builds with a plain host compiler; the timing lives in tuning.h / Tuning.cu.
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/file.h>
+#include <unistd.h>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#define TUNING_HEADER "# THCUNN launch tuning v1: device, kernel, bucket, candidates, choice"
+
+// Shapes are bucketed by powers of two so the table stays small.
+class THCUNNTuningCache
+{
+public:
+  static long bucket(long size)
+  {
+    long b = 1;
+    while (b < size)
+      b <<= 1;
+    return b;
+  }
+
+  // Index of the fastest candidate; times below zero mark candidates that
+  // failed to launch. -1 if none ran.
+  static int fastest(const std::vector<float> &times)
+  {
+    int best = -1;
+    for (size_t i = 0; i < times.size(); i++)
+      if (times[i] >= 0 && (best < 0 || times[i] < times[best]))
+        best = i;
+    return best;
+  }
+
+  bool lookup(const std::string &device, const std::string &kernel, long size,
+              int candidates, int *choice) const
+  {
+    Table::const_iterator it = table_.find(key(device, kernel, bucket(size)));
+    // a different candidate count means the kernel's list changed since
+    if (it == table_.end() || it->second.candidates != candidates)
+      return false;
+    *choice = it->second.choice;
+    return true;
+  }
+
+  void record(const std::string &device, const std::string &kernel, long size,
+              int candidates, int choice)
+  {
+    Entry entry = { candidates, choice };
+    table_[key(device, kernel, bucket(size))] = entry;
+  }
+
+  void clear()
+  {
+    table_.clear();
+  }
+
+  size_t size() const
+  {
+    return table_.size();
+  }
+
+  // Merges the entries of `path`, keeping those already in the table. A
+  // missing file is not an error.
+  bool load(const char *path)
+  {
+    FILE *f = fopen(path, "r");
+    if (!f)
+      return false;
+    THCUNNTuningCache loaded;
+    loaded.read(f);
+    fclose(f);
+    merge(loaded);
+    return true;
+  }
+
+  // Writes every entry to `path`, together with those other processes have
+  // written there since it was loaded; the table keeps the merged result.
+  // The file is locked while it is read and replaced atomically.
+  bool save(const char *path)
+  {
+    std::string lockPath = std::string(path) + ".lock";
+    int lock = open(lockPath.c_str(), O_RDWR | O_CREAT, 0644);
+    if (lock < 0)
+      return false;
+    flock(lock, LOCK_EX);
+    load(path);
+    std::ostringstream tmp;
+    tmp << path << ".tmp." << getpid();
+    bool ok = write(tmp.str().c_str()) && rename(tmp.str().c_str(), path) == 0;
+    if (!ok)
+      remove(tmp.str().c_str());
+    flock(lock, LOCK_UN);
+    close(lock);
+    return ok;
+  }
+
+private:
+  struct Entry { int candidates; int choice; };
+  typedef std::map<std::string, Entry> Table;
+
+  static std::string key(const std::string &device, const std::string &kernel, long bucket)
+  {
+    std::ostringstream s;
+    s << device << '\t' << kernel << '\t' << bucket;
+    return s.str();
+  }
+
+  void read(FILE *f)
+  {
+    char line[1024];
+    while (fgets(line, sizeof(line), f)) {
+      if (line[0] == '#')
+        continue;
+      // device names may contain spaces, so fields are tab separated
+      std::vector<std::string> fields;
+      std::istringstream s(line);
+      std::string field;
+      while (std::getline(s, field, '\t'))
+        fields.push_back(field);
+      if (fields.size() != 5)
+        continue;
+      long b = atol(fields[2].c_str());
+      int candidates = atoi(fields[3].c_str());
+      int choice = atoi(fields[4].c_str());
+      if (b < 1 || choice < 0 || choice >= candidates)
+        continue;
+      record(fields[0], fields[1], b, candidates, choice);
+    }
+  }
+
+  bool write(const char *path) const
+  {
+    FILE *f = fopen(path, "w");
+    if (!f)
+      return false;
+    fprintf(f, "%s\n", TUNING_HEADER);
+    for (Table::const_iterator it = table_.begin(); it != table_.end(); ++it)
+      fprintf(f, "%s\t%d\t%d\n", it->first.c_str(), it->second.candidates, it->second.choice);
+    return fclose(f) == 0;
+  }
+
+  void merge(const THCUNNTuningCache &other)
+  {
+    for (Table::const_iterator it = other.table_.begin(); it != other.table_.end(); ++it)
+      table_.insert(*it);
+  }
+
+  Table table_;
+};
+
+#undef TUNING_HEADER
+
+#endif
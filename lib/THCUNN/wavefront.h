@@ -0,0 +1,129 @@
+#include "hip/hip_runtime.h"
+#ifndef THCUNN_WAVEFRONT_H
+#define THCUNN_WAVEFRONT_H
+
+// Wavefront-level primitives: shuffles, reductions and collision detection.
+//
+// A wavefront (a warp on NVIDIA) is 64 lanes wide on AMD GCN and 32 on
+// NVIDIA. Kernels size their loops, lane ids and launch shapes with
+// WAVEFRONT_SIZE instead of a literal 32, and reduce with the helpers below,
+// which take the width as a template argument defaulting to WAVEFRONT_SIZE.
+
+#if defined(__HIP_PLATFORM_HCC__)
+const int WAVEFRONT_SIZE = 64;
+#else
+const int WAVEFRONT_SIZE = 32;
+#endif
+
+// Largest block the block-wide reductions support
+const int WAVEFRONT_MAX_BLOCK = 1024;
+
+// Butterfly shuffles. Other types reduce through waveReduce by providing an
+// overload of waveShflXor next to their definition.
+__device__ __forceinline__ float waveShflXor(float v, int mask, int width)
+{
+  return __shfl_xor(v, mask, width);
+}
+
+__device__ __forceinline__ int waveShflXor(int v, int mask, int width)
+{
+  return __shfl_xor(v, mask, width);
+}
+
+struct WaveSum
+{
+  template <typename T>
+  __device__ __forceinline__ T operator()(T a, const T &b) const
+  {
+    a += b;
+    return a;
+  }
+};
+
+struct WaveMax
+{
+  __device__ __forceinline__ float operator()(float a, float b) const
+  {
+    return fmaxf(a, b);
+  }
+};
+
+// Reduces val over the W lanes of the wavefront with op; every lane gets the
+// result. The order of operations is fixed, so results are reproducible.
+template <int W = WAVEFRONT_SIZE, typename T, typename Op>
+__device__ __forceinline__ T waveReduce(T val, const Op &op)
+{
+#pragma unroll
+  for (int mask = W / 2; mask > 0; mask >>= 1)
+    val = op(val, waveShflXor(val, mask, W));
+  return val;
+}
+
+template <int W = WAVEFRONT_SIZE, typename T>
+__device__ __forceinline__ T waveSum(T val)
+{
+  return waveReduce<W>(val, WaveSum());
+}
+
+// Reduces val over the first n lanes of the wavefront into lane 0, for the
+// last wavefront of a block that is not a whole number of them. The lanes
+// past n do not exist, so their shuffles are ignored: with the masks in
+// increasing order, lane 0's partner is always the first lane of the half it
+// takes in, which exists whenever any lane of that half does.
+template <int W = WAVEFRONT_SIZE, typename T, typename Op>
+__device__ __forceinline__ T wavePartialReduce(T val, const Op &op, int n)
+{
+  const int lane = hipThreadIdx_x % W;
+#pragma unroll
+  for (int mask = 1; mask < W; mask <<= 1) {
+    T other = waveShflXor(val, mask, W);
+    if ((lane ^ mask) < n)
+      val = op(val, other);
+  }
+  return val;
+}
+
+// Reduces val over the block with op; every thread gets the result.
+// identity must leave any value unchanged under op. hipBlockDim_x may be up
+// to WAVEFRONT_MAX_BLOCK, and all threads must take part. T is stored in
+// shared memory, so it may not have a non-trivial constructor.
+template <int W = WAVEFRONT_SIZE, typename T, typename Op>
+__device__ __forceinline__ T blockReduce(T val, const Op &op, T identity)
+{
+  __shared__ T partials[WAVEFRONT_MAX_BLOCK / W];
+  int lane = hipThreadIdx_x % W;
+  int wave = hipThreadIdx_x / W;
+  int waves = (hipBlockDim_x + W - 1) / W;
+  int lanes = min((int)hipBlockDim_x - wave * W, W);
+
+  val = lanes == W ? waveReduce<W>(val, op) : wavePartialReduce<W>(val, op, lanes);
+  // a previous call may still be reading partials[0]
+  __syncthreads();
+  if (lane == 0)
+    partials[wave] = val;
+  __syncthreads();
+
+  if (wave == 0) {
+    val = lane < waves ? partials[lane] : identity;
+    val = lanes == W ? waveReduce<W>(val, op) : wavePartialReduce<W>(val, op, lanes);
+    if (lane == 0)
+      partials[0] = val;
+  }
+  __syncthreads();
+  return partials[0];
+}
+
+// Whether two lanes of the wavefront hold the same value. Each lane compares
+// with the next W / 2 lanes, wrapping around, which covers every pair.
+template <int W = WAVEFRONT_SIZE>
+__device__ __forceinline__ bool waveHasCollision(int val)
+{
+  const int lane = hipThreadIdx_x % W;
+  bool dup = false;
+#pragma unroll
+  for (int i = 1; i <= W / 2; i++)
+    dup |= (__shfl(val, (lane + i) % W, W) == val);
+  return __any(dup) != 0;
+}
+
+#endif
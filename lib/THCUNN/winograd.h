@@ -0,0 +1,160 @@
+#include "hip/hip_runtime.h"
+#ifndef THCUNN_WINOGRAD_H
+#define THCUNN_WINOGRAD_H
+
+#include "THCUNN.h"
+#include "conv_activation.h"
+
+// Winograd minimal filtering F(MxM, 3x3) (Lavin & Gray, "Fast Algorithms for
+// Convolutional Neural Networks").
+//
+// A 3x3 stride-1 convolution is computed on output tiles of MxM from input
+// tiles of alpha x alpha, alpha = M + 2:
+//
+//   U = G g G^T          filter transform, once per (output, input) plane
+//   V = B^T d B          input transform, once per (input plane, tile)
+//   m = sum_c U (.) V    alpha^2 independent GEMMs over the input planes
+//   Y = A^T m A          output transform
+//
+// F(2x2, 3x3) does 16 multiplies per 4 outputs instead of 36; F(4x4, 3x3) 36
+// per 16 instead of 144, at the cost of larger transform constants and a
+// slightly larger rounding error. The transforms are __host__ __device__ so
+// the host reference in SpatialConvolutionWinograd.cu runs the same code.
+
+template <int M> struct Winograd;
+
+template <> struct Winograd<2>
+{
+  static const int alpha = 4;
+
+  struct BT { __host__ __device__ static float at(int i, int j) {
+    const float c[4][4] = {
+      {1,  0, -1,  0},
+      {0,  1,  1,  0},
+      {0, -1,  1,  0},
+      {0,  1,  0, -1}};
+    return c[i][j];
+  } };
+
+  struct G { __host__ __device__ static float at(int i, int j) {
+    const float c[4][3] = {
+      {1.0f,  0.0f, 0.0f},
+      {0.5f,  0.5f, 0.5f},
+      {0.5f, -0.5f, 0.5f},
+      {0.0f,  0.0f, 1.0f}};
+    return c[i][j];
+  } };
+
+  struct AT { __host__ __device__ static float at(int i, int j) {
+    const float c[2][4] = {
+      {1, 1,  1,  0},
+      {0, 1, -1, -1}};
+    return c[i][j];
+  } };
+};
+
+template <> struct Winograd<4>
+{
+  static const int alpha = 6;
+
+  struct BT { __host__ __device__ static float at(int i, int j) {
+    const float c[6][6] = {
+      {4,  0, -5,  0, 1, 0},
+      {0, -4, -4,  1, 1, 0},
+      {0,  4, -4, -1, 1, 0},
+      {0, -2, -1,  2, 1, 0},
+      {0,  2, -1, -2, 1, 0},
+      {0,  4,  0, -5, 0, 1}};
+    return c[i][j];
+  } };
+
+  struct G { __host__ __device__ static float at(int i, int j) {
+    const float c[6][3] = {
+      { 1.0f/4,       0.0f,    0.0f},
+      {-1.0f/6,  -1.0f/6,  -1.0f/6},
+      {-1.0f/6,   1.0f/6,  -1.0f/6},
+      { 1.0f/24,  1.0f/12,  1.0f/6},
+      { 1.0f/24, -1.0f/12,  1.0f/6},
+      {    0.0f,     0.0f,    1.0f}};
+    return c[i][j];
+  } };
+
+  struct AT { __host__ __device__ static float at(int i, int j) {
+    const float c[4][6] = {
+      {1, 1,  1, 1,  1, 0},
+      {0, 1, -1, 2, -2, 0},
+      {0, 1,  1, 4,  4, 0},
+      {0, 1, -1, 8, -8, 1}};
+    return c[i][j];
+  } };
+};
+
+// y = L x L^T for an R x K matrix L
+template <typename L, int R, int K>
+__host__ __device__ inline void winograd_sandwich(const float (&x)[K][K], float (&y)[R][R])
+{
+  float t[R][K];
+#pragma unroll
+  for (int i = 0; i < R; i++) {
+#pragma unroll
+    for (int j = 0; j < K; j++) {
+      float s = 0;
+#pragma unroll
+      for (int k = 0; k < K; k++)
+        s += L::at(i, k) * x[k][j];
+      t[i][j] = s;
+    }
+  }
+#pragma unroll
+  for (int i = 0; i < R; i++) {
+#pragma unroll
+    for (int j = 0; j < R; j++) {
+      float s = 0;
+#pragma unroll
+      for (int k = 0; k < K; k++)
+        s += t[i][k] * L::at(j, k);
+      y[i][j] = s;
+    }
+  }
+}
+
+template <int M>
+__host__ __device__ inline void winograd_filterTransform(
+    const float (&g)[3][3], float (&u)[Winograd<M>::alpha][Winograd<M>::alpha])
+{
+  winograd_sandwich<typename Winograd<M>::G>(g, u);
+}
+
+template <int M>
+__host__ __device__ inline void winograd_inputTransform(
+    const float (&d)[Winograd<M>::alpha][Winograd<M>::alpha],
+    float (&v)[Winograd<M>::alpha][Winograd<M>::alpha])
+{
+  winograd_sandwich<typename Winograd<M>::BT>(d, v);
+}
+
+template <int M>
+__host__ __device__ inline void winograd_outputTransform(
+    const float (&m)[Winograd<M>::alpha][Winograd<M>::alpha], float (&y)[M][M])
+{
+  winograd_sandwich<typename Winograd<M>::AT>(m, y);
+}
+
+class THCUNNWorkspace;
+
+// Output tile size (2 or 4) to run a 3x3 stride-1 SpatialConvolutionMM
+// forward with, 0 for the regular path, or -1 in the default mode, where
+// F(2x2) is timed against the regular path (ImplicitGemmChoice::path).
+// Follows THCUNN.setWinograd.
+int winograd_tileSize();
+
+// output must already be sized batch x nOutputPlane x outputHeight x outputWidth;
+// scratch is borrowed from `workspace` into `columns`. act is applied after
+// the bias.
+void winograd_updateOutput(THCState *state, THCUNNWorkspace &workspace,
+                           THCudaTensor *input, THCudaTensor *output,
+                           THCudaTensor *weight, THCudaTensor *bias,
+                           THCudaTensor *columns, int padW, int padH, int tile,
+                           const ConvActivation &act);
+
+#endif
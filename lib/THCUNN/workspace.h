@@ -0,0 +1,52 @@
+#ifndef THCUNN_WORKSPACE_H
+#define THCUNN_WORKSPACE_H
+
+#include "THCUNN.h"
+#include <vector>
+
+// Scratch memory shared by the convolution layers.
+//
+// A THCUNNWorkspace lives for the duration of one THNN_Cuda* call. Scratch
+// tensors handed in by the Lua modules (columns, fgradInput, finput) are
+// pointed at a region of an arena owned by the current device and stream
+// instead of being resized, and are detached again when the call returns.
+// The arena only ever grows to the largest single call, so a network needs
+// max(layer) bytes of scratch instead of sum(layers), and steady-state steps
+// do not allocate at all. Reuse is safe because every borrower of an arena
+// runs on the same stream.
+//
+// Each arena also holds the `ones` buffer of its device and stream.
+//
+// Declare the workspace after the argument checks: an error raised while
+// it is open skips its destructor, and the call is only closed when the
+// same thread starts the next one. Calls must not nest.
+//
+// THCUNN.setWorkspaceEnabled(false) restores the per-module buffers.
+
+struct THCUNNArena;
+
+class THCUNNWorkspace
+{
+public:
+  explicit THCUNNWorkspace(THCState *state);
+  ~THCUNNWorkspace();
+
+  // Replacements for THCudaTensor_resize{2,3}d on scratch tensors
+  void borrow2d(THCudaTensor *t, long size0, long size1);
+  void borrow3d(THCudaTensor *t, long size0, long size1, long size2);
+
+  // Points t at a buffer of ones of at least the given shape
+  void ones2d(THCudaTensor *t, long size0, long size1);
+  void ones3d(THCudaTensor *t, long size0, long size1, long size2);
+
+private:
+  void borrow(THCudaTensor *t, int nDimension, long *size);
+  void ones(THCudaTensor *t, int nDimension, long *size);
+
+  THCState *state_;
+  THCUNNArena *arena_;  // NULL when the workspace is disabled
+  long mark_;
+  std::vector<THCudaTensor*> borrowed_;
+};
+
+#endif
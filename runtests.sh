@@ -30,6 +30,7 @@ th -lcunn -e 'cunn.test("Sqrt_transposed")'
 th -lcunn -e 'cunn.test("Square_forward")'
 th -lcunn -e 'cunn.test("Square_backward")'
 th -lcunn -e 'cunn.test("Square_transposed")'
+th -lcunn -e 'cunn.test("PointwiseFused")'
 th -lcunn -e 'cunn.test("SoftShrink_forward")'
 th -lcunn -e 'cunn.test("SoftShrink_backward")'
 th -lcunn -e 'cunn.test("SoftShrink_transposed")'
@@ -41,6 +42,7 @@ th -lcunn -e 'cunn.test("SoftMax_backward")'
 th -lcunn -e 'cunn.test("LogSoftMax_forward")'
 th -lcunn -e 'cunn.test("LogSoftMax_backward")'
 th -lcunn -e 'cunn.test("SpatialSoftMax")'
+th -lcunn -e 'cunn.test("SoftMax_shapes")'
 th -lcunn -e 'cunn.test("LogSoftMax_forward_batch")'
 th -lcunn -e 'cunn.test("LogSoftMax_backward_batch")'
 th -lcunn -e 'cunn.test("SpatialLogSoftMax_forward")'
@@ -53,17 +55,28 @@ th -lcunn -e 'cunn.test("WeightedEuclidean_forward_batch")'
 th -lcunn -e 'cunn.test("WeightedEuclidean_backward_batch")'
 th -lcunn -e 'cunn.test("SparseLinear_forward")'
 th -lcunn -e 'cunn.test("SparseLinear_backward")'
+th -lcunn -e 'cunn.test("SparseLinear_skewed")'
 th -lcunn -e 'cunn.test("BatchNormalization")'
 th -lcunn -e 'cunn.test("SpatialBatchNormalization")'
 th -lcunn -e 'cunn.test("VolumetricBatchNormalization")'
+th -lcunn -e 'cunn.test("SpatialBatchNormalization_split")'
+th -lcunn -e 'cunn.test("SpatialBatchNormalization_fold")'
 th -lcunn -e 'cunn.test("SpatialConvolutionMM_forward_single")'
 th -lcunn -e 'cunn.test("SpatialConvolutionMM_forward_batch")'
 th -lcunn -e 'cunn.test("SpatialConvolutionMM_backward_single")'
 th -lcunn -e 'cunn.test("SpatialConvolutionMM_backward_batch")'
+th -lcunn -e 'cunn.test("SpatialConvolutionMM_batched_columns")'
+th -lcunn -e 'cunn.test("SpatialConvolution_workspace")'
+th -lcunn -e 'cunn.test("SpatialConvolution_implicit_gemm")'
+th -lcunn -e 'cunn.test("SpatialConvolutionMM_winograd")'
+th -lcunn -e 'cunn.test("SpatialConvolution_fused_activation")'
+th -lcunn -e 'cunn.test("Tuning")'
+th -lcunn -e 'cunn.test("Wavefront_reduce")'
 th -lcunn -e 'cunn.test("SpatialConvolutionLocal_forward_single")'
 th -lcunn -e 'cunn.test("SpatialConvolutionLocal_forward_batch")'
 th -lcunn -e 'cunn.test("SpatialConvolutionLocal_backward_single")'
 th -lcunn -e 'cunn.test("SpatialConvolutionLocal_backward_batch")'
+th -lcunn -e 'cunn.test("SpatialConvolutionLocal_large_batch")'
 th -lcunn -e 'cunn.test("SpatialFullConvolution_forward_single")'
 th -lcunn -e 'cunn.test("SpatialFullConvolution_forward_batch")'
 th -lcunn -e 'cunn.test("SpatialFullConvolution_backward_single")'
@@ -86,6 +99,7 @@ th -lcunn -e 'cunn.test("SpatialDilatedMaxPooling_forward")'
 th -lcunn -e 'cunn.test("SpatialDilatedMaxPooling_forward_batch")'
 th -lcunn -e 'cunn.test("SpatialDilatedMaxPooling_backward")'
 th -lcunn -e 'cunn.test("SpatialDilatedMaxPooling_backward_batch")'
+th -lcunn -e 'cunn.test("SpatialMaxPooling_scatter_backward")'
 th -lcunn -e 'cunn.test("SpatialFractionalMaxPooling_forward")'
 th -lcunn -e 'cunn.test("SpatialFractionalMaxPooling_backward")'
 th -lcunn -e 'cunn.test("SpatialAveragePooling_includepad")'
@@ -119,6 +133,7 @@ th -lcunn -e 'cunn.test("TemporalConvolution_forward")'
 th -lcunn -e 'cunn.test("TemporalConvolution_forward_batch")'
 th -lcunn -e 'cunn.test("TemporalConvolution_backward")'
 th -lcunn -e 'cunn.test("TemporalConvolution_backward_batch")'
+th -lcunn -e 'cunn.test("TemporalConvolution_long_sequence")'
 th -lcunn -e 'cunn.test("Dropout")'
 th -lcunn -e 'cunn.test("Dropout_forward")'
 th -lcunn -e 'cunn.test("SoftPlus_forward")'
@@ -137,6 +152,9 @@ th -lcunn -e 'cunn.test("ClassNLLCriterionSingleTargetWeights")'
 th -lcunn -e 'cunn.test("ClassNLLCriterionMultipleTarget")'
 th -lcunn -e 'cunn.test("SpatialClassNLLCriterion")'
 th -lcunn -e 'cunn.test("ClassNLLCriterionMultipleTargetWeights")'
+th -lcunn -e 'cunn.test("ClassNLLCriterion_deterministic")'
+th -lcunn -e 'cunn.test("FusedCrossEntropyCriterion")'
+th -lcunn -e 'cunn.test("Profiler")'
 th -lcunn -e 'cunn.test("TemporalMaxPooling")'
 th -lcunn -e 'cunn.test("VolumetricConvolution_forward_single")'
 th -lcunn -e 'cunn.test("VolumetricConvolution_forward_batch")'
@@ -148,6 +166,8 @@ th -lcunn -e 'cunn.test("VolumetricDilatedMaxPooling_forward_batch")'
 th -lcunn -e 'cunn.test("VolumetricDilatedMaxPooling_backward_batch")'
 th -lcunn -e 'cunn.test("VolumetricMaxUnpooling_forward_batch")'
 th -lcunn -e 'cunn.test("VolumetricMaxUnpooling_backward_batch")'
+th -lcunn -e 'cunn.test("SpatialMaxPooling_compact_indices")'
+th -lcunn -e 'cunn.test("VolumetricMaxPooling_compact_indices")'
 th -lcunn -e 'cunn.test("VolumetricAveragePooling_forward")'
 th -lcunn -e 'cunn.test("VolumetricAveragePooling_backward")'
 th -lcunn -e 'cunn.test("CMul_forward_batch")'
@@ -161,6 +181,8 @@ th -lcunn -e 'cunn.test("VolumetricFullConvolution")'
 th -lcunn -e 'cunn.test("VolumetricDilatedConvolution")'
 th -lcunn -e 'cunn.test("LookupTable_forward")'
 th -lcunn -e 'cunn.test("LookupTable_backward")'
+th -lcunn -e 'cunn.test("LookupTable_backward_large")'
+th -lcunn -e 'cunn.test("LookupTable_renorm")'
 th -lcunn -e 'cunn.test("getParameters")'
 th -lcunn -e 'cunn.test("SpatialReflectionPadding_forward")'
 th -lcunn -e 'cunn.test("SpatialReflectionPadding_backward")'
@@ -294,6 +294,43 @@ function cunntest.Square_transposed()
    pointwise_transposed(nn.Square(), 'Square')
 end
 
+function cunntest.PointwiseFused()
+   local size = math.random(1, 100)
+   local chains = {
+      -- chains with a kernel of their own
+      {nn.Square(), nn.Sqrt(1e-3)},
+      {nn.Square(), nn.Sqrt(1e-3), nn.Tanh()},
+      {nn.Abs(), nn.Sqrt(1e-3)},
+      {nn.Threshold(0.1, 0), nn.HardTanh(0, 1.5)},
+      {nn.SoftPlus(2), nn.Tanh()},
+      -- generic kernel
+      {nn.Sigmoid(), nn.ELU(0.7), nn.LeakyReLU(0.2)},
+      {nn.Tanh(), nn.Square(), nn.HardTanh(-0.5, 0.5), nn.ReLU(), nn.SoftPlus()},
+   }
+
+   for _, chain in ipairs(chains) do
+      local model = nn.Sequential():add(nn.Identity())
+      for _, m in ipairs(chain) do
+         model:add(m)
+      end
+      local input = torch.randn(size, size)
+      local gradOutput = torch.randn(size, size)
+      local groundtruth = model:forward(input):clone()
+      local groundgrad = model:backward(input, gradOutput):clone()
+
+      local gmodel, count = cunn.fusePointwise(model:clone():cuda())
+      local name = tostring(gmodel.modules[2])
+      mytester:asserteq(count, #chain, 'wrong number of modules fused: ' .. name)
+      mytester:asserteq(#gmodel.modules, 2, 'chain should be a single module: ' .. name)
+      local rescuda = gmodel:forward(input:cuda())
+      local gradcuda = gmodel:backward(input:cuda(), gradOutput:cuda())
+      mytester:assertlt((rescuda:float() - groundtruth):abs():max(), precision_forward,
+                        'error on fused output: ' .. name)
+      mytester:assertlt((gradcuda:float() - groundgrad):abs():max(), precision_backward,
+                        'error on fused gradInput: ' .. name)
+   end
+end
+
 function cunntest.SoftShrink_forward()
   pointwise_forward(nn.SoftShrink(math.random()), 'SoftShrink', precision_forward)
 end
@@ -359,6 +396,41 @@ function cunntest.SpatialSoftMax()
    mytester:assertlt(error:abs():max(), precision_backward*10, 'error on state (backward) ')
 end
 
+function cunntest.SoftMax_shapes()
+   -- one case per engine: wavefront rows, block rows with and without float4
+   -- access, and an offset storage that breaks 16-byte alignment
+   local cases = {
+      {torch.random(1, 256), torch.random(1, 64)},
+      {torch.random(2, 16), 4 * torch.random(257, 2048)},
+      {torch.random(2, 16), 4 * torch.random(257, 2048) + torch.random(1, 3)},
+   }
+   for _, c in ipairs(cases) do
+      local bs, dim = c[1], c[2]
+      local input = torch.randn(bs, dim)
+      local gradOutput = torch.randn(bs, dim)
+      local sconv = nn.SoftMax()
+      local groundtruth = sconv:forward(input):clone()
+      local gradInput = sconv:backward(input, gradOutput):clone()
+
+      local gconv = nn.SoftMax():cuda()
+      local rescuda = gconv:forward(input:cuda())
+      local gradcuda = gconv:backward(input:cuda(), gradOutput:cuda())
+
+      local error = rescuda:float() - groundtruth
+      mytester:assertlt(error:abs():max(), precision_forward, 'error on state (forward) ' .. bs .. 'x' .. dim)
+      error = gradcuda:float() - gradInput
+      mytester:assertlt(error:abs():max(), precision_backward, 'error on state (backward) ' .. bs .. 'x' .. dim)
+   end
+
+   local dim = 4 * torch.random(257, 1024)
+   local storage = torch.CudaStorage(dim + 1)
+   local input = torch.CudaTensor(storage, 2, torch.LongStorage{dim}):normal()
+   local groundtruth = nn.SoftMax():forward(input:float())
+   local rescuda = nn.SoftMax():cuda():forward(input)
+   local error = rescuda:float() - groundtruth
+   mytester:assertlt(error:abs():max(), precision_forward, 'error on state (forward, unaligned) ')
+end
+
 function cunntest.LogSoftMax_forward_batch()
    local size = math.random(1,256)
    local bs = math.random(32,256)
@@ -841,6 +913,47 @@ function cunntest.SparseLinear_backward()
     gslin:zeroGradParameters()
 end
 
+function cunntest.SparseLinear_skewed()
+    -- one dense-ish row among short ones, so both the row-split and the
+    -- nnz-balanced SpMM kernels get exercised
+    local inb = math.random(5,10)
+    local ini = math.random(2000,4000)
+    local inj = math.random(5,20)
+
+    local gslin = nn.SparseLinear(ini,inj):cuda()
+    local sslin = nn.Linear(ini,inj)
+    gslin.weight = sslin.weight:clone():cuda()
+    gslin.bias = sslin.bias:clone():cuda()
+
+    local input = {}
+    local nonsparse = torch.zeros(inb, ini)
+    for i=1,inb do
+        local nnz = i == 1 and math.random(1000, ini) or math.random(1, 5)
+        local inds = torch.randperm(ini)[{{1,nnz}}]
+        input[i] = torch.Tensor(nnz, 2)
+        input[i]:select(2,1):copy(inds)
+        input[i]:select(2,2):copy(torch.rand(nnz))
+        nonsparse[i]:scatter(1, input[i]:select(2,1):long(), input[i]:select(2,2))
+    end
+    local gradOutput = torch.randn(inb, inj)
+
+    local groundtruth = sslin:forward(nonsparse)
+    sslin:zeroGradParameters()
+    sslin:backward(nonsparse, gradOutput)
+
+    for i,v in ipairs(input) do input[i] = input[i]:cuda() end
+    local rescuda = gslin:forward(input)
+    gslin:zeroGradParameters()
+    gslin:backward(input, gradOutput:cuda())
+
+    local error = rescuda:float() - groundtruth
+    local werror = gslin.gradWeight:float() - sslin.gradWeight
+    local berror = gslin.gradBias:float() - sslin.gradBias
+    mytester:assertlt(error:abs():max(), precision_forward * 10, 'error on state (forward) ')
+    mytester:assertlt(werror:abs():max(), precision_backward, 'error on weight (backward) ')
+    mytester:assertlt(berror:abs():max(), precision_backward, 'error on bias (backward) ')
+end
+
 local function BatchNormalization_forward(moduleName, inputSize)
    local planes = inputSize[2]
    local tm = {}
@@ -1013,6 +1126,61 @@ function cunntest.VolumetricBatchNormalization()
    testBatchNormalization('VolumetricBatchNormalization', 3, 16)
 end
 
+function cunntest.SpatialBatchNormalization_split()
+   -- few planes over large maps take the split (multi-block) reductions
+   local function backward(m, input, gradOutput)
+      return m:backward(input, gradOutput)
+   end
+   for _, inputSize in ipairs{{4, 3, 128, 128}, {2, 16, 96, 96}} do
+      BatchNormalization_forward('SpatialBatchNormalization', inputSize)
+      BatchNormalization_forward_inference('SpatialBatchNormalization', inputSize)
+      BatchNormalization_backward('SpatialBatchNormalization', 'training', inputSize, backward)
+      BatchNormalization_backward('SpatialBatchNormalization', 'evaluation', inputSize, backward)
+   end
+end
+
+function cunntest.SpatialBatchNormalization_fold()
+   local model = nn.Sequential()
+      :add(nn.SpatialConvolutionMM(3, 8, 3, 3, 1, 1, 1, 1))
+      :add(nn.SpatialBatchNormalization(8))
+      :add(nn.ReLU())
+      :add(nn.SpatialDilatedConvolution(8, 6, 3, 3, 1, 1, 2, 2, 2, 2))
+      :add(nn.SpatialBatchNormalization(6, nil, nil, false))
+      :add(nn.Sequential()
+         :add(nn.SpatialConvolution(6, 4, 3, 3):noBias())
+         :add(nn.SpatialBatchNormalization(4)))
+      :add(nn.SpatialBatchNormalization(4))
+   for _, bn in ipairs(model:findModules('nn.SpatialBatchNormalization')) do
+      bn.running_mean:normal(0, 1)
+      bn.running_var:uniform(0.5, 2)
+      if bn.weight then
+         bn.weight:uniform(0.5, 1.5)
+         bn.bias:normal(0, 1)
+      end
+   end
+   model:evaluate()
+
+   local input = torch.randn(2, 3, 17, 19)
+   local groundtruth = model:forward(input):clone()
+
+   local gmodel, count = cunn.foldBatchNormalization(model:clone():cuda())
+   mytester:asserteq(count, 3, 'wrong number of layers folded')
+   mytester:asserteq(#gmodel:findModules('nn.SpatialBatchNormalization'), 1,
+                     'batch normalization not following a convolution was folded')
+   local rescuda = gmodel:forward(input:cuda())
+   local error = rescuda:float() - groundtruth
+   mytester:assertlt(error:abs():max(), precision_forward, 'error on folded output')
+
+   -- the same pass on CPU modules
+   local fmodel = cunn.foldBatchNormalization(model:clone())
+   error = fmodel:forward(input) - groundtruth
+   mytester:assertlt(error:abs():max(), precision_forward, 'error on folded CPU output')
+
+   -- modules in training mode are left alone
+   local _, trained = cunn.foldBatchNormalization(model:clone():training():cuda())
+   mytester:asserteq(trained, 0, 'training mode batch normalization was folded')
+end
+
 function cunntest.SpatialConvolutionMM_forward_single()
    local from = math.random(1,32)
    local to = math.random(1,8) * 8
@@ -1283,6 +1451,387 @@ function cunntest.SpatialConvolutionMM_backward_batch()
    jacTests(true)
 end
 
+function cunntest.SpatialConvolutionMM_batched_columns()
+   local bs = math.random(5,16)
+   local from = math.random(1,16)
+   local to = math.random(1,8) * 8
+   local ki = math.random(1,7)
+   local kj = math.random(1,7)
+   local si = math.random(1,3)
+   local sj = math.random(1,3)
+   local outi = math.random(1,32)
+   local outj = math.random(1,32)
+   local padW = math.random(0,1)
+   local padH = math.random(0,1)
+   local ini = (outi-1)*si+ki-padW*2
+   local inj = (outj-1)*sj+kj-padH*2
+
+   local THCUNN = require 'cunn.THCUNN'
+   -- room for 3 samples per chunk, so the last chunk is usually partial
+   local perSample = (from*ki*kj + to) * outi*outj * 4
+   local limit = 3 * perSample
+
+   local input = torch.randn(bs,from,inj,ini)
+   local gradOutput = torch.randn(bs,to,outj,outi)
+   local sconv = nn.SpatialConvolutionMM(from,to,ki,kj,si,sj,padW,padH)
+   local groundtruth = sconv:forward(input):clone()
+   sconv:zeroGradParameters()
+   local groundgrad = sconv:backward(input, gradOutput):clone()
+
+   local function run(bytes)
+      THCUNN.setConvolutionColumnsLimit(bytes)
+      local gconv = sconv:clone():cuda()
+      gconv:zeroGradParameters()
+      local output = gconv:forward(input:cuda()):float()
+      local gradInput = gconv:backward(input:cuda(), gradOutput:cuda()):float()
+      return output, gradInput, gconv.gradWeight:float(), gconv.gradBias:float()
+   end
+
+   local ok, err = pcall(function()
+      local out1, gin1, gw1, gb1 = run(0)
+      local out2, gin2, gw2, gb2 = run(limit)
+
+      mytester:assertlt((out2 - groundtruth):abs():max(), precision_forward, 'error on state (forward) ')
+      mytester:assertlt((gin2 - groundgrad):abs():max(), precision_backward, 'error on state (backward) ')
+      mytester:assertlt((gw2 - sconv.gradWeight):abs():max(), precision_backward, 'error on weight (backward) ')
+      mytester:assertlt((gb2 - sconv.gradBias):abs():max(), precision_backward, 'error on bias (backward) ')
+
+      mytester:assertlt((out2 - out1):abs():max(), precision_forward, 'batched and per-sample forward differ ')
+      mytester:assertlt((gin2 - gin1):abs():max(), precision_backward, 'batched and per-sample backward differ ')
+      mytester:assertlt((gw2 - gw1):abs():max(), precision_backward, 'batched and per-sample gradWeight differ ')
+      mytester:assertlt((gb2 - gb1):abs():max(), precision_backward, 'batched and per-sample gradBias differ ')
+   end)
+   THCUNN.setConvolutionColumnsLimit(0)
+   if not ok then error(err) end
+end
+
+function cunntest.SpatialConvolution_workspace()
+   local THCUNN = require 'cunn.THCUNN'
+   local bs = math.random(2,8)
+   local net = nn.Sequential()
+      :add(nn.SpatialConvolutionMM(3, 16, 5, 5, 1, 1, 2, 2))
+      :add(nn.SpatialConvolutionMM(16, 32, 3, 3, 2, 2, 1, 1))
+      :add(nn.SpatialDilatedConvolution(32, 8, 3, 3, 1, 1, 2, 2, 2, 2))
+      :add(nn.SpatialFullConvolution(8, 4, 4, 4, 2, 2, 1, 1))
+   local input = torch.randn(bs, 3, 32, 32)
+   local gradOutput = torch.randn(bs, 4, 32, 32)
+
+   local function run(enabled)
+      THCUNN.setWorkspaceEnabled(enabled)
+      local gnet = net:clone():cuda()
+      gnet:zeroGradParameters()
+      local output = gnet:forward(input:cuda()):float()
+      local gradInput = gnet:backward(input:cuda(), gradOutput:cuda()):float()
+      local _, gradParams = gnet:getParameters()
+      return gnet, output, gradInput, gradParams:float()
+   end
+
+   local ok, err = pcall(function()
+      local _, out1, gin1, gp1 = run(false)
+      THCUNN.releaseWorkspace()
+      local gnet, out2, gin2, gp2 = run(true)
+      mytester:assertlt((out2 - out1):abs():max(), precision_forward, 'error on state (forward) ')
+      mytester:assertlt((gin2 - gin1):abs():max(), precision_backward, 'error on state (backward) ')
+      mytester:assertlt((gp2 - gp1):abs():max(), precision_backward, 'error on parameters (backward) ')
+
+      -- scratch is returned to the arena when each call ends
+      mytester:asserteq(gnet:get(1).finput:nElement(), 0, 'columns still attached after forward')
+      mytester:asserteq(gnet:get(2).fgradInput:nElement(), 0, 'columns still attached after backward')
+
+      -- the arena holds the largest single call, not the sum over layers,
+      -- and a second step does not allocate
+      local stats = THCUNN.workspaceStats()
+      local largest = 3*5*5 * 32*32 * 4 -- columns of the first layer
+      mytester:assertle(stats.highWater, largest + 256, 'high-water mark is above the largest layer')
+      gnet:forward(input:cuda())
+      gnet:backward(input:cuda(), gradOutput:cuda())
+      mytester:asserteq(THCUNN.workspaceStats().grows, stats.grows, 'arena grew on the second step')
+   end)
+   THCUNN.setWorkspaceEnabled(true)
+   if not ok then error(err) end
+end
+
+function cunntest.SpatialConvolution_implicit_gemm()
+   local THCUNN = require 'cunn.THCUNN'
+   -- odd sizes, strides, padding and dilation, so tiles and kernel taps
+   -- fall off every edge
+   local bs = math.random(2,5)
+   local cases = {
+      {nn.SpatialConvolutionMM(3, 70, 5, 5, 1, 1, 2, 2), torch.randn(bs, 3, 19, 23)},
+      {nn.SpatialConvolutionMM(17, 9, 3, 4, 2, 3, 1, 0), torch.randn(bs, 17, 21, 26)},
+      {nn.SpatialDilatedConvolution(6, 11, 3, 3, 2, 1, 2, 1, 2, 3), torch.randn(bs, 6, 17, 20)},
+      {nn.VolumetricConvolution(4, 13, 3, 3, 2, 1, 2, 1, 1, 1, 0), torch.randn(bs, 4, 9, 11, 10)},
+   }
+
+   local function run(module, input, gradOutput, implicit)
+      THCUNN.setImplicitGemm(implicit)
+      local gmodule = module:clone():cuda()
+      gmodule:zeroGradParameters()
+      local output = gmodule:forward(input:cuda()):float()
+      local gradInput = gmodule:backward(input:cuda(), gradOutput:cuda()):float()
+      return output, gradInput, gmodule.gradWeight:float(), gmodule.gradBias:float()
+   end
+
+   local ok, err = pcall(function()
+      for _, c in ipairs(cases) do
+         local module, input = c[1], c[2]
+         local gradOutput = torch.randn(module:forward(input):size())
+         local out1, gin1, gw1, gb1 = run(module, input, gradOutput, false)
+         local out2, gin2, gw2, gb2 = run(module, input, gradOutput, true)
+         local suffix = ' (' .. torch.type(module) .. ')'
+         mytester:assertlt((out2 - out1):abs():max(), precision_forward, 'error on state (forward)' .. suffix)
+         mytester:assertlt((gin2 - gin1):abs():max(), precision_backward, 'error on state (backward)' .. suffix)
+         -- the parameter gradients sum over the whole batch
+         local wscale = math.max(1, gw1:abs():max())
+         mytester:assertlt((gw2 - gw1):abs():max() / wscale, precision_backward, 'error on weight (backward)' .. suffix)
+         local bscale = math.max(1, gb1:abs():max())
+         mytester:assertlt((gb2 - gb1):abs():max() / bscale, precision_backward, 'error on bias (backward)' .. suffix)
+
+         -- 'auto' alternates between the paths while it times them
+         THCUNN.clearTuning()
+         for i = 1, 5 do
+            local out3, gin3, gw3 = run(module, input, gradOutput, 'auto')
+            mytester:assertlt((out3 - out1):abs():max(), precision_forward, 'error on state (forward, auto)' .. suffix)
+            mytester:assertlt((gin3 - gin1):abs():max(), precision_backward, 'error on state (backward, auto)' .. suffix)
+            mytester:assertlt((gw3 - gw1):abs():max() / wscale, precision_backward, 'error on weight (backward, auto)' .. suffix)
+         end
+
+         -- non-batch input
+         local single = module:clone():cuda():forward(input[1]:cuda()):float()
+         mytester:assertlt((single - out1[1]):abs():max(), precision_forward, 'error on state (forward, no batch)' .. suffix)
+      end
+   end)
+   THCUNN.setImplicitGemm('auto')
+   if not ok then error(err) end
+end
+
+function cunntest.SpatialConvolutionMM_winograd()
+   local THCUNN = require 'cunn.THCUNN'
+   local bs = math.random(1,4)
+   local from, to = math.random(16,40), math.random(16,40)
+   local ok, err = pcall(function()
+      -- output sizes off the tile grid, with and without padding
+      for _, config in ipairs{{1, 1, 17, 22}, {0, 2, 9, 16}} do
+         local padW, padH, inH, inW = table.unpack(config)
+         local sconv = nn.SpatialConvolutionMM(from, to, 3, 3, 1, 1, padW, padH)
+         local input = torch.randn(bs, from, inH, inW)
+         local groundtruth = sconv:forward(input)
+         local scale = math.max(1, groundtruth:abs():max())
+
+         for _, tile in ipairs{2, 4} do
+            -- F(4x4) rounds with transform constants up to 8
+            local precision = tile == 4 and 10 * precision_forward or precision_forward
+            local suffix = string.format(' (F(%dx%d), pad %dx%d)', tile, tile, padW, padH)
+
+            -- the host reference runs the same transforms without a device
+            local ref = THCUNN.winogradReference(input, sconv.weight, sconv.bias, padW, padH, tile)
+            mytester:assertlt((ref - groundtruth):abs():max() / scale, precision, 'error on reference' .. suffix)
+
+            THCUNN.setWinograd(tile)
+            local gconv = sconv:clone():cuda()
+            local rescuda = gconv:forward(input:cuda()):float()
+            mytester:assertlt((rescuda - groundtruth):abs():max() / scale, precision, 'error on state (forward)' .. suffix)
+
+            -- inference with the transformed filters cached
+            gconv:evaluate()
+            local _, count = cunn.cacheWinogradFilters(gconv)
+            mytester:asserteq(count, 1, 'filters not cached' .. suffix)
+            for _ = 1, 2 do
+               rescuda = gconv:forward(input:cuda()):float()
+               mytester:assertlt((rescuda - groundtruth):abs():max() / scale, precision, 'error with cached filters' .. suffix)
+            end
+            -- in-place weight updates reach the cached filters
+            local updated = sconv:clone()
+            updated.weight:narrow(1, 1, math.ceil(to / 2)):mul(-0.5)
+            local expected = updated:forward(input)
+            gconv.weight:copy(updated.weight)
+            rescuda = gconv:forward(input:cuda()):float()
+            mytester:assertlt((rescuda - expected):abs():max() / scale, precision, 'stale cached filters' .. suffix)
+            cunn.cacheWinogradFilters(gconv, false)
+         end
+      end
+   end)
+   THCUNN.setWinograd('auto')
+   if not ok then error(err) end
+end
+
+function cunntest.SpatialConvolution_fused_activation()
+   local THCUNN = require 'cunn.THCUNN'
+   local bs = math.random(1,4)
+   local from, to = math.random(16,24), math.random(16,24)
+   local activations = {nn.ReLU(), nn.Threshold(0.3, -0.2), nn.ELU(0.7), nn.LeakyReLU(0.1)}
+   -- every forward path of SpatialConvolutionMM: per-sample GEMM, batched
+   -- columns, implicit GEMM and Winograd
+   local paths = {
+      {name = 'columns', implicit = false, winograd = false, limit = 0},
+      {name = 'batched columns', implicit = false, winograd = false, limit = 2^30},
+      {name = 'implicit GEMM', implicit = true, winograd = false, limit = 0},
+      {name = 'Winograd', implicit = false, winograd = 2, limit = 0},
+   }
+
+   local ok, err = pcall(function()
+      for _, activation in ipairs(activations) do
+         local model = nn.Sequential()
+            :add(nn.SpatialConvolutionMM(from, to, 3, 3, 1, 1, 1, 1))
+            :add(nn.SpatialBatchNormalization(to))
+            :add(activation)
+            :add(nn.SpatialConvolution(to, 8, 3, 3, 2, 2):noBias())
+            :add(activation:clone())
+         local bn = model.modules[2]
+         bn.running_mean:normal(0, 1)
+         bn.running_var:uniform(0.5, 2)
+         model:evaluate()
+
+         local input = torch.randn(bs, from, 13, 15)
+         local groundtruth = model:forward(input):clone()
+         local suffix = ' (' .. torch.type(activation) .. ')'
+
+         local gmodel, count = cunn.fuseConvolutionActivation(model:clone():cuda())
+         mytester:asserteq(count, 2, 'wrong number of activations fused' .. suffix)
+         mytester:asserteq(#gmodel.modules, 2, 'fused model should hold the two convolutions' .. suffix)
+         for _, path in ipairs(paths) do
+            THCUNN.setImplicitGemm(path.implicit)
+            THCUNN.setWinograd(path.winograd)
+            THCUNN.setConvolutionColumnsLimit(path.limit)
+            local rescuda = gmodel:forward(input:cuda()):float()
+            mytester:assertlt((rescuda - groundtruth):abs():max(), precision_forward,
+                              'error on fused output, ' .. path.name .. suffix)
+         end
+         THCUNN.setImplicitGemm('auto')
+         THCUNN.setWinograd('auto')
+         THCUNN.setConvolutionColumnsLimit(0)
+
+         mytester:asserteq(torch.type(gmodel.modules[1]), 'nn.SpatialConvolutionMMActivation', 'fused class' .. suffix)
+         mytester:asserteq(torch.type(gmodel.modules[2]), 'nn.SpatialConvolutionActivation', 'fused class' .. suffix)
+         -- the activation survives serialization
+         local loaded = torch.deserialize(torch.serialize(gmodel))
+         local rescuda = loaded:forward(input:cuda()):float()
+         mytester:assertlt((rescuda - groundtruth):abs():max(), precision_forward,
+                           'error on fused output after loading' .. suffix)
+         -- and is never silently dropped
+         local conv = loaded.modules[1]
+         mytester:assert(not pcall(function() conv:forward(input) end), 'fused convolution ran on float input' .. suffix)
+         local gradOutput = conv.output:clone()
+         mytester:assert(not pcall(function() conv:updateGradInput(input:cuda(), gradOutput) end),
+                         'fused convolution ran updateGradInput' .. suffix)
+         mytester:assert(not pcall(function() conv:accGradParameters(input:cuda(), gradOutput) end),
+                         'fused convolution ran accGradParameters' .. suffix)
+      end
+
+      -- modules in training mode are left alone
+      local trained = nn.Sequential():add(nn.SpatialConvolution(3, 4, 3, 3)):add(nn.ReLU()):cuda()
+      local _, count = cunn.fuseConvolutionActivation(trained)
+      mytester:asserteq(count, 0, 'training mode convolution was fused')
+   end)
+   THCUNN.setImplicitGemm('auto')
+   THCUNN.setWinograd('auto')
+   THCUNN.setConvolutionColumnsLimit(0)
+   if not ok then error(err) end
+end
+
+function cunntest.Tuning()
+   local THCUNN = require 'cunn.THCUNN'
+   local ffi = require 'ffi'
+   local state = THCUNN.getState()
+   local path = os.tmpname()
+
+   local ok, err = pcall(function()
+      -- the entry points used from Lua; the cache itself is covered by the
+      -- host tests in lib/THCUNN/test
+      local choice = ffi.new('int[1]')
+      THCUNN.C.THNN_CudaTuning_fastest(state, 4, ffi.new('float[4]', {3, -1, 1, 2}), choice)
+      mytester:asserteq(choice[0], 2, 'fastest candidate')
+      THCUNN.C.THNN_CudaTuning_fastest(state, 2, ffi.new('float[2]', {-1, -1}), choice)
+      mytester:asserteq(choice[0], -1, 'no candidate ran')
+
+      THCUNN.setTuningCache(path)
+      THCUNN.clearTuning()
+      THCUNN.C.THNN_CudaTuning_record(state, 'Device A/60', 'kernel', 100, 4, 3)
+      mytester:asserteq(THCUNN.tuningLookup('Device A/60', 'kernel', 120, 4), 3, 'same bucket')
+      mytester:asserteq(THCUNN.tuningLookup('Device A/60', 'kernel', 129, 4), nil, 'next bucket')
+      mytester:asserteq(THCUNN.tuningLookup('Device B/60', 'kernel', 100, 4), nil, 'other device')
+      mytester:asserteq(THCUNN.tuningLookup('Device A/60', 'kernel', 100, 5), nil, 'candidate list changed')
+
+      -- choices survive in the file
+      THCUNN.clearTuning()
+      mytester:asserteq(THCUNN.tuningLookup('Device A/60', 'kernel', 100, 4), nil, 'cleared')
+      THCUNN.setTuningCache(path)
+      mytester:asserteq(THCUNN.tuningLookup('Device A/60', 'kernel', 100, 4), 3, 'reloaded')
+
+      -- tuned kernels give the same results and record their choice
+      local props = cutorch.getDeviceProperties(cutorch.getDevice())
+      local device = props.name .. '/' .. props.multiProcessorCount
+      local input = torch.randn(17, 1000)
+      local groundtruth = nn.LogSoftMax():forward(input)
+      local output = nn.LogSoftMax():cuda():forward(input:cuda()):float()
+      mytester:assertlt((output - groundtruth):abs():max(), precision_forward, 'error on state (LogSoftMax)')
+      mytester:assertne(THCUNN.tuningLookup(device, 'LogSoftMax_updateOutput', 1000, 4), nil, 'LogSoftMax not tuned')
+
+      input = torch.randn(4, 7, 30, 33)
+      local sconv = nn.SpatialSubSampling(7, 3, 3, 2, 2)
+      groundtruth = sconv:forward(input)
+      output = sconv:clone():cuda():forward(input:cuda()):float()
+      mytester:assertlt((output - groundtruth):abs():max(), precision_forward, 'error on state (SpatialSubSampling)')
+      mytester:assertne(THCUNN.tuningLookup(device, 'SpatialSubSampling_updateOutput', groundtruth[1][1]:nElement(), 5),
+                        nil, 'SpatialSubSampling not tuned')
+   end)
+   THCUNN.setTuningCache(nil)
+   os.remove(path)
+   if not ok then error(err) end
+end
+
+function cunntest.Wavefront_reduce()
+   local THCUNN = require 'cunn.THCUNN'
+   local state = THCUNN.getState()
+   -- blocks smaller than a wavefront, with a partial last wavefront, and whole
+   -- ones; none of them a multiple of 64
+   local input = torch.range(1, 777):float()
+   input[500] = 2000
+   local sum, max = input:sum(), input:max()
+   local output = torch.CudaTensor()
+   for _, blockSize in ipairs({1, 7, 32, 33, 96, 100, 160, 333, 1000}) do
+      THCUNN.C.THNN_CudaWavefront_reduce(state, input:cuda():cdata(), output:cdata(), blockSize)
+      local result = output:float()
+      mytester:asserteq(result[1], sum, 'sum with ' .. blockSize .. ' threads')
+      mytester:asserteq(result[2], max, 'max with ' .. blockSize .. ' threads')
+   end
+end
+
+function cunntest.SpatialConvolutionLocal_large_batch()
+   -- sizes off the 16x16 tile grid of the batched kernels
+   local bs = math.random(33,64)
+   local from = math.random(1,20)
+   local to = math.random(1,20)
+   local ki = math.random(1,5)
+   local kj = math.random(1,5)
+   local si = math.random(1,2)
+   local sj = math.random(1,2)
+   local outi = math.random(1,20)
+   local outj = math.random(1,20)
+   local padW = math.random(0,1)
+   local padH = math.random(0,1)
+   local ini = (outi-1)*si+ki-padW*2
+   local inj = (outj-1)*sj+kj-padH*2
+   local scale = math.random()
+
+   local input = torch.randn(bs,from,inj,ini)
+   local gradOutput = torch.randn(bs,to,outj,outi)
+   local sconv = nn.SpatialConvolutionLocal(from,to,ini,inj,ki,kj,si,sj,padW,padH)
+   local gconv = sconv:clone():cuda()
+   sconv:zeroGradParameters()
+   gconv:zeroGradParameters()
+
+   local groundtruth = sconv:forward(input)
+   local groundgrad = sconv:backward(input, gradOutput, scale)
+   local rescuda = gconv:forward(input:cuda())
+   local gradcuda = gconv:backward(input:cuda(), gradOutput:cuda(), scale)
+
+   mytester:assertlt((rescuda:float() - groundtruth):abs():max(), precision_forward, 'error on state (forward) ')
+   mytester:assertlt((gradcuda:float() - groundgrad):abs():max(), precision_backward, 'error on state (backward) ')
+   mytester:assertlt((gconv.gradWeight:float() - sconv.gradWeight):abs():max(), precision_backward * 10, 'error on weight (backward) ')
+   mytester:assertlt((gconv.gradBias:float() - sconv.gradBias):abs():max(), precision_backward * 10, 'error on bias (backward) ')
+end
+
 function cunntest.SpatialConvolutionLocal_forward_single()
    local from = math.random(1,32)
    local to = math.random(1,8) * 8
@@ -2734,6 +3283,47 @@ function cunntest.SpatialDilatedMaxPooling_backward_batch()
    mytester:assertlt(error:abs():max(), precision_backward, 'error on state (backward) ')
 end
 
+function cunntest.SpatialMaxPooling_scatter_backward()
+   local THCUNN = require 'cunn.THCUNN'
+   local bs = math.random(1,4)
+   local from = math.random(1,16)
+   -- {kW, kH, dW, dH, padW, padH, dilationW, dilationH}: disjoint windows,
+   -- overlapping 3x3/2 windows and dilated ones
+   local cases = {
+      {2, 2, 2, 2, 0, 0, 1, 1},
+      {3, 3, 2, 2, 1, 1, 1, 1},
+      {3, 2, 1, 2, 1, 0, 2, 3},
+      {4, 4, 3, 3, 1, 2, 1, 1},
+   }
+
+   local ok, err = pcall(function()
+      for _, c in ipairs(cases) do
+         local module = nn.SpatialDilatedMaxPooling(unpack(c))
+         local input = torch.randn(bs, from, math.random(17,40), math.random(17,40))
+         local gradOutput = torch.randn(module:forward(input):size())
+         local groundgrad = module:backward(input, gradOutput)
+         local title = string.format(' (%dx%d, stride %dx%d, pad %dx%d, dilation %dx%d)', unpack(c))
+
+         for _, compact in ipairs{false, true} do
+            local gmodule = module:clone():cuda()
+            if compact then cunn.compactPoolingIndices(gmodule) end
+            gmodule:forward(input:cuda())
+            for _, scatter in ipairs{false, true} do
+               THCUNN.setMaxPoolingScatter(scatter)
+               local gradInput = gmodule:backward(input:cuda(), gradOutput:cuda()):float()
+               local suffix = title .. (scatter and ' scatter' or ' gather') .. (compact and ', compact' or '')
+               mytester:assertlt((gradInput - groundgrad):abs():max(), precision_backward,
+                                 'error on state (backward)' .. suffix)
+               local again = gmodule:backward(input:cuda(), gradOutput:cuda()):float()
+               mytester:asserteq((again - gradInput):abs():max(), 0, 'not deterministic' .. suffix)
+            end
+         end
+      end
+   end)
+   THCUNN.setMaxPoolingScatter('auto')
+   if not ok then error(err) end
+end
+
 function cunntest.SpatialFractionalMaxPooling_forward()
     local batch = math.random(1, 3)
     local plane = math.random(1, 3)
@@ -4160,6 +4750,45 @@ function cunntest.TemporalConvolution_backward_batch()
    mytester:assertlt(berror:abs():max(), precision_backward, 'error on bias (backward) ')
 end
 
+function cunntest.TemporalConvolution_long_sequence()
+   -- long sequences, strides larger than the kernel and trailing input frames
+   for _, config in ipairs{{1, 1}, {3, 1}, {5, 2}, {2, 5}, {4, 3}} do
+      local ki, si = table.unpack(config)
+      local bs, from, to = 3, 24, 40
+      local ini = 1500 + math.random(0, si)
+
+      local input = torch.randn(bs, ini, from)
+      local sconv = nn.TemporalConvolution(from, to, ki, si)
+      local groundtruth = sconv:forward(input)
+      local gradOutput = torch.randn(groundtruth:size())
+      sconv:zeroGradParameters()
+      local groundgrad = sconv:backward(input, gradOutput)
+
+      local gconv = sconv:clone():cuda()
+      local rescuda = gconv:forward(input:cuda())
+      gconv:zeroGradParameters()
+      local gradcuda = gconv:backward(input:cuda(), gradOutput:cuda())
+
+      local suffix = string.format(' (kW %d, dW %d)', ki, si)
+      mytester:assertlt((rescuda:float() - groundtruth):abs():max(), precision_forward,
+                        'error on state (forward)' .. suffix)
+      mytester:assertlt((gradcuda:float() - groundgrad):abs():max(), precision_backward,
+                        'error on state (backward)' .. suffix)
+      -- the parameter gradients sum over every output frame of the batch
+      local wscale = math.max(1, sconv.gradWeight:abs():max())
+      mytester:assertlt((gconv.gradWeight:float() - sconv.gradWeight):abs():max() / wscale,
+                        precision_backward, 'error on weight (backward)' .. suffix)
+      local bscale = math.max(1, sconv.gradBias:abs():max())
+      mytester:assertlt((gconv.gradBias:float() - sconv.gradBias):abs():max() / bscale,
+                        precision_backward, 'error on bias (backward)' .. suffix)
+
+      -- non-batch input
+      local single = gconv:forward(input[1]:cuda())
+      mytester:assertlt((single:float() - groundtruth[1]):abs():max(), precision_forward,
+                        'error on state (forward, 2D)' .. suffix)
+   end
+end
+
 function cunntest.Dropout()
    local p = 0.2 --prob of droping out a neuron
    local input = torch.CudaTensor(1000):fill((1-p))
@@ -4769,6 +5398,137 @@ function cunntest.ClassNLLCriterionMultipleTargetWeights()
    mytester:assertlt(gerr:abs():max(), precision_forward, 'error  on gradInput')
 end
 
+function cunntest.ClassNLLCriterion_deterministic()
+   -- large batches are reduced across many blocks; the two-stage reduction
+   -- must match the CPU and give identical results from run to run
+   local batchSize = math.random(50000, 100000)
+   local classes = math.random(2, 10)
+   local input = torch.randn(batchSize, classes)
+   local target = torch.LongTensor(batchSize):random(classes)
+   local weights = torch.rand(classes)
+
+   local mod = nn.ClassNLLCriterion(weights)
+   local fout = mod:forward(input, target)
+
+   local cmod = nn.ClassNLLCriterion(weights:cuda()):cuda()
+   local cinput, ctarget = input:cuda(), target:cuda()
+   local cout = cmod:forward(cinput, ctarget)
+   local ctw = cmod.total_weight_tensor:float()[1]
+   mytester:assertlt(math.abs(fout - cout), precision_forward, 'error on output')
+   mytester:assertlt(math.abs(mod.total_weight_tensor[1] - ctw) / ctw, precision_forward, 'error on total_weight')
+   for i = 1, 3 do
+      mytester:asserteq(cmod:forward(cinput, ctarget), cout, 'ClassNLLCriterion output not reproducible')
+   end
+
+   local h, w = math.random(100, 200), math.random(100, 200)
+   local sinput = torch.randn(4, classes, h, w)
+   local starget = torch.LongTensor(4, h, w):random(classes)
+   local smod = nn.SpatialClassNLLCriterion(weights)
+   local sfout = smod:forward(sinput, starget)
+
+   local scmod = nn.SpatialClassNLLCriterion(weights:cuda()):cuda()
+   local scinput, sctarget = sinput:cuda(), starget:cuda()
+   local scout = scmod:forward(scinput, sctarget)
+   mytester:assertlt(math.abs(sfout - scout), precision_forward, 'error on spatial output')
+   for i = 1, 3 do
+      mytester:asserteq(scmod:forward(scinput, sctarget), scout, 'SpatialClassNLLCriterion output not reproducible')
+   end
+end
+
+function cunntest.FusedCrossEntropyCriterion()
+   local batchSize = math.random(1, 64)
+   local classes = math.random(2, 5000)
+
+   for _, useWeights in ipairs{false, true} do
+      for _, sizeAverage in ipairs{true, false} do
+         local input = torch.randn(batchSize, classes)
+         local target = torch.LongTensor(batchSize):random(classes)
+         local weights = useWeights and torch.rand(classes) or nil
+
+         local lsm = nn.LogSoftMax()
+         local nll = nn.ClassNLLCriterion(weights, sizeAverage)
+         local logprob = lsm:forward(input)
+         local fout = nll:forward(logprob, target)
+         local fgin = lsm:backward(input, nll:backward(logprob, target))
+
+         local cmod = nn.FusedCrossEntropyCriterion(weights and weights:cuda(), sizeAverage):cuda()
+         local cinput = input:cuda()
+         local cout = cmod:forward(cinput, target:cuda())
+         local cgin = cmod:backward(cinput, target:cuda())
+
+         mytester:assertlt(math.abs(fout - cout) / math.max(1, math.abs(fout)), precision_forward, 'error on output')
+         mytester:assertlt((cgin:float() - fgin):abs():max(), precision_forward, 'error on gradInput')
+
+         -- gradient written over the logits
+         local imod = nn.FusedCrossEntropyCriterion(weights and weights:cuda(), sizeAverage, true):cuda()
+         local iinput = input:cuda()
+         mytester:assertlt(math.abs(imod:forward(iinput, target:cuda()) - cout), precision_forward, 'error on inplace output')
+         local igin = imod:backward(iinput, target:cuda())
+         mytester:assert(igin == iinput, 'inplace gradInput is not the input')
+         mytester:assertlt((igin:float() - fgin):abs():max(), precision_forward, 'error on inplace gradInput')
+      end
+   end
+
+   -- class weights that cancel out: a zero total weight is not divided by,
+   -- and gives no gradient
+   local input = torch.randn(2, classes)
+   local target = torch.LongTensor{1, 2}
+   local weights = torch.zeros(classes)
+   weights[1] = 1
+   weights[2] = -1
+   local nll = nn.ClassNLLCriterion(weights)
+   local logprob = nn.LogSoftMax():forward(input)
+   local fout = nll:forward(logprob, target)
+   local cmod = nn.FusedCrossEntropyCriterion(weights:cuda(), true, true):cuda()
+   local cinput = input:cuda()
+   -- targets that are not CudaLongTensors go through a buffer kept across calls
+   local cout = cmod:forward(cinput, target)
+   local buffer = cmod.targetBuffer
+   mytester:assert(cmod.target == buffer, 'target was not copied into the buffer')
+   mytester:asserteq(cout, fout, 'error on output with zero total weight')
+   local cgin = cmod:backward(cinput, target)
+   mytester:asserteq(cgin:float():abs():max(), 0, 'gradInput with zero total weight is not zero')
+   cmod:forward(input:cuda(), target)
+   mytester:assert(cmod.targetBuffer == buffer, 'target buffer was reallocated')
+end
+
+function cunntest.Profiler()
+   local THCUNN = require 'cunn.THCUNN'
+   if not pcall(THCUNN.profile, true) then
+      -- the bookkeeping is covered by the host tests in lib/THCUNN/test
+      io.stderr:write('skipping Profiler: THCUNN was built without -DTHCUNN_PROFILE=ON\n')
+      return
+   end
+   THCUNN.profileReset()
+
+   local mod = nn.SoftMax():cuda()
+   local input = torch.CudaTensor(16, 100):normal()
+   for i = 1, 3 do
+      mod:forward(input)
+   end
+   mod:backward(input, input)
+   THCUNN.profile(false)
+   mod:forward(input)
+
+   local trace, summary = os.tmpname(), os.tmpname()
+   THCUNN.profileDump(trace, summary)
+   THCUNN.profileReset()
+
+   local f = io.open(trace)
+   local json = f:read('*a')
+   f:close()
+   local _, calls = json:gsub('"name":"THNN_CudaSoftMax_updateOutput"', '')
+   mytester:asserteq(calls, 3, 'calls recorded while enabled')
+   mytester:assert(json:find('"shapes":"16x100"', 1, true) ~= nil, 'input shape')
+
+   f = io.open(summary)
+   local text = f:read('*a')
+   f:close()
+   mytester:assert(text:find('THNN_CudaSoftMax_updateGradInput%s+1 ') ~= nil, 'aggregated calls')
+   os.remove(trace)
+   os.remove(summary)
+end
+
 function cunntest.TemporalMaxPooling()
    local input = torch.rand(16, 18, 3)
    local settings = {{2, 2}, {3, 3}, {4, 2}, {2, 4}, {3, 5}}
@@ -5352,6 +6112,93 @@ function cunntest.VolumetricMaxUnpooling_backward_batch()
    mytester:assertlt(error:abs():max(), precision_backward, 'error on state (backward) ')
 end
 
+-- compact (byte) indices must route exactly like the float ones
+local function checkCompactPooling(pooler, unpooler, input, gradOutput, title)
+   local gpool = pooler:clone():cuda()
+   local cpool = pooler:clone():cuda()
+   local gunpool = unpooler(gpool):cuda()
+   local cunpool = unpooler(cpool):cuda()
+   local _, count = cunn.compactPoolingIndices(nn.Sequential():add(cpool):add(cunpool))
+   mytester:asserteq(count, 1, 'wrong number of modules converted, ' .. title)
+   mytester:asserteq(torch.type(cpool), torch.type(pooler) .. 'Compact', 'pooling class, ' .. title)
+   mytester:asserteq(torch.type(cunpool), torch.type(gunpool) .. 'Compact', 'unpooling class, ' .. title)
+
+   input = input:cuda()
+   local output = gpool:forward(input)
+   local coutput = cpool:forward(input)
+   mytester:asserteq(torch.type(cpool.indices), 'torch.CudaByteTensor', 'compact indices, ' .. title)
+
+   -- converted modules keep their class through serialization
+   local loaded = torch.deserialize(torch.serialize(cpool))
+   mytester:asserteq(torch.type(loaded), torch.type(cpool), 'class after loading, ' .. title)
+   mytester:assertlt((loaded:forward(input) - output):abs():max(), precision_forward,
+                     'error on loaded output, ' .. title)
+   mytester:asserteq(torch.type(loaded.indices), 'torch.CudaByteTensor', 'compact indices after loading, ' .. title)
+   mytester:assertlt((coutput - output):abs():max(), precision_forward, 'error on output, ' .. title)
+
+   gradOutput = gradOutput:cuda()
+   local gradInput = gpool:backward(input, gradOutput)
+   local cgradInput = cpool:backward(input, gradOutput)
+   mytester:assertlt((cgradInput - gradInput):abs():max(), precision_backward,
+                     'error on gradInput, ' .. title)
+
+   local unpooled = gunpool:forward(output)
+   local cunpooled = cunpool:forward(coutput)
+   mytester:assertlt((cunpooled - unpooled):abs():max(), precision_forward,
+                     'error on unpooled output, ' .. title)
+   local unpoolGrad = gunpool:backward(output, input)
+   local cunpoolGrad = cunpool:backward(coutput, input)
+   mytester:assertlt((cunpoolGrad - unpoolGrad):abs():max(), precision_backward,
+                     'error on unpooled gradInput, ' .. title)
+
+   cunn.compactPoolingIndices(loaded, false)
+   mytester:asserteq(torch.type(loaded), torch.type(pooler), 'class after converting back, ' .. title)
+   loaded:forward(input)
+   mytester:asserteq(torch.type(loaded.indices), 'torch.CudaTensor', 'float indices after converting back, ' .. title)
+end
+
+function cunntest.SpatialMaxPooling_compact_indices()
+   local bs = math.random(1,4)
+   local from = math.random(1,16)
+   local ki = math.random(2,4)
+   local kj = math.random(2,4)
+   local si = math.random(1,ki)
+   local sj = math.random(1,kj)
+   local padi = math.random(0,ki/2-1)
+   local padj = math.random(0,kj/2-1)
+   local ini = math.random(16,64)
+   local inj = math.random(16,64)
+
+   local pooler = nn.SpatialMaxPooling(ki,kj,si,sj,padi,padj)
+   local input = torch.randn(bs,from,inj,ini)
+   local gradOutput = torch.randn(pooler:forward(input):size())
+   local title = string.format('SpatialMaxPooling %dx%d, stride %dx%d, pad %dx%d',
+                               kj, ki, sj, si, padj, padi)
+   checkCompactPooling(pooler, nn.SpatialMaxUnpooling, input, gradOutput, title)
+end
+
+function cunntest.VolumetricMaxPooling_compact_indices()
+   local bs = math.random(1,4)
+   local from = math.random(1,8)
+   local kt = math.random(2,5)
+   local ki = math.random(2,5)
+   local kj = math.random(2,5)
+   local padt = math.random(0,kt/2-1)
+   local padi = math.random(0,ki/2-1)
+   local padj = math.random(0,kj/2-1)
+   local it = math.random(8,24)
+   local ii = math.random(8,24)
+   local ij = math.random(8,24)
+
+   -- unpooling needs non-overlapping windows
+   local pooler = nn.VolumetricMaxPooling(kt,ki,kj,kt,ki,kj,padt,padi,padj)
+   local input = torch.randn(bs,from,it,ij,ii)
+   local gradOutput = torch.randn(pooler:forward(input):size())
+   local title = string.format('VolumetricMaxPooling %dx%dx%d, pad %dx%dx%d',
+                               kt, kj, ki, padt, padj, padi)
+   checkCompactPooling(pooler, nn.VolumetricMaxUnpooling, input, gradOutput, title)
+end
+
 function cunntest.VolumetricAveragePooling_forward()
    local kT = math.random(3, 7)
    local kH = math.random(3, 7)
@@ -5955,6 +6802,60 @@ function cunntest.LookupTable_backward()
    mytester:assertlt(weightGradError:abs():max(), precision_backward, 'error on weight')
 end
 
+function cunntest.LookupTable_backward_large()
+   -- many repeated indices over a large vocabulary exercises the device
+   -- radix sort and the run-length counts used by scaleGradByFreq
+   local nVocab = 100000
+   local nDim = 16
+   local nInput = 65536
+
+   for _, scaleGradByFreq in ipairs{false, true} do
+      local input = torch.rand(nInput):pow(3):mul(nVocab - 1):floor():add(1):long()
+      local gradOutput = torch.randn(nInput, nDim)
+
+      local sconv = nn.LookupTable(nVocab, nDim, 1)
+      local gconv = sconv:clone():cuda()
+      if scaleGradByFreq then
+         sconv = sconv:scaleGradByFreq()
+         gconv = gconv:scaleGradByFreq()
+      end
+
+      sconv:forward(input)
+      sconv:backward(input, gradOutput)
+
+      gconv:forward(input:cuda())
+      gconv:backward(input:cuda(), gradOutput:cuda())
+
+      local weightGradError = gconv.gradWeight:float() - sconv.gradWeight
+      mytester:assertlt(weightGradError:abs():max(), precision_backward,
+         'error on weight, scaleGradByFreq: ' .. tostring(scaleGradByFreq))
+   end
+end
+
+function cunntest.LookupTable_renorm()
+   -- repeated, unsorted indices: every row must be rescaled exactly once
+   local nVocab = 5000
+   local nInput = 20000
+
+   for _, nDim in ipairs{7, 100, 1000} do
+      for _, normType in ipairs{1, 2, 3} do
+         local input = torch.rand(nInput):pow(2):mul(nVocab - 1):floor():add(1):long()
+         local sconv = nn.LookupTable(nVocab, nDim, 0, 1, normType)
+         sconv.weight:mul(10)
+         local gconv = sconv:clone():cuda()
+
+         local groundtruth = sconv:forward(input)
+         local rescuda = gconv:forward(input:cuda())
+
+         local title = string.format('dim %d, normType %d', nDim, normType)
+         local error = rescuda:float() - groundtruth
+         mytester:assertlt(error:abs():max(), precision_forward, 'error on output, ' .. title)
+         local weightError = gconv.weight:float() - sconv.weight
+         mytester:assertlt(weightError:abs():max(), precision_forward, 'error on weight, ' .. title)
+      end
+   end
+end
+
 function cunntest.getParameters()
   -- tensors are non-contiguous but compact; they can be gathered
   local L = nn.Linear(10,10):cuda()
@@ -629,6 +629,286 @@ function test.DataParallelTable_emptyData()
 end
 
 
+-- A device layer for the collectives that keeps every "device" in host
+-- memory. It checks that each copy and add touches tensors on the devices it
+-- names, and counts the elements each device receives.
+local MockComm = {}
+MockComm.__index = MockComm
+
+function MockComm.new(tensors, devices)
+   local self = setmetatable({ buffers = {}, owner = {}, received = {} }, MockComm)
+   for i, t in ipairs(tensors) do
+      self.owner[torch.pointer(t:storage())] = devices[i]
+      self.received[devices[i]] = 0
+   end
+   return self
+end
+
+function MockComm:check(device, t)
+   assert(self.owner[torch.pointer(t:storage())] == device, 'tensor used on the wrong device')
+end
+
+function MockComm:buffer(device, slot, t)
+   local key = device .. ':' .. slot
+   if not self.buffers[key] then
+      self.buffers[key] = torch.DoubleTensor(1)
+      self.owner[torch.pointer(self.buffers[key]:storage())] = device
+   end
+   return self.buffers[key]:resizeAs(t)
+end
+
+function MockComm:copy(dstDevice, dst, srcDevice, src)
+   assert(torch.pointer(dst:storage()) ~= torch.pointer(src:storage()), 'copy within a tensor')
+   self:check(dstDevice, dst)
+   self:check(srcDevice, src)
+   dst:copy(src)
+   self.received[dstDevice] = self.received[dstDevice] + src:nElement()
+end
+
+function MockComm:add(device, dst, src)
+   self:check(device, dst)
+   self:check(device, src)
+   dst:add(src)
+end
+
+function test.DataParallelTable_collectives()
+   local collectives = nn.DataParallelTable.collectives
+   for _, nDevices in ipairs{1, 2, 3, 4, 5, 8} do
+      for _, size in ipairs{1, 7, 1000, collectives.treeThreshold + 13} do
+         local devices = {}
+         for i = 1, nDevices do devices[i] = nDevices - i + 1 end
+         local grads = {}
+         for i = 1, nDevices do grads[i] = torch.randn(size) end
+
+         local function run(op, mode, inputs)
+            local tensors = {}
+            for i, t in ipairs(inputs) do tensors[i] = t:clone() end
+            local comm = MockComm.new(tensors, devices)
+            collectives[op](comm, mode, tensors, devices)
+            return tensors, comm
+         end
+
+         local expected, star = run('reduce', 'star', grads)
+         for _, mode in ipairs{'ring', 'tree', 'auto'} do
+            local reduced, comm = run('reduce', mode, grads)
+            local err = (reduced[1] - expected[1]):abs():max()
+            mytester:assertlt(err, precision, mode .. ' reduce differs from star')
+
+            local copies = run('broadcast', mode, grads)
+            for i = 2, nDevices do
+               mytester:assertTensorEq(copies[i], grads[1], 0, mode .. ' broadcast')
+            end
+
+            if mode == 'ring' and size >= nDevices then
+               -- no device receives more than two shares of the tensor
+               local bound = 2 * (nDevices - 1) * math.ceil(size / nDevices)
+               for _, n in pairs(comm.received) do
+                  mytester:assertle(n, bound, 'ring moved too much through one device')
+               end
+               mytester:assertle(comm.received[devices[1]], star.received[devices[1]],
+                                 'ring moved more through the root than star')
+            end
+         end
+      end
+   end
+end
+
+-- gpuAssignments may name a device more than once
+function test.DataParallelTable_collectivesRepeatedDevices()
+   local collectives = nn.DataParallelTable.collectives
+   for _, devices in ipairs{{1, 1}, {1, 2, 1, 2}, {2, 1, 1}, {1, 1, 1, 2, 2}} do
+      for _, size in ipairs{7, 1000} do
+         local grads = {}
+         for i = 1, #devices do grads[i] = torch.randn(size) end
+         local expected = grads[1]:clone()
+         for i = 2, #devices do expected:add(grads[i]) end
+
+         for _, mode in ipairs{'star', 'ring', 'tree'} do
+            local tensors = {}
+            for i, t in ipairs(grads) do tensors[i] = t:clone() end
+            collectives.reduce(MockComm.new(tensors, devices), mode, tensors, devices)
+            local err = (tensors[1] - expected):abs():max()
+            mytester:assertlt(err, precision, mode .. ' reduce with devices {' ..
+                              table.concat(devices, ',') .. '}')
+
+            for i, t in ipairs(grads) do tensors[i] = t:clone() end
+            collectives.broadcast(MockComm.new(tensors, devices), mode, tensors, devices)
+            for i = 2, #devices do
+               mytester:assertTensorEq(tensors[i], grads[1], 0, mode .. ' broadcast with devices {' ..
+                                       table.concat(devices, ',') .. '}')
+            end
+         end
+      end
+   end
+end
+
+function test.DataParallelTable_reduction()
+   local net = nn.Sequential()
+      :add(nn.Linear(10, 1000))
+      :add(nn.Tanh())
+      :add(nn.Linear(1000, 100))
+      :cuda()
+   local input = torch.CudaTensor(2 * numGpus, 10):uniform(-1, 1)
+   local gradOutput = torch.CudaTensor(2 * numGpus, 100):uniform(-1, 1)
+
+   local function gradients(reduction, flatten)
+      local dpt = nn.DataParallelTable(1, flatten, false, reduction)
+      for i = 1, numGpus do
+         cutorch.withDevice(i, function()
+            dpt:add(net:clone(), i)
+         end)
+      end
+      if flatten then dpt:getParameters() end
+      dpt:zeroGradParameters()
+      dpt:forward(input)
+      dpt:backward(input, gradOutput)
+      local _, gradParams = dpt:get(1):parameters()
+      return gradParams, dpt
+   end
+
+   for _, flatten in ipairs{false, true} do
+      local expected = gradients('star', flatten)
+      for _, reduction in ipairs{'ring', 'tree', 'auto'} do
+         local gradParams, dpt = gradients(reduction, flatten)
+         for i = 1, #expected do
+            local err = (gradParams[i] - expected[i]):abs():max()
+            mytester:assertlt(err, precision, reduction .. ' gradients differ from star')
+         end
+
+         -- broadcast the first replica's parameters
+         local params = dpt:moduleParameters()
+         for _, p in ipairs(params[1][1]) do p:uniform(-1, 1) end
+         dpt:syncParameters()
+         for i = 2, numGpus do
+            for j, p in ipairs(params[i][1]) do
+               local err = (p:float() - params[1][1][j]:float()):abs():max()
+               mytester:assertlt(err, precision, reduction .. ' broadcast')
+            end
+         end
+      end
+   end
+
+   local ok = pcall(function() nn.DataParallelTable(1, false, false, 'mesh') end)
+   mytester:assert(not ok, 'unknown reductions should be rejected')
+end
+
+function test.DataParallelTable_bucketReduction()
+   local net = nn.Sequential()
+      :add(nn.Linear(10, 200))
+      :add(nn.ReLU())
+      :add(nn.Sequential()
+         :add(nn.Linear(200, 100))
+         :add(nn.Tanh()))
+      :add(nn.Linear(100, 7))
+      :cuda()
+   local input = torch.CudaTensor(2 * numGpus, 10):uniform(-1, 1)
+   local gradOutput = torch.CudaTensor(2 * numGpus, 7):uniform(-1, 1)
+
+   local function run(bucketSize, threads, reduction)
+      local dpt = nn.DataParallelTable(1, true, false, reduction)
+         :add(net:clone(), torch.range(1, numGpus):totable())
+      if threads then dpt:threads() end
+      if bucketSize then dpt:bucketReduction(bucketSize, true) end
+      local _, gradParams = dpt:getParameters()
+      dpt:zeroGradParameters()
+      dpt:forward(input)
+      local gradInput = dpt:backward(input, gradOutput):clone()
+      return gradParams:clone(), gradInput, dpt
+   end
+
+   local expectedGrads, expectedGradInput = run()
+   for _, bucketSize in ipairs{1, 4096, 1e9} do
+      for _, threads in ipairs{false, true} do
+         for _, reduction in ipairs{'star', 'ring'} do
+            local gradParams, gradInput, dpt = run(bucketSize, threads, reduction)
+            mytester:assertlt((gradParams - expectedGrads):abs():max(), precision,
+                              'bucketed gradients differ')
+            mytester:assertlt((gradInput - expectedGradInput):abs():max(), precision,
+                              'bucketed gradInput differs')
+
+            -- the buckets cover the parameters exactly once
+            local timings, numel = dpt:bucketTimings(), 0
+            for _, t in ipairs(timings) do
+               numel = numel + t.numel
+               mytester:assert(t.ms >= 0 and t.bytes == 4 * t.numel, 'bad bucket timing')
+            end
+            mytester:asserteq(numel, gradParams:nElement(), 'buckets do not cover the gradients')
+            if bucketSize == 1 then
+               mytester:asserteq(#timings, 6, 'expected one bucket per parameter')
+            elseif bucketSize == 1e9 then
+               mytester:asserteq(#timings, 1, 'expected a single bucket')
+            end
+         end
+      end
+   end
+end
+
+function test.DataParallelTable_splitWeights()
+   local net = nn.Sequential()
+      :add(nn.Linear(10, 20))
+      :add(nn.Tanh())
+      :add(nn.Linear(20, 5))
+      :cuda()
+   local batch = 10 * numGpus + 3
+   local input = torch.CudaTensor(batch, 10):uniform(-1, 1)
+   local gradOutput = torch.CudaTensor(batch, 5):uniform(-1, 1)
+   net:zeroGradParameters()
+   local expectedOutput = net:forward(input):clone()
+   local expectedGradInput = net:backward(input, gradOutput):clone()
+   local _, expectedGrads = net:getParameters()
+
+   local weights = {}
+   for i = 1, numGpus do weights[i] = i end
+
+   for _, threads in ipairs{false, true} do
+      local dpt = nn.DataParallelTable(1, true)
+         :add(net:clone(), torch.range(1, numGpus):totable())
+         :setSplitWeights(weights)
+      if threads then dpt:threads() end
+      local _, gradParams = dpt:getParameters()
+
+      for step = 1, 3 do
+         dpt:zeroGradParameters()
+         local output = dpt:forward(input)
+         local gradInput = dpt:backward(input, gradOutput)
+         mytester:assertlt((output - expectedOutput):abs():max(), precision,
+                           'weighted split: wrong output')
+         mytester:assertlt((gradInput - expectedGradInput):abs():max(), precision,
+                           'weighted split: wrong gradInput')
+         mytester:assertlt((gradParams - expectedGrads):abs():max(), precision,
+                           'weighted split: wrong gradients')
+
+         local total, rows = numGpus * (numGpus + 1) / 2, 0
+         for i = 1, numGpus do
+            local size = dpt.inputGpu[i]:size(1)
+            if step == 1 then
+               -- each replica gets a share of the batch in proportion to its weight
+               mytester:assertle(math.abs(size - batch * i / total), 1, 'split not weighted')
+            end
+            rows = rows + size
+         end
+         mytester:asserteq(rows, batch, 'split does not cover the batch')
+
+         if step == 1 then
+            -- learn the weights from then on, timing every step
+            dpt:autoBalance(4, 1)
+         end
+      end
+
+      local learned = dpt.splitWeights
+      mytester:asserteq(#learned, numGpus, 'expected one learned weight per replica')
+      for i = 1, numGpus do
+         mytester:assertgt(learned[i], 0, 'learned weights must be positive')
+      end
+      dpt:setSplitWeights(nil):autoBalance(false)
+      dpt:forward(input)
+      for i = 1, numGpus do
+         mytester:assertle(math.abs(dpt.inputGpu[i]:size(1) - batch / numGpus), 1,
+                           'even split not restored')
+      end
+   end
+end
+
 function test.ProfileDataParallelTable()
    local width = 32
    local height = 32